@@ -0,0 +1,639 @@
+#include "../Engine/Camera.h"
+#include "../Engine/CPURenderer.h"
+#include "../Engine/CPUScene.h"
+#include "../Engine/Math3D.h"
+#include "../Engine/ShaderPreprocessor.h"
+#include "../Engine/ShaderUtil.h"
+#include "../Engine/Util.h"
+#include "../Engine/VariableBuffer.h"
+#include "../Engine/VariableTokenizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// microbenchmarks of the engine parts which run every frame or every reload
+// usage: Benchmark [options] [names...]
+//  runs the given benchmarks, default all of them
+//  variables   uploading the user variables each frame, with 16 to 1024 of them
+//  tokenizer   finding and parsing the VAR_ tags of the scenes and of a 1 mb shader
+//  preprocessor  the pixel shader of each scene, from scratch, unchanged and with an edited scene
+//  reload      builds the pixel shader of each scene a few times, with d3d, and the time of each phase
+//  math        matrix multiply, transpose, inverse and point transforms, scalar against sse / neon
+//  gradient    map calls per pixel of each cpu scene, normals from differences against duals
+// options:
+//  --shaders <folder>   the shader folder, default ../Engine/shader
+//  --reloads <count>    how often reload builds each scene, default 10
+namespace
+{
+	// keeps the compiler from removing the measured work
+	volatile float sink;
+
+	std::filesystem::path shader_folder = "../Engine/shader";
+	unsigned reload_count = 10;
+
+	// the time of one call of f in nanoseconds, the best of a few runs
+	template<class F>
+	double measure(unsigned iterations, F &&f)
+	{
+		double best = 0.0;
+		for (unsigned run = 0; run < 5; ++run)
+		{
+			auto start_time = std::chrono::steady_clock::now();
+			for (unsigned i = 0; i < iterations; ++i)
+			{
+				f(i);
+			}
+			double time = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_time).count() / iterations;
+			best = run ? std::min(best, time) : time;
+		}
+		return best;
+	}
+
+	// the upload once walked the map every frame, now only a moved slider costs anything
+	void benchmarkVariables()
+	{
+		std::printf("%10s %14s %14s %14s\n", "variables", "map walk ns", "idle ns", "one slider ns");
+		for (unsigned count : { 16u, 64u, 256u, 1024u })
+		{
+			VariableMap variables;
+			for (unsigned i = 0; i < count; ++i)
+			{
+				char name[16];
+				std::snprintf(name, sizeof(name), "var%04u", i);
+				variables[name] = { 0.f, 1.f, 0.5f, 0.01f, 0.5f };
+			}
+			VariableBuffer values;
+			values.layout(variables);
+			// stands in for the mapped constant buffer
+			std::vector<float> mapped(values.getByteSize() / sizeof(float));
+
+			double map_walk = measure(10000, [&](unsigned)
+			{
+				float *ptr = mapped.data();
+				for (const auto &[name, var] : variables)
+				{
+					*ptr++ = var.value;
+				}
+				sink = mapped.back();
+			});
+
+			values.upload(mapped.data());
+			double idle = measure(10000, [&](unsigned)
+			{
+				if (values.isDirty())
+				{
+					values.upload(mapped.data());
+				}
+				sink = mapped.back();
+			});
+
+			unsigned slot = variables.begin()->second.slot;
+			double one_slider = measure(10000, [&](unsigned frame)
+			{
+				values.set(slot, (frame & 1) ? 0.25f : 0.75f);
+				if (values.isDirty())
+				{
+					values.upload(mapped.data());
+				}
+				sink = mapped.back();
+			});
+
+			std::printf("%10u %14.1f %14.1f %14.1f\n", count, map_walk, idle, one_slider);
+		}
+	}
+
+	// how the tags were parsed before the tokenizer: split the code, then each parameter list,
+	// with a map of the parameters and a string for every number
+	bool parseVariableOld(std::string_view params, Variable &var)
+	{
+		std::map<std::string, float, std::less<>> param_map;
+		while (!params.empty())
+		{
+			auto comma = params.find(',');
+			auto param = params.substr(0, comma);
+			params = comma != std::string_view::npos ? params.substr(comma + 1) : std::string_view();
+
+			auto equal = param.find('=');
+			if (equal == std::string_view::npos)
+			{
+				if (removeSpaces(param).empty())
+				{
+					continue;
+				}
+				return false;
+			}
+
+			std::string value_str(removeSpaces(param.substr(equal + 1)));
+			char *end;
+			float value = std::strtof(value_str.c_str(), &end);
+			if (value_str.empty() || *end != '\0')
+			{
+				return false;
+			}
+			param_map[std::string(removeSpaces(param.substr(0, equal)))] = value;
+		}
+
+		auto iter = param_map.find("min");
+		var.minval = iter != param_map.end() ? iter->second : 0.f;
+		iter = param_map.find("max");
+		var.maxval = iter != param_map.end() ? iter->second : 2.f;
+		iter = param_map.find("start");
+		var.start = iter != param_map.end() ? iter->second : (var.maxval + var.minval) * 0.5f;
+		iter = param_map.find("step");
+		var.step = iter != param_map.end() ? iter->second : (var.maxval - var.minval) * 0.05f;
+		var.value = var.start;
+		return true;
+	}
+
+	unsigned parseOld(std::string_view code)
+	{
+		unsigned count = 0;
+		auto [code_blocks, variable_blocks] = splitString(code, "VAR_", ")");
+		for (auto &block : variable_blocks)
+		{
+			auto bracket = block.find('(');
+			Variable var;
+			if (bracket != std::string_view::npos && parseVariableOld(block.substr(bracket + 1, block.size() - bracket - 2), var))
+			{
+				sink = var.value;
+				++count;
+			}
+		}
+		return count;
+	}
+
+	unsigned parseNew(std::string_view code)
+	{
+		unsigned count = 0;
+		VariableTokenizer tokenizer(code);
+		VariableTokenizer::Tag tag;
+		Variable var;
+		while (tokenizer.next(tag))
+		{
+			if (tokenizer.parse(tag, var))
+			{
+				sink = var.value;
+				++count;
+			}
+		}
+		return count;
+	}
+
+	// a scene like shader with a tag every few lines
+	std::string makeSyntheticShader(size_t size)
+	{
+		std::string code;
+		for (unsigned i = 0; code.size() < size; ++i)
+		{
+			code += "float d" + std::to_string(i) + " = sdBox(p - float3(1.0, 2.0, 3.0), float3(0.5, 0.5, 0.5)); // the box\n";
+			code += "float s" + std::to_string(i) + " = VAR_size" + std::to_string(i % 200) + "(min = -1.5, max = +2.5, start = 0.25, step = 0.01) * d" + std::to_string(i) + ";\n";
+		}
+		return code;
+	}
+
+	void benchmarkTokenizer()
+	{
+		std::vector<std::pair<std::string, std::string>> inputs;
+		std::error_code ec;
+		for (auto &item : std::filesystem::directory_iterator(shader_folder / "scenes", ec))
+		{
+			if (item.path().extension() == ".hlsl")
+			{
+				std::ifstream file(item.path(), std::ios::binary);
+				inputs.emplace_back(item.path().filename().string(), readFromFile(file));
+			}
+		}
+		std::sort(inputs.begin(), inputs.end());
+		if (inputs.empty())
+		{
+			std::cout << "no scenes in " << (shader_folder / "scenes").string() << ", use --shaders\n";
+		}
+		inputs.emplace_back("synthetic 1 mb", makeSyntheticShader(1 << 20));
+
+		std::printf("%-40s %10s %6s %12s %12s\n", "file", "bytes", "tags", "old mb/s", "new mb/s");
+		for (auto &[name, code] : inputs)
+		{
+			// enough runs for about 10 mb
+			unsigned iterations = static_cast<unsigned>(std::max<size_t>(10'000'000 / std::max<size_t>(code.size(), 1), 1));
+			unsigned old_count = parseOld(code), new_count = parseNew(code);
+			double old_time = measure(iterations, [&](unsigned) { parseOld(code); });
+			double new_time = measure(iterations, [&](unsigned) { parseNew(code); });
+			// bytes per ns is gb/s, so * 1000 for mb/s
+			std::printf("%-40s %10zu %6u %12.1f %12.1f%s\n", name.c_str(), code.size(), new_count, code.size() / old_time * 1000.0, code.size() / new_time * 1000.0,
+				old_count != new_count ? " (the old parser found another count)" : "");
+		}
+	}
+
+	void benchmarkPreprocessor()
+	{
+		// the files are read once, so only the preprocessor is measured
+		std::map<std::string, std::string> files;
+		std::error_code ec;
+		for (auto &item : std::filesystem::recursive_directory_iterator(shader_folder, ec))
+		{
+			if (item.path().extension() == ".hlsl")
+			{
+				std::ifstream file(item.path(), std::ios::binary);
+				files[item.path().lexically_relative(shader_folder).generic_string()] = readFromFile(file);
+			}
+		}
+		files["user_variables.hlsl"] = "";
+		if (!files.count("pshader_sdf.hlsl"))
+		{
+			std::cout << "no shaders in " << shader_folder.string() << ", use --shaders\n";
+			return;
+		}
+
+		// like the includer, the scene stands in for sdf_scene.hlsl
+		std::string scene;
+		ShaderPreprocessor preprocessor([&](const std::string &filename, std::string &code)
+		{
+			auto iter = files.find(filename == "sdf_scene.hlsl" ? scene : filename);
+			if (iter == files.end())
+				return false;
+			code = iter->second;
+			return true;
+		});
+
+		std::printf("%-40s %10s %12s %12s %12s\n", "scene", "bytes", "cold us", "unchanged us", "edited us");
+		std::string output;
+		for (auto &[name, code] : files)
+		{
+			if (!name.starts_with("scenes/"))
+			{
+				continue;
+			}
+			scene = name;
+			if (!preprocessor.preprocessFile("pshader_sdf.hlsl", {}, output))
+			{
+				std::cout << preprocessor.getError() << "\n";
+				continue;
+			}
+			size_t size = output.size();
+
+			double cold = measure(20, [&](unsigned)
+			{
+				preprocessor.clear();
+				preprocessor.preprocessFile("pshader_sdf.hlsl", {}, output);
+			});
+			double unchanged = measure(20, [&](unsigned)
+			{
+				preprocessor.preprocessFile("pshader_sdf.hlsl", {}, output);
+			});
+			// a saved scene, the other files stay as they were
+			std::string original = code;
+			double edited = measure(20, [&](unsigned i)
+			{
+				files[name] = original + "// edit " + std::to_string(i) + "\n";
+				preprocessor.preprocessFile("pshader_sdf.hlsl", {}, output);
+			});
+			files[name] = original;
+			std::printf("%-40s %10zu %12.1f %12.1f %12.1f\n", name.c_str(), size, cold / 1000.0, unchanged / 1000.0, edited / 1000.0);
+		}
+	}
+
+	// the value below which a fraction p of the values are, by the nearest rank
+	double percentile(std::vector<double> values, double p)
+	{
+		if (values.empty())
+		{
+			return 0.0;
+		}
+		std::sort(values.begin(), values.end());
+		size_t rank = static_cast<size_t>(std::ceil(p * values.size()));
+		return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+	}
+
+	// what a reload of the scene does, without the window. nothing is kept in memory but the
+	// files, so every reload compiles. the first one also reads the files from disk
+	void benchmarkReload()
+	{
+		std::vector<std::string> scenes;
+		std::error_code ec;
+		for (auto &item : std::filesystem::directory_iterator(shader_folder / "scenes", ec))
+		{
+			if (item.path().extension() == ".hlsl")
+			{
+				scenes.push_back("scenes/" + item.path().filename().string());
+			}
+		}
+		std::sort(scenes.begin(), scenes.end());
+		if (scenes.empty())
+		{
+			std::cout << "no scenes in " << (shader_folder / "scenes").string() << ", use --shaders\n";
+			return;
+		}
+
+		const ShaderTimings::Phase phases[] = { ShaderTimings::Phase::Scan, ShaderTimings::Phase::Preprocess, ShaderTimings::Phase::Compile };
+		std::printf("%u reloads, times in ms\n", reload_count);
+		std::printf("%-40s %10s %10s %10s %10s %10s %10s %10s %10s\n", "scene", "total p50", "total p95",
+			"scan p50", "scan p95", "prep p50", "prep p95", "comp p50", "comp p95");
+		for (auto &scene : scenes)
+		{
+			ShaderIncluder includer;
+			includer.setFolder(shader_folder.string());
+			includer.setSubstitutions({ { "sdf_scene.hlsl", scene } });
+			std::string errors;
+			includer.setMessageHandler([&](const std::string &message, bool error)
+			{
+				if (error)
+					errors += message;
+			});
+
+			std::vector<double> totals;
+			std::vector<std::vector<double>> phase_times(std::size(phases));
+			for (unsigned reload = 0; reload < reload_count && errors.empty(); ++reload)
+			{
+				includer.clearPermutations();
+				ShaderVariableManager var_manager;
+				var_manager.setSlot(1);
+
+				auto start_time = std::chrono::steady_clock::now();
+				ShaderBuild build(includer);
+				includer.setShaderVariableManager(&var_manager);
+				includer.setFeaturePrefix("MATERIAL_");
+				unsigned job = build.add("pshader_sdf.hlsl", "ps_5_0", "ps_main");
+				includer.setFeaturePrefix({});
+				includer.setShaderVariableManager(nullptr);
+				build.run();
+				build.finish(job, false);
+				totals.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count());
+
+				for (size_t phase = 0; phase < std::size(phases); ++phase)
+				{
+					phase_times[phase].push_back(build.getTimings().getTotal(phases[phase]) * 1000.0);
+				}
+			}
+			if (!errors.empty())
+			{
+				std::printf("%-40s failed: %s\n", scene.c_str(), errors.substr(0, errors.find('\n')).c_str());
+				continue;
+			}
+
+			std::printf("%-40s %10.2f %10.2f", scene.c_str(), percentile(totals, 0.5), percentile(totals, 0.95));
+			for (auto &times : phase_times)
+			{
+				std::printf(" %10.2f %10.2f", percentile(times, 0.5), percentile(times, 0.95));
+			}
+			std::printf("\n");
+		}
+	}
+
+	// how Math3D did it before the rows went into sse / neon registers
+	Math3D::Matrix4x4 multiplyOld(const Math3D::Matrix4x4 &a, const Math3D::Matrix4x4 &b)
+	{
+		Math3D::Matrix4x4 ret = Math3D::Matrix4x4::NullMatrix();
+		for (unsigned i = 0; i < 4; ++i)
+			for (unsigned j = 0; j < 4; ++j)
+				for (unsigned k = 0; k < 4; ++k)
+					ret[i][j] += a[i][k] * b[k][j];
+		return ret;
+	}
+
+	Math3D::Matrix4x4 transposeOld(const Math3D::Matrix4x4 &a)
+	{
+		return Math3D::Matrix4x4(a.f11, a.f21, a.f31, a.f41, a.f12, a.f22, a.f32, a.f42, a.f13, a.f23, a.f33, a.f43, a.f14, a.f24, a.f34, a.f44);
+	}
+
+	// there was no inverse, this is the same gauss-jordan one float at a time
+	bool invertOld(Math3D::Matrix4x4 &mat)
+	{
+		Math3D::Matrix4x4 a = mat, inv = Math3D::Matrix4x4::IdentityMatrix();
+		for (unsigned c = 0; c < 4; ++c)
+		{
+			unsigned pivot = c;
+			for (unsigned r = c + 1; r < 4; ++r)
+			{
+				if (std::fabs(a[r][c]) > std::fabs(a[pivot][c]))
+					pivot = r;
+			}
+			if (a[pivot][c] == 0.f)
+				return false;
+			for (unsigned k = 0; k < 4; ++k)
+			{
+				std::swap(a[pivot][k], a[c][k]);
+				std::swap(inv[pivot][k], inv[c][k]);
+			}
+			float scale = 1.f / a[c][c];
+			for (unsigned k = 0; k < 4; ++k)
+			{
+				a[c][k] *= scale;
+				inv[c][k] *= scale;
+			}
+			for (unsigned r = 0; r < 4; ++r)
+			{
+				if (r == c)
+					continue;
+				float factor = a[r][c];
+				for (unsigned k = 0; k < 4; ++k)
+				{
+					a[r][k] -= factor * a[c][k];
+					inv[r][k] -= factor * inv[c][k];
+				}
+			}
+		}
+		mat = inv;
+		return true;
+	}
+
+	// the loop of the temporal reprojection
+	void transformPointsOld(const Math3D::Matrix4x4 &mat, const Math3D::Vector3 *points, Math3D::Vector4 *transformed, size_t count)
+	{
+		for (size_t p = 0; p < count; ++p)
+		{
+			for (unsigned i = 0; i < 4; ++i)
+			{
+				transformed[p][i] = points[p].x * mat[0][i] + points[p].y * mat[1][i] + points[p].z * mat[2][i] + mat[3][i];
+			}
+		}
+	}
+
+	void benchmarkMath()
+	{
+		using namespace Math3D;
+		Matrix4x4 view = Matrix4x4::CameraMatrix(Vector3(1.f, 2.f, -3.f), Vector3(0.f, 1.f, 0.f));
+		Matrix4x4 projection = Matrix4x4::ProjectionMatrix(ToRadian(60.f), 16.f / 9.f, 1.f, 300.f);
+		std::printf("%-20s %10s %10s %8s\n", "operation", "old ns", "new ns", "speedup");
+		auto print = [](const char *name, double old_time, double new_time)
+		{
+			std::printf("%-20s %10.2f %10.2f %7.2fx\n", name, old_time, new_time, old_time / new_time);
+		};
+
+		// the input changes each call and the whole result is kept, so nothing can be hoisted or left out
+		std::vector<Matrix4x4> results(256);
+		double multiply_old = measure(1000000, [&](unsigned i)
+		{
+			view.f41 = static_cast<float>(i & 255);
+			results[i & 255] = multiplyOld(view, projection);
+		});
+		double multiply_new = measure(1000000, [&](unsigned i)
+		{
+			view.f41 = static_cast<float>(i & 255);
+			results[i & 255] = view * projection;
+		});
+		print("multiply", multiply_old, multiply_new);
+
+		double transpose_old = measure(1000000, [&](unsigned i)
+		{
+			view.f41 = static_cast<float>(i & 255);
+			results[i & 255] = transposeOld(view);
+		});
+		double transpose_new = measure(1000000, [&](unsigned i)
+		{
+			view.f41 = static_cast<float>(i & 255);
+			results[i & 255] = view.Transposed();
+		});
+		print("transpose", transpose_old, transpose_new);
+
+		Matrix4x4 full = view * projection;
+		double inverse_old = measure(1000000, [&](unsigned i)
+		{
+			Matrix4x4 mat = full;
+			mat.f41 = static_cast<float>(i & 255);
+			invertOld(mat);
+			results[i & 255] = mat;
+		});
+		double inverse_new = measure(1000000, [&](unsigned i)
+		{
+			Matrix4x4 mat = full;
+			mat.f41 = static_cast<float>(i & 255);
+			mat.Invert();
+			results[i & 255] = mat;
+		});
+		print("inverse", inverse_old, inverse_new);
+		sink = results[7].f43;
+
+		// per point, a frame of temporal hits is about this many
+		std::vector<Vector3> points(65536);
+		for (size_t i = 0; i < points.size(); ++i)
+		{
+			points[i] = Vector3(static_cast<float>(i % 256), static_cast<float>(i / 256), static_cast<float>(i % 17));
+		}
+		std::vector<Vector4> transformed(points.size());
+		double transform_old = measure(100, [&](unsigned)
+		{
+			transformPointsOld(full, points.data(), transformed.data(), points.size());
+			sink = transformed.back().w;
+		}) / points.size();
+		double transform_new = measure(100, [&](unsigned)
+		{
+			full.TransformPoints(points.data(), transformed.data(), points.size());
+			sink = transformed.back().w;
+		}) / points.size();
+		print("transform points", transform_old, transform_new);
+	}
+
+	// the normals took three map calls more per shaded point, with duals the scenes which have a port need one
+	void benchmarkGradient()
+	{
+		const unsigned width = 320, height = 180;
+		std::printf("%-24s %-6s %12s %10s\n", "scene", "normal", "calls/pixel", "ms");
+		for (auto name : getCPUSceneNames())
+		{
+			auto scene = createCPUScene(name);
+			scene->setParameters(0.f);
+
+			// the start view of the application
+			Camera camera;
+			camera.SetCameraMode(Camera::CameraMode::FPS);
+			camera.SetAspect(static_cast<float>(width) / height);
+			camera.SetFOVY(Math3D::ToRadian(60.f));
+			camera.SetNearPlane(1.f);
+			camera.SetFarPlane(300.f);
+			camera.SetRoll(0.f);
+			camera.SetEye(Math3D::Vector3(0.f, 2.f, -3.f));
+			camera.SetLookat(Math3D::Vector3(0.f, 1.f, 0.f));
+
+			for (bool dual_gradient : { false, true })
+			{
+				CPURenderer renderer;
+				renderer.setScene(scene.get());
+				renderer.setDualGradient(dual_gradient);
+				double best = 0.0;
+				for (unsigned run = 0; run < 3; ++run)
+				{
+					renderer.render(camera, width, height);
+					double time = renderer.getStats().render_time;
+					best = run ? std::min(best, time) : time;
+				}
+				double calls = static_cast<double>(renderer.getStats().map_calls) / (width * height);
+				std::printf("%-24.*s %-6s %12.2f %10.2f\n", static_cast<int>(name.size()), name.data(), dual_gradient ? "dual" : "diff", calls, best * 1000.0);
+			}
+		}
+	}
+
+	struct Benchmark
+	{
+		std::string_view name;
+		void (*run)();
+	};
+
+	const Benchmark benchmarks[] =
+	{
+		{ "variables", benchmarkVariables },
+		{ "tokenizer", benchmarkTokenizer },
+		{ "preprocessor", benchmarkPreprocessor },
+		{ "reload", benchmarkReload },
+		{ "math", benchmarkMath },
+		{ "gradient", benchmarkGradient },
+	};
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<std::string_view> names;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string_view arg = argv[i];
+		if (arg == "--shaders")
+		{
+			if (i + 1 >= argc)
+			{
+				std::cerr << "missing value for " << arg << "\n";
+				return -1;
+			}
+			shader_folder = argv[++i];
+		}
+		else if (arg == "--reloads")
+		{
+			if (i + 1 >= argc)
+			{
+				std::cerr << "missing value for " << arg << "\n";
+				return -1;
+			}
+			reload_count = std::max(std::atoi(argv[++i]), 1);
+		}
+		else
+		{
+			names.push_back(arg);
+		}
+	}
+	for (auto &name : names)
+	{
+		if (std::none_of(std::begin(benchmarks), std::end(benchmarks), [&](auto &benchmark) { return benchmark.name == name; }))
+		{
+			std::cerr << "unknown benchmark " << name << "\n";
+			return -1;
+		}
+	}
+
+	for (auto &benchmark : benchmarks)
+	{
+		if (names.empty() || std::find(names.begin(), names.end(), benchmark.name) != names.end())
+		{
+			std::cout << "== " << benchmark.name << "\n";
+			benchmark.run();
+		}
+	}
+	return 0;
+}
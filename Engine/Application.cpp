@@ -11,6 +11,18 @@ using namespace Math3D;
 
 #define PROFILE_OUTPUT
 
+// all shader files are relative to this
+static const char *shader_folder = "shader";
+// the compiled shaders of previous runs
+static const char *shader_cache_folder = "shader_cache";
+// the timings of the last shader build, written with ctrl+t
+static const char *shader_timings_filename = "shader_timings.json";
+// the profiler events since the last trace, and the frame statistics, written with ctrl+e
+static const char *profile_trace_filename = "profile_trace.json";
+static const char *frame_stats_filename = "frame_stats.csv";
+// how often the frame statistics go to the debug output, in seconds
+static const double frame_stats_interval = 5.0;
+
 bool Application::Init(HINSTANCE hInstance)
 {
 	WNDCLASS wc = { 0 };
@@ -87,6 +99,7 @@ void Application::Run()
 		lasttime = newtime;
 
 		updateSimulation(static_cast<float>(diff) / 1000.f);
+		updateShader();
 		if (!single_frame_mode || do_single_renderer)
 		{
 			do_single_renderer = false;
@@ -144,6 +157,56 @@ LRESULT CALLBACK Application::WndProc(HWND hWnd, UINT Msg, WPARAM wParam, LPARAM
 			case 'U': // reset timer
 				stime = 0.f;
 				break;
+			case 'B': // bake the current variable values into the shader, or go back to sliders
+				sdf_renderer.setInitialValues(getVariableValues(sdf_renderer.getVariableMap()));
+				sdf_renderer.setBaked(!sdf_renderer.isBaked());
+				initShader();
+				break;
+			case 'D': // debug plane, it is only compiled in while turned on
+				sdf_renderer.setInitialValues(getVariableValues(sdf_renderer.getVariableMap()));
+				sdf_renderer.setDebugPlane(!sdf_renderer.hasDebugPlane());
+				initShader();
+				break;
+			case 'C': // the compiler's preprocessor or the built-in one, to compare them
+				includer.setBuiltinPreprocessor(!includer.usesBuiltinPreprocessor());
+				includer.clearPermutations();
+				initShader();
+				break;
+			case 'T': // write the timings of the last build, for a closer look
+				if (std::ofstream file(shader_timings_filename); file && file << shader_timings)
+				{
+					scene_manager.setStatus(Format() << "wrote " << shader_timings_filename);
+				}
+				else
+				{
+					ErrorBox(Format() << "Could not write \"" << shader_timings_filename << "\"");
+				}
+				break;
+			case 'E': // write what the profiler saw since the last time, for chrome://tracing, and the frame statistics
+				if (std::ofstream file(profile_trace_filename); !file || !(file << Profiler::toChromeTrace(frame_profiler.capture())))
+				{
+					ErrorBox(Format() << "Could not write \"" << profile_trace_filename << "\"");
+				}
+				else if (std::ofstream stats_file(frame_stats_filename); !stats_file || !(stats_file << frame_stats.toCsv()))
+				{
+					ErrorBox(Format() << "Could not write \"" << frame_stats_filename << "\"");
+				}
+				else
+				{
+					scene_manager.setStatus(Format() << "wrote " << profile_trace_filename << " and " << frame_stats_filename);
+				}
+				break;
+			case 'F': // freeze the current variable values as the preset of the scene
+				{
+					auto values = getVariableValues(sdf_renderer.getVariableMap());
+					auto preset_filename = std::filesystem::path(shader_folder) / getPresetFilename(scene_filename);
+					if (!savePreset(preset_filename, values))
+					{
+						ErrorBox(Format() << "Could not write preset \"" << preset_filename.string() << "\"");
+					}
+					sdf_renderer.setInitialValues(std::move(values));
+				}
+				break;
 			}
 		}
 		else
@@ -179,17 +242,27 @@ bool Application::initGraphics()
 		return false;
 
 	profiler.setGPU(graphics.GetDevice(), graphics.GetContext());
+	profiler.setProfiler(&frame_profiler);
+	frame_profiler.setThreadName("main");
+	frame_stats.setReportInterval(frame_stats_interval);
 
 	RECT rect;
 	GetClientRect(hWnd, &rect);
 	float width = static_cast<float>(rect.right - rect.left);
 	float height = static_cast<float>(rect.bottom - rect.top);
 
-	includer.setFolder("shader");
+	includer.setFolder(shader_folder);
+	// keeps the included files expanded between reloads, Ctrl+C goes back to D3DPreprocess
+	includer.setBuiltinPreprocessor(true);
+	// without the cache everything still works, just compiles every time
+	if (shader_cache.open(shader_cache_folder))
+	{
+		includer.setBlobCache(&shader_cache);
+	}
 
 	scene_manager.setClient(this);
 	scene_manager.InitClass(hInstance);
-	scene_manager.setShaderFolder("shader");
+	scene_manager.setShaderFolder(shader_folder);
 	scene_manager.setSceneFolder("scenes");
 	scene_manager.Open();
 
@@ -226,43 +299,125 @@ bool Application::initGraphics()
 	stime = 0.f;
 
 	// default scene
-	includer.setSubstitutions({ {"sdf_scene.hlsl", "scenes/sdf_scene_fast_sphere.hlsl"} });
-	initShader();
+	loadScene("scenes/sdf_scene_fast_sphere.hlsl");
 
 	return true;
 }
 
 void Application::initShader()
 {
-	variable_manager.resetVariables();
+	// start again once the running build is done
+	if (shader_job.valid())
+	{
+		shader_pending = true;
+		return;
+	}
+	shader_pending = false;
+
+	includer.setSubstitutions({ {"sdf_scene.hlsl", scene_filename.string()} });
+	includer.resetCacheStats();
+	includer.clearIncludeGraph();
+	shader_cache.resetStats();
+
+	// the files are read here, only the compiles run in the background, in parallel
+	shader_build = std::make_unique<ShaderBuild>(includer);
+	shader_build->setProfiler(&frame_profiler);
+	fullscreen_quad.addShaders(*shader_build);
+	hdr.addShaders(*shader_build);
+	sdf_renderer.addShaders(*shader_build);
+	shader_job = std::async(std::launch::async, [build = shader_build.get()]()
+	{
+		build->run();
+	});
+	scene_manager.setStatus("building " + scene_filename.string());
+}
 
-	fullscreen_quad.initShader(includer);
-	if (sdf_renderer.initShader(includer))
+void Application::updateShader()
+{
+	if (!shader_job.valid() || shader_job.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
 	{
-		variable_manager.setVariables("scene", &sdf_renderer.getVariableMap());
+		return;
 	}
-	hdr.initShader(includer);
+	shader_job.get();
 
+	// collect the messages, the scene manager shows them
+	std::string messages;
+	includer.setMessageHandler([&](const std::string &message, bool error)
+	{
+		messages += message;
+	});
+	// the sliders point into the variables of the old shader
+	variable_manager.resetVariables();
+	bool built = fullscreen_quad.createShaders(*shader_build);
+	built = hdr.createShaders(*shader_build) && built;
+	built = sdf_renderer.finishBuild(*shader_build) && built;
+	variable_manager.setVariables("scene", &sdf_renderer.getVariableMap(), sdf_renderer.getVariableBuffer());
 	variable_manager.createControls();
+	includer.setMessageHandler(nullptr);
+
+	// how long each shader took, and how much of the reload came from memory
+	OutputDebugString(shader_build->getBatch().formatTimings().c_str());
+	OutputDebugString(shader_build->getTimings().formatSummary().c_str());
+	shader_timings = shader_build->getTimings().toJson();
+	shader_build = nullptr;
+	auto &cache_stats = includer.getCacheStats();
+	std::string msg = Format() << "shader files: " << cache_stats.hits << " cached, " << cache_stats.misses << " loaded, " << cache_stats.bytes_read << " bytes read\n";
+	OutputDebugString(msg.c_str());
+	auto &blob_stats = shader_cache.getStats();
+	msg = Format() << "shader blobs: " << blob_stats.hits << " from disk, " << blob_stats.misses << " compiled, " << blob_stats.evictions << " evicted\n";
+	OutputDebugString(msg.c_str());
+
+	// a failed build keeps the old shaders. the full messages go to the debug output, the first line to the scene manager
+	if (!messages.empty())
+	{
+		OutputDebugString((messages + "\n").c_str());
+	}
+	std::string first_line = messages.substr(0, messages.find('\n'));
+	if (!built)
+	{
+		scene_manager.setStatus("build failed: " + first_line);
+	}
+	else
+	{
+		scene_manager.setStatus(messages.empty() ? "built " + scene_filename.string() : "built with warnings: " + first_line);
+		do_single_renderer = true; // after a shader refresh, render one frame as preview
+	}
+
+	// also the files of a failed build, so fixing it reloads
+	scene_files = includer.getIncludeGraph().getFiles();
+	scene_manager.updateWatchedFiles();
 
-	do_single_renderer = true; // after a shader refresh, render one frame as preview
+	if (shader_pending)
+	{
+		initShader();
+	}
 }
 
 void Application::render()
 {
+	static const Profiler::ScopeId render_scope = Profiler::intern("render");
+	Profiler::Scope profile(&frame_profiler, render_scope);
+
+	auto frame_time = std::chrono::steady_clock::now();
+	if (last_frame.time_since_epoch().count())
+	{
+		frame_stats.add("frame", std::chrono::duration<double>(frame_time - last_frame).count());
+	}
+	last_frame = frame_time;
+
 	if (profiler.fetchResults())
 	{
-		auto results = profiler.getResults();
-#ifdef PROFILE_OUTPUT
-		OutputDebugString("======================\n");
-		for (auto &elem : results)
+		for (auto &[name, time] : profiler.getResults())
 		{
-			std::string name = elem.first.empty() ? "Total" : elem.first;
-			std::string msg = Format() << name << ": " << elem.second * 1000.f << "ms\n";
-			OutputDebugString(msg.c_str());
+			frame_stats.add(name.empty() ? "gpu total" : name, time);
 		}
-#endif
 	}
+#ifdef PROFILE_OUTPUT
+	if (frame_stats.isReportDue())
+	{
+		OutputDebugString(frame_stats.report().c_str());
+	}
+#endif
 
 	sdf_renderer.setParameters(stime);
 
@@ -317,6 +472,25 @@ void Application::updateSimulation(float dt)
 
 void Application::loadScene(const std::filesystem::path &filename)
 {
-	includer.setSubstitutions({ {"sdf_scene.hlsl", filename.string()} });
+	scene_filename = filename;
+
+	// start with the frozen values, if there are any
+	VariableValues values;
+	if (!loadPreset(std::filesystem::path(shader_folder) / getPresetFilename(filename), values))
+	{
+		values.clear();
+	}
+	sdf_renderer.setInitialValues(std::move(values));
+
+	initShader();
+}
+
+void Application::reloadScene()
+{
 	initShader();
-}
\ No newline at end of file
+}
+
+std::vector<std::filesystem::path> Application::getSceneFiles()
+{
+	return scene_files;
+}
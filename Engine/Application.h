@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Windows.h>
+#include <future>
 #include <memory>
 #include <string>
 #include <map>
@@ -9,9 +10,11 @@
 #include "Camera.h"
 #include "Math3D.h"
 #include "GPUProfiler.h"
+#include "FrameStats.h"
 #include "SceneManager.h"
 #include "VariableManager.h"
 #include "ShaderUtil.h"
+#include "ShaderCache.h"
 #include "SDFRenderer.h"
 #include "Postprocessing.h"
 #include "FullscreenQuad.h"
@@ -28,11 +31,15 @@ private:
 
 	bool initGraphics();
 	void initShader();
+	// swaps in the new shaders when their build is done
+	void updateShader();
 	void render();
 	void updateSimulation(float dt);
 
 	// callbacks
 	void loadScene(const std::filesystem::path &filename);
+	void reloadScene();
+	std::vector<std::filesystem::path> getSceneFiles();
 
 	HINSTANCE hInstance;
 	HWND hWnd;
@@ -41,15 +48,27 @@ private:
 	SceneManager scene_manager;
 	VariableManager variable_manager;
 	ShaderIncluder includer;
+	ShaderCache shader_cache;
 	FullscreenQuad fullscreen_quad;
 	SDFRenderer sdf_renderer;
 	HDR hdr;
 	GPUProfiler profiler;
+	Profiler frame_profiler; // the cpu side of the frames and shader builds, and the gpu results
+	FrameStats frame_stats; // of the gpu results, and the time between frames
+	std::chrono::steady_clock::time_point last_frame;
 	InputManager input_manager;
 
 	Camera camera;
+	std::filesystem::path scene_filename; // relative to the shader folder
+	std::vector<std::filesystem::path> scene_files; // of the last build
+	bool shader_pending = false; // asked for while a build was running
+	std::string shader_timings; // of the last build, as json
 	float stime;
 	bool paused;
 	bool single_frame_mode;
 	bool do_single_renderer;
+
+	// the running build, last so it is waited for before anything it uses goes away
+	std::unique_ptr<ShaderBuild> shader_build;
+	std::future<void> shader_job;
 };
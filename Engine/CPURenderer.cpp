@@ -0,0 +1,1311 @@
+#include "CPURenderer.h"
+#include "CPUScene.h"
+#include "SDFLibraryDual.h"
+#include "Camera.h"
+#include "RayQueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+namespace hlsl
+{
+	namespace
+	{
+		// the globals of pshader_sdf.hlsl, plus the per thread statistics
+		struct ShaderContext
+		{
+			const CPUScene *scene;
+
+			float3 eye;
+			float3 front_vec;
+			float3 right_vec;
+			float3 top_vec;
+
+			// the user variables used by the debug plane
+			float3 debug_plane_point;
+			float3 debug_plane_normal;
+			bool debug_show_objects;
+			float debug_plane_scale;
+
+			// normals from one evaluation on duals, where the scene has a port
+			bool dual_gradient;
+			// how hard the penumbra of the shadows is, 0 for hard shadows
+			float shadow_sharpness;
+			// the secondary rays below the cutoff end, below the threshold the russian roulette decides
+			float contribution_cutoff;
+			float roulette_threshold;
+			uint random_state; // seeded per pixel
+
+			CPURenderer::Stats stats;
+		};
+
+		struct Ray
+		{
+			float3 pos;
+			float3 dir;
+			float3 contribution;
+			float inside_sign;
+			float3 last_transparent_pos;
+			bool has_transparent;
+			uint depth; // the cost so far, against the max_cost of the materials
+			float weight; // the expected contribution, what the queue is ordered by
+		};
+
+		// the rays of a pixel still to trace. the bounces go to the rays which show the most
+		using RayQueue = ::RayQueue<Ray, RAY_COUNT>;
+
+		// a shadow ray of a lit hit, towards one of the lights
+		struct ShadowRay
+		{
+			float3 dir;
+			float range;
+			float3 contribution; // the light it brings if nothing is in the way
+		};
+
+		// the result of marching the primary ray ahead of ps_main, in a packet
+		struct PrimaryHit
+		{
+			bool hit;
+			uint iter;
+			float scene_distance;
+			float3 pos;
+			float camera_distance;
+		};
+
+		// the primary rays of a tile, from Camera::RayBasis::GenerateRays, and what the passes
+		// before the shading found out about them. one per thread, reused for all of its tiles
+		struct TileRays
+		{
+			Camera::RayVectors origins, dirs;
+			Camera::RayFootprints footprints;
+			// how far the ray can start, and what it cost last frame or -1 for a cold start
+			std::vector<float> start_distance, source_iterations;
+		};
+
+		// one of them, as primary_ray would compute it
+		struct CameraRay
+		{
+			float3 pos;
+			float3 dir;
+			float3 right_ray_vec, bottom_ray_vec;
+		};
+
+		float3 toFloat3(const Math3D::Vector3 &vec)
+		{
+			return float3(vec.x, vec.y, vec.z);
+		}
+
+		CameraRay camera_ray(const TileRays &rays, size_t index)
+		{
+			CameraRay ray;
+			ray.pos = float3(rays.origins.x[index], rays.origins.y[index], rays.origins.z[index]);
+			ray.dir = float3(rays.dirs.x[index], rays.dirs.y[index], rays.dirs.z[index]);
+			ray.right_ray_vec = float3(rays.footprints.right.x[index], rays.footprints.right.y[index], rays.footprints.right.z[index]);
+			ray.bottom_ray_vec = float3(rays.footprints.bottom.x[index], rays.footprints.bottom.y[index], rays.footprints.bottom.z[index]);
+			return ray;
+		}
+
+		// from here on this follows pshader_sdf.hlsl
+		float map_geometry(ShaderContext &ctx, GeometryInput geometry, MarchingInput march)
+		{
+			float output_scene_distance = 3e38f;
+
+			MaterialInput material_input = {};
+			MaterialOutput material_output = {};
+
+			if (ctx.debug_show_objects)
+			{
+				ctx.scene->map(geometry, march, material_input, material_output, true, output_scene_distance);
+				++ctx.stats.map_calls;
+			}
+			float distance_debug_plane = sdPlaneFast(geometry.pos - ctx.debug_plane_point, geometry.dir, ctx.debug_plane_normal);
+
+			if (any(ctx.debug_plane_normal))
+			{
+				return min(output_scene_distance, distance_debug_plane);
+			}
+			else
+			{
+				return output_scene_distance;
+			}
+		}
+
+		void map_material(ShaderContext &ctx, GeometryInput geometry, const MaterialInput &material_input, MaterialOutput &material_output)
+		{
+			float output_scene_distance = 3e38f;
+			MarchingInput march = {};
+			float distance_debug_plane = sdPlaneFast(geometry.pos - ctx.debug_plane_point, geometry.dir, ctx.debug_plane_normal);
+			if (any(ctx.debug_plane_normal) && MATERIAL(distance_debug_plane))
+			{
+				MaterialInput material_input_dummy = {};
+				MaterialOutput material_output_dummy = {};
+
+				geometry.dir.w = 0.f;
+				ctx.scene->map(geometry, march, material_input_dummy, material_output_dummy, true, output_scene_distance);
+
+				material_output.material_id = MATERIAL_DISTANCE_PLANE;
+				material_output.material_properties.x = output_scene_distance / ctx.debug_plane_scale;
+			}
+			else
+			{
+				ctx.scene->map(geometry, march, material_input, material_output, false, output_scene_distance);
+			}
+			++ctx.stats.map_calls;
+		}
+
+		// map_geometry on duals. false if the scene has no port, then nothing was evaluated
+		bool map_geometry_gradient(ShaderContext &ctx, const GeometryInput &geometry, const MarchingInput &march, dual &distance)
+		{
+			dual3 pos = dual3::position(geometry.pos);
+			dual output_scene_distance = 3e38f;
+
+			if (ctx.debug_show_objects)
+			{
+				if (!ctx.scene->map_gradient(geometry, pos, march, output_scene_distance))
+				{
+					return false;
+				}
+				++ctx.stats.map_calls;
+			}
+			dual distance_debug_plane = sdPlaneFast(pos - ctx.debug_plane_point, geometry.dir, ctx.debug_plane_normal);
+
+			distance = any(ctx.debug_plane_normal) ? min(output_scene_distance, distance_debug_plane) : output_scene_distance;
+			return true;
+		}
+
+		float3 grad(ShaderContext &ctx, GeometryInput geometry, MarchingInput march, float baseline, float sample_distance)
+		{
+			// the exact gradient in one call instead of three more. a flat spot has none, the differences decide there
+			dual distance;
+			if (ctx.dual_gradient && map_geometry_gradient(ctx, geometry, march, distance) && any(distance.d))
+			{
+				return normalize(distance.d);
+			}
+
+			float3 pos = geometry.pos;
+
+			geometry.pos = pos + float3(sample_distance, 0.f, 0.f);
+			float d1 = map_geometry(ctx, geometry, march) - baseline;
+			geometry.pos = pos + float3(0.f, sample_distance, 0.f);
+			float d2 = map_geometry(ctx, geometry, march) - baseline;
+			geometry.pos = pos + float3(0.f, 0.f, sample_distance);
+			float d3 = map_geometry(ctx, geometry, march) - baseline;
+
+			return normalize(float3(d1, d2, d3));
+		}
+
+		// start_distance: how far along the ray is known to be free, 0 in the shader
+		// closest: if given, the smallest ratio of the scene distance to the distance along the ray
+		bool march_ray(ShaderContext &ctx, GeometryInput &geometry, MarchingInput march, float dist_max, float inside_sign, uint &iter, float &scene_distance, float start_distance = 0.f, float *closest = nullptr)
+		{
+			float3 start_pos = geometry.pos;
+			geometry.camera_distance = start_distance;
+			float step_factor = 1.0f;
+			float last_scene_distance = 0.f;
+			float last_safe_camera_distance = start_distance;
+			scene_distance = 0.f;
+			for (iter = 0; iter < ITER_COUNT; ++iter)
+			{
+				++ctx.stats.iterations;
+				if (iter == 3)
+				{
+					step_factor = 1.5f;
+				}
+
+				geometry.pos = start_pos + geometry.dir.xyz * geometry.camera_distance;
+				scene_distance = map_geometry(ctx, geometry, march) * inside_sign;
+				// check for overstepping
+				if (step_factor > 1.f && (last_scene_distance + scene_distance) < last_scene_distance * step_factor)
+				{
+					// go back and try slowly
+					geometry.camera_distance = last_safe_camera_distance;
+					step_factor = 1.f;
+					continue;
+				}
+				last_scene_distance = scene_distance;
+
+				if (closest && geometry.camera_distance > 0.f)
+				{
+					*closest = min(*closest, scene_distance / geometry.camera_distance);
+				}
+
+				// handle distance
+				if (geometry.camera_distance > dist_max)
+				{
+					return false;
+				}
+				else if (scene_distance < dist_eps)
+				{
+					return true;
+				}
+
+				last_safe_camera_distance = geometry.camera_distance + scene_distance;
+				geometry.camera_distance = geometry.camera_distance + scene_distance * step_factor;
+			}
+			return false;
+		}
+
+		void push_ray(ShaderContext &ctx, RayQueue &queue, const Ray &ray)
+		{
+			if (!queue.push(ray))
+			{
+				++ctx.stats.rays_dropped;
+			}
+		}
+
+		// pcg, a new state from the last one
+		uint pcg_hash(uint input)
+		{
+			uint state = input * 747796405u + 2891336453u;
+			uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+			return (word >> 22u) ^ word;
+		}
+
+		// in [0, 1)
+		float random_float(ShaderContext &ctx)
+		{
+			ctx.random_state = pcg_hash(ctx.random_state);
+			return (ctx.random_state >> 8) * (1.f / 16777216.f);
+		}
+
+		// the reflection, refraction and transparency rays, the weak ones end here
+		void add_ray(ShaderContext &ctx, RayQueue &queue, float3 pos, float3 dir, float3 contribution, float inside_sign, float3 last_transparent_pos, bool has_transparent, uint depth)
+		{
+			float weight = max(max(contribution.r, contribution.g), contribution.b);
+			if (weight < ctx.contribution_cutoff)
+			{
+				++ctx.stats.rays_culled;
+				return;
+			}
+			// russian roulette. a survivor carries the contribution of the ones which ended,
+			// so the image is the same on average
+			if (weight < ctx.roulette_threshold)
+			{
+				float probability = weight / ctx.roulette_threshold;
+				if (random_float(ctx) >= probability)
+				{
+					++ctx.stats.rays_culled;
+					return;
+				}
+				contribution /= probability;
+			}
+
+			Ray ray;
+			ray.pos = pos;
+			ray.dir = dir;
+			ray.contribution = contribution;
+			ray.inside_sign = inside_sign;
+			ray.last_transparent_pos = last_transparent_pos;
+			ray.has_transparent = has_transparent;
+			ray.depth = depth;
+			ray.weight = weight;
+			push_ray(ctx, queue, ray);
+		}
+
+		// the normal, first pass, and the material of a hit
+		void hit_material(ShaderContext &ctx, GeometryInput &geometry_input, const MarchingInput &marching_input, float scene_distance, float inside_sign, uint iter_count, NormalOutput &normal_output, MaterialOutput &material_output)
+		{
+			normal_output.use_normal = false;
+			normal_output.normal = float3(0.f, 0.f, 0.f);
+			normal_output.normal_sample_dist = grad_eps;
+
+			geometry_input.dir.w = 0;
+			ctx.scene->map_normal(geometry_input, normal_output);
+			if (!normal_output.use_normal)
+			{
+				normal_output.normal = grad(ctx, geometry_input, marching_input, scene_distance * inside_sign, normal_output.normal_sample_dist);
+			}
+
+			// get the material
+			MaterialInput material_input;
+			material_input.obj_normal = normal_output.normal;
+			material_input.iteration_count = iter_count;
+			material_input.scene_distance = scene_distance;
+
+			material_output.material_id = MATERIAL_NONE;
+			material_output.material_position = float4(geometry_input.pos, 0.f);
+			material_output.material_properties = float4(0.f, 0.f, 0.f, 0.f);
+			material_output.diffuse_color = float4(0.f, 0.f, 0.f, 1.f);
+			material_output.specular_color = float4(0.f, 0.f, 0.f, 60.f);
+			material_output.emissive_color = float3(0.f, 0.f, 0.f);
+			material_output.reflection_color = float3(0.f, 0.f, 0.f); // no reflection
+			material_output.refraction_color = float3(0.f, 0.f, 0.f); // no refraction
+			material_output.optical_index = 1.4f;
+			material_output.optical_density = 0.f;
+			material_output.normal = float4(0.f, 0.f, 0.f, 0.f);
+			material_output.max_cost = 7;
+			material_output.use_hdr = true;
+
+			map_material(ctx, geometry_input, material_input, material_output);
+		}
+
+		// unlike the shader, the shadow rays of a hit are not queued with the bounces, so the lights
+		// take none of the ray slots or bounces, hard or soft. a transparent occluder lets a ray go on,
+		// as long as depth stays below its max_cost. returns the light which gets through
+		//
+		// hard shadows (sharpness 0) are a 0/1 visibility per ray, the same as the shader's queued rays.
+		// soft shadows need the true distances, not the fast ones along the ray. then the first step
+		// of all rays is the same evaluation at scene_pos, which is done once for all of them. the
+		// hard rays march the fast distances, which already start further than that shared step
+		float3 march_shadows(ShaderContext &ctx, const GeometryInput &hit, float3 scene_pos, const ShadowRay *shadow_rays, uint shadow_count, uint depth)
+		{
+			float3 light = float3(0.f, 0.f, 0.f);
+			if (shadow_count == 0)
+			{
+				return light;
+			}
+
+			MarchingInput marching_input;
+			marching_input.is_inside = false;
+			marching_input.has_transparent = false;
+			marching_input.last_transparent_pos = float3(0.f, 0.f, 0.f);
+			marching_input.is_shadow_pass = true;
+
+			bool soft = ctx.shadow_sharpness > 0.f;
+			GeometryInput geometry_input = hit;
+			float free_distance = 0.f;
+			if (soft)
+			{
+				++ctx.stats.iterations;
+				geometry_input.pos = scene_pos;
+				geometry_input.dir = float4(shadow_rays[0].dir, 0.f);
+				geometry_input.camera_distance = 0.f;
+				free_distance = map_geometry(ctx, geometry_input, marching_input);
+				// too close, each ray finds the hit on its own
+				if (free_distance < dist_eps)
+				{
+					free_distance = 0.f;
+				}
+			}
+			for (uint index = 0; index < shadow_count; ++index)
+			{
+				const ShadowRay &shadow_ray = shadow_rays[index];
+				float3 contribution = shadow_ray.contribution;
+				float range = shadow_ray.range;
+				float start_distance = free_distance;
+				float closest = 1e10f;
+				geometry_input.pos = scene_pos;
+				marching_input.has_transparent = false;
+				marching_input.last_transparent_pos = float3(0.f, 0.f, 0.f);
+				for (uint ray_depth = depth;; ray_depth += 2)
+				{
+					++ctx.stats.rays;
+
+					geometry_input.dir = float4(shadow_ray.dir, soft ? 0.f : 1.f);
+					uint iter_count;
+					float scene_distance;
+					if (start_distance > range || !march_ray(ctx, geometry_input, marching_input, range, 1.f, iter_count, scene_distance, start_distance, soft ? &closest : nullptr))
+					{
+						// nothing in the way of the light
+						light += contribution * (soft ? saturate(ctx.shadow_sharpness * closest) : 1.f);
+						break;
+					}
+
+					NormalOutput normal_output;
+					MaterialOutput material_output;
+					hit_material(ctx, geometry_input, marching_input, scene_distance, 1.f, iter_count, normal_output, material_output);
+					if (material_output.diffuse_color.a >= 1.f || ray_depth + 2 >= material_output.max_cost)
+					{
+						break;
+					}
+
+					// reduce by the already traveled distance
+					contribution = (1.f - material_output.diffuse_color.a) * material_output.diffuse_color.xyz * contribution;
+					range -= geometry_input.camera_distance;
+					marching_input.has_transparent = true;
+					marching_input.last_transparent_pos = geometry_input.pos;
+					start_distance = 0.f;
+				}
+			}
+			return light;
+		}
+
+		// the ray through any screen position, the pixels of a tile come from Camera::RayBasis::GenerateRays
+		void primary_ray(const ShaderContext &ctx, float2 screenpos, float2 screenpos_derivative, float3 &dir, float3 &right_ray_vec, float3 &bottom_ray_vec)
+		{
+			dir = ctx.front_vec + screenpos.x * ctx.right_vec + screenpos.y * ctx.top_vec;
+			float dir_invlen = 1.f / length(dir);
+			dir *= dir_invlen;
+			right_ray_vec = screenpos_derivative.x * ctx.right_vec * dir_invlen;
+			bottom_ray_vec = screenpos_derivative.y * ctx.top_vec * dir_invlen;
+		}
+
+		// the center of a pixel, as the rasterizer would interpolate it
+		float2 pixel_screenpos(float x, float y, unsigned width, unsigned height)
+		{
+			return float2((x + 0.5f) / width * 2.f - 1.f, 1.f - (y + 0.5f) / height * 2.f);
+		}
+
+		static const uint cone_iter_count = 32;
+		// how much further than the local scene distance a temporal start backs off, relative to the distance
+		static const float temporal_margin = 0.05f;
+
+		// marches a cone which contains the primary rays through the screen rectangle [corner_min, corner_max]
+		// returns how far all of these rays can skip ahead without missing a surface
+		float cone_march(ShaderContext &ctx, float2 corner_min, float2 corner_max, float2 screenpos_derivative, float start_distance)
+		{
+			// the cone axis goes through the middle of the block
+			float3 dir, right_ray_vec, bottom_ray_vec;
+			primary_ray(ctx, (corner_min + corner_max) * 0.5f, screenpos_derivative, dir, right_ray_vec, bottom_ray_vec);
+
+			// the opening of the cone. how far the rays drift from the axis per unit of distance, the corners drift the most
+			float spread = 0.f;
+			for (uint corner = 0; corner < 4; ++corner)
+			{
+				float2 screenpos = float2((corner & 1) ? corner_max.x : corner_min.x, (corner & 2) ? corner_max.y : corner_min.y);
+				float3 corner_dir = normalize(ctx.front_vec + screenpos.x * ctx.right_vec + screenpos.y * ctx.top_vec);
+				spread = max(spread, length(corner_dir - dir));
+			}
+
+			// the fast methods only give the distance along the axis, the cone needs the real distance
+			GeometryInput geometry;
+			geometry.dir = float4(dir, 0.f);
+			geometry.right_ray_offset = right_ray_vec;
+			geometry.bottom_ray_offset = bottom_ray_vec;
+
+			MarchingInput march = {};
+
+			float camera_distance = start_distance;
+			for (uint iter = 0; iter < cone_iter_count && camera_distance <= RANGE; ++iter)
+			{
+				++ctx.stats.cone_iterations;
+
+				geometry.pos = ctx.eye + dir * camera_distance;
+				geometry.camera_distance = camera_distance;
+				float scene_distance = map_geometry(ctx, geometry, march);
+
+				// the cone is free as long as the empty sphere is wider than the cone
+				float free_distance = scene_distance - spread * camera_distance;
+				if (free_distance < dist_eps)
+				{
+					break;
+				}
+				// step so the cone stays inside the sphere
+				camera_distance += free_distance / (1.f + spread);
+			}
+			return camera_distance;
+		}
+
+		// cone marches the pixels [x, x + block_width) x [y, y + block_height), then refines the quarters down to min_block_size
+		// writes the start distance of each pixel into output, which points to the block with a row stride of output_stride
+		void cone_prepass(ShaderContext &ctx, unsigned x, unsigned y, unsigned block_width, unsigned block_height, unsigned width, unsigned height, unsigned min_block_size, float2 screenpos_derivative, float start_distance, float *output, unsigned output_stride)
+		{
+			float2 corner_min = pixel_screenpos(static_cast<float>(x), static_cast<float>(y + block_height - 1), width, height);
+			float2 corner_max = pixel_screenpos(static_cast<float>(x + block_width - 1), static_cast<float>(y), width, height);
+			float distance = cone_march(ctx, corner_min, corner_max, screenpos_derivative, start_distance);
+
+			unsigned half_width = (block_width + 1) / 2;
+			unsigned half_height = (block_height + 1) / 2;
+			if (max(block_width, block_height) / 2 >= min_block_size)
+			{
+				for (unsigned cy = 0; cy < block_height; cy += half_height)
+				{
+					for (unsigned cx = 0; cx < block_width; cx += half_width)
+					{
+						cone_prepass(ctx, x + cx, y + cy, min(half_width, block_width - cx), min(half_height, block_height - cy), width, height, min_block_size, screenpos_derivative, distance, output + cy * output_stride + cx, output_stride);
+					}
+				}
+			}
+			else
+			{
+				for (unsigned py = 0; py < block_height; ++py)
+				{
+					for (unsigned px = 0; px < block_width; ++px)
+					{
+						output[py * output_stride + px] = distance;
+					}
+				}
+			}
+		}
+
+		// a start distance from where the primary ray hit last frame, reprojected into this one
+		// backs off by the distance to the scene there, so geometry which moved in front of the old hit does not get skipped
+		// returns false if the reprojected distance can not be trusted
+		bool temporal_start(ShaderContext &ctx, const CameraRay &ray, float reprojected_distance, float &start_distance)
+		{
+			// like the cone pass, this needs the real distance
+			GeometryInput geometry;
+			geometry.dir = float4(ray.dir, 0.f);
+			geometry.right_ray_offset = ray.right_ray_vec;
+			geometry.bottom_ray_offset = ray.bottom_ray_vec;
+
+			MarchingInput march = {};
+
+			geometry.pos = ray.pos + ray.dir * reprojected_distance;
+			geometry.camera_distance = reprojected_distance;
+			float local_distance = abs(map_geometry(ctx, geometry, march));
+
+			float candidate = reprojected_distance - local_distance - temporal_margin * reprojected_distance;
+			if (candidate <= 0.f)
+			{
+				return false;
+			}
+
+			// we must start in free space, otherwise the reprojection is off
+			geometry.pos = ray.pos + ray.dir * candidate;
+			geometry.camera_distance = candidate;
+			if (map_geometry(ctx, geometry, march) < dist_eps)
+			{
+				return false;
+			}
+
+			start_distance = candidate;
+			return true;
+		}
+
+		// primary may hold the already marched primary ray, otherwise ps_main marches it itself
+		float4 ps_main(ShaderContext &ctx, const CameraRay &camera, const PrimaryHit *primary = nullptr)
+		{
+			// the main ray comes from the camera
+			float3 right_ray_vec = camera.right_ray_vec, bottom_ray_vec = camera.bottom_ray_vec;
+
+			RayQueue queue;
+
+			Ray main_ray;
+			main_ray.pos = camera.pos;
+			main_ray.dir = camera.dir;
+			main_ray.contribution = float3(1.f, 1.f, 1.f);
+			main_ray.inside_sign = 1.f;
+			main_ray.last_transparent_pos = float3(0.f, 0.f, 0.f);
+			main_ray.has_transparent = false;
+			main_ray.depth = 0;
+			main_ray.weight = 1.f;
+			push_ray(ctx, queue, main_ray);
+
+			float hdr_output = -1.f;
+			float4 output_color = float4(0.f, 0.f, 0.f, 0.f);
+			for (uint bounce = 0; bounce < BOUNCE_COUNT && !queue.empty(); ++bounce)
+			{
+				++ctx.stats.rays;
+
+				// get next ray
+				Ray current_ray = queue.pop();
+
+				float3 ray_color = float3(0.f, 0.f, 0.f);
+				// march geometry
+				GeometryInput geometry_input;
+				geometry_input.pos = current_ray.pos;
+				geometry_input.dir = float4(current_ray.dir, 1.f);
+				geometry_input.right_ray_offset = right_ray_vec;
+				geometry_input.bottom_ray_offset = bottom_ray_vec;
+
+				MarchingInput marching_input;
+				marching_input.is_inside = false;
+				marching_input.has_transparent = current_ray.has_transparent;
+				marching_input.last_transparent_pos = current_ray.last_transparent_pos;
+				marching_input.is_shadow_pass = false;
+
+				uint iter_count;
+				float scene_distance;
+				bool scene_hit;
+				if (primary && bounce == 0)
+				{
+					scene_hit = primary->hit;
+					iter_count = primary->iter;
+					scene_distance = primary->scene_distance;
+					geometry_input.pos = primary->pos;
+					geometry_input.camera_distance = primary->camera_distance;
+				}
+				else
+				{
+					scene_hit = march_ray(ctx, geometry_input, marching_input, RANGE, current_ray.inside_sign, iter_count, scene_distance);
+				}
+				if (scene_hit)
+				{
+					NormalOutput normal_output;
+					MaterialOutput material_output;
+					hit_material(ctx, geometry_input, marching_input, scene_distance, current_ray.inside_sign, iter_count, normal_output, material_output);
+
+					// change the hdr output to what the material wants, but only in the first iteration
+					float new_hdr = material_output.use_hdr ? 1.f : 0.f;
+					hdr_output = lerp(hdr_output, new_hdr, step(hdr_output, 0.f));
+
+					// get the new normal, second pass
+					float3 new_normal = lerp(normal_output.normal, material_output.normal.xyz, material_output.normal.w);
+
+					// do we have reflection?
+					if (any(material_output.reflection_color) && current_ray.inside_sign > 0.f && current_ray.depth + 3 < material_output.max_cost) // only if we are an outside ray
+					{
+						float3 ref_vec = reflect(geometry_input.dir.xyz, new_normal);
+						add_ray(ctx, queue, geometry_input.pos + ref_vec * reflect_eps, ref_vec, material_output.reflection_color * current_ray.contribution, 1.f, float3(0.f), false, current_ray.depth + 3);
+					}
+
+					// do we have refraction?
+					if (any(material_output.refraction_color) && current_ray.depth + 4 < material_output.max_cost)
+					{
+						if (current_ray.inside_sign > 0.f) // just entering the material
+						{
+							float3 ref_vec = refract(geometry_input.dir.xyz, new_normal, 1.f / material_output.optical_index);
+							add_ray(ctx, queue, geometry_input.pos + ref_vec * refract_eps, ref_vec, material_output.refraction_color * current_ray.contribution, -1.f, float3(0.f), false, current_ray.depth + 2);
+						}
+						else // leaving the material
+						{
+							float3 ref_vec = refract(geometry_input.dir.xyz, -new_normal, material_output.optical_index);
+							add_ray(ctx, queue, geometry_input.pos + ref_vec * refract_eps, ref_vec, material_output.refraction_color * current_ray.contribution, 1.f, float3(0.f), false, current_ray.depth + 2);
+						}
+					}
+
+					float3 diffuse_color = material_output.diffuse_color.xyz;
+					float3 color = float3(0.f, 0.f, 0.f);
+
+					bool use_light = true;
+					// handle material
+					if (material_output.material_id == MATERIAL_ITER)
+					{
+						color += iter_count_to_color(iter_count, ITER_COUNT - 1);
+						use_light = false;
+						hdr_output = 0.f;
+					}
+					else if (material_output.material_id == MATERIAL_PLAIN)
+					{
+						color += diffuse_color;
+						use_light = false;
+					}
+					else if (material_output.material_id == MATERIAL_NORMAL1)
+					{
+						float3 normal_color = max(0.01f, new_normal);
+						normal_color = normal_color / max(max(normal_color.r, normal_color.g), normal_color.b);
+						color += normal_color;
+						use_light = false;
+						hdr_output = 0.f;
+					}
+					else if (material_output.material_id == MATERIAL_NORMAL2)
+					{
+						float3 normal_color = abs(new_normal);
+						color += normal_color;
+						use_light = false;
+						hdr_output = 0.f;
+					}
+					else if (material_output.material_id == MATERIAL_DISTANCE_PLANE)
+					{
+						color += debug_plane_color(material_output.material_properties.x);
+						use_light = false;
+						hdr_output = 0.f;
+					}
+					else if (material_output.material_id == MATERIAL_WOOD)
+					{
+						diffuse_color += wood(material_output.material_position.xyz);
+					}
+					else if (material_output.material_id == MATERIAL_MARBLE_DARK)
+					{
+						diffuse_color += marble(material_output.material_position.xyz, float3(0.556f, 0.478f, 0.541f));
+					}
+					else if (material_output.material_id == MATERIAL_MARBLE_LIGHT)
+					{
+						diffuse_color += marble(material_output.material_position.xyz, float3(0.7f, 0.7f, 0.7f));
+					}
+					else if (material_output.material_id == MATERIAL_FIRE)
+					{
+						float fadeout = saturate(dot(-geometry_input.dir.xyz, new_normal));
+						float4 fire_color = fire(material_output.material_position.xyz, 1.f - fadeout);
+						color += fire_color.rgb;
+						material_output.diffuse_color.a = saturate(fire_color.a);
+						material_output.diffuse_color.rgb = float3(1.f, 1.f, 1.f);
+					}
+
+					// handle transparent material
+					if (material_output.diffuse_color.a < 1.f && current_ray.depth + 2 < material_output.max_cost)
+					{
+						add_ray(ctx, queue, geometry_input.pos, geometry_input.dir.xyz, (1.f - material_output.diffuse_color.a) * material_output.diffuse_color.xyz * current_ray.contribution, 1.f, geometry_input.pos, true, current_ray.depth + 2);
+					}
+
+					if (use_light)
+					{
+						LightOutput light_output[LIGHT_COUNT];
+						for (uint i1 = 0; i1 < LIGHT_COUNT; ++i1)
+						{
+							light_output[i1].used = false;
+							light_output[i1].pos = float4(0.f, 0.f, 0.f, 0.f);
+							light_output[i1].color = float3(0.f, 0.f, 0.f);
+							light_output[i1].falloff = 0.f;
+							light_output[i1].extend = 0.f;
+						}
+
+						float ambient_lighting_factor = 0.075f;
+						ctx.scene->map_light(geometry_input, light_output, ambient_lighting_factor);
+
+						// adjust for shadow eps
+						float3 view_dir = geometry_input.dir.xyz;
+						float shadow_move_distance = max(shadow_eps, normal_output.normal_sample_dist) + max(0.f, -scene_distance);
+						float3 scene_pos = geometry_input.pos + new_normal * shadow_move_distance;
+
+						ShadowRay shadow_rays[LIGHT_COUNT];
+						uint shadow_count = 0;
+
+						// handle all lights
+						for (uint i2 = 0; i2 < LIGHT_COUNT; ++i2)
+						{
+							if (light_output[i2].used)
+							{
+								// get light dir
+								float3 lighting_dir;
+								float distance_to_trace;
+								float falloff_factor = 1.f;
+								if (light_output[i2].pos.w == 1.f) // directional light
+								{
+									lighting_dir = light_output[i2].pos.xyz;
+									lighting_dir /= length(lighting_dir) + dist_eps;
+									distance_to_trace = RANGE; // reasonable default
+								}
+								else // point light
+								{
+									lighting_dir = scene_pos - light_output[i2].pos.xyz;
+									distance_to_trace = length(lighting_dir);
+									lighting_dir /= distance_to_trace;
+									distance_to_trace -= light_output[i2].extend;
+
+									falloff_factor = pow(0.1f, light_output[i2].falloff);
+								}
+								float3 light_color = light_output[i2].color * falloff_factor;
+
+								// handle ambient
+								color += diffuse_color * light_color * ambient_lighting_factor;
+
+								// the next components (diffuse and specular) depend whether we are in a shadow or not
+								// so first sum up the would be influence and apply it later
+								float3 light_influenced_color = float3(0.f, 0.f, 0.f);
+
+								// handle diffuse color
+								float light_dot = saturate(dot(-new_normal, lighting_dir));
+								light_influenced_color += diffuse_color * light_color * light_dot;
+
+								// handle specular
+								float3 half_vec = -normalize(view_dir + lighting_dir);
+								float specular_dot = saturate(dot(new_normal, half_vec));
+								float specular_factor = pow(specular_dot, material_output.specular_color.a);
+
+								light_influenced_color += material_output.specular_color.xyz * light_color * specular_factor;
+
+								// now handle the shadow with another ray, but only if we are not already in a shaded region
+								if (current_ray.depth + 2 < material_output.max_cost && light_dot > 0.f)
+								{
+									ShadowRay &shadow_ray = shadow_rays[shadow_count++];
+									shadow_ray.dir = -lighting_dir;
+									shadow_ray.range = distance_to_trace;
+									shadow_ray.contribution = light_influenced_color * current_ray.contribution * saturate(material_output.diffuse_color.a);
+								}
+							}
+						}
+
+						// the shadow rays of all lights together
+						ray_color += march_shadows(ctx, geometry_input, scene_pos, shadow_rays, shadow_count, current_ray.depth + 2);
+
+						// handle emissive color
+						color += material_output.emissive_color;
+
+						// modulate with alpha, but only if we are using lights
+						color *= saturate(material_output.diffuse_color.a);
+					}
+
+					ray_color += color * current_ray.contribution;
+				}
+				else // scene not hit -> background
+				{
+					float3 background_color = ctx.scene->map_background(geometry_input.dir.xyz, iter_count);
+					ray_color += background_color * current_ray.contribution;
+				}
+				output_color += float4(ray_color, 0.f);
+			}
+
+			// hdr_output is either -1 (not set), 0 (disable), or 1 (enable)
+			// with abs we map the "not set" case to the "enabled" case as well
+			output_color.a = abs(hdr_output);
+			return output_color;
+		}
+
+		// the primary rays of a packet, evaluated lane by lane
+		struct PrimaryPacket
+		{
+			ShaderContext *ctx;
+			GeometryInput geometry[PacketMarcher::max_width];
+			MarchingInput march;
+		};
+
+		void primary_distance(void *user, const unsigned *lanes, const float *pos_x, const float *pos_y, const float *pos_z, const float *camera_distance, float *distance, unsigned count)
+		{
+			auto &packet = *static_cast<PrimaryPacket *>(user);
+			for (unsigned i = 0; i < count; ++i)
+			{
+				GeometryInput geometry = packet.geometry[lanes[i]];
+				geometry.pos = float3(pos_x[i], pos_y[i], pos_z[i]);
+				geometry.camera_distance = camera_distance[i];
+				distance[i] = map_geometry(*packet.ctx, geometry, packet.march);
+			}
+		}
+
+		// marches the primary ray the same way ps_main would, but from start_distance on
+		void march_primary(ShaderContext &ctx, const CameraRay &ray, float start_distance, PrimaryHit &output)
+		{
+			GeometryInput geometry;
+			geometry.right_ray_offset = ray.right_ray_vec;
+			geometry.bottom_ray_offset = ray.bottom_ray_vec;
+			geometry.pos = ray.pos;
+			geometry.dir = float4(ray.dir, 1.f);
+
+			MarchingInput march;
+			march.is_inside = false;
+			march.last_transparent_pos = float3(0.f, 0.f, 0.f);
+			march.has_transparent = false;
+			march.is_shadow_pass = false;
+
+			output.hit = march_ray(ctx, geometry, march, RANGE, 1.f, output.iter, output.scene_distance, start_distance);
+			output.pos = geometry.pos;
+			output.camera_distance = geometry.camera_distance;
+		}
+
+		// marches the primary rays first to first + count of the tile together
+		void march_primary_packet(ShaderContext &ctx, PacketMarcher::Backend backend, const TileRays &rays, size_t first, const float *start_distance, PrimaryHit *output, unsigned count)
+		{
+			PrimaryPacket primary_packet;
+			primary_packet.ctx = &ctx;
+			primary_packet.march.is_inside = false;
+			primary_packet.march.last_transparent_pos = float3(0.f, 0.f, 0.f);
+			primary_packet.march.has_transparent = false;
+			primary_packet.march.is_shadow_pass = false;
+
+			PacketMarcher::Packet packet;
+			packet.count = count;
+			// already laid out like the packet
+			std::copy_n(&rays.origins.x[first], count, packet.pos_x);
+			std::copy_n(&rays.origins.y[first], count, packet.pos_y);
+			std::copy_n(&rays.origins.z[first], count, packet.pos_z);
+			std::copy_n(&rays.dirs.x[first], count, packet.dir_x);
+			std::copy_n(&rays.dirs.y[first], count, packet.dir_y);
+			std::copy_n(&rays.dirs.z[first], count, packet.dir_z);
+			std::copy_n(start_distance, count, packet.camera_distance);
+			for (unsigned i = 0; i < count; ++i)
+			{
+				CameraRay ray = camera_ray(rays, first + i);
+				GeometryInput &geometry = primary_packet.geometry[i];
+				geometry.right_ray_offset = ray.right_ray_vec;
+				geometry.bottom_ray_offset = ray.bottom_ray_vec;
+				geometry.dir = float4(ray.dir, 1.f);
+			}
+
+			PacketMarcher::Params params;
+			params.dist_max = RANGE;
+			params.inside_sign = 1.f;
+			params.dist_eps = dist_eps;
+			params.iter_count = ITER_COUNT;
+			params.distance_function = primary_distance;
+			params.user = &primary_packet;
+			PacketMarcher::march(backend, packet, params);
+
+			for (unsigned i = 0; i < count; ++i)
+			{
+				PrimaryHit &primary = output[i];
+				primary.hit = packet.hit[i];
+				primary.iter = packet.iterations[i];
+				primary.scene_distance = packet.scene_distance[i];
+				primary.pos = float3(packet.pos_x[i], packet.pos_y[i], packet.pos_z[i]);
+				primary.camera_distance = packet.camera_distance[i];
+
+				// march_ray counts the step it terminates in
+				ctx.stats.iterations += std::min(primary.iter + 1, static_cast<uint>(ITER_COUNT));
+			}
+		}
+	}
+}
+
+void CPURenderer::setScene(const CPUScene *scene)
+{
+	this->scene = scene;
+	temporal_width = temporal_height = 0;
+}
+
+void CPURenderer::setVariables(const VariableMap *variables)
+{
+	this->variables = variables;
+}
+
+void CPURenderer::setThreadCount(unsigned thread_count)
+{
+	this->thread_count = thread_count;
+}
+
+void CPURenderer::setTiling(unsigned tile_size, TileScheduler::Order tile_order)
+{
+	this->tile_size = tile_size;
+	this->tile_order = tile_order;
+}
+
+void CPURenderer::setConeBlockSize(unsigned cone_block_size)
+{
+	this->cone_block_size = cone_block_size;
+}
+
+void CPURenderer::setTemporalCache(bool enable)
+{
+	temporal_cache = enable;
+	temporal_width = temporal_height = 0;
+}
+
+void CPURenderer::setPacketMarching(bool enable, PacketMarcher::Backend backend)
+{
+	packet_marching = enable;
+	packet_backend = backend;
+}
+
+void CPURenderer::setDualGradient(bool enable)
+{
+	dual_gradient = enable;
+}
+
+void CPURenderer::setSoftShadows(float sharpness)
+{
+	shadow_sharpness = std::max(sharpness, 0.f);
+}
+
+void CPURenderer::setContributionCutoff(float cutoff)
+{
+	contribution_cutoff = std::max(cutoff, 0.f);
+}
+
+void CPURenderer::setRussianRoulette(float threshold)
+{
+	roulette_threshold = std::max(threshold, 0.f);
+}
+
+void CPURenderer::setProfiler(Profiler *profiler)
+{
+	this->profiler = profiler;
+}
+
+bool CPURenderer::render(const Camera &camera, unsigned width, unsigned height)
+{
+	if (!scene || !width || !height)
+	{
+		return false;
+	}
+
+	auto start_time = std::chrono::steady_clock::now();
+	static const Profiler::ScopeId frame_scope = Profiler::intern("cpu frame");
+	static const Profiler::ScopeId reproject_scope = Profiler::intern("reproject");
+	static const Profiler::ScopeId tile_scope = Profiler::intern("tile");
+	static const Profiler::ScopeId cone_scope = Profiler::intern("cone pass");
+	static const Profiler::ScopeId temporal_scope = Profiler::intern("temporal start");
+	static const Profiler::ScopeId shade_scope = Profiler::intern("march and shade");
+	Profiler::Scope frame_profile(profiler, frame_scope);
+
+	this->width = width;
+	this->height = height;
+	framebuffer.resize(static_cast<size_t>(width) * height);
+	primary_distances.resize(framebuffer.size());
+
+	Camera::RayBasis ray_basis = camera.GetRayBasis();
+	hlsl::ShaderContext base_context = {};
+	base_context.scene = scene;
+	base_context.eye = hlsl::toFloat3(ray_basis.eye);
+	base_context.front_vec = hlsl::toFloat3(ray_basis.front);
+	base_context.right_vec = hlsl::toFloat3(ray_basis.right);
+	base_context.top_vec = hlsl::toFloat3(ray_basis.top);
+
+	// the same defaults the VAR_ declarations in pshader_sdf.hlsl produce
+	base_context.debug_plane_point = hlsl::float3(getVariable("debug_x", 0.f), getVariable("debug_y", 0.f), getVariable("debug_z", 0.f));
+	hlsl::float3 debug_plane_normal = hlsl::float3(getVariable("debug_nx", 0.f), getVariable("debug_ny", 0.f), getVariable("debug_nz", 0.f));
+	base_context.debug_plane_normal = hlsl::any(debug_plane_normal) ? hlsl::normalize(debug_plane_normal) : hlsl::float3(0.f);
+	base_context.debug_show_objects = getVariable("show_objects", 1.f) != 0.f;
+	base_context.debug_plane_scale = getVariable("debug_scale", 0.2f);
+	base_context.dual_gradient = dual_gradient;
+	base_context.shadow_sharpness = shadow_sharpness;
+	base_context.contribution_cutoff = contribution_cutoff;
+	base_context.roulette_threshold = roulette_threshold;
+	hlsl::uint frame_seed = hlsl::pcg_hash(frame_index++);
+
+	// the screen space derivatives, as ddx and ddy would return them
+	hlsl::float2 screenpos_derivative = hlsl::float2(2.f / width, -2.f / height);
+
+	PacketMarcher::Backend backend = PacketMarcher::resolveBackend(packet_backend);
+	unsigned packet_width = PacketMarcher::getWidth(backend);
+
+	// last frame is only usable at the same size
+	bool use_temporal = temporal_cache && temporal_width == width && temporal_height == height;
+	if (use_temporal)
+	{
+		Profiler::Scope profile(profiler, reproject_scope);
+		reprojectTemporalCache(camera);
+	}
+	if (temporal_cache)
+	{
+		temporal_current.assign(static_cast<size_t>(width) * height, {});
+	}
+
+	auto render_tile = [&](hlsl::ShaderContext &ctx, hlsl::TileRays &rays, const TileScheduler::Tile &tile)
+	{
+		// every primary ray of the tile at once, the passes below only read them
+		ray_basis.GenerateRays(tile, width, height, rays.origins, rays.dirs, rays.footprints);
+
+		// how far the primary ray of each pixel can start, from the cone pass
+		auto &start_distance = rays.start_distance;
+		start_distance.assign(static_cast<size_t>(tile.width) * tile.height, 0.f);
+		if (cone_block_size)
+		{
+			Profiler::Scope profile(profiler, cone_scope);
+			for (unsigned y = 0; y < tile.height; y += cone_block_size)
+			{
+				for (unsigned x = 0; x < tile.width; x += cone_block_size)
+				{
+					unsigned block_width = std::min(cone_block_size, tile.width - x);
+					unsigned block_height = std::min(cone_block_size, tile.height - y);
+					hlsl::cone_prepass(ctx, tile.x + x, tile.y + y, block_width, block_height, width, height, min_cone_block_size, screenpos_derivative, 0.f, &start_distance[static_cast<size_t>(y) * tile.width + x], tile.width);
+				}
+			}
+		}
+
+		// warm start from last frame where the reprojection allows it
+		auto &source_iterations = rays.source_iterations;
+		if (use_temporal)
+		{
+			Profiler::Scope profile(profiler, temporal_scope);
+			source_iterations.assign(start_distance.size(), -1.f);
+			for (unsigned y = tile.y; y < tile.y + tile.height; ++y)
+			{
+				for (unsigned x = tile.x; x < tile.x + tile.width; ++x)
+				{
+					// the closest reprojected hit around the pixel, which also covers the holes of the splatting
+					const TemporalReprojection *closest = nullptr;
+					for (unsigned ny = std::max(y, 1u) - 1; ny <= std::min(y + 1, height - 1); ++ny)
+					{
+						for (unsigned nx = std::max(x, 1u) - 1; nx <= std::min(x + 1, width - 1); ++nx)
+						{
+							const auto &reprojection = temporal_reprojected[static_cast<size_t>(ny) * width + nx];
+							if (reprojection.valid && (!closest || reprojection.distance < closest->distance))
+							{
+								closest = &reprojection;
+							}
+						}
+					}
+
+					size_t index = static_cast<size_t>(y - tile.y) * tile.width + (x - tile.x);
+					float warm_distance;
+					if (closest && hlsl::temporal_start(ctx, hlsl::camera_ray(rays, index), closest->distance, warm_distance))
+					{
+						start_distance[index] = std::max(start_distance[index], warm_distance);
+						source_iterations[index] = closest->iterations;
+						++ctx.stats.temporal_hits;
+					}
+					else
+					{
+						++ctx.stats.temporal_misses;
+					}
+				}
+			}
+		}
+
+		Profiler::Scope profile(profiler, shade_scope);
+		unsigned span_width = packet_marching ? packet_width : 1;
+		for (unsigned y = tile.y; y < tile.y + tile.height; ++y)
+		{
+			hlsl::float4 *row = &framebuffer[static_cast<size_t>(y) * width];
+			size_t tile_row = static_cast<size_t>(y - tile.y) * tile.width;
+			for (unsigned x = tile.x; x < tile.x + tile.width; x += span_width)
+			{
+				// spans of neighboring pixels in a row form the packets
+				hlsl::PrimaryHit primary[PacketMarcher::max_width];
+				unsigned count = std::min(span_width, tile.x + tile.width - x);
+				size_t span = tile_row + (x - tile.x);
+
+				const float *span_start_distance = &start_distance[span];
+				if (packet_marching)
+				{
+					hlsl::march_primary_packet(ctx, backend, rays, span, span_start_distance, primary, count);
+				}
+				else
+				{
+					hlsl::march_primary(ctx, hlsl::camera_ray(rays, span), span_start_distance[0], primary[0]);
+				}
+
+				for (unsigned i = 0; i < count; ++i)
+				{
+					// by pixel, so it does not matter which thread renders it
+					ctx.random_state = hlsl::pcg_hash(y * width + x + i + frame_seed);
+					row[x + i] = hlsl::ps_main(ctx, hlsl::camera_ray(rays, span + i), &primary[i]);
+
+					PrimaryDistance &distance = primary_distances[static_cast<size_t>(y) * width + x + i];
+					distance.start = span_start_distance[i];
+					distance.hit = primary[i].hit ? primary[i].camera_distance : -1.f;
+
+					if (temporal_cache)
+					{
+						// remember what a cold start would have cost, so the savings can be estimated next frame too
+						float iterations = static_cast<float>(std::min(primary[i].iter + 1, static_cast<hlsl::uint>(ITER_COUNT)));
+						float source = use_temporal ? source_iterations[tile_row + (x - tile.x) + i] : -1.f;
+						if (source > iterations)
+						{
+							ctx.stats.temporal_iterations_saved += static_cast<uint64_t>(source - iterations);
+							iterations = source;
+						}
+
+						TemporalSample &sample = temporal_current[static_cast<size_t>(y) * width + x + i];
+						sample.pos = primary[i].pos;
+						sample.iterations = iterations;
+						sample.hit = primary[i].hit;
+					}
+				}
+			}
+		}
+	};
+
+	unsigned worker_count = thread_count ? thread_count : std::max(std::thread::hardware_concurrency(), 1u);
+	std::vector<hlsl::ShaderContext> contexts(worker_count, base_context);
+	std::vector<hlsl::TileRays> tile_rays(worker_count);
+
+	auto tiles = TileScheduler::makeTiles(width, height, tile_size, tile_order);
+	scheduler.run(tiles, worker_count, [&](const TileScheduler::Tile &tile, unsigned thread_index)
+	{
+		Profiler::Scope profile(profiler, tile_scope);
+		render_tile(contexts[thread_index], tile_rays[thread_index], tile);
+	});
+
+	stats = {};
+	for (auto &ctx : contexts)
+	{
+		stats.rays += ctx.stats.rays;
+		stats.iterations += ctx.stats.iterations;
+		stats.map_calls += ctx.stats.map_calls;
+		stats.cone_iterations += ctx.stats.cone_iterations;
+		stats.temporal_hits += ctx.stats.temporal_hits;
+		stats.temporal_misses += ctx.stats.temporal_misses;
+		stats.temporal_iterations_saved += ctx.stats.temporal_iterations_saved;
+		stats.rays_dropped += ctx.stats.rays_dropped;
+		stats.rays_culled += ctx.stats.rays_culled;
+	}
+
+	if (temporal_cache)
+	{
+		// no usable history (the first frame, or a new size), every primary ray started cold
+		if (!use_temporal)
+		{
+			stats.temporal_misses = static_cast<uint64_t>(width) * height;
+		}
+		std::swap(temporal_history, temporal_current);
+		temporal_width = width;
+		temporal_height = height;
+	}
+	stats.render_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+	return true;
+}
+
+unsigned CPURenderer::getWidth() const
+{
+	return width;
+}
+
+unsigned CPURenderer::getHeight() const
+{
+	return height;
+}
+
+const std::vector<hlsl::float4> &CPURenderer::getFramebuffer() const
+{
+	return framebuffer;
+}
+
+const CPURenderer::Stats &CPURenderer::getStats() const
+{
+	return stats;
+}
+
+const std::vector<TileScheduler::TileTiming> &CPURenderer::getTileTimings() const
+{
+	return scheduler.getTimings();
+}
+
+const std::vector<CPURenderer::PrimaryDistance> &CPURenderer::getPrimaryDistances() const
+{
+	return primary_distances;
+}
+
+bool CPURenderer::saveImage(const std::filesystem::path &filename) const
+{
+	std::ofstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	// negative scale means little endian
+	file << "PF\n" << width << " " << height << "\n-1.0\n";
+
+	// pfm stores the rows bottom to top
+	std::vector<float> row(static_cast<size_t>(width) * 3);
+	for (unsigned y = height; y-- > 0;)
+	{
+		for (unsigned x = 0; x < width; ++x)
+		{
+			const auto &pixel = framebuffer[static_cast<size_t>(y) * width + x];
+			row[x * 3 + 0] = pixel.r;
+			row[x * 3 + 1] = pixel.g;
+			row[x * 3 + 2] = pixel.b;
+		}
+		file.write(reinterpret_cast<const char *>(row.data()), row.size() * sizeof(float));
+	}
+	return static_cast<bool>(file);
+}
+
+void CPURenderer::reprojectTemporalCache(const Camera &camera)
+{
+	// splat the hits of last frame into this one, keeping the closest per pixel
+	Math3D::Matrix4x4 full_matrix = camera.GetFullMatrix();
+	hlsl::float3 eye = hlsl::toFloat3(camera.GetEye());
+
+	temporal_reprojected.assign(static_cast<size_t>(width) * height, {});
+
+	// the hits into clip space, all at once
+	reprojection_points.clear();
+	for (const auto &sample : temporal_history)
+	{
+		if (sample.hit)
+		{
+			reprojection_points.emplace_back(sample.pos.x, sample.pos.y, sample.pos.z);
+		}
+	}
+	reprojection_clip.resize(reprojection_points.size());
+	full_matrix.TransformPoints(reprojection_points.data(), reprojection_clip.data(), reprojection_points.size());
+
+	size_t hit_index = 0;
+	for (const auto &sample : temporal_history)
+	{
+		if (!sample.hit)
+		{
+			continue;
+		}
+
+		const Math3D::Vector4 &clip = reprojection_clip[hit_index++];
+		if (clip.w <= 0.f)
+		{
+			continue; // behind the camera now
+		}
+
+		float px = (clip.x / clip.w * 0.5f + 0.5f) * width;
+		float py = (0.5f - clip.y / clip.w * 0.5f) * height;
+		if (px < 0.f || py < 0.f || px >= width || py >= height)
+		{
+			continue;
+		}
+
+		auto &reprojection = temporal_reprojected[static_cast<size_t>(py) * width + static_cast<size_t>(px)];
+		float distance = hlsl::length(sample.pos - eye);
+		if (!reprojection.valid || distance < reprojection.distance)
+		{
+			reprojection.valid = true;
+			reprojection.distance = distance;
+			reprojection.iterations = sample.iterations;
+		}
+	}
+}
+
+float CPURenderer::getVariable(const char *name, float default_value) const
+{
+	if (variables)
+	{
+		auto iter = variables->find(name);
+		if (iter != variables->end())
+		{
+			return iter->second.value;
+		}
+	}
+	return default_value;
+}
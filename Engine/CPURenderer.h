@@ -0,0 +1,134 @@
+#pragma once
+
+#include "HLSL.h"
+#include "Math3D.h"
+#include "PacketMarcher.h"
+#include "Profiler.h"
+#include "ShaderVariable.h"
+#include "TileScheduler.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+class Camera;
+class CPUScene;
+
+// a reference implementation of pshader_sdf.hlsl on the cpu
+// renders into a hdr float framebuffer, without any graphics device
+class CPURenderer
+{
+public:
+	struct Stats
+	{
+		uint64_t rays = 0; // how many rays were traced, including shadow rays
+		uint64_t iterations = 0; // raymarching steps over all rays
+		uint64_t map_calls = 0; // calls into the scene, including the cone pass
+		uint64_t cone_iterations = 0; // steps of the cone pass
+		uint64_t temporal_hits = 0; // primary rays warm started from last frame
+		uint64_t temporal_misses = 0; // primary rays without a usable reprojection, started cold
+		uint64_t temporal_iterations_saved = 0; // estimated from what the pixels cost before
+		uint64_t rays_dropped = 0; // secondary rays lost because all RAY_COUNT slots of the pixel were taken
+		uint64_t rays_culled = 0; // secondary rays ended for their small contribution, by the cutoff or the roulette
+		double render_time = 0.0; // in seconds
+	};
+
+	// where the primary ray of a pixel started and ended, to check the passes which skip ahead
+	struct PrimaryDistance
+	{
+		float start; // from the cone pass and the temporal cache
+		float hit; // the camera distance of the hit, negative for a miss
+	};
+
+	void setScene(const CPUScene *scene);
+	// the user variables, used for the debug plane. may be nullptr for the defaults
+	void setVariables(const VariableMap *variables);
+	// 0 means one thread per core
+	void setThreadCount(unsigned thread_count);
+	// the frame is rendered in tiles of tile_size pixels, handed out in this order
+	void setTiling(unsigned tile_size, TileScheduler::Order tile_order);
+	// before the primary rays, one cone per block of cone_block_size pixels (refined down to 4x4)
+	// finds how far the rays can skip ahead. 0 disables it
+	void setConeBlockSize(unsigned cone_block_size);
+	// keeps where the primary rays hit, to warm start them in the next frame
+	void setTemporalCache(bool enable);
+	// marches the primary rays in SIMD packets, the rest of the shading stays per pixel
+	void setPacketMarching(bool enable, PacketMarcher::Backend backend = PacketMarcher::Backend::Auto);
+	// the normals from one scene evaluation on duals, instead of three more for the differences
+	// scenes without a map_gradient port always use the differences
+	void setDualGradient(bool enable);
+	// the shadow rays of a hit are marched together, outside of the bounces and ray slots
+	// a penumbra from how close they pass by the scene, the bigger the sharper
+	// 0 keeps them hard, a 0/1 visibility which gives the same image as the shader
+	void setSoftShadows(float sharpness);
+	// reflection, refraction and transparency rays whose contribution (the largest channel) is below
+	// the cutoff are not traced. 0 traces all of them, like the shader
+	void setContributionCutoff(float cutoff);
+	// below the threshold, those rays go on with a probability by their contribution and count
+	// for the ones which ended. unbiased, but noisy. 0 disables it
+	void setRussianRoulette(float threshold);
+	// scopes for the frame, every tile and the passes in it. nullptr to stop
+	void setProfiler(Profiler *profiler);
+
+	bool render(const Camera &camera, unsigned width, unsigned height);
+
+	unsigned getWidth() const;
+	unsigned getHeight() const;
+	// rgb: the hdr color, a: if the pixel uses hdr (like the alpha output of ps_main)
+	const std::vector<hlsl::float4> &getFramebuffer() const;
+	const Stats &getStats() const;
+	// how long each tile of the last frame took, to see the load imbalance
+	const std::vector<TileScheduler::TileTiming> &getTileTimings() const;
+	// per pixel of the last frame
+	const std::vector<PrimaryDistance> &getPrimaryDistances() const;
+
+	// writes the framebuffer as a portable float map
+	bool saveImage(const std::filesystem::path &filename) const;
+private:
+	float getVariable(const char *name, float default_value) const;
+	void reprojectTemporalCache(const Camera &camera);
+
+	struct TemporalSample
+	{
+		hlsl::float3 pos; // where the primary ray ended
+		float iterations; // what a cold start costs, estimated
+		bool hit;
+	};
+	struct TemporalReprojection
+	{
+		bool valid;
+		float distance; // from the current eye
+		float iterations;
+	};
+
+	const CPUScene *scene = nullptr;
+	const VariableMap *variables = nullptr;
+	unsigned thread_count = 0;
+	unsigned tile_size = 32;
+	TileScheduler::Order tile_order = TileScheduler::Order::Scanline;
+	unsigned cone_block_size = 8;
+	static constexpr unsigned min_cone_block_size = 4;
+	bool temporal_cache = false;
+	bool packet_marching = true;
+	PacketMarcher::Backend packet_backend = PacketMarcher::Backend::Auto;
+	bool dual_gradient = true;
+	float shadow_sharpness = 0.f;
+	float contribution_cutoff = 0.f;
+	float roulette_threshold = 0.f;
+	uint32_t frame_index = 0; // varies the roulette from frame to frame
+	Profiler *profiler = nullptr;
+
+	unsigned width = 0, height = 0;
+	std::vector<hlsl::float4> framebuffer;
+	std::vector<PrimaryDistance> primary_distances;
+	Stats stats;
+	TileScheduler scheduler;
+
+	// per pixel. the history is from last frame, with its size
+	std::vector<TemporalSample> temporal_history, temporal_current;
+	std::vector<TemporalReprojection> temporal_reprojected;
+	// the hits of last frame and where they are now, kept to save the allocations
+	std::vector<Math3D::Vector3> reprojection_points;
+	std::vector<Math3D::Vector4> reprojection_clip;
+	unsigned temporal_width = 0, temporal_height = 0;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Dual.h"
+#include "HLSL.h"
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// pull in the structs and constants which are shared with the shader
+namespace hlsl
+{
+#include "shader/sdf_structs.hlsl"
+#include "shader/sdf_constants.hlsl"
+}
+
+// the cpu counterpart of an sdf_scene_*.hlsl file
+// the functions follow the signatures of the shader functions
+class CPUScene
+{
+public:
+	virtual ~CPUScene() = default;
+
+	void setParameters(float stime)
+	{
+		this->stime = stime;
+	}
+
+	virtual void map(const hlsl::GeometryInput &geometry, const hlsl::MarchingInput &march, const hlsl::MaterialInput &material_input, hlsl::MaterialOutput &material_output, bool geometry_step, float &output_scene_distance) const = 0;
+	virtual void map_normal(const hlsl::GeometryInput &geometry, hlsl::NormalOutput &output) const
+	{
+	}
+	// the geometry step of map on duals (see SDFLibraryDual.h), pos is geometry.pos seeded with the axes
+	// gives the distance and its gradient in one call, for the normals. false if the scene has no such port
+	virtual bool map_gradient(const hlsl::GeometryInput &, const hlsl::dual3 &, const hlsl::MarchingInput &, hlsl::dual &) const
+	{
+		return false;
+	}
+	virtual void map_light(const hlsl::GeometryInput &input, hlsl::LightOutput (&output)[LIGHT_COUNT], float &ambient_lighting_factor) const = 0;
+	virtual hlsl::float3 map_background(const hlsl::float3 &dir, hlsl::uint iter_count) const = 0;
+protected:
+	float stime = 0.f;
+};
+
+// returns the cpu port of the scene with the given name (the file stem, e.g. "sdf_scene_fast_sphere")
+// or nullptr if there is none
+std::unique_ptr<CPUScene> createCPUScene(std::string_view name);
+// the names of all scenes with a cpu port, sorted
+std::vector<std::string_view> getCPUSceneNames();
@@ -0,0 +1,345 @@
+#include "CPUScene.h"
+#include "SDFLibraryDual.h"
+
+#include <functional>
+#include <map>
+#include <string>
+
+namespace hlsl
+{
+	namespace
+	{
+		// scenes/sdf_scene_fast_sphere.hlsl
+		class FastSphereScene : public CPUScene
+		{
+		public:
+			// the geometry of map, on float3 for map and on dual3 for map_gradient
+			template<class vec3>
+			auto sdScene(const GeometryInput &geometry, const vec3 &pos) const
+			{
+				return sdSphereFast(pos - float3(0.f, 1.f, 0.f), geometry.dir, 0.5f);
+			}
+
+			void map(const GeometryInput &geometry, const MarchingInput &march, const MaterialInput &material_input, MaterialOutput &material_output, bool geometry_step, float &output_scene_distance) const override
+			{
+				map_groundplane(geometry, material_output, geometry_step, output_scene_distance);
+
+				float sphere = sdScene(geometry, geometry.pos);
+
+				if (geometry_step)
+				{
+					OBJECT(sphere);
+				}
+				else
+				{
+					if (MATERIAL(sphere))
+					{
+						material_output.diffuse_color = float4(0.2f, 0.7f, 0.2f, 1.f);
+						material_output.specular_color.rgb = 0.5f;
+					}
+				}
+			}
+
+			bool map_gradient(const GeometryInput &geometry, const dual3 &pos, const MarchingInput &march, dual &output_scene_distance) const override
+			{
+				map_groundplane(geometry, pos, output_scene_distance);
+
+				dual sphere = sdScene(geometry, pos);
+				OBJECT(sphere);
+				return true;
+			}
+
+			void map_light(const GeometryInput &input, LightOutput (&output)[LIGHT_COUNT], float &ambient_lighting_factor) const override
+			{
+				output[0].used = true;
+				output[0].pos = float4(-1.f, -1.f, 2.f, 1.f);
+				output[0].color = float3(1.f, 1.f, 1.f);
+			}
+
+			float3 map_background(const float3 &dir, uint iter_count) const override
+			{
+				return sky_color(dir, stime);
+			}
+		};
+
+		// scenes/sdf_scene_gyroid.hlsl
+		class GyroidScene : public CPUScene
+		{
+		public:
+			// on float3 and on dual3, as everything below
+			template<class vec3>
+			static auto sdGyroid(const vec3 &p)
+			{
+				return dot(sin(p.xyz), cos(p.zxy));
+			}
+
+			// the geometry of map, on float3 for map and on dual3 for map_gradient
+			template<class vec3>
+			auto sdScene(const vec3 &pos) const
+			{
+				auto gyroid = sdGyroid(pos.xyz * 7.f) / 14.f;
+				gyroid = abs(gyroid) - 0.01f;
+				auto box = sdBox(pos.xyz, float3(1.f, 1.f, 1.f));
+				return max(gyroid, box);
+			}
+
+			void map(const GeometryInput &geometry, const MarchingInput &march, const MaterialInput &material_input, MaterialOutput &material_output, bool geometry_step, float &output_scene_distance) const override
+			{
+				float obj = sdScene(geometry.pos);
+
+				if (geometry_step)
+				{
+					OBJECT(obj);
+				}
+				else
+				{
+					if (MATERIAL(obj))
+					{
+						material_output.diffuse_color.rgb = float3(0.9f, 0.7f, 0.2f);
+						material_output.specular_color.rgb = 0.5f;
+					}
+				}
+			}
+
+			bool map_gradient(const GeometryInput &geometry, const dual3 &pos, const MarchingInput &march, dual &output_scene_distance) const override
+			{
+				dual obj = sdScene(pos);
+				OBJECT(obj);
+				return true;
+			}
+
+			void map_light(const GeometryInput &input, LightOutput (&output)[LIGHT_COUNT], float &ambient_lighting_factor) const override
+			{
+				output[0].used = true;
+				output[0].pos = float4(-1.f, -1.f, 2.f, 1.f);
+				output[0].color = float3(1.f, 1.f, 1.f);
+			}
+
+			float3 map_background(const float3 &dir, uint iter_count) const override
+			{
+				return sky_color(dir, stime);
+			}
+		};
+
+		// scenes/sdf_scene_gems.hlsl
+		class GemsScene : public CPUScene
+		{
+		public:
+			// the geometry of map, on float3 for map and on dual3 for map_gradient
+			// index is the gem, which picks the color
+			template<class vec3>
+			auto sdScene(const vec3 &pos, float &index) const
+			{
+				vec3 obj_pos = pos;
+				obj_pos.xz = opRotate(obj_pos.xz, stime * 0.5f);
+				index = opRepAngle(obj_pos.xz, 8.f);
+				obj_pos.x -= 1.f;
+				obj_pos.y -= 1.f;
+				opRepAngle(obj_pos.xz, 8.f);
+				auto plane1 = sdPlane(obj_pos.xyz - float3(0.1f, 0.1f, 0.f), float3(0.707f, 0.707f, 0.f));
+				auto plane2 = sdPlane(obj_pos.xyz, float3(0.707f, -0.707f, 0.f));
+				auto plane3 = sdPlane(obj_pos.xyz - float3(0.f, 0.13f, 0.f), float3(0.f, 1.f, 0.f));
+				return smax2(smax2(plane1, plane2, 0.001f), plane3, 0.001f);
+			}
+
+			void map(const GeometryInput &geometry, const MarchingInput &march, const MaterialInput &material_input, MaterialOutput &material_output, bool geometry_step, float &output_scene_distance) const override
+			{
+				map_groundplane(geometry, material_output, geometry_step, output_scene_distance);
+
+				float index;
+				float gems = sdScene(geometry.pos, index);
+
+				if (geometry_step)
+				{
+					OBJECT(gems);
+				}
+				else
+				{
+					if (MATERIAL(gems))
+					{
+						float3 ruby_color = float3(0.8f, 0.1f, 0.3f);
+						float3 saph_color = float3(0.8f, 0.7f, 0.1f);
+						material_output.diffuse_color.xyz = frac(index * 0.5f + 0.25f) > 0.5f ? ruby_color : saph_color;
+						material_output.specular_color.rgb = 1.f;
+						material_output.refraction_color.rgb = 0.5f;
+					}
+				}
+			}
+
+			bool map_gradient(const GeometryInput &geometry, const dual3 &pos, const MarchingInput &march, dual &output_scene_distance) const override
+			{
+				map_groundplane(geometry, pos, output_scene_distance);
+
+				float index;
+				dual gems = sdScene(pos, index);
+				OBJECT(gems);
+				return true;
+			}
+
+			void map_light(const GeometryInput &input, LightOutput (&output)[LIGHT_COUNT], float &ambient_lighting_factor) const override
+			{
+				output[0].used = true;
+				output[0].pos = float4(-1.f, -1.f, 2.f, 1.f);
+				output[0].color = float3(1.f, 1.f, 1.f);
+			}
+
+			float3 map_background(const float3 &dir, uint iter_count) const override
+			{
+				return sky_color(dir, stime);
+			}
+		};
+
+		// scenes/sdf_scene_light_shadows.hlsl
+		class LightShadowsScene : public CPUScene
+		{
+		public:
+			static float3 color_from_index(uint index)
+			{
+				float h = ((float)index) / 5.f;
+				float3 color = HSVtoRGB(float3(h, 1.f, 1.f));
+				float brightness = RGBtoBrightness(color);
+				return color / brightness;
+			}
+
+			// the geometry of map, on float3 for map and on dual3 for map_gradient
+			// returns the cubes, spheres are the lights
+			template<class vec3, class scalar>
+			scalar sdScene(const vec3 &pos, scalar (&spheres)[5]) const
+			{
+				// cubes
+				vec3 cube_pos = pos;
+				cube_pos.xz = opRepLim(cube_pos.xz, float2(2.f, 2.f), float2(3.f, 3.f));
+				scalar cubes = sdBox(cube_pos - float3(0.f, 1.f, 0.f), 0.4f) - 0.1f;
+
+				float time = stime * 0.25f;
+
+				for (uint i = 0; i < 5; ++i)
+				{
+					time += pi * 2.f / 5.f;
+					float sphere_x = cos(time * 1.f) * -5.f;
+					float sphere_y = (cos(time * 2.f) * -0.5f + 0.5f) * 2.f + 1.f;
+					float sphere_z = sin(time * 2.f) * 2.f;
+
+					spheres[i] = sdSphere(pos - float3(sphere_x, sphere_y, sphere_z), 0.2f);
+				}
+				return cubes;
+			}
+
+			void map(const GeometryInput &geometry, const MarchingInput &march, const MaterialInput &material_input, MaterialOutput &material_output, bool geometry_step, float &output_scene_distance) const override
+			{
+				map_groundplane(geometry, material_output, geometry_step, output_scene_distance);
+
+				float spheres[5];
+				float cubes = sdScene(geometry.pos, spheres);
+
+				if (geometry_step)
+				{
+					if (!march.is_shadow_pass)
+					{
+						OBJECT(spheres[0]);
+						OBJECT(spheres[1]);
+						OBJECT(spheres[2]);
+						OBJECT(spheres[3]);
+						OBJECT(spheres[4]);
+					}
+					OBJECT(cubes);
+				}
+				else
+				{
+					for (uint i = 0; i < 5; ++i)
+					{
+						if (MATERIAL(spheres[i]))
+						{
+							material_output.emissive_color = color_from_index(i);
+						}
+					}
+					if (MATERIAL(cubes))
+					{
+						material_output.diffuse_color.rgb = 0.65f;
+						material_output.specular_color.rgb = 0.75f;
+					}
+				}
+			}
+
+			bool map_gradient(const GeometryInput &geometry, const dual3 &pos, const MarchingInput &march, dual &output_scene_distance) const override
+			{
+				map_groundplane(geometry, pos, output_scene_distance);
+
+				dual spheres[5];
+				dual cubes = sdScene(pos, spheres);
+				if (!march.is_shadow_pass)
+				{
+					OBJECT(spheres[0]);
+					OBJECT(spheres[1]);
+					OBJECT(spheres[2]);
+					OBJECT(spheres[3]);
+					OBJECT(spheres[4]);
+				}
+				OBJECT(cubes);
+				return true;
+			}
+
+			void map_light(const GeometryInput &input, LightOutput (&output)[LIGHT_COUNT], float &ambient_lighting_factor) const override
+			{
+				float time = stime * 0.25f;
+
+				for (uint i = 0; i < 5; ++i)
+				{
+					time += pi * 2.f / 5.f;
+					float sphere_x = cos(time * 1.f) * -5.f;
+					float sphere_y = (cos(time * 2.f) * -0.5f + 0.5f) * 2.f + 0.5f;
+					float sphere_z = sin(time * 2.f) * 2.f;
+
+					output[i + 1].used = true;
+					output[i + 1].pos.xyz = float3(sphere_x, sphere_y, sphere_z);
+					output[i + 1].extend = 0.25f;
+					output[i + 1].falloff = 0.25f;
+					output[i + 1].color = color_from_index(i) * 0.5f;
+				}
+			}
+
+			float3 map_background(const float3 &dir, uint iter_count) const override
+			{
+				return sky_color(dir, stime);
+			}
+		};
+	}
+}
+
+namespace
+{
+	using SceneFactories = std::map<std::string, std::function<std::unique_ptr<CPUScene>()>, std::less<>>;
+
+	const SceneFactories &getSceneFactories()
+	{
+		static const SceneFactories scenes =
+		{
+			{ "sdf_scene_fast_sphere", [] { return std::make_unique<hlsl::FastSphereScene>(); } },
+			{ "sdf_scene_gems", [] { return std::make_unique<hlsl::GemsScene>(); } },
+			{ "sdf_scene_gyroid", [] { return std::make_unique<hlsl::GyroidScene>(); } },
+			{ "sdf_scene_light_shadows", [] { return std::make_unique<hlsl::LightShadowsScene>(); } },
+		};
+		return scenes;
+	}
+}
+
+std::unique_ptr<CPUScene> createCPUScene(std::string_view name)
+{
+	auto &scenes = getSceneFactories();
+	auto iter = scenes.find(name);
+	if (iter == scenes.end())
+	{
+		return nullptr;
+	}
+	return iter->second();
+}
+
+std::vector<std::string_view> getCPUSceneNames()
+{
+	std::vector<std::string_view> names;
+	for (auto &[name, factory] : getSceneFactories())
+	{
+		names.push_back(name);
+	}
+	return names;
+}
@@ -1,5 +1,98 @@
 #include "Camera.h"
 #include <math.h>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CAMERA_SSE
+#include <xmmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define CAMERA_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+	// 4 pixels of a row. like in Math3D, no fused multiply add, so the lanes match the scalar code
+#if defined(CAMERA_SSE)
+	using Lanes = __m128;
+
+	Lanes set1(float a)
+	{
+		return _mm_set1_ps(a);
+	}
+	Lanes ramp(float a) // a, a + 1, a + 2, a + 3
+	{
+		return _mm_add_ps(_mm_set1_ps(a), _mm_setr_ps(0.f, 1.f, 2.f, 3.f));
+	}
+	Lanes add(Lanes a, Lanes b)
+	{
+		return _mm_add_ps(a, b);
+	}
+	Lanes sub(Lanes a, Lanes b)
+	{
+		return _mm_sub_ps(a, b);
+	}
+	Lanes mul(Lanes a, Lanes b)
+	{
+		return _mm_mul_ps(a, b);
+	}
+	Lanes div(Lanes a, Lanes b)
+	{
+		return _mm_div_ps(a, b);
+	}
+	Lanes sqrt(Lanes a)
+	{
+		return _mm_sqrt_ps(a);
+	}
+	void store(float *p, Lanes a)
+	{
+		_mm_storeu_ps(p, a);
+	}
+#elif defined(CAMERA_NEON)
+	using Lanes = float32x4_t;
+
+	Lanes set1(float a)
+	{
+		return vdupq_n_f32(a);
+	}
+	Lanes ramp(float a) // a, a + 1, a + 2, a + 3
+	{
+		static const float offsets[4] = { 0.f, 1.f, 2.f, 3.f };
+		return vaddq_f32(vdupq_n_f32(a), vld1q_f32(offsets));
+	}
+	Lanes add(Lanes a, Lanes b)
+	{
+		return vaddq_f32(a, b);
+	}
+	Lanes sub(Lanes a, Lanes b)
+	{
+		return vsubq_f32(a, b);
+	}
+	Lanes mul(Lanes a, Lanes b)
+	{
+		return vmulq_f32(a, b);
+	}
+	Lanes div(Lanes a, Lanes b)
+	{
+		return vdivq_f32(a, b);
+	}
+	Lanes sqrt(Lanes a)
+	{
+		return vsqrtq_f32(a);
+	}
+	void store(float *p, Lanes a)
+	{
+		vst1q_f32(p, a);
+	}
+#endif
+
+	void resize(Camera::RayVectors &vectors, size_t count)
+	{
+		vectors.x.resize(count);
+		vectors.y.resize(count);
+		vectors.z.resize(count);
+	}
+}
 
 Camera::Camera() : mode(CameraMode::FPS)
 {
@@ -164,6 +257,80 @@ Math3D::Vector3 Camera::GetFrustrumEdge(unsigned index) const
 	Math3D::Matrix4x4 mat = Math3D::Matrix4x4::RotationAxisMatrix(dir, roll);
 	return dir + (mat * yaxis) * tanf(fovy / 2.f) * flip[2 * index] + (mat * xaxis) * tanf(fovy / 2.f) * aspect * flip[2 * index + 1];
 }
+Camera::RayBasis Camera::GetRayBasis() const
+{
+	// the frustum edges, without the cancellation of subtracting them
+	Math3D::Matrix4x4 mat = Math3D::Matrix4x4::RotationAxisMatrix(dir, roll);
+	float tan_half = tanf(fovy / 2.f);
+	RayBasis basis;
+	basis.eye = eye;
+	basis.front = dir;
+	basis.right = (mat * GetRelXAxis()) * tan_half * aspect;
+	basis.top = (mat * GetRelYAxis()) * tan_half;
+	return basis;
+}
+void Camera::RayBasis::GenerateRays(const TileScheduler::Tile &tile, unsigned image_width, unsigned image_height, RayVectors &origins, RayVectors &dirs, RayFootprints &footprints) const
+{
+	size_t count = static_cast<size_t>(tile.width) * tile.height;
+	resize(origins, count);
+	resize(dirs, count);
+	resize(footprints.right, count);
+	resize(footprints.bottom, count);
+	std::fill(origins.x.begin(), origins.x.end(), eye.x);
+	std::fill(origins.y.begin(), origins.y.end(), eye.y);
+	std::fill(origins.z.begin(), origins.z.end(), eye.z);
+
+	// the screen space derivatives, as ddx and ddy would return them
+	float width = static_cast<float>(image_width), height = static_cast<float>(image_height);
+	Math3D::Vector3 right_step = right * (2.f / width);
+	Math3D::Vector3 bottom_step = top * (-2.f / height);
+
+	for (unsigned row = 0; row < tile.height; ++row)
+	{
+		// the pixel centers, as the rasterizer interpolates them
+		float screen_y = 1.f - (static_cast<float>(tile.y + row) + 0.5f) / height * 2.f;
+		Math3D::Vector3 row_dir = Math3D::Vector3(screen_y * top.x, screen_y * top.y, screen_y * top.z);
+		size_t index = static_cast<size_t>(row) * tile.width;
+		unsigned column = 0;
+#if defined(CAMERA_SSE) || defined(CAMERA_NEON)
+		for (; column + 4 <= tile.width; column += 4, index += 4)
+		{
+			Lanes screen_x = sub(mul(div(add(ramp(static_cast<float>(tile.x + column)), set1(0.5f)), set1(width)), set1(2.f)), set1(1.f));
+			Lanes dir_x = add(add(set1(front.x), mul(screen_x, set1(right.x))), set1(row_dir.x));
+			Lanes dir_y = add(add(set1(front.y), mul(screen_x, set1(right.y))), set1(row_dir.y));
+			Lanes dir_z = add(add(set1(front.z), mul(screen_x, set1(right.z))), set1(row_dir.z));
+			Lanes invlen = div(set1(1.f), sqrt(add(add(mul(dir_x, dir_x), mul(dir_y, dir_y)), mul(dir_z, dir_z))));
+			store(&dirs.x[index], mul(dir_x, invlen));
+			store(&dirs.y[index], mul(dir_y, invlen));
+			store(&dirs.z[index], mul(dir_z, invlen));
+			store(&footprints.right.x[index], mul(set1(right_step.x), invlen));
+			store(&footprints.right.y[index], mul(set1(right_step.y), invlen));
+			store(&footprints.right.z[index], mul(set1(right_step.z), invlen));
+			store(&footprints.bottom.x[index], mul(set1(bottom_step.x), invlen));
+			store(&footprints.bottom.y[index], mul(set1(bottom_step.y), invlen));
+			store(&footprints.bottom.z[index], mul(set1(bottom_step.z), invlen));
+		}
+#endif
+		// the rest of the row, one by one
+		for (; column < tile.width; ++column, ++index)
+		{
+			float screen_x = (static_cast<float>(tile.x + column) + 0.5f) / width * 2.f - 1.f;
+			float dir_x = front.x + screen_x * right.x + row_dir.x;
+			float dir_y = front.y + screen_x * right.y + row_dir.y;
+			float dir_z = front.z + screen_x * right.z + row_dir.z;
+			float invlen = 1.f / sqrtf(dir_x * dir_x + dir_y * dir_y + dir_z * dir_z);
+			dirs.x[index] = dir_x * invlen;
+			dirs.y[index] = dir_y * invlen;
+			dirs.z[index] = dir_z * invlen;
+			footprints.right.x[index] = right_step.x * invlen;
+			footprints.right.y[index] = right_step.y * invlen;
+			footprints.right.z[index] = right_step.z * invlen;
+			footprints.bottom.x[index] = bottom_step.x * invlen;
+			footprints.bottom.y[index] = bottom_step.y * invlen;
+			footprints.bottom.z[index] = bottom_step.z * invlen;
+		}
+	}
+}
 Math3D::Matrix4x4 Camera::GetViewMatrix() const
 {
 	if (mode == CameraMode::FPS)
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "Math3D.h"
+#include "TileScheduler.h"
+
+#include <vector>
 
 class Camera
 {
@@ -11,6 +14,29 @@ public:
 		Flight
 	};
 
+	// structure of arrays, one entry per pixel
+	struct RayVectors
+	{
+		std::vector<float> x, y, z;
+	};
+	// how far the rays of the pixel to the right and the one below are off, per unit of distance along the ray
+	struct RayFootprints
+	{
+		RayVectors right, bottom;
+	};
+
+	// what the rays of a frame are made of, so there is no trigonometry per pixel
+	// the ray through the screen position (sx, sy) in [-1, 1] goes along front + sx * right + sy * top
+	struct RayBasis
+	{
+		Math3D::Vector3 eye;
+		Math3D::Vector3 front, right, top;
+
+		// the normalized primary rays through the pixel centers of the tile, row by row, for an image of image_width x image_height
+		// the same as the pixel shader computes them, 4 pixels at a time where the cpu can
+		void GenerateRays(const TileScheduler::Tile &tile, unsigned image_width, unsigned image_height, RayVectors &origins, RayVectors &dirs, RayFootprints &footprints) const;
+	};
+
 	Camera();
 
 	void SetCameraMode(CameraMode);
@@ -47,6 +73,8 @@ public:
 	// 2 -> bottom left
 	// 3 -> top left
 	Math3D::Vector3 GetFrustrumEdge(unsigned index) const;
+	// once per frame, right and top reach the frustum edges
+	RayBasis GetRayBasis() const;
 
 	void MoveAbs(const Math3D::Vector3 &);
 	void MoveRel(const Math3D::Vector3 &);
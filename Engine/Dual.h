@@ -0,0 +1,331 @@
+#pragma once
+
+#include "HLSL.h"
+
+// forward mode automatic differentiation, for the cpu port of the shader libraries
+// a dual is a value together with its gradient with respect to the evaluated position.
+// evaluating a distance function on the position as a dual3 gives the distance and its exact
+// gradient in one go, where finite differences need a map call per axis
+//
+// floats convert to constants, so the ported functions read like the hlsl ones
+// only what the ports in SDFLibraryDual.h and the scenes need is here, including the swizzles
+namespace hlsl
+{
+	struct dual
+	{
+		dual() = default;
+		dual(float v) : v(v), d(0.f) // a constant
+		{
+		}
+		dual(float v, const float3 &d) : v(v), d(d)
+		{
+		}
+
+		float v; // the value
+		float3 d; // d/dx, d/dy, d/dz
+	};
+
+	// a component like .x of dual2 and dual3. dual has constructors, so unlike the floats the
+	// components can not be in an anonymous struct in the union, they are proxies like the swizzles
+	template<unsigned N, unsigned I>
+	struct DualComponent
+	{
+		operator dual &()
+		{
+			return e[I];
+		}
+		operator const dual &() const
+		{
+			return e[I];
+		}
+
+		DualComponent &operator = (const dual &value)
+		{
+			e[I] = value;
+			return *this;
+		}
+		// as for the swizzles, the implicit copy assignment would copy all components
+		template<class S> requires std::is_same_v<std::remove_cvref_t<S>, DualComponent>
+		DualComponent &operator = (S &&other)
+		{
+			e[I] = other.e[I];
+			return *this;
+		}
+
+		dual e[N];
+	};
+
+	struct dual2
+	{
+		dual2() = default;
+		dual2(const dual &x, const dual &y) : v{ x, y }
+		{
+		}
+		dual2(const float2 &a) : v{ a.x, a.y }
+		{
+		}
+
+		float2 value() const
+		{
+			return float2(v[0].v, v[1].v);
+		}
+
+		union
+		{
+			dual v[2];
+			DualComponent<2, 0> x;
+			DualComponent<2, 1> y;
+		};
+	};
+
+	struct dual3
+	{
+		dual3() = default;
+		dual3(const dual &x, const dual &y, const dual &z) : v{ x, y, z }
+		{
+		}
+		dual3(const float3 &a) : v{ a.x, a.y, a.z }
+		{
+		}
+
+		// the position everything is differentiated by, each component seeded with its axis
+		static dual3 position(const float3 &pos)
+		{
+			return dual3(dual(pos.x, float3(1.f, 0.f, 0.f)), dual(pos.y, float3(0.f, 1.f, 0.f)), dual(pos.z, float3(0.f, 0.f, 1.f)));
+		}
+
+		float3 value() const
+		{
+			return float3(v[0].v, v[1].v, v[2].v);
+		}
+
+		union
+		{
+			dual v[3];
+			DualComponent<3, 0> x;
+			DualComponent<3, 1> y;
+			DualComponent<3, 2> z;
+			SwizzleOf<dual, 3, dual2, 0, 2> xz;
+			SwizzleOf<dual, 3, dual3, 0, 1, 2> xyz;
+			SwizzleOf<dual, 3, dual3, 2, 0, 1> zxy;
+		};
+	};
+
+	// passed like the float vectors, so a swizzle can be an inout argument
+	template<>
+	struct InOutType<dual2>
+	{
+		using type = InOut<dual2>;
+	};
+	template<>
+	struct InOutType<dual3>
+	{
+		using type = InOut<dual3>;
+	};
+
+	// the product and quotient rules
+	inline dual operator + (const dual &a, const dual &b)
+	{
+		return dual(a.v + b.v, a.d + b.d);
+	}
+	inline dual operator - (const dual &a, const dual &b)
+	{
+		return dual(a.v - b.v, a.d - b.d);
+	}
+	inline dual operator * (const dual &a, const dual &b)
+	{
+		return dual(a.v * b.v, a.d * b.v + a.v * b.d);
+	}
+	inline dual operator / (const dual &a, const dual &b)
+	{
+		return dual(a.v / b.v, (a.d * b.v - a.v * b.d) / (b.v * b.v));
+	}
+	// with a constant, which saves the products with its zero gradient
+	inline dual operator + (const dual &a, float b)
+	{
+		return dual(a.v + b, a.d);
+	}
+	inline dual operator + (float a, const dual &b)
+	{
+		return dual(a + b.v, b.d);
+	}
+	inline dual operator - (const dual &a, float b)
+	{
+		return dual(a.v - b, a.d);
+	}
+	inline dual operator - (float a, const dual &b)
+	{
+		return dual(a - b.v, -b.d);
+	}
+	inline dual operator * (const dual &a, float b)
+	{
+		return dual(a.v * b, a.d * b);
+	}
+	inline dual operator * (float a, const dual &b)
+	{
+		return dual(a * b.v, a * b.d);
+	}
+	inline dual operator / (const dual &a, float b)
+	{
+		return dual(a.v / b, a.d / b);
+	}
+	inline dual operator - (const dual &a)
+	{
+		return dual(-a.v, -a.d);
+	}
+	inline dual &operator += (dual &a, const dual &b)
+	{
+		return a = a + b;
+	}
+	inline dual &operator -= (dual &a, const dual &b)
+	{
+		return a = a - b;
+	}
+	inline dual &operator *= (dual &a, const dual &b)
+	{
+		return a = a * b;
+	}
+	inline dual &operator /= (dual &a, const dual &b)
+	{
+		return a = a / b;
+	}
+
+	// the chain rule, f(a) with f' at a
+	inline dual chain(const dual &a, float value, float derivative)
+	{
+		return dual(value, a.d * derivative);
+	}
+
+	inline dual abs(const dual &a)
+	{
+		return a.v < 0.f ? -a : a;
+	}
+	// like the float versions, which of the two is taken decides the gradient
+	inline dual min(const dual &a, const dual &b)
+	{
+		return a.v < b.v ? a : b;
+	}
+	inline dual max(const dual &a, const dual &b)
+	{
+		return a.v > b.v ? a : b;
+	}
+	inline dual clamp(const dual &a, const dual &lo, const dual &hi)
+	{
+		return min(max(a, lo), hi);
+	}
+	inline dual saturate(const dual &a)
+	{
+		return clamp(a, 0.f, 1.f);
+	}
+	inline dual lerp(const dual &a, const dual &b, const dual &t)
+	{
+		return a + t * (b - a);
+	}
+	inline dual sqrt(const dual &a)
+	{
+		float root = sqrt(a.v);
+		// the gradient of the kink at 0 is taken as 0, instead of infinite
+		return chain(a, root, root > 0.f ? 0.5f / root : 0.f);
+	}
+	inline dual sin(const dual &a)
+	{
+		return chain(a, sin(a.v), cos(a.v));
+	}
+	inline dual cos(const dual &a)
+	{
+		return chain(a, cos(a.v), -sin(a.v));
+	}
+	inline dual atan2(const dual &y, const dual &x)
+	{
+		float inv = 1.f / (x.v * x.v + y.v * y.v);
+		return dual(atan2(y.v, x.v), (y.d * x.v - x.d * y.v) * inv);
+	}
+	// piecewise constant, so there is nothing to differentiate
+	inline float floor(const dual &a)
+	{
+		return floor(a.v);
+	}
+	inline dual frac(const dual &a)
+	{
+		return dual(frac(a.v), a.d);
+	}
+
+	// component wise
+	inline dual2 operator + (const dual2 &a, const dual2 &b)
+	{
+		return dual2(a.x + b.x, a.y + b.y);
+	}
+	inline dual2 operator - (const dual2 &a, const dual2 &b)
+	{
+		return dual2(a.x - b.x, a.y - b.y);
+	}
+	inline dual2 operator * (const dual2 &a, const dual &b)
+	{
+		return dual2(a.x * b, a.y * b);
+	}
+	inline dual dot(const dual2 &a, const dual2 &b)
+	{
+		return a.x * b.x + a.y * b.y;
+	}
+	inline dual length(const dual2 &a)
+	{
+		return sqrt(dot(a, a));
+	}
+	inline dual2 abs(const dual2 &a)
+	{
+		return dual2(abs(a.x), abs(a.y));
+	}
+	inline dual2 max(const dual2 &a, const dual &b)
+	{
+		return dual2(max(a.x, b), max(a.y, b));
+	}
+
+	inline dual3 operator + (const dual3 &a, const dual3 &b)
+	{
+		return dual3(a.x + b.x, a.y + b.y, a.z + b.z);
+	}
+	inline dual3 operator - (const dual3 &a, const dual3 &b)
+	{
+		return dual3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+	inline dual3 operator * (const dual3 &a, const dual &b)
+	{
+		return dual3(a.x * b, a.y * b, a.z * b);
+	}
+	inline dual3 operator * (const dual3 &a, float b)
+	{
+		return dual3(a.x * b, a.y * b, a.z * b);
+	}
+	inline dual3 operator * (const dual3 &a, const float3 &b)
+	{
+		return dual3(a.x * b.x, a.y * b.y, a.z * b.z);
+	}
+	inline dual dot(const dual3 &a, const dual3 &b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+	inline dual dot(const dual3 &a, const float3 &b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+	inline dual length(const dual3 &a)
+	{
+		return sqrt(dot(a, a));
+	}
+	inline dual3 abs(const dual3 &a)
+	{
+		return dual3(abs(a.x), abs(a.y), abs(a.z));
+	}
+	inline dual3 max(const dual3 &a, const dual &b)
+	{
+		return dual3(max(a.x, b), max(a.y, b), max(a.z, b));
+	}
+	inline dual3 sin(const dual3 &a)
+	{
+		return dual3(sin(a.x), sin(a.y), sin(a.z));
+	}
+	inline dual3 cos(const dual3 &a)
+	{
+		return dual3(cos(a.x), cos(a.y), cos(a.z));
+	}
+}
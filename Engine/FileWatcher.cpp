@@ -0,0 +1,380 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// the os specific part. owned by the watcher thread, except for wake
+class FileWatcher::Platform
+{
+public:
+	Platform();
+	~Platform();
+
+	bool isValid() const;
+	// lets wait return early
+	void wake();
+	void watchDirectories(const std::set<std::filesystem::path> &directories);
+	// waits up to timeout (negative = forever) and adds the files that changed
+	void wait(std::chrono::milliseconds timeout, std::vector<std::filesystem::path> &changed);
+private:
+#ifdef _WIN32
+	struct Directory
+	{
+		std::filesystem::path path;
+		HANDLE handle = INVALID_HANDLE_VALUE;
+		OVERLAPPED overlapped = {};
+		alignas(DWORD) char buffer[16384];
+
+		bool read();
+	};
+
+	HANDLE wake_event = nullptr;
+	std::vector<std::unique_ptr<Directory>> directories;
+#else
+	int inotify_fd = -1;
+	int wake_fd = -1;
+	std::map<int, std::filesystem::path> directories; // by watch descriptor
+#endif
+};
+
+#ifdef _WIN32
+FileWatcher::Platform::Platform()
+{
+	wake_event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+}
+
+FileWatcher::Platform::~Platform()
+{
+	watchDirectories({});
+	if (wake_event)
+	{
+		CloseHandle(wake_event);
+	}
+}
+
+bool FileWatcher::Platform::isValid() const
+{
+	return wake_event;
+}
+
+void FileWatcher::Platform::wake()
+{
+	SetEvent(wake_event);
+}
+
+bool FileWatcher::Platform::Directory::read()
+{
+	DWORD filter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE;
+	return ReadDirectoryChangesW(handle, buffer, sizeof(buffer), FALSE, filter, nullptr, &overlapped, nullptr);
+}
+
+void FileWatcher::Platform::watchDirectories(const std::set<std::filesystem::path> &new_directories)
+{
+	// stop the ones we do not need anymore
+	for (auto iter = directories.begin(); iter != directories.end();)
+	{
+		auto &dir = **iter;
+		if (new_directories.count(dir.path))
+		{
+			++iter;
+			continue;
+		}
+		DWORD bytes;
+		CancelIoEx(dir.handle, &dir.overlapped);
+		GetOverlappedResult(dir.handle, &dir.overlapped, &bytes, TRUE);
+		CloseHandle(dir.overlapped.hEvent);
+		CloseHandle(dir.handle);
+		iter = directories.erase(iter);
+	}
+
+	for (auto &path : new_directories)
+	{
+		if (std::any_of(directories.begin(), directories.end(), [&](auto &dir) { return dir->path == path; }))
+		{
+			continue;
+		}
+		// WaitForMultipleObjects takes the wake event plus 63 folders
+		if (directories.size() + 1 >= MAXIMUM_WAIT_OBJECTS)
+		{
+			break;
+		}
+
+		auto dir = std::make_unique<Directory>();
+		dir->path = path;
+		dir->handle = CreateFileW(path.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (dir->handle == INVALID_HANDLE_VALUE)
+		{
+			continue;
+		}
+		dir->overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+		if (!dir->read())
+		{
+			CloseHandle(dir->overlapped.hEvent);
+			CloseHandle(dir->handle);
+			continue;
+		}
+		directories.push_back(std::move(dir));
+	}
+}
+
+void FileWatcher::Platform::wait(std::chrono::milliseconds timeout, std::vector<std::filesystem::path> &changed)
+{
+	std::vector<HANDLE> handles = { wake_event };
+	for (auto &dir : directories)
+	{
+		handles.push_back(dir->overlapped.hEvent);
+	}
+
+	DWORD wait_time = timeout.count() < 0 ? INFINITE : static_cast<DWORD>(timeout.count());
+	DWORD result = WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), FALSE, wait_time);
+	if (result <= WAIT_OBJECT_0 || result >= WAIT_OBJECT_0 + handles.size())
+	{
+		return; // woken up, timeout or error
+	}
+
+	auto &dir = *directories[result - WAIT_OBJECT_0 - 1];
+	DWORD bytes = 0;
+	if (GetOverlappedResult(dir.handle, &dir.overlapped, &bytes, FALSE) && bytes)
+	{
+		for (char *ptr = dir.buffer;;)
+		{
+			auto info = reinterpret_cast<FILE_NOTIFY_INFORMATION *>(ptr);
+			changed.push_back(dir.path / std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR)));
+			if (!info->NextEntryOffset)
+			{
+				break;
+			}
+			ptr += info->NextEntryOffset;
+		}
+	}
+	// zero bytes means the buffer overflowed and the changes are lost. rare with a few shader files
+	dir.read();
+}
+#else
+FileWatcher::Platform::Platform()
+{
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+FileWatcher::Platform::~Platform()
+{
+	if (inotify_fd >= 0)
+	{
+		close(inotify_fd);
+	}
+	if (wake_fd >= 0)
+	{
+		close(wake_fd);
+	}
+}
+
+bool FileWatcher::Platform::isValid() const
+{
+	return inotify_fd >= 0 && wake_fd >= 0;
+}
+
+void FileWatcher::Platform::wake()
+{
+	uint64_t one = 1;
+	[[maybe_unused]] auto written = write(wake_fd, &one, sizeof(one));
+}
+
+void FileWatcher::Platform::watchDirectories(const std::set<std::filesystem::path> &new_directories)
+{
+	for (auto iter = directories.begin(); iter != directories.end();)
+	{
+		if (new_directories.count(iter->second))
+		{
+			++iter;
+			continue;
+		}
+		inotify_rm_watch(inotify_fd, iter->first);
+		iter = directories.erase(iter);
+	}
+
+	for (auto &path : new_directories)
+	{
+		// adding a folder twice returns the same descriptor
+		int wd = inotify_add_watch(inotify_fd, path.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+		if (wd >= 0)
+		{
+			directories[wd] = path;
+		}
+	}
+}
+
+void FileWatcher::Platform::wait(std::chrono::milliseconds timeout, std::vector<std::filesystem::path> &changed)
+{
+	pollfd fds[2] = { { inotify_fd, POLLIN, 0 }, { wake_fd, POLLIN, 0 } };
+	if (poll(fds, 2, timeout.count() < 0 ? -1 : static_cast<int>(timeout.count())) <= 0)
+	{
+		return;
+	}
+
+	if (fds[1].revents & POLLIN)
+	{
+		uint64_t count;
+		[[maybe_unused]] auto bytes = read(wake_fd, &count, sizeof(count));
+	}
+
+	alignas(inotify_event) char buffer[4096];
+	for (;;)
+	{
+		ssize_t size = read(inotify_fd, buffer, sizeof(buffer));
+		if (size <= 0)
+		{
+			break;
+		}
+		for (char *ptr = buffer; ptr < buffer + size;)
+		{
+			auto event = reinterpret_cast<const inotify_event *>(ptr);
+			auto iter = directories.find(event->wd);
+			if (event->len && iter != directories.end())
+			{
+				changed.push_back(iter->second / event->name);
+			}
+			ptr += sizeof(inotify_event) + event->len;
+		}
+	}
+}
+#endif
+
+FileWatcher::FileWatcher() : platform(std::make_unique<Platform>()), debounce(0)
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+	stop();
+}
+
+bool FileWatcher::start(Callback callback, std::chrono::milliseconds debounce)
+{
+	if (thread.joinable() || !platform->isValid())
+	{
+		return false;
+	}
+
+	this->callback = std::move(callback);
+	this->debounce = debounce;
+	stopping = false;
+	// watch before returning, so no change after start gets lost
+	updateWatches();
+	thread = std::thread(&FileWatcher::run, this);
+	return true;
+}
+
+void FileWatcher::stop()
+{
+	if (!thread.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard lock(mutex);
+		stopping = true;
+	}
+	platform->wake();
+	thread.join();
+}
+
+bool FileWatcher::isRunning() const
+{
+	return thread.joinable();
+}
+
+void FileWatcher::setFiles(const std::vector<std::filesystem::path> &files)
+{
+	{
+		std::lock_guard lock(mutex);
+		this->files.clear();
+		for (auto &file : files)
+		{
+			this->files.insert(normalize(file));
+		}
+		files_changed = true;
+	}
+	platform->wake();
+}
+
+void FileWatcher::run()
+{
+	using clock = std::chrono::steady_clock;
+
+	std::set<std::filesystem::path> pending;
+	clock::time_point deadline;
+	std::vector<std::filesystem::path> changed;
+	for (;;)
+	{
+		{
+			std::lock_guard lock(mutex);
+			if (stopping)
+			{
+				break;
+			}
+			if (files_changed)
+			{
+				updateWatches();
+			}
+		}
+
+		auto timeout = std::chrono::milliseconds(-1);
+		if (!pending.empty())
+		{
+			timeout = std::max(std::chrono::ceil<std::chrono::milliseconds>(deadline - clock::now()), std::chrono::milliseconds(0));
+		}
+
+		changed.clear();
+		platform->wait(timeout, changed);
+
+		for (auto &file : changed)
+		{
+			// the folder also has files we do not care about
+			if (watched_files.count(file.lexically_normal()))
+			{
+				pending.insert(file.lexically_normal());
+				deadline = clock::now() + debounce;
+			}
+		}
+
+		if (!pending.empty() && clock::now() >= deadline)
+		{
+			callback({ pending.begin(), pending.end() });
+			pending.clear();
+		}
+	}
+	platform->watchDirectories({});
+}
+
+void FileWatcher::updateWatches()
+{
+	watched_files = files;
+	files_changed = false;
+
+	std::set<std::filesystem::path> directories;
+	for (auto &file : watched_files)
+	{
+		directories.insert(file.parent_path());
+	}
+	platform->watchDirectories(directories);
+}
+
+std::filesystem::path FileWatcher::normalize(const std::filesystem::path &path)
+{
+	std::error_code ec;
+	auto absolute = std::filesystem::absolute(path, ec);
+	return (ec ? path : absolute).lexically_normal();
+}
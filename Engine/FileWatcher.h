@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+// reports changes of a set of files, without polling
+// uses inotify on linux and ReadDirectoryChangesW on windows, on the folders of the files
+// editors often save in several steps (truncate, write, rename), so the changes are
+// collected until nothing happened for the debounce time, then reported at once
+class FileWatcher
+{
+public:
+	// gets called on the watcher thread
+	using Callback = std::function<void(const std::vector<std::filesystem::path> &changed)>;
+
+	FileWatcher();
+	~FileWatcher();
+
+	bool start(Callback callback, std::chrono::milliseconds debounce = std::chrono::milliseconds(50));
+	void stop();
+	bool isRunning() const;
+
+	// replaces the watched files, can be called while running
+	void setFiles(const std::vector<std::filesystem::path> &files);
+private:
+	class Platform;
+
+	void run();
+	// hands the new files to the platform, with the mutex held
+	void updateWatches();
+	static std::filesystem::path normalize(const std::filesystem::path &path);
+
+	std::unique_ptr<Platform> platform;
+	std::thread thread;
+	Callback callback;
+	std::chrono::milliseconds debounce;
+
+	std::set<std::filesystem::path> watched_files; // the copy of the watcher thread
+
+	std::mutex mutex;
+	std::set<std::filesystem::path> files;
+	bool files_changed = false;
+	bool stopping = false;
+};
@@ -0,0 +1,175 @@
+#include "FrameStats.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace
+{
+	// nearest rank, on sorted values
+	double percentile(const std::vector<double> &sorted, double p)
+	{
+		size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+		return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+	}
+
+	std::string quoteCsv(std::string_view text)
+	{
+		std::string quoted = "\"";
+		for (char c : text)
+		{
+			quoted += c == '"' ? "\"\"" : std::string(1, c);
+		}
+		return quoted + "\"";
+	}
+}
+
+FrameStats::FrameStats(size_t window) : window(std::max<size_t>(window, 1)), last_report(std::chrono::steady_clock::now())
+{
+}
+
+void FrameStats::add(std::string_view name, double time)
+{
+	auto iter = series.find(name);
+	if (iter == series.end())
+	{
+		iter = series.emplace(std::string(name), Series{}).first;
+		iter->second.samples.reserve(window);
+	}
+	auto &entry = iter->second;
+	entry.count += 1;
+
+	// welford while it fills up, then the oldest sample is swapped for the new one
+	if (entry.samples.size() < window)
+	{
+		entry.samples.push_back(time);
+		double delta = time - entry.mean;
+		entry.mean += delta / entry.samples.size();
+		entry.m2 += delta * (time - entry.mean);
+		return;
+	}
+	double old_time = entry.samples[entry.next];
+	entry.samples[entry.next] = time;
+	entry.next = (entry.next + 1) % window;
+
+	double old_mean = entry.mean;
+	entry.mean += (time - old_time) / window;
+	entry.m2 += (time - old_time) * (time - entry.mean + old_time - old_mean);
+	// rounding can take it below 0 when the samples are all the same
+	entry.m2 = std::max(entry.m2, 0.0);
+}
+
+void FrameStats::setReportInterval(double seconds)
+{
+	report_interval = seconds;
+}
+
+bool FrameStats::isReportDue() const
+{
+	return report_interval > 0.0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - last_report).count() >= report_interval;
+}
+
+std::string FrameStats::report()
+{
+	last_report = std::chrono::steady_clock::now();
+
+	std::ostringstream out;
+	out.setf(std::ios::fixed);
+	out.precision(3);
+	for (auto &summary : getSummaries())
+	{
+		out << summary.name << ": mean " << summary.mean * 1000.0 << " ms, min " << summary.min * 1000.0 << ", p50 " << summary.p50 * 1000.0 <<
+			", p95 " << summary.p95 * 1000.0 << ", p99 " << summary.p99 * 1000.0 << ", max " << summary.max * 1000.0 <<
+			", stddev " << std::sqrt(summary.variance) * 1000.0 << " (" << summary.window << " samples)\n";
+	}
+	return out.str();
+}
+
+std::vector<FrameStats::Summary> FrameStats::getSummaries() const
+{
+	std::vector<Summary> summaries;
+	summaries.reserve(series.size());
+	for (auto &[name, entry] : series)
+	{
+		summaries.push_back(summarize(name, entry));
+	}
+	return summaries;
+}
+
+FrameStats::Summary FrameStats::getSummary(std::string_view name) const
+{
+	auto iter = series.find(name);
+	if (iter == series.end())
+	{
+		Summary summary;
+		summary.name = name;
+		return summary;
+	}
+	return summarize(iter->first, iter->second);
+}
+
+std::string FrameStats::toCsv() const
+{
+	std::ostringstream out;
+	out << "scope,count,window,min_ms,mean_ms,p50_ms,p95_ms,p99_ms,max_ms,stddev_ms\n";
+	for (auto &summary : getSummaries())
+	{
+		out << quoteCsv(summary.name) << "," << summary.count << "," << summary.window << "," << summary.min * 1000.0 << "," << summary.mean * 1000.0 << "," <<
+			summary.p50 * 1000.0 << "," << summary.p95 * 1000.0 << "," << summary.p99 * 1000.0 << "," << summary.max * 1000.0 << "," << std::sqrt(summary.variance) * 1000.0 << "\n";
+	}
+	return out.str();
+}
+
+std::string FrameStats::toJson() const
+{
+	std::ostringstream out;
+	out << "{\n\t\"scopes\": [";
+	bool first = true;
+	for (auto &[name, entry] : series)
+	{
+		auto summary = summarize(name, entry);
+		out << (first ? "\n" : ",\n") << "\t\t{ \"name\": " << quoteJson(name) << ", \"count\": " << summary.count << ", \"window\": " << summary.window <<
+			", \"min_ms\": " << summary.min * 1000.0 << ", \"mean_ms\": " << summary.mean * 1000.0 << ", \"p50_ms\": " << summary.p50 * 1000.0 <<
+			", \"p95_ms\": " << summary.p95 * 1000.0 << ", \"p99_ms\": " << summary.p99 * 1000.0 << ", \"max_ms\": " << summary.max * 1000.0 <<
+			", \"stddev_ms\": " << std::sqrt(summary.variance) * 1000.0 << ", \"samples_ms\": [";
+		// oldest first
+		for (size_t i = 0; i < entry.samples.size(); ++i)
+		{
+			out << (i ? ", " : "") << entry.samples[(entry.next + i) % entry.samples.size()] * 1000.0;
+		}
+		out << "] }";
+		first = false;
+	}
+	out << "\n\t]\n}\n";
+	return out.str();
+}
+
+void FrameStats::clear()
+{
+	series.clear();
+	last_report = std::chrono::steady_clock::now();
+}
+
+FrameStats::Summary FrameStats::summarize(const std::string &name, const Series &entry) const
+{
+	Summary summary;
+	summary.name = name;
+	summary.count = entry.count;
+	summary.window = entry.samples.size();
+	if (entry.samples.empty())
+	{
+		return summary;
+	}
+
+	std::vector<double> sorted = entry.samples;
+	std::sort(sorted.begin(), sorted.end());
+	summary.min = sorted.front();
+	summary.max = sorted.back();
+	summary.p50 = percentile(sorted, 0.5);
+	summary.p95 = percentile(sorted, 0.95);
+	summary.p99 = percentile(sorted, 0.99);
+	summary.mean = entry.mean;
+	summary.variance = entry.m2 / entry.samples.size();
+	return summary;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// rolling statistics of the frame times, per profiled scope
+// keeps the last window samples of each scope in a ring buffer. the mean and variance over the
+// window are updated with every sample, the percentiles are sorted out when asked for
+// adding a sample of a known scope does not allocate, so it can be called every frame
+class FrameStats
+{
+public:
+	struct Summary
+	{
+		std::string name;
+		uint64_t count = 0; // samples ever added
+		size_t window = 0; // samples the rest is over
+		// in seconds
+		double min = 0.0, mean = 0.0, p50 = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0;
+		double variance = 0.0; // in seconds squared
+	};
+
+	explicit FrameStats(size_t window = 256);
+
+	// one sample of the scope, in seconds
+	void add(std::string_view name, double time);
+
+	// 0 only reports when asked
+	void setReportInterval(double seconds);
+	// if the interval passed since the last report
+	bool isReportDue() const;
+	// one line per scope, starts the interval again
+	std::string report();
+
+	// by name
+	std::vector<Summary> getSummaries() const;
+	Summary getSummary(std::string_view name) const;
+	// the summaries in milliseconds, for a spreadsheet
+	std::string toCsv() const;
+	// the summaries and the samples of the window, in milliseconds
+	std::string toJson() const;
+	void clear();
+private:
+	struct Series
+	{
+		std::vector<double> samples; // the ring buffer, grows up to the window
+		size_t next = 0; // where the next sample goes once it is full
+		uint64_t count = 0;
+		// over the samples in the ring, updated as they come and go
+		double mean = 0.0;
+		double m2 = 0.0; // sum of the squared differences to the mean
+	};
+
+	Summary summarize(const std::string &name, const Series &entry) const;
+
+	size_t window;
+	std::map<std::string, Series, std::less<>> series;
+	double report_interval = 0.0;
+	std::chrono::steady_clock::time_point last_report;
+};
@@ -14,21 +14,23 @@ bool FullscreenQuad::isValid()
 	return v_shader && input_layout;
 }
 
-bool FullscreenQuad::initShader(ShaderIncluder &includer)
+void FullscreenQuad::addShaders(ShaderBuild &build)
 {
-	// remove old objects. since d3d keeps a reference internally
-	// the object is not freed yet. setting it to zero ensures
-	// we dont overwrite it later and loose the pointer.
-	// once we set the new objects in the pipeline, the old ones will get released anyway
-	v_shader = nullptr;
-	input_layout = nullptr;
-
-	Comptr<ID3DBlob> v_compiled = compileShader(includer, "vshader.hlsl", "vs_5_0", "vs_main");
+	v_job = build.add("vshader.hlsl", "vs_5_0", "vs_main");
+}
+
+bool FullscreenQuad::createShaders(ShaderBuild &build)
+{
+	Comptr<ID3DBlob> v_compiled = build.finish(v_job);
 	if (!v_compiled)
 		return false;
 
+	// the new objects only replace the old ones if all of them could be created
+	Comptr<ID3D11VertexShader> new_v_shader;
+	Comptr<ID3D11InputLayout> new_input_layout;
+
 	auto device = graphics->GetDevice();
-	HRESULT hr = device->CreateVertexShader(v_compiled->GetBufferPointer(), v_compiled->GetBufferSize(), 0, &v_shader);
+	HRESULT hr = device->CreateVertexShader(v_compiled->GetBufferPointer(), v_compiled->GetBufferSize(), 0, &new_v_shader);
 	if (FAILED(hr))
 		return false;
 
@@ -38,10 +40,12 @@ bool FullscreenQuad::initShader(ShaderIncluder &includer)
 		{"POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
 	};
 
-	hr = device->CreateInputLayout(input_desc, static_cast<UINT>(std::size(input_desc)), v_compiled->GetBufferPointer(), v_compiled->GetBufferSize(), &input_layout);
+	hr = device->CreateInputLayout(input_desc, static_cast<UINT>(std::size(input_desc)), v_compiled->GetBufferPointer(), v_compiled->GetBufferSize(), &new_input_layout);
 	if (FAILED(hr))
 		return false;
 
+	v_shader = std::move(new_v_shader);
+	input_layout = std::move(new_input_layout);
 	return true;
 }
 
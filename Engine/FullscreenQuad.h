@@ -5,13 +5,16 @@
 #include <d3d11.h>
 
 class Graphics;
-class ShaderIncluder;
+class ShaderBuild;
 
 class FullscreenQuad
 {
 public:
 	bool init(Graphics &graphics);
-	bool initShader(ShaderIncluder &includer);
+	// adds the vertex shader to the build, createShaders takes it once the build ran
+	// a failed build keeps the old shader
+	void addShaders(ShaderBuild &build);
+	bool createShaders(ShaderBuild &build);
 	bool isValid();
 	void render();
 private:
@@ -27,4 +30,6 @@ private:
 	Comptr<ID3D11Buffer> vertex_buffer, index_buffer;
 	Comptr<ID3D11VertexShader> v_shader;
 	Comptr<ID3D11InputLayout> input_layout;
+
+	unsigned v_job = 0;
 };
@@ -16,6 +16,11 @@ void GPUProfiler::setGPU(ID3D11Device *dev, ID3D11DeviceContext *ctx)
 	this->ctx = ctx;
 }
 
+void GPUProfiler::setProfiler(Profiler *profiler)
+{
+	this->profiler = profiler;
+}
+
 void GPUProfiler::beginFrame()
 {
 	ensureQueryExists(nullptr);
@@ -27,6 +32,7 @@ void GPUProfiler::beginFrame()
 		ctx->End(active->query_begin);
 
 		active->last_query_index = -1;
+		active->profiler_begin = profiler ? profiler->now() : 0;
 	}
 }
 
@@ -104,6 +110,15 @@ std::map<std::string, float> GPUProfiler::getResults()
 			ctx->GetData(active->query_begin, &frame_begin, sizeof(frame_begin), 0);
 			ctx->GetData(active->query_end, &frame_end, sizeof(frame_end), 0);
 
+			// the gpu clock has no relation to the cpu one, the frame is placed where beginFrame was called
+			// the gpu starts on it a bit later, so the steps show up earlier than they ran
+			static const Profiler::ScopeId frame_scope = Profiler::intern("gpu frame");
+			double profiler_ticks = profiler ? static_cast<double>(profiler->getClock().getFrequency()) / disjoint.Frequency : 0.0;
+			auto to_profiler = [&](UINT64 time)
+			{
+				return active->profiler_begin + static_cast<uint64_t>((time - frame_begin) * profiler_ticks);
+			};
+
 			std::map<std::string, float> results;
 			// collect all user queries
 			UINT64 last_time = frame_begin;
@@ -112,10 +127,18 @@ std::map<std::string, float> GPUProfiler::getResults()
 				UINT64 time;
 				ctx->GetData(query.query, &time, sizeof(time), 0);
 				results[query.name] = static_cast<float>(time - last_time) / disjoint.Frequency;
+				if (profiler)
+				{
+					profiler->addEvent("gpu", query.scope, 1, to_profiler(last_time), to_profiler(time));
+				}
 				last_time = time;
 			}
 			// add frame query
 			results[{}] = static_cast<float>(frame_end - frame_begin) / disjoint.Frequency;
+			if (profiler)
+			{
+				profiler->addEvent("gpu", frame_scope, 0, to_profiler(frame_begin), to_profiler(frame_end));
+			}
 			return results;
 		}
 	}
@@ -134,7 +157,7 @@ void GPUProfiler::ensureQueryExists(const std::string *name)
 			Comptr<ID3D11Query> query;
 			dev->CreateQuery(&desc, &query);
 
-			active->queries.emplace_back(*name, query);
+			active->queries.emplace_back(*name, query, Profiler::intern(*name));
 		}
 	}
 	else // the mandatory ones
@@ -6,6 +6,7 @@
 #include <d3d11.h>
 
 #include "Comptr.h"
+#include "Profiler.h"
 
 // Profiles drawcalls
 //
@@ -17,11 +18,15 @@
 // - for everything you want to profile, call profile with the name of that thing
 // - when you are done with the frame, call endFrame
 // - call swapSets
+//
+// with setProfiler, the results also go to the "gpu" track of a Profiler, next to the cpu scopes
 class GPUProfiler
 {
 public:
 	GPUProfiler();
 	void setGPU(ID3D11Device *dev, ID3D11DeviceContext *ctx);
+	// getResults adds the frame and every profiled step as events, nullptr to stop
+	void setProfiler(Profiler *profiler);
 	// must set valid GPU interfaces before calling beginFrame
 	void beginFrame();
 	// must call beginFrame before endFrame
@@ -43,6 +48,7 @@ private:
 	{
 		std::string name;
 		Comptr<ID3D11Query> query;
+		Profiler::ScopeId scope;
 	};
 
 	void ensureQueryExists(const std::string *name);
@@ -56,9 +62,12 @@ private:
 		// the last query that was queried, or -1
 		int last_query_index = -1;
 		QueryState state = QueryState::Ready;
+		// when beginFrame was called, in ticks of the profiler
+		uint64_t profiler_begin = 0;
 	} sets[2]; // double buffered, one active, one polling
 	QuerySet *active, *inactive; // pointers for easier access
 
 	ID3D11Device *dev;
 	ID3D11DeviceContext *ctx;
+	Profiler *profiler = nullptr;
 };
@@ -0,0 +1,716 @@
+#pragma once
+
+#include <cmath>
+#include <type_traits>
+
+// a header only subset of the HLSL types and intrinsics, so that the shader
+// libraries (sdf_primitives.hlsl, sdf_ops.hlsl, ...) compile as C++ unmodified.
+// see SDFLibrary.h for how they get included
+
+// inout parameters become references, or copies written back for the vectors (see InOut).
+// the shader side defines this in cpu_compat.hlsl
+#define INOUT(type) hlsl::inout<type>
+
+namespace hlsl
+{
+	using uint = unsigned int;
+
+	struct float2;
+	struct float3;
+	struct float4;
+
+	// a swizzle like .xz or .zxy, living in the union of the vector it belongs to
+	// T: the component type, N: the size of the vector, V: the type it produces, I: the components it selects
+	template<class T, unsigned N, class V, unsigned... I>
+	struct SwizzleOf
+	{
+		operator V() const
+		{
+			return V(e[I]...);
+		}
+
+		SwizzleOf &operator = (const V &vec)
+		{
+			unsigned index = 0;
+			((e[I] = vec.v[index++]), ...);
+			return *this;
+		}
+		// the same swizzle of another vector. the implicit copy assignment stays, so the vectors are
+		// trivially copyable, but it copies all components. this one is the better match, except for
+		// a const vector, where the swizzle has to be read as V(other.xz) first
+		template<class S> requires std::is_same_v<std::remove_cvref_t<S>, SwizzleOf>
+		SwizzleOf &operator = (S &&other)
+		{
+			return *this = V(other);
+		}
+
+		SwizzleOf &operator += (const V &vec)
+		{
+			return *this = V(*this) + vec;
+		}
+		SwizzleOf &operator -= (const V &vec)
+		{
+			return *this = V(*this) - vec;
+		}
+		SwizzleOf &operator *= (const V &vec)
+		{
+			return *this = V(*this) * vec;
+		}
+		SwizzleOf &operator /= (const V &vec)
+		{
+			return *this = V(*this) / vec;
+		}
+
+		T e[N];
+	};
+	template<unsigned N, class V, unsigned... I>
+	using Swizzle = SwizzleOf<float, N, V, I...>;
+
+	struct float2
+	{
+		float2() = default;
+		constexpr float2(float s) : x(s), y(s)
+		{
+		}
+		constexpr float2(float x, float y) : x(x), y(y)
+		{
+		}
+
+		float &operator [] (unsigned index)
+		{
+			return v[index];
+		}
+		float operator [] (unsigned index) const
+		{
+			return v[index];
+		}
+
+		union
+		{
+			float v[2];
+			struct
+			{
+				float x, y;
+			};
+			struct
+			{
+				float r, g;
+			};
+			// all swizzles with 2 to 4 components
+			Swizzle<2, float2, 0, 0> xx; Swizzle<2, float2, 0, 1> xy;
+			Swizzle<2, float2, 1, 0> yx; Swizzle<2, float2, 1, 1> yy;
+			Swizzle<2, float3, 0, 0, 0> xxx; Swizzle<2, float3, 0, 0, 1> xxy; Swizzle<2, float3, 0, 1, 0> xyx; Swizzle<2, float3, 0, 1, 1> xyy;
+			Swizzle<2, float3, 1, 0, 0> yxx; Swizzle<2, float3, 1, 0, 1> yxy; Swizzle<2, float3, 1, 1, 0> yyx; Swizzle<2, float3, 1, 1, 1> yyy;
+			Swizzle<2, float4, 0, 0, 0, 0> xxxx; Swizzle<2, float4, 0, 0, 0, 1> xxxy; Swizzle<2, float4, 0, 0, 1, 0> xxyx; Swizzle<2, float4, 0, 0, 1, 1> xxyy;
+			Swizzle<2, float4, 0, 1, 0, 0> xyxx; Swizzle<2, float4, 0, 1, 0, 1> xyxy; Swizzle<2, float4, 0, 1, 1, 0> xyyx; Swizzle<2, float4, 0, 1, 1, 1> xyyy;
+			Swizzle<2, float4, 1, 0, 0, 0> yxxx; Swizzle<2, float4, 1, 0, 0, 1> yxxy; Swizzle<2, float4, 1, 0, 1, 0> yxyx; Swizzle<2, float4, 1, 0, 1, 1> yxyy;
+			Swizzle<2, float4, 1, 1, 0, 0> yyxx; Swizzle<2, float4, 1, 1, 0, 1> yyxy; Swizzle<2, float4, 1, 1, 1, 0> yyyx; Swizzle<2, float4, 1, 1, 1, 1> yyyy;
+			Swizzle<2, float2, 0, 1> rg;
+		};
+	};
+
+	struct float3
+	{
+		float3() = default;
+		constexpr float3(float s) : x(s), y(s), z(s)
+		{
+		}
+		constexpr float3(float x, float y, float z) : x(x), y(y), z(z)
+		{
+		}
+		constexpr float3(const float2 &xy, float z) : x(xy.x), y(xy.y), z(z)
+		{
+		}
+		constexpr float3(float x, const float2 &yz) : x(x), y(yz.x), z(yz.y)
+		{
+		}
+
+		float &operator [] (unsigned index)
+		{
+			return v[index];
+		}
+		float operator [] (unsigned index) const
+		{
+			return v[index];
+		}
+
+		union
+		{
+			float v[3];
+			struct
+			{
+				float x, y, z;
+			};
+			struct
+			{
+				float r, g, b;
+			};
+			// all swizzles with 2 to 4 components
+			Swizzle<3, float2, 0, 0> xx; Swizzle<3, float2, 0, 1> xy; Swizzle<3, float2, 0, 2> xz;
+			Swizzle<3, float2, 1, 0> yx; Swizzle<3, float2, 1, 1> yy; Swizzle<3, float2, 1, 2> yz;
+			Swizzle<3, float2, 2, 0> zx; Swizzle<3, float2, 2, 1> zy; Swizzle<3, float2, 2, 2> zz;
+			Swizzle<3, float3, 0, 0, 0> xxx; Swizzle<3, float3, 0, 0, 1> xxy; Swizzle<3, float3, 0, 0, 2> xxz; Swizzle<3, float3, 0, 1, 0> xyx;
+			Swizzle<3, float3, 0, 1, 1> xyy; Swizzle<3, float3, 0, 1, 2> xyz; Swizzle<3, float3, 0, 2, 0> xzx; Swizzle<3, float3, 0, 2, 1> xzy;
+			Swizzle<3, float3, 0, 2, 2> xzz;
+			Swizzle<3, float3, 1, 0, 0> yxx; Swizzle<3, float3, 1, 0, 1> yxy; Swizzle<3, float3, 1, 0, 2> yxz; Swizzle<3, float3, 1, 1, 0> yyx;
+			Swizzle<3, float3, 1, 1, 1> yyy; Swizzle<3, float3, 1, 1, 2> yyz; Swizzle<3, float3, 1, 2, 0> yzx; Swizzle<3, float3, 1, 2, 1> yzy;
+			Swizzle<3, float3, 1, 2, 2> yzz;
+			Swizzle<3, float3, 2, 0, 0> zxx; Swizzle<3, float3, 2, 0, 1> zxy; Swizzle<3, float3, 2, 0, 2> zxz; Swizzle<3, float3, 2, 1, 0> zyx;
+			Swizzle<3, float3, 2, 1, 1> zyy; Swizzle<3, float3, 2, 1, 2> zyz; Swizzle<3, float3, 2, 2, 0> zzx; Swizzle<3, float3, 2, 2, 1> zzy;
+			Swizzle<3, float3, 2, 2, 2> zzz;
+			Swizzle<3, float4, 0, 0, 0, 0> xxxx; Swizzle<3, float4, 0, 0, 0, 1> xxxy; Swizzle<3, float4, 0, 0, 0, 2> xxxz; Swizzle<3, float4, 0, 0, 1, 0> xxyx;
+			Swizzle<3, float4, 0, 0, 1, 1> xxyy; Swizzle<3, float4, 0, 0, 1, 2> xxyz; Swizzle<3, float4, 0, 0, 2, 0> xxzx; Swizzle<3, float4, 0, 0, 2, 1> xxzy;
+			Swizzle<3, float4, 0, 0, 2, 2> xxzz; Swizzle<3, float4, 0, 1, 0, 0> xyxx; Swizzle<3, float4, 0, 1, 0, 1> xyxy; Swizzle<3, float4, 0, 1, 0, 2> xyxz;
+			Swizzle<3, float4, 0, 1, 1, 0> xyyx; Swizzle<3, float4, 0, 1, 1, 1> xyyy; Swizzle<3, float4, 0, 1, 1, 2> xyyz; Swizzle<3, float4, 0, 1, 2, 0> xyzx;
+			Swizzle<3, float4, 0, 1, 2, 1> xyzy; Swizzle<3, float4, 0, 1, 2, 2> xyzz; Swizzle<3, float4, 0, 2, 0, 0> xzxx; Swizzle<3, float4, 0, 2, 0, 1> xzxy;
+			Swizzle<3, float4, 0, 2, 0, 2> xzxz; Swizzle<3, float4, 0, 2, 1, 0> xzyx; Swizzle<3, float4, 0, 2, 1, 1> xzyy; Swizzle<3, float4, 0, 2, 1, 2> xzyz;
+			Swizzle<3, float4, 0, 2, 2, 0> xzzx; Swizzle<3, float4, 0, 2, 2, 1> xzzy; Swizzle<3, float4, 0, 2, 2, 2> xzzz;
+			Swizzle<3, float4, 1, 0, 0, 0> yxxx; Swizzle<3, float4, 1, 0, 0, 1> yxxy; Swizzle<3, float4, 1, 0, 0, 2> yxxz; Swizzle<3, float4, 1, 0, 1, 0> yxyx;
+			Swizzle<3, float4, 1, 0, 1, 1> yxyy; Swizzle<3, float4, 1, 0, 1, 2> yxyz; Swizzle<3, float4, 1, 0, 2, 0> yxzx; Swizzle<3, float4, 1, 0, 2, 1> yxzy;
+			Swizzle<3, float4, 1, 0, 2, 2> yxzz; Swizzle<3, float4, 1, 1, 0, 0> yyxx; Swizzle<3, float4, 1, 1, 0, 1> yyxy; Swizzle<3, float4, 1, 1, 0, 2> yyxz;
+			Swizzle<3, float4, 1, 1, 1, 0> yyyx; Swizzle<3, float4, 1, 1, 1, 1> yyyy; Swizzle<3, float4, 1, 1, 1, 2> yyyz; Swizzle<3, float4, 1, 1, 2, 0> yyzx;
+			Swizzle<3, float4, 1, 1, 2, 1> yyzy; Swizzle<3, float4, 1, 1, 2, 2> yyzz; Swizzle<3, float4, 1, 2, 0, 0> yzxx; Swizzle<3, float4, 1, 2, 0, 1> yzxy;
+			Swizzle<3, float4, 1, 2, 0, 2> yzxz; Swizzle<3, float4, 1, 2, 1, 0> yzyx; Swizzle<3, float4, 1, 2, 1, 1> yzyy; Swizzle<3, float4, 1, 2, 1, 2> yzyz;
+			Swizzle<3, float4, 1, 2, 2, 0> yzzx; Swizzle<3, float4, 1, 2, 2, 1> yzzy; Swizzle<3, float4, 1, 2, 2, 2> yzzz;
+			Swizzle<3, float4, 2, 0, 0, 0> zxxx; Swizzle<3, float4, 2, 0, 0, 1> zxxy; Swizzle<3, float4, 2, 0, 0, 2> zxxz; Swizzle<3, float4, 2, 0, 1, 0> zxyx;
+			Swizzle<3, float4, 2, 0, 1, 1> zxyy; Swizzle<3, float4, 2, 0, 1, 2> zxyz; Swizzle<3, float4, 2, 0, 2, 0> zxzx; Swizzle<3, float4, 2, 0, 2, 1> zxzy;
+			Swizzle<3, float4, 2, 0, 2, 2> zxzz; Swizzle<3, float4, 2, 1, 0, 0> zyxx; Swizzle<3, float4, 2, 1, 0, 1> zyxy; Swizzle<3, float4, 2, 1, 0, 2> zyxz;
+			Swizzle<3, float4, 2, 1, 1, 0> zyyx; Swizzle<3, float4, 2, 1, 1, 1> zyyy; Swizzle<3, float4, 2, 1, 1, 2> zyyz; Swizzle<3, float4, 2, 1, 2, 0> zyzx;
+			Swizzle<3, float4, 2, 1, 2, 1> zyzy; Swizzle<3, float4, 2, 1, 2, 2> zyzz; Swizzle<3, float4, 2, 2, 0, 0> zzxx; Swizzle<3, float4, 2, 2, 0, 1> zzxy;
+			Swizzle<3, float4, 2, 2, 0, 2> zzxz; Swizzle<3, float4, 2, 2, 1, 0> zzyx; Swizzle<3, float4, 2, 2, 1, 1> zzyy; Swizzle<3, float4, 2, 2, 1, 2> zzyz;
+			Swizzle<3, float4, 2, 2, 2, 0> zzzx; Swizzle<3, float4, 2, 2, 2, 1> zzzy; Swizzle<3, float4, 2, 2, 2, 2> zzzz;
+			Swizzle<3, float2, 0, 1> rg;
+			Swizzle<3, float3, 0, 1, 2> rgb;
+		};
+	};
+
+	// aligned, so it maps onto a single SSE register
+	struct alignas(16) float4
+	{
+		float4() = default;
+		constexpr float4(float s) : x(s), y(s), z(s), w(s)
+		{
+		}
+		constexpr float4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w)
+		{
+		}
+		constexpr float4(const float3 &xyz, float w) : x(xyz.x), y(xyz.y), z(xyz.z), w(w)
+		{
+		}
+		constexpr float4(const float2 &xy, const float2 &zw) : x(xy.x), y(xy.y), z(zw.x), w(zw.y)
+		{
+		}
+		constexpr float4(const float2 &xy, float z, float w) : x(xy.x), y(xy.y), z(z), w(w)
+		{
+		}
+
+		float &operator [] (unsigned index)
+		{
+			return v[index];
+		}
+		float operator [] (unsigned index) const
+		{
+			return v[index];
+		}
+
+		union
+		{
+			float v[4];
+			struct
+			{
+				float x, y, z, w;
+			};
+			struct
+			{
+				float r, g, b, a;
+			};
+			// all swizzles with 2 to 4 components
+			Swizzle<4, float2, 0, 0> xx; Swizzle<4, float2, 0, 1> xy; Swizzle<4, float2, 0, 2> xz; Swizzle<4, float2, 0, 3> xw;
+			Swizzle<4, float2, 1, 0> yx; Swizzle<4, float2, 1, 1> yy; Swizzle<4, float2, 1, 2> yz; Swizzle<4, float2, 1, 3> yw;
+			Swizzle<4, float2, 2, 0> zx; Swizzle<4, float2, 2, 1> zy; Swizzle<4, float2, 2, 2> zz; Swizzle<4, float2, 2, 3> zw;
+			Swizzle<4, float2, 3, 0> wx; Swizzle<4, float2, 3, 1> wy; Swizzle<4, float2, 3, 2> wz; Swizzle<4, float2, 3, 3> ww;
+			Swizzle<4, float3, 0, 0, 0> xxx; Swizzle<4, float3, 0, 0, 1> xxy; Swizzle<4, float3, 0, 0, 2> xxz; Swizzle<4, float3, 0, 0, 3> xxw;
+			Swizzle<4, float3, 0, 1, 0> xyx; Swizzle<4, float3, 0, 1, 1> xyy; Swizzle<4, float3, 0, 1, 2> xyz; Swizzle<4, float3, 0, 1, 3> xyw;
+			Swizzle<4, float3, 0, 2, 0> xzx; Swizzle<4, float3, 0, 2, 1> xzy; Swizzle<4, float3, 0, 2, 2> xzz; Swizzle<4, float3, 0, 2, 3> xzw;
+			Swizzle<4, float3, 0, 3, 0> xwx; Swizzle<4, float3, 0, 3, 1> xwy; Swizzle<4, float3, 0, 3, 2> xwz; Swizzle<4, float3, 0, 3, 3> xww;
+			Swizzle<4, float3, 1, 0, 0> yxx; Swizzle<4, float3, 1, 0, 1> yxy; Swizzle<4, float3, 1, 0, 2> yxz; Swizzle<4, float3, 1, 0, 3> yxw;
+			Swizzle<4, float3, 1, 1, 0> yyx; Swizzle<4, float3, 1, 1, 1> yyy; Swizzle<4, float3, 1, 1, 2> yyz; Swizzle<4, float3, 1, 1, 3> yyw;
+			Swizzle<4, float3, 1, 2, 0> yzx; Swizzle<4, float3, 1, 2, 1> yzy; Swizzle<4, float3, 1, 2, 2> yzz; Swizzle<4, float3, 1, 2, 3> yzw;
+			Swizzle<4, float3, 1, 3, 0> ywx; Swizzle<4, float3, 1, 3, 1> ywy; Swizzle<4, float3, 1, 3, 2> ywz; Swizzle<4, float3, 1, 3, 3> yww;
+			Swizzle<4, float3, 2, 0, 0> zxx; Swizzle<4, float3, 2, 0, 1> zxy; Swizzle<4, float3, 2, 0, 2> zxz; Swizzle<4, float3, 2, 0, 3> zxw;
+			Swizzle<4, float3, 2, 1, 0> zyx; Swizzle<4, float3, 2, 1, 1> zyy; Swizzle<4, float3, 2, 1, 2> zyz; Swizzle<4, float3, 2, 1, 3> zyw;
+			Swizzle<4, float3, 2, 2, 0> zzx; Swizzle<4, float3, 2, 2, 1> zzy; Swizzle<4, float3, 2, 2, 2> zzz; Swizzle<4, float3, 2, 2, 3> zzw;
+			Swizzle<4, float3, 2, 3, 0> zwx; Swizzle<4, float3, 2, 3, 1> zwy; Swizzle<4, float3, 2, 3, 2> zwz; Swizzle<4, float3, 2, 3, 3> zww;
+			Swizzle<4, float3, 3, 0, 0> wxx; Swizzle<4, float3, 3, 0, 1> wxy; Swizzle<4, float3, 3, 0, 2> wxz; Swizzle<4, float3, 3, 0, 3> wxw;
+			Swizzle<4, float3, 3, 1, 0> wyx; Swizzle<4, float3, 3, 1, 1> wyy; Swizzle<4, float3, 3, 1, 2> wyz; Swizzle<4, float3, 3, 1, 3> wyw;
+			Swizzle<4, float3, 3, 2, 0> wzx; Swizzle<4, float3, 3, 2, 1> wzy; Swizzle<4, float3, 3, 2, 2> wzz; Swizzle<4, float3, 3, 2, 3> wzw;
+			Swizzle<4, float3, 3, 3, 0> wwx; Swizzle<4, float3, 3, 3, 1> wwy; Swizzle<4, float3, 3, 3, 2> wwz; Swizzle<4, float3, 3, 3, 3> www;
+			Swizzle<4, float4, 0, 0, 0, 0> xxxx; Swizzle<4, float4, 0, 0, 0, 1> xxxy; Swizzle<4, float4, 0, 0, 0, 2> xxxz; Swizzle<4, float4, 0, 0, 0, 3> xxxw;
+			Swizzle<4, float4, 0, 0, 1, 0> xxyx; Swizzle<4, float4, 0, 0, 1, 1> xxyy; Swizzle<4, float4, 0, 0, 1, 2> xxyz; Swizzle<4, float4, 0, 0, 1, 3> xxyw;
+			Swizzle<4, float4, 0, 0, 2, 0> xxzx; Swizzle<4, float4, 0, 0, 2, 1> xxzy; Swizzle<4, float4, 0, 0, 2, 2> xxzz; Swizzle<4, float4, 0, 0, 2, 3> xxzw;
+			Swizzle<4, float4, 0, 0, 3, 0> xxwx; Swizzle<4, float4, 0, 0, 3, 1> xxwy; Swizzle<4, float4, 0, 0, 3, 2> xxwz; Swizzle<4, float4, 0, 0, 3, 3> xxww;
+			Swizzle<4, float4, 0, 1, 0, 0> xyxx; Swizzle<4, float4, 0, 1, 0, 1> xyxy; Swizzle<4, float4, 0, 1, 0, 2> xyxz; Swizzle<4, float4, 0, 1, 0, 3> xyxw;
+			Swizzle<4, float4, 0, 1, 1, 0> xyyx; Swizzle<4, float4, 0, 1, 1, 1> xyyy; Swizzle<4, float4, 0, 1, 1, 2> xyyz; Swizzle<4, float4, 0, 1, 1, 3> xyyw;
+			Swizzle<4, float4, 0, 1, 2, 0> xyzx; Swizzle<4, float4, 0, 1, 2, 1> xyzy; Swizzle<4, float4, 0, 1, 2, 2> xyzz; Swizzle<4, float4, 0, 1, 2, 3> xyzw;
+			Swizzle<4, float4, 0, 1, 3, 0> xywx; Swizzle<4, float4, 0, 1, 3, 1> xywy; Swizzle<4, float4, 0, 1, 3, 2> xywz; Swizzle<4, float4, 0, 1, 3, 3> xyww;
+			Swizzle<4, float4, 0, 2, 0, 0> xzxx; Swizzle<4, float4, 0, 2, 0, 1> xzxy; Swizzle<4, float4, 0, 2, 0, 2> xzxz; Swizzle<4, float4, 0, 2, 0, 3> xzxw;
+			Swizzle<4, float4, 0, 2, 1, 0> xzyx; Swizzle<4, float4, 0, 2, 1, 1> xzyy; Swizzle<4, float4, 0, 2, 1, 2> xzyz; Swizzle<4, float4, 0, 2, 1, 3> xzyw;
+			Swizzle<4, float4, 0, 2, 2, 0> xzzx; Swizzle<4, float4, 0, 2, 2, 1> xzzy; Swizzle<4, float4, 0, 2, 2, 2> xzzz; Swizzle<4, float4, 0, 2, 2, 3> xzzw;
+			Swizzle<4, float4, 0, 2, 3, 0> xzwx; Swizzle<4, float4, 0, 2, 3, 1> xzwy; Swizzle<4, float4, 0, 2, 3, 2> xzwz; Swizzle<4, float4, 0, 2, 3, 3> xzww;
+			Swizzle<4, float4, 0, 3, 0, 0> xwxx; Swizzle<4, float4, 0, 3, 0, 1> xwxy; Swizzle<4, float4, 0, 3, 0, 2> xwxz; Swizzle<4, float4, 0, 3, 0, 3> xwxw;
+			Swizzle<4, float4, 0, 3, 1, 0> xwyx; Swizzle<4, float4, 0, 3, 1, 1> xwyy; Swizzle<4, float4, 0, 3, 1, 2> xwyz; Swizzle<4, float4, 0, 3, 1, 3> xwyw;
+			Swizzle<4, float4, 0, 3, 2, 0> xwzx; Swizzle<4, float4, 0, 3, 2, 1> xwzy; Swizzle<4, float4, 0, 3, 2, 2> xwzz; Swizzle<4, float4, 0, 3, 2, 3> xwzw;
+			Swizzle<4, float4, 0, 3, 3, 0> xwwx; Swizzle<4, float4, 0, 3, 3, 1> xwwy; Swizzle<4, float4, 0, 3, 3, 2> xwwz; Swizzle<4, float4, 0, 3, 3, 3> xwww;
+			Swizzle<4, float4, 1, 0, 0, 0> yxxx; Swizzle<4, float4, 1, 0, 0, 1> yxxy; Swizzle<4, float4, 1, 0, 0, 2> yxxz; Swizzle<4, float4, 1, 0, 0, 3> yxxw;
+			Swizzle<4, float4, 1, 0, 1, 0> yxyx; Swizzle<4, float4, 1, 0, 1, 1> yxyy; Swizzle<4, float4, 1, 0, 1, 2> yxyz; Swizzle<4, float4, 1, 0, 1, 3> yxyw;
+			Swizzle<4, float4, 1, 0, 2, 0> yxzx; Swizzle<4, float4, 1, 0, 2, 1> yxzy; Swizzle<4, float4, 1, 0, 2, 2> yxzz; Swizzle<4, float4, 1, 0, 2, 3> yxzw;
+			Swizzle<4, float4, 1, 0, 3, 0> yxwx; Swizzle<4, float4, 1, 0, 3, 1> yxwy; Swizzle<4, float4, 1, 0, 3, 2> yxwz; Swizzle<4, float4, 1, 0, 3, 3> yxww;
+			Swizzle<4, float4, 1, 1, 0, 0> yyxx; Swizzle<4, float4, 1, 1, 0, 1> yyxy; Swizzle<4, float4, 1, 1, 0, 2> yyxz; Swizzle<4, float4, 1, 1, 0, 3> yyxw;
+			Swizzle<4, float4, 1, 1, 1, 0> yyyx; Swizzle<4, float4, 1, 1, 1, 1> yyyy; Swizzle<4, float4, 1, 1, 1, 2> yyyz; Swizzle<4, float4, 1, 1, 1, 3> yyyw;
+			Swizzle<4, float4, 1, 1, 2, 0> yyzx; Swizzle<4, float4, 1, 1, 2, 1> yyzy; Swizzle<4, float4, 1, 1, 2, 2> yyzz; Swizzle<4, float4, 1, 1, 2, 3> yyzw;
+			Swizzle<4, float4, 1, 1, 3, 0> yywx; Swizzle<4, float4, 1, 1, 3, 1> yywy; Swizzle<4, float4, 1, 1, 3, 2> yywz; Swizzle<4, float4, 1, 1, 3, 3> yyww;
+			Swizzle<4, float4, 1, 2, 0, 0> yzxx; Swizzle<4, float4, 1, 2, 0, 1> yzxy; Swizzle<4, float4, 1, 2, 0, 2> yzxz; Swizzle<4, float4, 1, 2, 0, 3> yzxw;
+			Swizzle<4, float4, 1, 2, 1, 0> yzyx; Swizzle<4, float4, 1, 2, 1, 1> yzyy; Swizzle<4, float4, 1, 2, 1, 2> yzyz; Swizzle<4, float4, 1, 2, 1, 3> yzyw;
+			Swizzle<4, float4, 1, 2, 2, 0> yzzx; Swizzle<4, float4, 1, 2, 2, 1> yzzy; Swizzle<4, float4, 1, 2, 2, 2> yzzz; Swizzle<4, float4, 1, 2, 2, 3> yzzw;
+			Swizzle<4, float4, 1, 2, 3, 0> yzwx; Swizzle<4, float4, 1, 2, 3, 1> yzwy; Swizzle<4, float4, 1, 2, 3, 2> yzwz; Swizzle<4, float4, 1, 2, 3, 3> yzww;
+			Swizzle<4, float4, 1, 3, 0, 0> ywxx; Swizzle<4, float4, 1, 3, 0, 1> ywxy; Swizzle<4, float4, 1, 3, 0, 2> ywxz; Swizzle<4, float4, 1, 3, 0, 3> ywxw;
+			Swizzle<4, float4, 1, 3, 1, 0> ywyx; Swizzle<4, float4, 1, 3, 1, 1> ywyy; Swizzle<4, float4, 1, 3, 1, 2> ywyz; Swizzle<4, float4, 1, 3, 1, 3> ywyw;
+			Swizzle<4, float4, 1, 3, 2, 0> ywzx; Swizzle<4, float4, 1, 3, 2, 1> ywzy; Swizzle<4, float4, 1, 3, 2, 2> ywzz; Swizzle<4, float4, 1, 3, 2, 3> ywzw;
+			Swizzle<4, float4, 1, 3, 3, 0> ywwx; Swizzle<4, float4, 1, 3, 3, 1> ywwy; Swizzle<4, float4, 1, 3, 3, 2> ywwz; Swizzle<4, float4, 1, 3, 3, 3> ywww;
+			Swizzle<4, float4, 2, 0, 0, 0> zxxx; Swizzle<4, float4, 2, 0, 0, 1> zxxy; Swizzle<4, float4, 2, 0, 0, 2> zxxz; Swizzle<4, float4, 2, 0, 0, 3> zxxw;
+			Swizzle<4, float4, 2, 0, 1, 0> zxyx; Swizzle<4, float4, 2, 0, 1, 1> zxyy; Swizzle<4, float4, 2, 0, 1, 2> zxyz; Swizzle<4, float4, 2, 0, 1, 3> zxyw;
+			Swizzle<4, float4, 2, 0, 2, 0> zxzx; Swizzle<4, float4, 2, 0, 2, 1> zxzy; Swizzle<4, float4, 2, 0, 2, 2> zxzz; Swizzle<4, float4, 2, 0, 2, 3> zxzw;
+			Swizzle<4, float4, 2, 0, 3, 0> zxwx; Swizzle<4, float4, 2, 0, 3, 1> zxwy; Swizzle<4, float4, 2, 0, 3, 2> zxwz; Swizzle<4, float4, 2, 0, 3, 3> zxww;
+			Swizzle<4, float4, 2, 1, 0, 0> zyxx; Swizzle<4, float4, 2, 1, 0, 1> zyxy; Swizzle<4, float4, 2, 1, 0, 2> zyxz; Swizzle<4, float4, 2, 1, 0, 3> zyxw;
+			Swizzle<4, float4, 2, 1, 1, 0> zyyx; Swizzle<4, float4, 2, 1, 1, 1> zyyy; Swizzle<4, float4, 2, 1, 1, 2> zyyz; Swizzle<4, float4, 2, 1, 1, 3> zyyw;
+			Swizzle<4, float4, 2, 1, 2, 0> zyzx; Swizzle<4, float4, 2, 1, 2, 1> zyzy; Swizzle<4, float4, 2, 1, 2, 2> zyzz; Swizzle<4, float4, 2, 1, 2, 3> zyzw;
+			Swizzle<4, float4, 2, 1, 3, 0> zywx; Swizzle<4, float4, 2, 1, 3, 1> zywy; Swizzle<4, float4, 2, 1, 3, 2> zywz; Swizzle<4, float4, 2, 1, 3, 3> zyww;
+			Swizzle<4, float4, 2, 2, 0, 0> zzxx; Swizzle<4, float4, 2, 2, 0, 1> zzxy; Swizzle<4, float4, 2, 2, 0, 2> zzxz; Swizzle<4, float4, 2, 2, 0, 3> zzxw;
+			Swizzle<4, float4, 2, 2, 1, 0> zzyx; Swizzle<4, float4, 2, 2, 1, 1> zzyy; Swizzle<4, float4, 2, 2, 1, 2> zzyz; Swizzle<4, float4, 2, 2, 1, 3> zzyw;
+			Swizzle<4, float4, 2, 2, 2, 0> zzzx; Swizzle<4, float4, 2, 2, 2, 1> zzzy; Swizzle<4, float4, 2, 2, 2, 2> zzzz; Swizzle<4, float4, 2, 2, 2, 3> zzzw;
+			Swizzle<4, float4, 2, 2, 3, 0> zzwx; Swizzle<4, float4, 2, 2, 3, 1> zzwy; Swizzle<4, float4, 2, 2, 3, 2> zzwz; Swizzle<4, float4, 2, 2, 3, 3> zzww;
+			Swizzle<4, float4, 2, 3, 0, 0> zwxx; Swizzle<4, float4, 2, 3, 0, 1> zwxy; Swizzle<4, float4, 2, 3, 0, 2> zwxz; Swizzle<4, float4, 2, 3, 0, 3> zwxw;
+			Swizzle<4, float4, 2, 3, 1, 0> zwyx; Swizzle<4, float4, 2, 3, 1, 1> zwyy; Swizzle<4, float4, 2, 3, 1, 2> zwyz; Swizzle<4, float4, 2, 3, 1, 3> zwyw;
+			Swizzle<4, float4, 2, 3, 2, 0> zwzx; Swizzle<4, float4, 2, 3, 2, 1> zwzy; Swizzle<4, float4, 2, 3, 2, 2> zwzz; Swizzle<4, float4, 2, 3, 2, 3> zwzw;
+			Swizzle<4, float4, 2, 3, 3, 0> zwwx; Swizzle<4, float4, 2, 3, 3, 1> zwwy; Swizzle<4, float4, 2, 3, 3, 2> zwwz; Swizzle<4, float4, 2, 3, 3, 3> zwww;
+			Swizzle<4, float4, 3, 0, 0, 0> wxxx; Swizzle<4, float4, 3, 0, 0, 1> wxxy; Swizzle<4, float4, 3, 0, 0, 2> wxxz; Swizzle<4, float4, 3, 0, 0, 3> wxxw;
+			Swizzle<4, float4, 3, 0, 1, 0> wxyx; Swizzle<4, float4, 3, 0, 1, 1> wxyy; Swizzle<4, float4, 3, 0, 1, 2> wxyz; Swizzle<4, float4, 3, 0, 1, 3> wxyw;
+			Swizzle<4, float4, 3, 0, 2, 0> wxzx; Swizzle<4, float4, 3, 0, 2, 1> wxzy; Swizzle<4, float4, 3, 0, 2, 2> wxzz; Swizzle<4, float4, 3, 0, 2, 3> wxzw;
+			Swizzle<4, float4, 3, 0, 3, 0> wxwx; Swizzle<4, float4, 3, 0, 3, 1> wxwy; Swizzle<4, float4, 3, 0, 3, 2> wxwz; Swizzle<4, float4, 3, 0, 3, 3> wxww;
+			Swizzle<4, float4, 3, 1, 0, 0> wyxx; Swizzle<4, float4, 3, 1, 0, 1> wyxy; Swizzle<4, float4, 3, 1, 0, 2> wyxz; Swizzle<4, float4, 3, 1, 0, 3> wyxw;
+			Swizzle<4, float4, 3, 1, 1, 0> wyyx; Swizzle<4, float4, 3, 1, 1, 1> wyyy; Swizzle<4, float4, 3, 1, 1, 2> wyyz; Swizzle<4, float4, 3, 1, 1, 3> wyyw;
+			Swizzle<4, float4, 3, 1, 2, 0> wyzx; Swizzle<4, float4, 3, 1, 2, 1> wyzy; Swizzle<4, float4, 3, 1, 2, 2> wyzz; Swizzle<4, float4, 3, 1, 2, 3> wyzw;
+			Swizzle<4, float4, 3, 1, 3, 0> wywx; Swizzle<4, float4, 3, 1, 3, 1> wywy; Swizzle<4, float4, 3, 1, 3, 2> wywz; Swizzle<4, float4, 3, 1, 3, 3> wyww;
+			Swizzle<4, float4, 3, 2, 0, 0> wzxx; Swizzle<4, float4, 3, 2, 0, 1> wzxy; Swizzle<4, float4, 3, 2, 0, 2> wzxz; Swizzle<4, float4, 3, 2, 0, 3> wzxw;
+			Swizzle<4, float4, 3, 2, 1, 0> wzyx; Swizzle<4, float4, 3, 2, 1, 1> wzyy; Swizzle<4, float4, 3, 2, 1, 2> wzyz; Swizzle<4, float4, 3, 2, 1, 3> wzyw;
+			Swizzle<4, float4, 3, 2, 2, 0> wzzx; Swizzle<4, float4, 3, 2, 2, 1> wzzy; Swizzle<4, float4, 3, 2, 2, 2> wzzz; Swizzle<4, float4, 3, 2, 2, 3> wzzw;
+			Swizzle<4, float4, 3, 2, 3, 0> wzwx; Swizzle<4, float4, 3, 2, 3, 1> wzwy; Swizzle<4, float4, 3, 2, 3, 2> wzwz; Swizzle<4, float4, 3, 2, 3, 3> wzww;
+			Swizzle<4, float4, 3, 3, 0, 0> wwxx; Swizzle<4, float4, 3, 3, 0, 1> wwxy; Swizzle<4, float4, 3, 3, 0, 2> wwxz; Swizzle<4, float4, 3, 3, 0, 3> wwxw;
+			Swizzle<4, float4, 3, 3, 1, 0> wwyx; Swizzle<4, float4, 3, 3, 1, 1> wwyy; Swizzle<4, float4, 3, 3, 1, 2> wwyz; Swizzle<4, float4, 3, 3, 1, 3> wwyw;
+			Swizzle<4, float4, 3, 3, 2, 0> wwzx; Swizzle<4, float4, 3, 3, 2, 1> wwzy; Swizzle<4, float4, 3, 3, 2, 2> wwzz; Swizzle<4, float4, 3, 3, 2, 3> wwzw;
+			Swizzle<4, float4, 3, 3, 3, 0> wwwx; Swizzle<4, float4, 3, 3, 3, 1> wwwy; Swizzle<4, float4, 3, 3, 3, 2> wwwz; Swizzle<4, float4, 3, 3, 3, 3> wwww;
+			Swizzle<4, float2, 0, 1> rg;
+			Swizzle<4, float3, 0, 1, 2> rgb;
+			Swizzle<4, float4, 0, 1, 2, 3> rgba;
+		};
+	};
+
+	// only conversions, as used by the noise functions
+	struct int2
+	{
+		int2() = default;
+		constexpr int2(int x, int y) : x(x), y(y)
+		{
+		}
+		constexpr int2(const float2 &vec) : x(static_cast<int>(vec.x)), y(static_cast<int>(vec.y))
+		{
+		}
+
+		operator float2() const
+		{
+			return float2(static_cast<float>(x), static_cast<float>(y));
+		}
+
+		int x, y;
+	};
+
+	// an inout parameter. like in HLSL it is a copy, written back to the argument on return,
+	// so a swizzle like pos.xz can be passed as well, which is no single variable in C++
+	template<class V>
+	struct InOut : V
+	{
+		using T = std::remove_reference_t<decltype(V::v[0])>;
+
+		InOut(V &arg) : V(arg)
+		{
+			for (unsigned i = 0; i < count; ++i)
+				target[i] = &arg.v[i];
+		}
+		template<unsigned N, unsigned... I>
+		InOut(SwizzleOf<T, N, V, I...> &arg) : V(arg), target{ &arg.e[I]... }
+		{
+		}
+		InOut(const InOut &) = delete;
+		~InOut()
+		{
+			for (unsigned i = 0; i < count; ++i)
+				*target[i] = this->v[i];
+		}
+
+		using V::operator =;
+		InOut &operator = (const InOut &other)
+		{
+			V::operator = (other);
+			return *this;
+		}
+
+	private:
+		static constexpr unsigned count = sizeof(V::v) / sizeof(T);
+		T *target[count];
+	};
+
+	// everything else is passed by reference
+	template<class T>
+	struct InOutType
+	{
+		using type = T &;
+	};
+	template<>
+	struct InOutType<float2>
+	{
+		using type = InOut<float2>;
+	};
+	template<>
+	struct InOutType<float3>
+	{
+		using type = InOut<float3>;
+	};
+	template<>
+	struct InOutType<float4>
+	{
+		using type = InOut<float4>;
+	};
+	template<class T>
+	using inout = typename InOutType<T>::type;
+
+	// component wise operators
+	// written as plain loops over the components, which the compiler turns into SIMD code
+#define HLSL_VECTOR_OPERATOR(type, count, op) \
+	inline type operator op (const type &a, const type &b) \
+	{ \
+		type res; \
+		for (unsigned i = 0; i < count; ++i) \
+			res.v[i] = a.v[i] op b.v[i]; \
+		return res; \
+	} \
+	inline type operator op (const type &a, float b) \
+	{ \
+		type res; \
+		for (unsigned i = 0; i < count; ++i) \
+			res.v[i] = a.v[i] op b; \
+		return res; \
+	} \
+	inline type operator op (float a, const type &b) \
+	{ \
+		type res; \
+		for (unsigned i = 0; i < count; ++i) \
+			res.v[i] = a op b.v[i]; \
+		return res; \
+	} \
+	inline type &operator op##= (type &a, const type &b) \
+	{ \
+		for (unsigned i = 0; i < count; ++i) \
+			a.v[i] op##= b.v[i]; \
+		return a; \
+	} \
+	inline type &operator op##= (type &a, float b) \
+	{ \
+		for (unsigned i = 0; i < count; ++i) \
+			a.v[i] op##= b; \
+		return a; \
+	}
+
+#define HLSL_VECTOR_OPERATORS(type, count) \
+	HLSL_VECTOR_OPERATOR(type, count, +) \
+	HLSL_VECTOR_OPERATOR(type, count, -) \
+	HLSL_VECTOR_OPERATOR(type, count, *) \
+	HLSL_VECTOR_OPERATOR(type, count, /) \
+	inline type operator - (const type &a) \
+	{ \
+		type res; \
+		for (unsigned i = 0; i < count; ++i) \
+			res.v[i] = -a.v[i]; \
+		return res; \
+	}
+
+	HLSL_VECTOR_OPERATORS(float2, 2)
+	HLSL_VECTOR_OPERATORS(float3, 3)
+	HLSL_VECTOR_OPERATORS(float4, 4)
+
+#undef HLSL_VECTOR_OPERATORS
+#undef HLSL_VECTOR_OPERATOR
+
+	// scalar intrinsics
+	// min and max are written so they compile to minss/maxss
+	inline float abs(float a)
+	{
+		return std::fabs(a);
+	}
+	inline float min(float a, float b)
+	{
+		return a < b ? a : b;
+	}
+	inline float max(float a, float b)
+	{
+		return a > b ? a : b;
+	}
+	inline float clamp(float a, float lo, float hi)
+	{
+		return min(max(a, lo), hi);
+	}
+	inline float saturate(float a)
+	{
+		return clamp(a, 0.f, 1.f);
+	}
+	inline float lerp(float a, float b, float t)
+	{
+		return a + t * (b - a);
+	}
+	inline float step(float edge, float a)
+	{
+		return a >= edge ? 1.f : 0.f;
+	}
+	inline float smoothstep(float lo, float hi, float a)
+	{
+		float t = saturate((a - lo) / (hi - lo));
+		return t * t * (3.f - 2.f * t);
+	}
+	inline float sqrt(float a)
+	{
+		return std::sqrt(a);
+	}
+	inline float rsqrt(float a)
+	{
+		return 1.f / std::sqrt(a);
+	}
+	inline float pow(float a, float b)
+	{
+		return std::pow(a, b);
+	}
+	inline float exp(float a)
+	{
+		return std::exp(a);
+	}
+	inline float floor(float a)
+	{
+		return std::floor(a);
+	}
+	inline float ceil(float a)
+	{
+		return std::ceil(a);
+	}
+	inline float frac(float a)
+	{
+		return a - std::floor(a);
+	}
+	inline float round(float a)
+	{
+		return std::nearbyint(a);
+	}
+	inline float fmod(float a, float b)
+	{
+		return std::fmod(a, b);
+	}
+	inline float modf(float a, float &int_part)
+	{
+		return std::modf(a, &int_part);
+	}
+	inline float sin(float a)
+	{
+		return std::sin(a);
+	}
+	inline float cos(float a)
+	{
+		return std::cos(a);
+	}
+	inline float tan(float a)
+	{
+		return std::tan(a);
+	}
+	inline float atan(float a)
+	{
+		return std::atan(a);
+	}
+	inline float atan2(float y, float x)
+	{
+		return std::atan2(y, x);
+	}
+	inline float sign(float a)
+	{
+		return static_cast<float>((a > 0.f) - (a < 0.f));
+	}
+	inline bool any(float a)
+	{
+		return a != 0.f;
+	}
+	inline bool all(float a)
+	{
+		return a != 0.f;
+	}
+
+	// component wise intrinsics
+#define HLSL_VECTOR_FUNCTION1(type, count, name) \
+	inline type name(const type &a) \
+	{ \
+		type res; \
+		for (unsigned i = 0; i < count; ++i) \
+			res.v[i] = name(a.v[i]); \
+		return res; \
+	}
+#define HLSL_VECTOR_FUNCTION2(type, count, name) \
+	inline type name(const type &a, const type &b) \
+	{ \
+		type res; \
+		for (unsigned i = 0; i < count; ++i) \
+			res.v[i] = name(a.v[i], b.v[i]); \
+		return res; \
+	}
+#define HLSL_VECTOR_FUNCTION3(type, count, name) \
+	inline type name(const type &a, const type &b, const type &c) \
+	{ \
+		type res; \
+		for (unsigned i = 0; i < count; ++i) \
+			res.v[i] = name(a.v[i], b.v[i], c.v[i]); \
+		return res; \
+	}
+
+#define HLSL_VECTOR_FUNCTIONS(type, count) \
+	HLSL_VECTOR_FUNCTION1(type, count, abs) \
+	HLSL_VECTOR_FUNCTION1(type, count, saturate) \
+	HLSL_VECTOR_FUNCTION1(type, count, sqrt) \
+	HLSL_VECTOR_FUNCTION1(type, count, rsqrt) \
+	HLSL_VECTOR_FUNCTION1(type, count, exp) \
+	HLSL_VECTOR_FUNCTION1(type, count, floor) \
+	HLSL_VECTOR_FUNCTION1(type, count, ceil) \
+	HLSL_VECTOR_FUNCTION1(type, count, frac) \
+	HLSL_VECTOR_FUNCTION1(type, count, round) \
+	HLSL_VECTOR_FUNCTION1(type, count, sin) \
+	HLSL_VECTOR_FUNCTION1(type, count, cos) \
+	HLSL_VECTOR_FUNCTION1(type, count, sign) \
+	HLSL_VECTOR_FUNCTION2(type, count, min) \
+	HLSL_VECTOR_FUNCTION2(type, count, max) \
+	HLSL_VECTOR_FUNCTION2(type, count, step) \
+	HLSL_VECTOR_FUNCTION2(type, count, pow) \
+	HLSL_VECTOR_FUNCTION2(type, count, fmod) \
+	HLSL_VECTOR_FUNCTION3(type, count, clamp) \
+	HLSL_VECTOR_FUNCTION3(type, count, lerp) \
+	HLSL_VECTOR_FUNCTION3(type, count, smoothstep) \
+	inline float dot(const type &a, const type &b) \
+	{ \
+		float res = 0.f; \
+		for (unsigned i = 0; i < count; ++i) \
+			res += a.v[i] * b.v[i]; \
+		return res; \
+	} \
+	inline float length(const type &a) \
+	{ \
+		return sqrt(dot(a, a)); \
+	} \
+	inline float distance(const type &a, const type &b) \
+	{ \
+		return length(a - b); \
+	} \
+	inline type normalize(const type &a) \
+	{ \
+		return a * rsqrt(dot(a, a)); \
+	} \
+	inline bool any(const type &a) \
+	{ \
+		bool res = false; \
+		for (unsigned i = 0; i < count; ++i) \
+			res |= a.v[i] != 0.f; \
+		return res; \
+	} \
+	inline bool all(const type &a) \
+	{ \
+		bool res = true; \
+		for (unsigned i = 0; i < count; ++i) \
+			res &= a.v[i] != 0.f; \
+		return res; \
+	}
+
+	HLSL_VECTOR_FUNCTIONS(float2, 2)
+	HLSL_VECTOR_FUNCTIONS(float3, 3)
+	HLSL_VECTOR_FUNCTIONS(float4, 4)
+
+#undef HLSL_VECTOR_FUNCTIONS
+#undef HLSL_VECTOR_FUNCTION3
+#undef HLSL_VECTOR_FUNCTION2
+#undef HLSL_VECTOR_FUNCTION1
+
+	inline float3 cross(const float3 &a, const float3 &b)
+	{
+		return float3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	inline float3 reflect(const float3 &i, const float3 &n)
+	{
+		return i - 2.f * n * dot(n, i);
+	}
+
+	inline float3 refract(const float3 &i, const float3 &n, float eta)
+	{
+		float cosi = dot(n, i);
+		float k = 1.f - eta * eta * (1.f - cosi * cosi);
+		return k < 0.f ? float3(0.f) : eta * i - (eta * cosi + sqrt(k)) * n;
+	}
+
+	// row major, like the default in HLSL
+	struct float3x3
+	{
+		float3x3() = default;
+		constexpr float3x3(float m11, float m12, float m13, float m21, float m22, float m23, float m31, float m32, float m33) :
+			m{ float3(m11, m12, m13), float3(m21, m22, m23), float3(m31, m32, m33) }
+		{
+		}
+		constexpr float3x3(const float3 &row1, const float3 &row2, const float3 &row3) : m{ row1, row2, row3 }
+		{
+		}
+
+		float3 &operator [] (unsigned row)
+		{
+			return m[row];
+		}
+		const float3 &operator [] (unsigned row) const
+		{
+			return m[row];
+		}
+
+		float3 m[3];
+	};
+
+	inline float3x3 transpose(const float3x3 &mat)
+	{
+		return float3x3(
+			mat.m[0].x, mat.m[1].x, mat.m[2].x,
+			mat.m[0].y, mat.m[1].y, mat.m[2].y,
+			mat.m[0].z, mat.m[1].z, mat.m[2].z);
+	}
+
+	// the vector as a column vector
+	inline float3 mul(const float3x3 &mat, const float3 &vec)
+	{
+		return float3(dot(mat.m[0], vec), dot(mat.m[1], vec), dot(mat.m[2], vec));
+	}
+
+	// the vector as a row vector
+	inline float3 mul(const float3 &vec, const float3x3 &mat)
+	{
+		return vec.x * mat.m[0] + vec.y * mat.m[1] + vec.z * mat.m[2];
+	}
+
+	inline float3x3 mul(const float3x3 &a, const float3x3 &b)
+	{
+		return float3x3(mul(a.m[0], b), mul(a.m[1], b), mul(a.m[2], b));
+	}
+}
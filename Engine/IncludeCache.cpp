@@ -0,0 +1,105 @@
+#include "IncludeCache.h"
+
+#include <fstream>
+
+std::shared_ptr<IncludeCache::Entry> IncludeCache::load(const std::filesystem::path &path)
+{
+	std::error_code ec;
+	auto time = std::filesystem::last_write_time(path, ec);
+	if (ec)
+	{
+		return nullptr;
+	}
+	auto size = std::filesystem::file_size(path, ec);
+	if (ec)
+	{
+		return nullptr;
+	}
+
+	auto iter = files.find(path);
+	if (iter != files.end() && iter->second.time == time && iter->second.size == size)
+	{
+		++stats.hits;
+		return iter->second.entry;
+	}
+
+	// read it in one go, the size is known. text mode may return less
+	std::ifstream file(path);
+	if (!file)
+	{
+		return nullptr;
+	}
+	std::string source(static_cast<size_t>(size), '\0');
+	file.read(source.data(), source.size());
+	source.resize(static_cast<size_t>(file.gcount()));
+	stats.bytes_read += source.size();
+
+	uint64_t source_hash = hash(source);
+	std::shared_ptr<Entry> entry;
+	if (iter != files.end() && iter->second.entry->hash == source_hash && iter->second.entry->source == source)
+	{
+		entry = iter->second.entry; // only touched
+	}
+	else if (auto content = contents.find(source_hash); content != contents.end())
+	{
+		entry = content->second.lock();
+		if (entry && entry->source != source)
+		{
+			entry = nullptr; // a collision, very unlikely
+		}
+	}
+
+	if (entry)
+	{
+		++stats.hits;
+	}
+	else
+	{
+		++stats.misses;
+		entry = std::make_shared<Entry>();
+		entry->hash = source_hash;
+		entry->source = std::move(source);
+		contents[source_hash] = entry;
+	}
+
+	// drop the old content, unless another path or an open include still uses it
+	if (iter != files.end() && iter->second.entry->hash != entry->hash && iter->second.entry.use_count() == 1)
+	{
+		contents.erase(iter->second.entry->hash);
+	}
+	files[path] = { time, size, entry };
+	return entry;
+}
+
+const IncludeCache::Stats &IncludeCache::getStats() const
+{
+	return stats;
+}
+
+void IncludeCache::resetStats()
+{
+	stats = {};
+}
+
+void IncludeCache::clear()
+{
+	files.clear();
+	contents.clear();
+}
+
+uint64_t IncludeCache::hash(std::string_view data)
+{
+	// 64 bit FNV-1a
+	uint64_t h = 14695981039346656037ull;
+	for (unsigned char c : data)
+	{
+		h ^= c;
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+uint64_t IncludeCache::combine(uint64_t seed, uint64_t value)
+{
+	return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
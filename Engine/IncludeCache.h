@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// keeps the shader files in memory between compiles
+// a file is only read again when its time or size on disk changed, and even then
+// the old entry is kept if the content hash is the same. so the VAR_ rewritten text
+// survives a touched but unchanged file
+class IncludeCache
+{
+public:
+	struct Entry
+	{
+		uint64_t hash = 0;
+		std::string source; // as it is on disk
+		std::string rewritten; // with the variable declarations rewritten, filled by the user
+		bool has_rewritten = false;
+	};
+
+	struct Stats
+	{
+		unsigned hits = 0; // served from memory
+		unsigned misses = 0; // new or changed content
+		uint64_t bytes_read = 0; // also counts files that were read but had the same content
+	};
+
+	// the file at path, nullptr if it can not be opened
+	// the entry stays valid as long as someone holds it, even if the file changes
+	std::shared_ptr<Entry> load(const std::filesystem::path &path);
+
+	const Stats &getStats() const;
+	void resetStats();
+	void clear();
+
+	static uint64_t hash(std::string_view data);
+	// mixes value into seed, for keys made of several hashes
+	static uint64_t combine(uint64_t seed, uint64_t value);
+private:
+	struct FileState
+	{
+		std::filesystem::file_time_type time;
+		uintmax_t size;
+		std::shared_ptr<Entry> entry;
+	};
+
+	std::map<std::filesystem::path, FileState> files;
+	// the same content under different paths (e.g. a substitution) shares the entry
+	std::map<uint64_t, std::weak_ptr<Entry>> contents;
+	Stats stats;
+};
@@ -0,0 +1,55 @@
+#include "IncludeGraph.h"
+
+void IncludeGraph::clear()
+{
+	roots.clear();
+	included_by.clear();
+}
+
+void IncludeGraph::addRoot(const std::filesystem::path &root)
+{
+	roots.insert(root.lexically_normal());
+}
+
+void IncludeGraph::addInclude(const std::filesystem::path &parent, const std::filesystem::path &child)
+{
+	included_by[child.lexically_normal()].insert(parent.lexically_normal());
+}
+
+std::vector<std::filesystem::path> IncludeGraph::getFiles() const
+{
+	std::set<std::filesystem::path> files = roots;
+	for (auto &[child, parents] : included_by)
+	{
+		files.insert(child);
+		files.insert(parents.begin(), parents.end());
+	}
+	return { files.begin(), files.end() };
+}
+
+std::vector<std::filesystem::path> IncludeGraph::getDependentRoots(const std::filesystem::path &file) const
+{
+	// walk the edges backwards, the visited set also stops include cycles
+	std::set<std::filesystem::path> visited;
+	std::vector<std::filesystem::path> stack = { file.lexically_normal() };
+	std::vector<std::filesystem::path> result;
+	while (!stack.empty())
+	{
+		auto current = std::move(stack.back());
+		stack.pop_back();
+		if (!visited.insert(current).second)
+		{
+			continue;
+		}
+
+		if (roots.count(current))
+		{
+			result.push_back(current);
+		}
+		if (auto iter = included_by.find(current); iter != included_by.end())
+		{
+			stack.insert(stack.end(), iter->second.begin(), iter->second.end());
+		}
+	}
+	return result;
+}
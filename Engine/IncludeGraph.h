@@ -0,0 +1,24 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <set>
+#include <vector>
+
+// which shader file includes which, recorded while the shaders are loaded
+// the roots are the files given to the compiler
+class IncludeGraph
+{
+public:
+	void clear();
+	void addRoot(const std::filesystem::path &root);
+	void addInclude(const std::filesystem::path &parent, const std::filesystem::path &child);
+
+	// every file of the graph, roots and their transitive includes
+	std::vector<std::filesystem::path> getFiles() const;
+	// the roots that include file, directly or through other includes. a root depends on itself
+	std::vector<std::filesystem::path> getDependentRoots(const std::filesystem::path &file) const;
+private:
+	std::set<std::filesystem::path> roots;
+	std::map<std::filesystem::path, std::set<std::filesystem::path>> included_by;
+};
@@ -1,4 +1,5 @@
 #include <math.h>
+#include <utility>
 
 #define D3DVECTOR_DEFINED
 #define D3DMATRIX_DEFINED
@@ -10,8 +11,132 @@ struct D3DXMATRIX;
 
 #include "Math3D.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATH3D_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define MATH3D_NEON
+#include <arm_neon.h>
+#endif
+
 namespace Math3D
 {
+	namespace
+	{
+		// a row of a matrix, or a Vector4, in a register. the pointers have to be 16 byte aligned
+		// multiply and add are kept apart, so the results are the same as with plain floats
+#if defined(MATH3D_SSE)
+		using Row = __m128;
+
+		Row load(const float *p)
+		{
+			return _mm_load_ps(p);
+		}
+		void store(float *p, Row a)
+		{
+			_mm_store_ps(p, a);
+		}
+		Row set1(float a)
+		{
+			return _mm_set1_ps(a);
+		}
+		Row add(Row a, Row b)
+		{
+			return _mm_add_ps(a, b);
+		}
+		Row sub(Row a, Row b)
+		{
+			return _mm_sub_ps(a, b);
+		}
+		Row mul(Row a, Row b)
+		{
+			return _mm_mul_ps(a, b);
+		}
+		void transpose(Row &r0, Row &r1, Row &r2, Row &r3)
+		{
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		}
+#elif defined(MATH3D_NEON)
+		using Row = float32x4_t;
+
+		Row load(const float *p)
+		{
+			return vld1q_f32(p);
+		}
+		void store(float *p, Row a)
+		{
+			vst1q_f32(p, a);
+		}
+		Row set1(float a)
+		{
+			return vdupq_n_f32(a);
+		}
+		Row add(Row a, Row b)
+		{
+			return vaddq_f32(a, b);
+		}
+		Row sub(Row a, Row b)
+		{
+			return vsubq_f32(a, b);
+		}
+		Row mul(Row a, Row b)
+		{
+			return vmulq_f32(a, b);
+		}
+		void transpose(Row &r0, Row &r1, Row &r2, Row &r3)
+		{
+			float32x4x2_t t01 = vtrnq_f32(r0, r1);
+			float32x4x2_t t23 = vtrnq_f32(r2, r3);
+			r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+			r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+			r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+			r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+		}
+#else
+		struct Row
+		{
+			float v[4];
+		};
+
+		Row load(const float *p)
+		{
+			return { p[0], p[1], p[2], p[3] };
+		}
+		void store(float *p, Row a)
+		{
+			for (unsigned i = 0; i < 4; ++i)
+				p[i] = a.v[i];
+		}
+		Row set1(float a)
+		{
+			return { a, a, a, a };
+		}
+		Row add(Row a, Row b)
+		{
+			return { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] };
+		}
+		Row sub(Row a, Row b)
+		{
+			return { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] };
+		}
+		Row mul(Row a, Row b)
+		{
+			return { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] };
+		}
+		void transpose(Row &r0, Row &r1, Row &r2, Row &r3)
+		{
+			Row rows[4] = { r0, r1, r2, r3 };
+			for (unsigned i = 0; i < 4; ++i)
+				for (unsigned j = 0; j < i; ++j)
+					std::swap(rows[i].v[j], rows[j].v[i]);
+			r0 = rows[0];
+			r1 = rows[1];
+			r2 = rows[2];
+			r3 = rows[3];
+		}
+#endif
+	}
+
 	bool EqualsZero(float a, float epsilon = 8e-7f)
 	{
 		return fabs(a) < epsilon;
@@ -42,18 +167,6 @@ namespace Math3D
 		return Equal(a, b);
 	}
 
-	Vector2::Vector2()
-	{
-	}
-	Vector2::Vector2(const Vector2 &other) : x(other.x), y(other.y)
-	{
-	}
-	Vector2::Vector2(float _x, float _y) : x(_x), y(_y)
-	{
-	}
-	Vector2::Vector2(const float *pf) : x(pf[0]), y(pf[1])
-	{
-	}
 	Vector2::Vector2(const D3DXVECTOR2 &other) :
 		x(reinterpret_cast<const float *>(&other)[0]), y(reinterpret_cast<const float *>(&other)[1])
 	{
@@ -66,16 +179,6 @@ namespace Math3D
 	{
 		return reinterpret_cast<const D3DXVECTOR2 &>(*this);
 	}
-	Vector2 Vector2::NullVector()
-	{
-		return Vector2(0.f, 0.f);
-	}
-	Vector2 Vector2::operator = (const Vector2 &other)
-	{
-		x = other.x;
-		y = other.y;
-		return *this;
-	}
 	Vector2 Vector2::operator + () const
 	{
 		return *this;
@@ -167,18 +270,6 @@ namespace Math3D
 		return other * s;
 	}
 	////////////////////////////////////////////////////////
-	Vector3::Vector3()
-	{
-	}
-	Vector3::Vector3(const Vector3 &other) : x(other.x), y(other.y), z(other.z)
-	{
-	}
-	Vector3::Vector3(float _x, float _y, float _z) : x(_x), y(_y), z(_z)
-	{
-	}
-	Vector3::Vector3(const float *pf) : x(pf[0]), y(pf[1]), z(pf[2])
-	{
-	}
 	Vector3::Vector3(const D3DXVECTOR3 &other) :
 		x(reinterpret_cast<const float *>(&other)[0]),
 		y(reinterpret_cast<const float *>(&other)[1]),
@@ -193,17 +284,6 @@ namespace Math3D
 	{
 		return reinterpret_cast<const D3DXVECTOR3 &>(*this);
 	}
-	Vector3 Vector3::NullVector()
-	{
-		return Vector3(0.f, 0.f, 0.f);
-	}
-	Vector3 Vector3::operator = (const Vector3 &other)
-	{
-		x = other.x;
-		y = other.y;
-		z = other.z;
-		return *this;
-	}
 	Vector3 Vector3::operator + () const
 	{
 		return *this;
@@ -324,18 +404,6 @@ namespace Math3D
 		return other * s;
 	}
 	//////////////////////////////////////////////////////////
-	Vector4::Vector4()
-	{
-	}
-	Vector4::Vector4(const Vector4 &other) : x(other.x), y(other.y), z(other.z), w(other.w)
-	{
-	}
-	Vector4::Vector4(float p_x, float p_y, float p_z, float p_w) : x(p_x), y(p_y), z(p_z), w(p_w)
-	{
-	}
-	Vector4::Vector4(const float *pf) : x(pf[0]), y(pf[1]), z(pf[2]), w(pf[3])
-	{
-	}
 	Vector4::Vector4(const D3DXVECTOR4 &other) :
 		x(reinterpret_cast<const float *>(&other)[0]),
 		y(reinterpret_cast<const float *>(&other)[1]),
@@ -351,18 +419,6 @@ namespace Math3D
 	{
 		return reinterpret_cast<const D3DXVECTOR4 &>(*this);
 	}
-	Vector4 Vector4::NullVector()
-	{
-		return Vector4(0.f, 0.f, 0.f, 0.f);
-	}
-	Vector4 Vector4::operator = (const Vector4 &other)
-	{
-		x = other.x;
-		y = other.y;
-		z = other.z;
-		w = other.w;
-		return *this;
-	}
 	Vector4 Vector4::operator + () const
 	{
 		return *this;
@@ -481,6 +537,16 @@ namespace Math3D
 	{
 		return other * s;
 	}
+	Vector4 operator * (const Vector4 &vec, const Matrix4x4 &mat)
+	{
+		Row row = mul(set1(vec.x), load(mat.m[0]));
+		row = add(row, mul(set1(vec.y), load(mat.m[1])));
+		row = add(row, mul(set1(vec.z), load(mat.m[2])));
+		row = add(row, mul(set1(vec.w), load(mat.m[3])));
+		Vector4 ret;
+		store(ret.v, row);
+		return ret;
+	}
 	//////////////////////////////////////////////////////////
 	Quaternion::Quaternion()
 	{
@@ -490,14 +556,6 @@ namespace Math3D
 		z=0.f;
 	}
 
-	Quaternion::Quaternion(const Quaternion& copy)
-	{
-		w=copy.w;
-		x=copy.x;
-		y=copy.y;
-		z=copy.z;
-	}
-
 	Quaternion::Quaternion(float w_, float x_, float y_, float z_)
 	{
 		w=w_;
@@ -539,15 +597,6 @@ namespace Math3D
 		return Quaternion(1.0f, 0.0f, 0.0f, 0.0f);
 	}
 
-	Quaternion& Quaternion::operator=(const Quaternion& other)
-	{
-		w=other.w;
-		x=other.x;
-		y=other.y;
-		z=other.z;
-		return *this;
-	}
-
 	Quaternion Quaternion::operator-() const
 	{
 		return Quaternion(w,-x,-y,-z);
@@ -666,21 +715,6 @@ namespace Math3D
 			);
 	}
 	//////////////////////////////////////////////////////////
-	Plane::Plane()
-	{
-	}
-	Plane::Plane(const Plane &other) : a(other.a), b(other.b), c(other.c), d(other.d)
-	{
-	}
-	Plane::Plane(const Vector4 &vec) : a(vec.x), b(vec.y), c(vec.z), d(vec.w)
-	{
-	}
-	Plane::Plane(float p_a, float p_b, float p_c, float p_d) : a(p_a), b(p_b), c(p_c), d(p_d)
-	{
-	}
-	Plane::Plane(const float *ptr) : a(ptr[0]), b(ptr[1]), c(ptr[2]), d(ptr[3])
-	{
-	}
 	void Plane::Normalize()
 	{
 		float inv_length = 1.f / sqrtf(a * a + b * b + c * c);
@@ -703,29 +737,6 @@ namespace Math3D
 		return a * p.x + b * p.y + c * p.z + d;
 	}
 	//////////////////////////////////////////////////////////
-	Matrix4x4::Matrix4x4()
-	{
-	}
-	Matrix4x4::Matrix4x4(const Matrix4x4 &other) :
-	f11(other.f11), f12(other.f12), f13(other.f13), f14(other.f14),
-		f21(other.f21), f22(other.f22), f23(other.f23), f24(other.f24),
-		f31(other.f31), f32(other.f32), f33(other.f33), f34(other.f34),
-		f41(other.f41), f42(other.f42), f43(other.f43), f44(other.f44)
-	{
-	}
-	Matrix4x4::Matrix4x4(float _f11, float _f12, float _f13, float _f14,
-				float _f21, float _f22, float _f23, float _f24,
-				float _f31, float _f32, float _f33, float _f34,
-				float _f41, float _f42, float _f43, float _f44) :
-	f11(_f11), f12(_f12), f13(_f13), f14(_f14), f21(_f21), f22(_f22), f23(_f23), f24(_f24),
-		f31(_f31), f32(_f32), f33(_f33), f34(_f34), f41(_f41), f42(_f42), f43(_f43), f44(_f44)
-	{
-	}
-	Matrix4x4::Matrix4x4(const float *fp) :
-	f11(fp[0]), f12(fp[1]), f13(fp[2]), f14(fp[3]), f21(fp[4]), f22(fp[5]), f23(fp[6]), f24(fp[7]),
-		f31(fp[8]), f32(fp[9]), f33(fp[10]), f34(fp[11]), f41(fp[12]), f42(fp[13]), f43(fp[14]), f44(fp[15])
-	{
-	}
 	Matrix4x4::Matrix4x4(const D3DXMATRIX &other)
 	{
 		const float *src = reinterpret_cast<const float *>(&other);
@@ -740,14 +751,6 @@ namespace Math3D
 	{
 		return reinterpret_cast<const D3DXMATRIX &>(*this);
 	}
-	Matrix4x4 Matrix4x4::NullMatrix()
-	{
-		return Matrix4x4(0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f);
-	}
-	Matrix4x4 Matrix4x4::IdentityMatrix()
-	{
-		return Matrix4x4(1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f);
-	}
 	Matrix4x4 Matrix4x4::RotationXMatrix(float angle)
 	{
 		float c = cosf(angle);
@@ -838,12 +841,6 @@ namespace Math3D
 		}
 		return p.Normalized();
 	}
-	Matrix4x4 Matrix4x4::operator = (const Matrix4x4 &other)
-	{
-		for (unsigned i = 0; i < 16; ++i)
-			m[0][i] = other.m[0][i];
-		return *this;
-	}
 	Matrix4x4 Matrix4x4::operator + () const
 	{
 		return *this;
@@ -909,11 +906,17 @@ namespace Math3D
 	}
 	Matrix4x4 Matrix4x4::operator * (const Matrix4x4 &other) const
 	{
-		Matrix4x4 ret = NullMatrix();
+		// each row of the result mixes the rows of other
+		Row b0 = load(other.m[0]), b1 = load(other.m[1]), b2 = load(other.m[2]), b3 = load(other.m[3]);
+		Matrix4x4 ret;
 		for (unsigned i = 0; i < 4; ++i)
-			for (unsigned j = 0; j < 4; ++j)
-				for (unsigned k = 0; k < 4; ++k)
-					ret[i][j] += m[i][k] * other.m[k][j];
+		{
+			Row row = mul(set1(m[i][0]), b0);
+			row = add(row, mul(set1(m[i][1]), b1));
+			row = add(row, mul(set1(m[i][2]), b2));
+			row = add(row, mul(set1(m[i][3]), b3));
+			store(ret.m[i], row);
+		}
 		return ret;
 	}
 
@@ -931,7 +934,70 @@ namespace Math3D
 	}
 	Matrix4x4 Matrix4x4::Transposed() const
 	{
-		return Matrix4x4(f11, f21, f31, f41, f12, f22, f32, f42, f13, f23, f33, f43, f14, f24, f34, f44);
+		Row r0 = load(m[0]), r1 = load(m[1]), r2 = load(m[2]), r3 = load(m[3]);
+		transpose(r0, r1, r2, r3);
+		Matrix4x4 ret;
+		store(ret.m[0], r0);
+		store(ret.m[1], r1);
+		store(ret.m[2], r2);
+		store(ret.m[3], r3);
+		return ret;
+	}
+	bool Matrix4x4::Invert()
+	{
+		// gauss-jordan on the rows, doing the same to the identity next to it
+		Matrix4x4 a = *this, inv = IdentityMatrix();
+		for (unsigned c = 0; c < 4; ++c)
+		{
+			// the largest value of the column as pivot keeps the rounding errors small
+			unsigned pivot = c;
+			for (unsigned r = c + 1; r < 4; ++r)
+			{
+				if (fabsf(a.m[r][c]) > fabsf(a.m[pivot][c]))
+					pivot = r;
+			}
+			if (a.m[pivot][c] == 0.f)
+				return false;
+			if (pivot != c)
+			{
+				Row a_pivot = load(a.m[pivot]), inv_pivot = load(inv.m[pivot]);
+				store(a.m[pivot], load(a.m[c]));
+				store(inv.m[pivot], load(inv.m[c]));
+				store(a.m[c], a_pivot);
+				store(inv.m[c], inv_pivot);
+			}
+
+			Row scale = set1(1.f / a.m[c][c]);
+			Row a_c = mul(load(a.m[c]), scale), inv_c = mul(load(inv.m[c]), scale);
+			store(a.m[c], a_c);
+			store(inv.m[c], inv_c);
+			for (unsigned r = 0; r < 4; ++r)
+			{
+				if (r == c)
+					continue;
+				Row factor = set1(a.m[r][c]);
+				store(a.m[r], sub(load(a.m[r]), mul(factor, a_c)));
+				store(inv.m[r], sub(load(inv.m[r]), mul(factor, inv_c)));
+			}
+		}
+		*this = inv;
+		return true;
+	}
+	Matrix4x4 Matrix4x4::Inverted() const
+	{
+		Matrix4x4 ret = *this;
+		return ret.Invert() ? ret : NullMatrix();
+	}
+	void Matrix4x4::TransformPoints(const Vector3 *points, Vector4 *transformed, size_t count) const
+	{
+		Row r0 = load(m[0]), r1 = load(m[1]), r2 = load(m[2]), r3 = load(m[3]);
+		for (size_t i = 0; i < count; ++i)
+		{
+			Row row = mul(set1(points[i].x), r0);
+			row = add(row, mul(set1(points[i].y), r1));
+			row = add(row, mul(set1(points[i].z), r2));
+			store(transformed[i].v, add(row, r3));
+		}
 	}
 	Vector3 Matrix4x4::operator * (const Vector3 &other) const
 	{
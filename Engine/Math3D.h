@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstddef>
+
+// the types are trivially copyable, so they can be copied straight into constant buffers,
+// and the constructors are constexpr. Vector4 and Matrix4x4 are aligned for SSE / NEON
 namespace Math3D
 {
 	class Vector2;
@@ -15,10 +19,13 @@ namespace Math3D
 	class Vector2
 	{
 	public:
-		Vector2();
-		Vector2(const Vector2 &);
-		Vector2(float x, float y);
-		Vector2(const float *);
+		Vector2() = default;
+		constexpr Vector2(float _x, float _y) : x(_x), y(_y)
+		{
+		}
+		constexpr Vector2(const float *pf) : x(pf[0]), y(pf[1])
+		{
+		}
 
 #ifdef D3DVECTOR_DEFINED
 		Vector2(const D3DXVECTOR2 &);
@@ -26,9 +33,11 @@ namespace Math3D
 		operator const D3DXVECTOR2 &() const;
 #endif
 
-		static Vector2 NullVector();
+		static constexpr Vector2 NullVector()
+		{
+			return Vector2(0.f, 0.f);
+		}
 
-		Vector2 operator = (const Vector2 &);
 		Vector2 operator + () const;
 		Vector2 operator - () const;
 		Vector2 operator * (float) const;
@@ -62,10 +71,13 @@ namespace Math3D
 	class Vector3
 	{
 	public:
-		Vector3();
-		Vector3(const Vector3 &);
-		Vector3(float x, float y, float z);
-		Vector3(const float *);
+		Vector3() = default;
+		constexpr Vector3(float _x, float _y, float _z) : x(_x), y(_y), z(_z)
+		{
+		}
+		constexpr Vector3(const float *pf) : x(pf[0]), y(pf[1]), z(pf[2])
+		{
+		}
 
 #ifdef D3DVECTOR_DEFINED
 		Vector3(const D3DXVECTOR3 &);
@@ -73,9 +85,11 @@ namespace Math3D
 		operator const D3DXVECTOR3 &() const;
 #endif
 
-		static Vector3 NullVector();
+		static constexpr Vector3 NullVector()
+		{
+			return Vector3(0.f, 0.f, 0.f);
+		}
 
-		Vector3 operator = (const Vector3 &);
 		Vector3 operator + () const;
 		Vector3 operator - () const;
 		Vector3 operator * (float) const;
@@ -112,13 +126,16 @@ namespace Math3D
 	};
 	Vector3 operator * (float, const Vector3 &);
 
-	class Vector4
+	class alignas(16) Vector4
 	{
 	public:
-		Vector4();
-		Vector4(const Vector4 &);
-		Vector4(float x, float y, float z, float w);
-		Vector4(const float *);
+		Vector4() = default;
+		constexpr Vector4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w)
+		{
+		}
+		constexpr Vector4(const float *pf) : x(pf[0]), y(pf[1]), z(pf[2]), w(pf[3])
+		{
+		}
 
 #ifdef D3DVECTOR_DEFINED
 		Vector4(const D3DXVECTOR4 &);
@@ -126,9 +143,11 @@ namespace Math3D
 		operator const D3DXVECTOR4 &() const;
 #endif
 
-		static Vector4 NullVector();
+		static constexpr Vector4 NullVector()
+		{
+			return Vector4(0.f, 0.f, 0.f, 0.f);
+		}
 
-		Vector4 operator = (const Vector4 &);
 		Vector4 operator + () const;
 		Vector4 operator - () const;
 		Vector4 operator * (float) const;
@@ -163,12 +182,13 @@ namespace Math3D
 		};
 	};
 	Vector4 operator * (float, const Vector4 &);
+	// a row vector times the matrix, like the shaders use them
+	Vector4 operator * (const Vector4 &, const Matrix4x4 &);
 
 	class Quaternion
 	{
 	public:
 		Quaternion();
-		Quaternion(const Quaternion &);
 		Quaternion(float w, float x, float y, float z);
 		Quaternion(const Vector3 &other);
 		Quaternion(const Vector3 &other, float angle);
@@ -176,7 +196,6 @@ namespace Math3D
 
 		static Quaternion NullQuaternion();
 
-		Quaternion &operator = (const Quaternion &other);
 		Quaternion operator - () const;
 		Quaternion operator + (const Quaternion &other) const;
 		Quaternion operator - (const Quaternion &other) const;
@@ -210,11 +229,16 @@ namespace Math3D
 	class Plane // a*x + b*y + c*z + d*w = 0
 	{
 	public:
-		Plane();
-		Plane(const Plane &other);
-		Plane(const Vector4 &);
-		Plane(float a, float b, float c, float d);
-		Plane(const float *);
+		Plane() = default;
+		constexpr Plane(const Vector4 &vec) : a(vec.x), b(vec.y), c(vec.z), d(vec.w)
+		{
+		}
+		constexpr Plane(float p_a, float p_b, float p_c, float p_d) : a(p_a), b(p_b), c(p_c), d(p_d)
+		{
+		}
+		constexpr Plane(const float *ptr) : a(ptr[0]), b(ptr[1]), c(ptr[2]), d(ptr[3])
+		{
+		}
 
 		void Normalize();
 		Plane Normalized() const;
@@ -232,16 +256,23 @@ namespace Math3D
 		};
 	};
 
-	class Matrix4x4
+	class alignas(16) Matrix4x4
 	{
 	public:
-		Matrix4x4();
-		Matrix4x4(const Matrix4x4 &);
-		Matrix4x4(float f11, float f12, float f13, float f14,
-				  float f21, float f22, float f23, float f24,
-				  float f31, float f32, float f33, float f34,
-				  float f41, float f42, float f43, float f44);
-		Matrix4x4(const float *);
+		Matrix4x4() = default;
+		constexpr Matrix4x4(float _f11, float _f12, float _f13, float _f14,
+				  float _f21, float _f22, float _f23, float _f24,
+				  float _f31, float _f32, float _f33, float _f34,
+				  float _f41, float _f42, float _f43, float _f44) :
+			f11(_f11), f12(_f12), f13(_f13), f14(_f14), f21(_f21), f22(_f22), f23(_f23), f24(_f24),
+			f31(_f31), f32(_f32), f33(_f33), f34(_f34), f41(_f41), f42(_f42), f43(_f43), f44(_f44)
+		{
+		}
+		constexpr Matrix4x4(const float *fp) :
+			f11(fp[0]), f12(fp[1]), f13(fp[2]), f14(fp[3]), f21(fp[4]), f22(fp[5]), f23(fp[6]), f24(fp[7]),
+			f31(fp[8]), f32(fp[9]), f33(fp[10]), f34(fp[11]), f41(fp[12]), f42(fp[13]), f43(fp[14]), f44(fp[15])
+		{
+		}
 
 #ifdef D3DMATRIX_DEFINED
 		Matrix4x4(const D3DXMATRIX &);
@@ -249,8 +280,14 @@ namespace Math3D
 		operator const D3DXMATRIX &() const;
 #endif
 
-		static Matrix4x4 NullMatrix();
-		static Matrix4x4 IdentityMatrix();
+		static constexpr Matrix4x4 NullMatrix()
+		{
+			return Matrix4x4(0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f);
+		}
+		static constexpr Matrix4x4 IdentityMatrix()
+		{
+			return Matrix4x4(1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f);
+		}
 		static Matrix4x4 RotationXMatrix(float);
 		static Matrix4x4 RotationYMatrix(float);
 		static Matrix4x4 RotationZMatrix(float);
@@ -264,7 +301,6 @@ namespace Math3D
 		enum PlaneIndex {PlaneLeft, PlaneRight, PlaneTop, PlaneBottom, PlaneNear, PlaneFar};
 		Plane GetClippingPlane(unsigned index) const;
 
-		Matrix4x4 operator = (const Matrix4x4 &);
 		Matrix4x4 operator + () const;
 		Matrix4x4 operator - () const;
 		Matrix4x4 operator * (float) const;
@@ -282,7 +318,13 @@ namespace Math3D
 
 		void Transpose();
 		Matrix4x4 Transposed() const;
+		// false if the matrix is singular, then it stays as it was
+		bool Invert();
+		// the null matrix if it is singular
+		Matrix4x4 Inverted() const;
 		Vector3 operator * (const Vector3 &) const;
+		// the points as row vectors (x, y, z, 1) times the matrix, without dividing by w
+		void TransformPoints(const Vector3 *points, Vector4 *transformed, size_t count) const;
 	
 		union
 		{
@@ -0,0 +1,226 @@
+#include "PacketMarcherImpl.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace PacketMarcher
+{
+	namespace
+	{
+		// plain arrays, the compiler is free to vectorize with the baseline instruction set
+		struct ScalarLanes
+		{
+			static constexpr unsigned width = 8;
+
+			struct F
+			{
+				float v[width];
+			};
+			struct M
+			{
+				bool v[width];
+			};
+
+			static F load(const float *p)
+			{
+				F r;
+				for (unsigned i = 0; i < width; ++i)
+					r.v[i] = p[i];
+				return r;
+			}
+			static void store(float *p, const F &a)
+			{
+				for (unsigned i = 0; i < width; ++i)
+					p[i] = a.v[i];
+			}
+			static F set1(float a)
+			{
+				F r;
+				for (unsigned i = 0; i < width; ++i)
+					r.v[i] = a;
+				return r;
+			}
+			static F add(const F &a, const F &b)
+			{
+				F r;
+				for (unsigned i = 0; i < width; ++i)
+					r.v[i] = a.v[i] + b.v[i];
+				return r;
+			}
+			static F mul(const F &a, const F &b)
+			{
+				F r;
+				for (unsigned i = 0; i < width; ++i)
+					r.v[i] = a.v[i] * b.v[i];
+				return r;
+			}
+			static M lt(const F &a, const F &b)
+			{
+				M r;
+				for (unsigned i = 0; i < width; ++i)
+					r.v[i] = a.v[i] < b.v[i];
+				return r;
+			}
+			static M and_(const M &a, const M &b)
+			{
+				M r;
+				for (unsigned i = 0; i < width; ++i)
+					r.v[i] = a.v[i] && b.v[i];
+				return r;
+			}
+			// a and not b
+			static M andnot(const M &a, const M &b)
+			{
+				M r;
+				for (unsigned i = 0; i < width; ++i)
+					r.v[i] = a.v[i] && !b.v[i];
+				return r;
+			}
+			static F select(const M &m, const F &a, const F &b)
+			{
+				F r;
+				for (unsigned i = 0; i < width; ++i)
+					r.v[i] = m.v[i] ? a.v[i] : b.v[i];
+				return r;
+			}
+			static uint32_t bits(const M &m)
+			{
+				uint32_t r = 0;
+				for (unsigned i = 0; i < width; ++i)
+					r |= uint32_t(m.v[i]) << i;
+				return r;
+			}
+			template<class T>
+			static void compress(uint32_t keep, T *p)
+			{
+				unsigned n = 0;
+				for (unsigned i = 0; i < width; ++i)
+				{
+					if ((keep >> i) & 1u)
+						p[n++] = p[i];
+				}
+			}
+		};
+
+#ifdef _MSC_VER
+		bool cpuSupportsAVX2()
+		{
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return false;
+
+			__cpuid(info, 1);
+			bool osxsave = (info[2] >> 27) & 1;
+			bool fma = (info[2] >> 12) & 1;
+			if (!osxsave || !fma)
+				return false;
+
+			// the os has to save the ymm registers
+			if ((_xgetbv(0) & 0x6) != 0x6)
+				return false;
+
+			__cpuidex(info, 7, 0);
+			return (info[1] >> 5) & 1;
+		}
+
+		bool cpuSupportsAVX512()
+		{
+			if (!cpuSupportsAVX2())
+				return false;
+
+			// and the zmm and opmask registers
+			if ((_xgetbv(0) & 0xe6) != 0xe6)
+				return false;
+
+			int info[4];
+			__cpuidex(info, 7, 0);
+			return (info[1] >> 16) & 1;
+		}
+#else
+		bool cpuSupportsAVX2()
+		{
+			return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+		}
+
+		bool cpuSupportsAVX512()
+		{
+			return __builtin_cpu_supports("avx512f");
+		}
+#endif
+	}
+
+	Backend detectBackend()
+	{
+		static const Backend backend = []
+		{
+			if (hasAVX512() && cpuSupportsAVX512())
+				return Backend::AVX512;
+			if (hasAVX2() && cpuSupportsAVX2())
+				return Backend::AVX2;
+			return Backend::Scalar;
+		}();
+		return backend;
+	}
+
+	Backend resolveBackend(Backend backend)
+	{
+		Backend best = detectBackend();
+		if (backend == Backend::Auto || static_cast<int>(backend) > static_cast<int>(best))
+		{
+			return best;
+		}
+		return backend;
+	}
+
+	unsigned getWidth(Backend backend)
+	{
+		switch (resolveBackend(backend))
+		{
+		case Backend::AVX512:
+			return 16;
+		case Backend::AVX2:
+			return 8;
+		default:
+			return ScalarLanes::width;
+		}
+	}
+
+	const char *getName(Backend backend)
+	{
+		switch (backend)
+		{
+		case Backend::Auto:
+			return "auto";
+		case Backend::Scalar:
+			return "scalar";
+		case Backend::AVX2:
+			return "avx2";
+		case Backend::AVX512:
+			return "avx512";
+		}
+		return "unknown";
+	}
+
+	void march(Backend backend, Packet &packet, const Params &params)
+	{
+		switch (resolveBackend(backend))
+		{
+		case Backend::AVX512:
+			marchAVX512(packet, params);
+			break;
+		case Backend::AVX2:
+			marchAVX2(packet, params);
+			break;
+		default:
+			marchScalar(packet, params);
+			break;
+		}
+	}
+
+	void marchScalar(Packet &packet, const Params &params)
+	{
+		marchPacket<ScalarLanes>(packet, params);
+	}
+}
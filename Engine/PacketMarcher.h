@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+
+// marches a packet of coherent rays together, following march_ray in pshader_sdf.hlsl:
+// same over-relaxation, overstep detection and backtracking, but per lane.
+// the marching state lives in SIMD registers, retired lanes get compacted away,
+// so the scene only gets evaluated for the lanes which are still active
+namespace PacketMarcher
+{
+	enum class Backend
+	{
+		Auto, // pick the widest one the cpu supports
+		Scalar,
+		AVX2, // 8 lanes
+		AVX512 // 16 lanes
+	};
+
+	static constexpr unsigned max_width = 16;
+
+	// structure of arrays, one entry per lane
+	struct Packet
+	{
+		// input: where the rays start. output: the last evaluated position
+		alignas(64) float pos_x[max_width];
+		alignas(64) float pos_y[max_width];
+		alignas(64) float pos_z[max_width];
+		// input: the normalized ray directions
+		alignas(64) float dir_x[max_width];
+		alignas(64) float dir_y[max_width];
+		alignas(64) float dir_z[max_width];
+
+		// input: how far along the ray to start, known to be free
+		// output, like the out parameters of march_ray
+		alignas(64) float camera_distance[max_width];
+		alignas(64) float scene_distance[max_width];
+		alignas(64) uint32_t iterations[max_width];
+		alignas(64) bool hit[max_width];
+
+		// how many lanes are used
+		unsigned count;
+	};
+
+	// evaluates the scene for count lanes. lanes holds the original lane index of every entry,
+	// since the entries get compacted while lanes retire
+	// must write the (unsigned) scene distance of each entry into distance
+	using DistanceFunction = void (*)(void *user, const unsigned *lanes, const float *pos_x, const float *pos_y, const float *pos_z, const float *camera_distance, float *distance, unsigned count);
+
+	struct Params
+	{
+		float dist_max;
+		float inside_sign;
+		float dist_eps;
+		unsigned iter_count;
+		DistanceFunction distance_function;
+		void *user;
+	};
+
+	// what the cpu supports, never returns Auto
+	Backend detectBackend();
+	// resolves Auto and falls back to what is supported and compiled in
+	Backend resolveBackend(Backend backend);
+	// how many lanes a packet of this backend has
+	unsigned getWidth(Backend backend);
+	const char *getName(Backend backend);
+
+	// packet.count must not exceed getWidth(backend)
+	void march(Backend backend, Packet &packet, const Params &params);
+
+	// the implementations, each in its own translation unit with the matching instruction set
+	void marchScalar(Packet &packet, const Params &params);
+	bool hasAVX2();
+	void marchAVX2(Packet &packet, const Params &params);
+	bool hasAVX512();
+	void marchAVX512(Packet &packet, const Params &params);
+}
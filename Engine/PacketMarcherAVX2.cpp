@@ -0,0 +1,93 @@
+// compiled with /arch:AVX2, nothing from here may run before the dispatch checked the cpu
+#include "PacketMarcherImpl.h"
+
+#ifdef __AVX2__
+
+#include <immintrin.h>
+
+#include <array>
+
+namespace PacketMarcher
+{
+	namespace
+	{
+		// for every 8 bit mask, the permutation which moves the set lanes to the front
+		constexpr std::array<std::array<int, 8>, 256> makeCompressTable()
+		{
+			std::array<std::array<int, 8>, 256> table{};
+			for (unsigned mask = 0; mask < 256; ++mask)
+			{
+				unsigned n = 0;
+				for (unsigned i = 0; i < 8; ++i)
+				{
+					if ((mask >> i) & 1u)
+						table[mask][n++] = i;
+				}
+				while (n < 8)
+					table[mask][n++] = 0;
+			}
+			return table;
+		}
+
+		alignas(32) constexpr auto compress_table = makeCompressTable();
+
+		struct AVX2Lanes
+		{
+			static constexpr unsigned width = 8;
+
+			using F = __m256;
+			using M = __m256;
+
+			static F load(const float *p) { return _mm256_load_ps(p); }
+			static void store(float *p, F a) { _mm256_store_ps(p, a); }
+			static F set1(float a) { return _mm256_set1_ps(a); }
+			static F add(F a, F b) { return _mm256_add_ps(a, b); }
+			static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+			static M lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+			static M and_(M a, M b) { return _mm256_and_ps(a, b); }
+			// a and not b
+			static M andnot(M a, M b) { return _mm256_andnot_ps(b, a); }
+			static F select(M m, F a, F b) { return _mm256_blendv_ps(b, a, m); }
+			static uint32_t bits(M m) { return static_cast<uint32_t>(_mm256_movemask_ps(m)); }
+
+			static void compress(uint32_t keep, float *p)
+			{
+				__m256i index = _mm256_load_si256(reinterpret_cast<const __m256i *>(compress_table[keep].data()));
+				_mm256_store_ps(p, _mm256_permutevar8x32_ps(_mm256_load_ps(p), index));
+			}
+			static void compress(uint32_t keep, unsigned *p)
+			{
+				__m256i index = _mm256_load_si256(reinterpret_cast<const __m256i *>(compress_table[keep].data()));
+				__m256i v = _mm256_load_si256(reinterpret_cast<const __m256i *>(p));
+				_mm256_store_si256(reinterpret_cast<__m256i *>(p), _mm256_permutevar8x32_epi32(v, index));
+			}
+		};
+	}
+
+	bool hasAVX2()
+	{
+		return true;
+	}
+
+	void marchAVX2(Packet &packet, const Params &params)
+	{
+		marchPacket<AVX2Lanes>(packet, params);
+	}
+}
+
+#else
+
+namespace PacketMarcher
+{
+	bool hasAVX2()
+	{
+		return false;
+	}
+
+	void marchAVX2(Packet &packet, const Params &params)
+	{
+		marchScalar(packet, params);
+	}
+}
+
+#endif
@@ -0,0 +1,69 @@
+// compiled with /arch:AVX512, nothing from here may run before the dispatch checked the cpu
+#include "PacketMarcherImpl.h"
+
+#ifdef __AVX512F__
+
+#include <immintrin.h>
+
+namespace PacketMarcher
+{
+	namespace
+	{
+		struct AVX512Lanes
+		{
+			static constexpr unsigned width = 16;
+
+			using F = __m512;
+			using M = __mmask16;
+
+			static F load(const float *p) { return _mm512_load_ps(p); }
+			static void store(float *p, F a) { _mm512_store_ps(p, a); }
+			static F set1(float a) { return _mm512_set1_ps(a); }
+			static F add(F a, F b) { return _mm512_add_ps(a, b); }
+			static F mul(F a, F b) { return _mm512_mul_ps(a, b); }
+			static M lt(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+			static M and_(M a, M b) { return a & b; }
+			// a and not b
+			static M andnot(M a, M b) { return a & ~b; }
+			static F select(M m, F a, F b) { return _mm512_mask_blend_ps(m, b, a); }
+			static uint32_t bits(M m) { return m; }
+
+			static void compress(uint32_t keep, float *p)
+			{
+				_mm512_store_ps(p, _mm512_maskz_compress_ps(static_cast<__mmask16>(keep), _mm512_load_ps(p)));
+			}
+			static void compress(uint32_t keep, unsigned *p)
+			{
+				__m512i v = _mm512_load_si512(p);
+				_mm512_store_si512(p, _mm512_maskz_compress_epi32(static_cast<__mmask16>(keep), v));
+			}
+		};
+	}
+
+	bool hasAVX512()
+	{
+		return true;
+	}
+
+	void marchAVX512(Packet &packet, const Params &params)
+	{
+		marchPacket<AVX512Lanes>(packet, params);
+	}
+}
+
+#else
+
+namespace PacketMarcher
+{
+	bool hasAVX512()
+	{
+		return false;
+	}
+
+	void marchAVX512(Packet &packet, const Params &params)
+	{
+		marchScalar(packet, params);
+	}
+}
+
+#endif
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "PacketMarcher.h"
+
+#include <bit>
+
+// the packet marching loop, shared by all backends
+// V describes the lanes: the vector and mask types, and the few operations needed
+// only include this from the PacketMarcher*.cpp files, each one compiles it for its own instruction set
+namespace PacketMarcher
+{
+	namespace
+	{
+		template<class V>
+		void marchPacket(Packet &packet, const Params &params)
+		{
+			constexpr unsigned width = V::width;
+			using F = typename V::F;
+			using M = typename V::M;
+
+			// the state of the active lanes, compacted to the front
+			struct State
+			{
+				alignas(64) float start_x[width];
+				alignas(64) float start_y[width];
+				alignas(64) float start_z[width];
+				alignas(64) float dir_x[width];
+				alignas(64) float dir_y[width];
+				alignas(64) float dir_z[width];
+				alignas(64) float pos_x[width];
+				alignas(64) float pos_y[width];
+				alignas(64) float pos_z[width];
+				alignas(64) float camera_distance[width];
+				alignas(64) float retired_camera_distance[width];
+				alignas(64) float last_scene_distance[width];
+				alignas(64) float last_safe_camera_distance[width];
+				alignas(64) float step_factor[width];
+				alignas(64) float scene_distance[width];
+				alignas(64) unsigned lane[width];
+			} state;
+
+			unsigned active = packet.count;
+			for (unsigned i = 0; i < width; ++i)
+			{
+				// unused lanes run along with a copy of the first one
+				unsigned src = i < active ? i : 0;
+				state.start_x[i] = packet.pos_x[src];
+				state.start_y[i] = packet.pos_y[src];
+				state.start_z[i] = packet.pos_z[src];
+				state.dir_x[i] = packet.dir_x[src];
+				state.dir_y[i] = packet.dir_y[src];
+				state.dir_z[i] = packet.dir_z[src];
+				state.camera_distance[i] = packet.camera_distance[src];
+				state.last_scene_distance[i] = 0.f;
+				state.last_safe_camera_distance[i] = packet.camera_distance[src];
+				state.step_factor[i] = 1.f;
+				state.lane[i] = src;
+			}
+
+			const F one = V::set1(1.f);
+			const F dist_eps = V::set1(params.dist_eps);
+			const F dist_max = V::set1(params.dist_max);
+			const F inside_sign = V::set1(params.inside_sign);
+
+			unsigned iter;
+			for (iter = 0; iter < params.iter_count && active; ++iter)
+			{
+				if (iter == 3)
+				{
+					V::store(state.step_factor, V::set1(1.5f));
+				}
+
+				F camera_distance = V::load(state.camera_distance);
+				V::store(state.pos_x, V::add(V::load(state.start_x), V::mul(V::load(state.dir_x), camera_distance)));
+				V::store(state.pos_y, V::add(V::load(state.start_y), V::mul(V::load(state.dir_y), camera_distance)));
+				V::store(state.pos_z, V::add(V::load(state.start_z), V::mul(V::load(state.dir_z), camera_distance)));
+
+				params.distance_function(params.user, state.lane, state.pos_x, state.pos_y, state.pos_z, state.camera_distance, state.scene_distance, active);
+
+				F scene_distance = V::mul(V::load(state.scene_distance), inside_sign);
+				V::store(state.scene_distance, scene_distance);
+
+				F step_factor = V::load(state.step_factor);
+				F last_scene_distance = V::load(state.last_scene_distance);
+				F last_safe_camera_distance = V::load(state.last_safe_camera_distance);
+
+				// check for overstepping, these lanes go back and try slowly
+				M overstep = V::and_(V::lt(one, step_factor), V::lt(V::add(last_scene_distance, scene_distance), V::mul(last_scene_distance, step_factor)));
+				camera_distance = V::select(overstep, last_safe_camera_distance, camera_distance);
+				step_factor = V::select(overstep, one, step_factor);
+				last_scene_distance = V::select(overstep, last_scene_distance, scene_distance);
+
+				// handle distance
+				M out_of_range = V::andnot(V::lt(dist_max, camera_distance), overstep);
+				M hit = V::andnot(V::andnot(V::lt(scene_distance, dist_eps), out_of_range), overstep);
+
+				uint32_t active_bits = (1u << active) - 1u;
+				uint32_t hit_bits = V::bits(hit) & active_bits;
+				uint32_t retire_bits = (V::bits(out_of_range) | hit_bits) & active_bits;
+				V::store(state.retired_camera_distance, camera_distance);
+
+				// advance the others
+				V::store(state.last_safe_camera_distance, V::select(overstep, last_safe_camera_distance, V::add(camera_distance, scene_distance)));
+				V::store(state.camera_distance, V::select(overstep, camera_distance, V::add(camera_distance, V::mul(scene_distance, step_factor))));
+				V::store(state.step_factor, step_factor);
+				V::store(state.last_scene_distance, last_scene_distance);
+
+				if (retire_bits)
+				{
+					for (uint32_t bits = retire_bits; bits; bits &= bits - 1)
+					{
+						unsigned i = std::countr_zero(bits);
+						unsigned lane = state.lane[i];
+						packet.pos_x[lane] = state.pos_x[i];
+						packet.pos_y[lane] = state.pos_y[i];
+						packet.pos_z[lane] = state.pos_z[i];
+						packet.camera_distance[lane] = state.retired_camera_distance[i];
+						packet.scene_distance[lane] = state.scene_distance[i];
+						packet.iterations[lane] = iter;
+						packet.hit[lane] = (hit_bits >> i) & 1u;
+					}
+
+					// only the state which survives into the next iteration needs compacting
+					uint32_t keep_bits = active_bits & ~retire_bits;
+					V::compress(keep_bits, state.start_x);
+					V::compress(keep_bits, state.start_y);
+					V::compress(keep_bits, state.start_z);
+					V::compress(keep_bits, state.dir_x);
+					V::compress(keep_bits, state.dir_y);
+					V::compress(keep_bits, state.dir_z);
+					V::compress(keep_bits, state.pos_x);
+					V::compress(keep_bits, state.pos_y);
+					V::compress(keep_bits, state.pos_z);
+					V::compress(keep_bits, state.camera_distance);
+					V::compress(keep_bits, state.last_scene_distance);
+					V::compress(keep_bits, state.last_safe_camera_distance);
+					V::compress(keep_bits, state.step_factor);
+					V::compress(keep_bits, state.scene_distance);
+					V::compress(keep_bits, state.lane);
+					active = std::popcount(keep_bits);
+				}
+			}
+
+			// these ran out of iterations
+			for (unsigned i = 0; i < active; ++i)
+			{
+				unsigned lane = state.lane[i];
+				packet.pos_x[lane] = state.pos_x[i];
+				packet.pos_y[lane] = state.pos_y[i];
+				packet.pos_z[lane] = state.pos_z[i];
+				packet.camera_distance[lane] = state.camera_distance[i];
+				packet.scene_distance[lane] = state.scene_distance[i];
+				packet.iterations[lane] = iter;
+				packet.hit[lane] = false;
+			}
+		}
+	}
+}
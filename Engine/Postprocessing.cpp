@@ -86,34 +86,42 @@ bool HDR::init(Graphics &graphics, unsigned width, unsigned height)
 	return true;
 }
 
-bool HDR::initShader(ShaderIncluder &includer)
+void HDR::addShaders(ShaderBuild &build)
+{
+	// both bloom passes share the preprocessing of the file
+	hdr_job = build.add("pshader_hdr.hlsl", "ps_5_0", "ps_main");
+	bloom1_job = build.add("bloom.hlsl", "cs_5_0", "cs_main1");
+	bloom2_job = build.add("bloom.hlsl", "cs_5_0", "cs_main2");
+}
+
+bool HDR::createShaders(ShaderBuild &build)
 {
 	auto dev = graphics->GetDevice();
 
-	Comptr<ID3DBlob> p_compiled = compileShader(includer, "pshader_hdr.hlsl", "ps_5_0", "ps_main");
-	if (!p_compiled)
+	// finish each job, so all the messages get reported
+	Comptr<ID3DBlob> p_compiled = build.finish(hdr_job);
+	Comptr<ID3DBlob> bloom1_compiled = build.finish(bloom1_job);
+	Comptr<ID3DBlob> bloom2_compiled = build.finish(bloom2_job);
+	if (!p_compiled || !bloom1_compiled || !bloom2_compiled)
 		return false;
 
-	HRESULT result = dev->CreatePixelShader(p_compiled->GetBufferPointer(), p_compiled->GetBufferSize(), 0, &hdr_shader);
+	Comptr<ID3D11PixelShader> new_hdr_shader;
+	HRESULT result = dev->CreatePixelShader(p_compiled->GetBufferPointer(), p_compiled->GetBufferSize(), 0, &new_hdr_shader);
 	if (FAILED(result))
 		return false;
 
-	p_compiled = compileShader(includer, "bloom.hlsl", "cs_5_0", "cs_main1");
-	if (!p_compiled)
-		return false;
-
-	result = dev->CreateComputeShader(p_compiled->GetBufferPointer(), p_compiled->GetBufferSize(), 0, &bloom1_shader);
+	Comptr<ID3D11ComputeShader> new_bloom1_shader, new_bloom2_shader;
+	result = dev->CreateComputeShader(bloom1_compiled->GetBufferPointer(), bloom1_compiled->GetBufferSize(), 0, &new_bloom1_shader);
 	if (FAILED(result))
 		return false;
 
-	p_compiled = compileShader(includer, "bloom.hlsl", "cs_5_0", "cs_main2");
-	if (!p_compiled)
-		return false;
-
-	result = dev->CreateComputeShader(p_compiled->GetBufferPointer(), p_compiled->GetBufferSize(), 0, &bloom2_shader);
+	result = dev->CreateComputeShader(bloom2_compiled->GetBufferPointer(), bloom2_compiled->GetBufferSize(), 0, &new_bloom2_shader);
 	if (FAILED(result))
 		return false;
 
+	hdr_shader = std::move(new_hdr_shader);
+	bloom1_shader = std::move(new_bloom1_shader);
+	bloom2_shader = std::move(new_bloom2_shader);
 	return true;
 }
 
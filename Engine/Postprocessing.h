@@ -7,13 +7,15 @@
 class Graphics;
 class GPUProfiler;
 class FullscreenQuad;
-class ShaderIncluder;
+class ShaderBuild;
 
 class HDR
 {
 public:
 	bool init(Graphics &graphics, unsigned width, unsigned height);
-	bool initShader(ShaderIncluder &includer);
+	// like the quad, the old shaders stay if the build failed
+	void addShaders(ShaderBuild &build);
+	bool createShaders(ShaderBuild &build);
 
 	ID3D11RenderTargetView *getRenderTarget();
 	ID3D11ShaderResourceView *getShaderView();
@@ -39,5 +41,7 @@ private:
 
 	Comptr<ID3D11ComputeShader> bloom1_shader, bloom2_shader;
 
+	unsigned hdr_job = 0, bloom1_job = 0, bloom2_job = 0;
+
 	unsigned width = 0, height = 0;
 };
\ No newline at end of file
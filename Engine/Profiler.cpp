@@ -0,0 +1,460 @@
+#include "Profiler.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <sstream>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PROFILER_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace
+{
+	// the names of all profilers, ids are indices
+	struct ScopeNames
+	{
+		std::mutex mutex;
+		std::map<std::string, Profiler::ScopeId, std::less<>> ids;
+		std::deque<std::string> names; // does not move them when growing
+	};
+
+	ScopeNames &getScopeNames()
+	{
+		static ScopeNames scope_names;
+		return scope_names;
+	}
+
+	std::atomic<uint64_t> next_serial = 1;
+
+	// the buffer the thread wrote to last, so most calls do not need the lock
+	// all buffers of the thread, in any profiler, are marked as finished when it ends. then the
+	// next capture removes them, or a new thread takes them over
+	struct ThreadCache
+	{
+		uint64_t serial = 0;
+		void *buffer = nullptr;
+		std::vector<std::shared_ptr<std::atomic<bool>>> finished;
+
+		void add(const std::shared_ptr<std::atomic<bool>> &flag)
+		{
+			// the ones only held here belong to buffers which are gone
+			std::erase_if(finished, [](auto &entry) { return entry.use_count() == 1; });
+			if (std::ranges::find(finished, flag) == finished.end())
+			{
+				finished.push_back(flag);
+			}
+		}
+
+		~ThreadCache()
+		{
+			for (auto &flag : finished)
+			{
+				flag->store(true, std::memory_order_release);
+			}
+		}
+	};
+	thread_local ThreadCache thread_cache;
+}
+
+struct Profiler::Buffer
+{
+	// atomic, since the capture may read a slot while the thread writes it again
+	struct Slot
+	{
+		std::atomic<ScopeId> scope;
+		std::atomic<unsigned> depth;
+		std::atomic<uint64_t> begin, end;
+	};
+	struct Open
+	{
+		ScopeId scope;
+		uint64_t begin;
+	};
+
+	std::string name; // changed only by the owner, with the mutex
+	unsigned id = 0;
+	bool thread = false; // written by a thread with scopes, or by addEvent
+	std::thread::id owner;
+	std::shared_ptr<std::atomic<bool>> finished = std::make_shared<std::atomic<bool>>(false);
+
+	std::unique_ptr<Slot[]> slots;
+	uint64_t mask = 0;
+	std::atomic<uint64_t> written = 0; // events ever written, only by the owner
+	uint64_t read = 0; // where the capture goes on, only with the mutex
+	std::vector<Open> open; // the scopes of the owner
+};
+
+uint64_t ChronoClock::now() const
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t ChronoClock::getFrequency() const
+{
+	return 1'000'000'000;
+}
+
+std::string_view ChronoClock::getName() const
+{
+	return "steady_clock";
+}
+
+TscClock::TscClock()
+{
+#ifdef PROFILER_TSC
+	// count the ticks over a few milliseconds of the steady_clock
+	auto start_time = std::chrono::steady_clock::now();
+	uint64_t start_ticks = __rdtsc();
+	std::chrono::steady_clock::time_point end_time;
+	do
+	{
+		end_time = std::chrono::steady_clock::now();
+	} while (end_time - start_time < std::chrono::milliseconds(5));
+	uint64_t ticks = __rdtsc() - start_ticks;
+	frequency = static_cast<uint64_t>(ticks / std::chrono::duration<double>(end_time - start_time).count());
+#else
+	frequency = ChronoClock().getFrequency();
+#endif
+}
+
+uint64_t TscClock::now() const
+{
+#ifdef PROFILER_TSC
+	return __rdtsc();
+#else
+	return ChronoClock().now();
+#endif
+}
+
+uint64_t TscClock::getFrequency() const
+{
+	return frequency;
+}
+
+std::string_view TscClock::getName() const
+{
+	return isAvailable() ? "rdtsc" : "steady_clock";
+}
+
+bool TscClock::isAvailable()
+{
+#ifdef PROFILER_TSC
+	return true;
+#else
+	return false;
+#endif
+}
+
+Profiler::Profiler(std::unique_ptr<ProfilerClock> clock, size_t capacity) : clock(std::move(clock)), serial(next_serial++)
+{
+	if (!this->clock)
+	{
+		this->clock = std::make_unique<ChronoClock>();
+	}
+	this->capacity = 1;
+	while (this->capacity < capacity)
+	{
+		this->capacity *= 2;
+	}
+}
+
+Profiler::~Profiler() = default;
+
+Profiler::ScopeId Profiler::intern(std::string_view name)
+{
+	auto &scope_names = getScopeNames();
+	std::lock_guard lock(scope_names.mutex);
+	if (auto iter = scope_names.ids.find(name); iter != scope_names.ids.end())
+	{
+		return iter->second;
+	}
+	auto id = static_cast<ScopeId>(scope_names.names.size());
+	scope_names.names.emplace_back(name);
+	scope_names.ids.emplace(name, id);
+	return id;
+}
+
+std::string_view Profiler::getName(ScopeId scope)
+{
+	auto &scope_names = getScopeNames();
+	std::lock_guard lock(scope_names.mutex);
+	if (scope >= scope_names.names.size())
+	{
+		return "unknown";
+	}
+	return scope_names.names[scope];
+}
+
+void Profiler::setThreadName(std::string_view name)
+{
+	auto &buffer = getBuffer();
+	if (buffer.name != name)
+	{
+		std::lock_guard lock(mutex);
+		buffer.name = name;
+	}
+}
+
+void Profiler::begin(ScopeId scope)
+{
+	auto &buffer = getBuffer();
+	buffer.open.push_back({ scope, clock->now() });
+}
+
+void Profiler::end()
+{
+	uint64_t end_time = clock->now();
+	auto &buffer = getBuffer();
+	if (buffer.open.empty())
+	{
+		return;
+	}
+	auto open = buffer.open.back();
+	buffer.open.pop_back();
+
+	Event event;
+	event.scope = open.scope;
+	event.depth = static_cast<unsigned>(buffer.open.size());
+	event.begin = open.begin;
+	event.end = end_time;
+	write(buffer, event);
+}
+
+void Profiler::addEvent(std::string_view track, ScopeId scope, unsigned depth, uint64_t begin, uint64_t end)
+{
+	Buffer *buffer = nullptr;
+	{
+		std::lock_guard lock(mutex);
+		auto iter = std::ranges::find_if(buffers, [&](auto &entry)
+		{
+			return !entry->thread && entry->name == track;
+		});
+		buffer = iter != buffers.end() ? iter->get() : &addBuffer(std::string(track), false);
+	}
+
+	Event event;
+	event.scope = scope;
+	event.depth = depth;
+	event.begin = begin;
+	event.end = std::max(begin, end);
+	write(*buffer, event);
+}
+
+uint64_t Profiler::now() const
+{
+	return clock->now();
+}
+
+const ProfilerClock &Profiler::getClock() const
+{
+	return *clock;
+}
+
+Profiler::Capture Profiler::capture()
+{
+	Capture capture;
+	capture.frequency = clock->getFrequency();
+	capture.clock = clock->getName();
+
+	std::lock_guard lock(mutex);
+	for (auto iter = buffers.begin(); iter != buffers.end();)
+	{
+		auto &buffer = **iter;
+		// before written, so the last events of a finished thread are seen
+		bool finished = buffer.finished->load(std::memory_order_acquire);
+
+		uint64_t written = buffer.written.load(std::memory_order_acquire);
+		uint64_t first = std::max(buffer.read, written > capacity ? written - capacity : 0);
+		std::vector<Event> events;
+		events.reserve(written - first);
+		for (uint64_t index = first; index < written; ++index)
+		{
+			auto &slot = buffer.slots[index & buffer.mask];
+			Event event;
+			event.scope = slot.scope.load(std::memory_order_relaxed);
+			event.depth = slot.depth.load(std::memory_order_relaxed);
+			event.begin = slot.begin.load(std::memory_order_relaxed);
+			event.end = slot.end.load(std::memory_order_relaxed);
+			events.push_back(event);
+		}
+
+		// the thread may have gone on while copying. once it got to index + capacity, the slot
+		// of index could hold a newer event, those are thrown away
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t after = buffer.written.load(std::memory_order_relaxed);
+		uint64_t valid = after >= capacity ? after - capacity + 1 : 0;
+		uint64_t overwritten = std::min(std::max(valid, first) - first, static_cast<uint64_t>(events.size()));
+		events.erase(events.begin(), events.begin() + overwritten);
+
+		Track track;
+		track.name = buffer.name;
+		track.id = buffer.id;
+		track.events = std::move(events);
+		track.dropped = first - buffer.read + overwritten;
+		capture.tracks.push_back(std::move(track));
+		buffer.read = written;
+
+		if (finished)
+		{
+			iter = buffers.erase(iter);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+	capture.dropped = dropped;
+	dropped = 0;
+	return capture;
+}
+
+std::string Profiler::toChromeTrace(const Capture &capture)
+{
+	// microseconds from the first event
+	uint64_t origin = UINT64_MAX;
+	for (auto &track : capture.tracks)
+	{
+		for (auto &event : track.events)
+		{
+			origin = std::min(origin, event.begin);
+		}
+	}
+	double microseconds = 1e6 / capture.frequency;
+	uint64_t dropped = 0;
+
+	std::ostringstream out;
+	out.setf(std::ios::fixed);
+	out.precision(3);
+	out << "{\n\t\"traceEvents\": [";
+	bool first = true;
+	for (auto &track : capture.tracks)
+	{
+		out << (first ? "\n" : ",\n") << "\t\t{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << track.id <<
+			", \"args\": { \"name\": " << quoteJson(track.name) << " } }";
+		first = false;
+		for (auto &event : track.events)
+		{
+			out << ",\n\t\t{ \"name\": " << quoteJson(getName(event.scope)) << ", \"ph\": \"X\", \"ts\": " << (event.begin - origin) * microseconds <<
+				", \"dur\": " << (event.end - event.begin) * microseconds << ", \"pid\": 1, \"tid\": " << track.id << " }";
+		}
+		dropped += track.dropped;
+	}
+	dropped += capture.dropped;
+	out << "\n\t],\n\t\"displayTimeUnit\": \"ms\",\n\t\"otherData\": { \"clock\": " << quoteJson(capture.clock) << ", \"dropped\": " << dropped << " }\n}\n";
+	return out.str();
+}
+
+Profiler::Scope::Scope(Profiler *profiler, ScopeId scope) : profiler(profiler)
+{
+	if (profiler)
+	{
+		profiler->begin(scope);
+	}
+}
+
+Profiler::Scope::~Scope()
+{
+	if (profiler)
+	{
+		profiler->end();
+	}
+}
+
+Profiler::Buffer &Profiler::getBuffer()
+{
+	if (thread_cache.serial == serial)
+	{
+		return *static_cast<Buffer *>(thread_cache.buffer);
+	}
+
+	// first use on this thread, or the thread used another profiler in between
+	std::lock_guard lock(mutex);
+	auto owner = std::this_thread::get_id();
+	auto iter = std::ranges::find_if(buffers, [&](auto &entry)
+	{
+		return entry->thread && entry->owner == owner && !entry->finished->load(std::memory_order_relaxed);
+	});
+	Buffer &buffer = iter != buffers.end() ? **iter : reuseBuffer();
+	thread_cache.serial = serial;
+	thread_cache.buffer = &buffer;
+	thread_cache.add(buffer.finished);
+	return buffer;
+}
+
+Profiler::Buffer &Profiler::reuseBuffer()
+{
+	// one of a finished thread, best one which was captured completely
+	Buffer *reused = nullptr;
+	size_t finished_count = 0;
+	for (auto &entry : buffers)
+	{
+		if (entry->thread && entry->finished->load(std::memory_order_acquire))
+		{
+			++finished_count;
+			bool captured = entry->read == entry->written.load(std::memory_order_relaxed);
+			if (captured || !reused)
+			{
+				reused = entry.get();
+			}
+			if (captured)
+			{
+				break;
+			}
+		}
+	}
+	if (!reused || (reused->read != reused->written.load(std::memory_order_relaxed) && finished_count <= max_finished_tracks))
+	{
+		return addBuffer({}, true);
+	}
+
+	// the events left in it are lost, and it continues as the track of this thread
+	uint64_t written = reused->written.load(std::memory_order_relaxed);
+	dropped += written - reused->read;
+	reused->read = written;
+	reused->id = next_id++;
+	reused->name = "thread " + std::to_string(reused->id);
+	reused->owner = std::this_thread::get_id();
+	reused->finished = std::make_shared<std::atomic<bool>>(false);
+	reused->open.clear();
+	return *reused;
+}
+
+Profiler::Buffer &Profiler::addBuffer(std::string name, bool thread)
+{
+	auto buffer = std::make_unique<Buffer>();
+	buffer->id = next_id++;
+	buffer->name = name.empty() ? "thread " + std::to_string(buffer->id) : std::move(name);
+	buffer->thread = thread;
+	if (thread)
+	{
+		buffer->owner = std::this_thread::get_id();
+		buffer->open.reserve(32);
+	}
+	buffer->slots = std::make_unique<Buffer::Slot[]>(capacity);
+	buffer->mask = capacity - 1;
+	buffers.push_back(std::move(buffer));
+	return *buffers.back();
+}
+
+void Profiler::write(Buffer &buffer, const Event &event)
+{
+	uint64_t index = buffer.written.load(std::memory_order_relaxed);
+	// a capture which sees the new slot also sees written at index at least, so it knows the old event is gone
+	std::atomic_thread_fence(std::memory_order_release);
+	auto &slot = buffer.slots[index & buffer.mask];
+	slot.scope.store(event.scope, std::memory_order_relaxed);
+	slot.depth.store(event.depth, std::memory_order_relaxed);
+	slot.begin.store(event.begin, std::memory_order_relaxed);
+	slot.end.store(event.end, std::memory_order_relaxed);
+	buffer.written.store(index + 1, std::memory_order_release);
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// where a profiler takes its time from, in ticks
+class ProfilerClock
+{
+public:
+	virtual ~ProfilerClock() = default;
+	virtual uint64_t now() const = 0;
+	// ticks per second
+	virtual uint64_t getFrequency() const = 0;
+	virtual std::string_view getName() const = 0;
+};
+
+// std::chrono::steady_clock, in nanoseconds
+class ChronoClock : public ProfilerClock
+{
+public:
+	uint64_t now() const override;
+	uint64_t getFrequency() const override;
+	std::string_view getName() const override;
+};
+
+// the time stamp counter of the cpu, a lot cheaper to read than the os clock
+// its frequency is measured against steady_clock when constructed, which takes a few milliseconds
+// on cpus without one, it is the steady_clock
+class TscClock : public ProfilerClock
+{
+public:
+	TscClock();
+	uint64_t now() const override;
+	uint64_t getFrequency() const override;
+	std::string_view getName() const override;
+
+	static bool isAvailable();
+private:
+	uint64_t frequency;
+};
+
+// a hierarchical profiler, which does not need any graphics device
+//
+// how to use:
+// - intern the name of a scope once, e.g. into a static
+// - wrap the code in a Scope (or begin / end), scopes nest per thread
+// - timestamps from somewhere else, like gpu queries, go to their own track with addEvent
+// - capture collects what happened since the last capture, toChromeTrace writes it out
+//
+// every thread writes its events into its own ring buffer, without a lock. when a thread writes
+// faster than they are captured, the oldest events are lost and counted as dropped
+class Profiler
+{
+public:
+	using ScopeId = uint32_t;
+
+	struct Event
+	{
+		ScopeId scope = 0;
+		unsigned depth = 0; // how many scopes were open around it
+		uint64_t begin = 0, end = 0; // in ticks of the clock
+	};
+
+	struct Track
+	{
+		std::string name; // of the thread, or what added the events
+		unsigned id = 0;
+		std::vector<Event> events; // in the order they ended
+		uint64_t dropped = 0; // overwritten before the capture
+	};
+
+	struct Capture
+	{
+		std::vector<Track> tracks;
+		uint64_t dropped = 0; // of finished threads, whose track was reused before it was captured
+		uint64_t frequency = 1; // ticks per second
+		std::string clock; // the name of the clock
+	};
+
+	// nullptr takes a ChronoClock. capacity is the number of events per track, rounded up to a power of two
+	explicit Profiler(std::unique_ptr<ProfilerClock> clock = nullptr, size_t capacity = 1 << 14);
+	~Profiler();
+	Profiler(const Profiler &) = delete;
+	Profiler &operator=(const Profiler &) = delete;
+
+	// the same name gives the same id, in every profiler
+	static ScopeId intern(std::string_view name);
+	// stays valid until the program ends
+	static std::string_view getName(ScopeId scope);
+
+	// the track name of the calling thread, the default is "thread <id>"
+	void setThreadName(std::string_view name);
+	// on the calling thread, end closes the last scope which began
+	void begin(ScopeId scope);
+	void end();
+	// an event which was measured elsewhere, in ticks of the clock
+	// one track must only be added to by one thread at a time
+	void addEvent(std::string_view track, ScopeId scope, unsigned depth, uint64_t begin, uint64_t end);
+
+	uint64_t now() const;
+	const ProfilerClock &getClock() const;
+
+	// the events since the last capture, one track per thread. tracks of finished threads are removed
+	// after their last events were captured
+	Capture capture();
+
+	// the tracks of finished threads are reused by new threads, so starting threads without ever
+	// capturing does not grow the memory. up to this many are kept with events nobody captured yet
+	static constexpr size_t max_finished_tracks = 8;
+
+	// the trace_event json format, which chrome://tracing and ui.perfetto.dev open
+	static std::string toChromeTrace(const Capture &capture);
+
+	// begins in the constructor and ends in the destructor. does nothing without a profiler
+	class Scope
+	{
+	public:
+		Scope(Profiler *profiler, ScopeId scope);
+		~Scope();
+		Scope(const Scope &) = delete;
+		Scope &operator=(const Scope &) = delete;
+	private:
+		Profiler *profiler;
+	};
+private:
+	struct Buffer;
+
+	// of the calling thread, created on first use
+	Buffer &getBuffer();
+	// a finished one for a new thread, or a new one. needs the mutex
+	Buffer &reuseBuffer();
+	// needs the mutex
+	Buffer &addBuffer(std::string name, bool thread);
+	void write(Buffer &buffer, const Event &event);
+
+	std::unique_ptr<ProfilerClock> clock;
+	size_t capacity;
+	// tells the profilers apart in the per thread cache, since one could be at the address of a deleted one
+	uint64_t serial;
+
+	std::mutex mutex; // for the list of buffers and their names
+	std::vector<std::unique_ptr<Buffer>> buffers;
+	unsigned next_id = 1;
+	uint64_t dropped = 0; // of reused tracks, until the next capture
+};
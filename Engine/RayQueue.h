@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+
+// the rays of a pixel still to trace, at most Count of them. a max heap on the weight
+// of the rays (their expected contribution), so the strongest one is traced next
+// the shader takes the one of the lowest depth instead, from a plain array
+template<class Ray, unsigned Count>
+class RayQueue
+{
+public:
+	// false if a ray was dropped because all slots are taken
+	// then the weakest of all of them is the one dropped, queued or new
+	bool push(const Ray &ray)
+	{
+		if (count < Count)
+		{
+			rays[count++] = ray;
+			std::push_heap(rays, rays + count, lowerWeight);
+			return true;
+		}
+
+		Ray *weakest = std::min_element(rays, rays + count, lowerWeight);
+		if (weakest->weight < ray.weight)
+		{
+			*weakest = ray;
+			std::make_heap(rays, rays + count, lowerWeight);
+		}
+		return false;
+	}
+
+	// the ray of the largest weight, the queue must not be empty
+	Ray pop()
+	{
+		std::pop_heap(rays, rays + count, lowerWeight);
+		return rays[--count];
+	}
+
+	unsigned size() const
+	{
+		return count;
+	}
+
+	bool empty() const
+	{
+		return count == 0;
+	}
+private:
+	static bool lowerWeight(const Ray &a, const Ray &b)
+	{
+		return a.weight < b.weight;
+	}
+
+	Ray rays[Count];
+	unsigned count = 0;
+};
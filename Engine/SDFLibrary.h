@@ -0,0 +1,29 @@
+#pragma once
+
+#include "HLSL.h"
+#include "CPUScene.h"
+
+// the shader libraries, compiled as C++
+// they live in an anonymous namespace, since the .hlsl files define
+// non-inline functions and every translation unit gets its own copy
+namespace hlsl
+{
+	namespace
+	{
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable: 4244 4305) // the shaders freely mix double literals with floats
+#endif
+
+#include "shader/math_constants.hlsl"
+#include "shader/noise.hlsl"
+#include "shader/sdf_primitives.hlsl"
+#include "shader/sdf_ops.hlsl"
+#include "shader/sdf_materials.hlsl"
+#include "shader/sdf_common.hlsl"
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+	}
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include "Dual.h"
+#include "SDFLibrary.h"
+
+// the shader library functions the cpu scenes use in map_gradient, ported to duals
+// each one follows its hlsl version, so the value is the same and the gradient is exact.
+// a change to a function in the .hlsl files has to be made here as well, TestDual compares them.
+// inline, since most translation units only use some of them
+namespace hlsl
+{
+	namespace
+	{
+		// sdf_primitives.hlsl
+		inline dual sdSphere(const dual3 &pos, float radius)
+		{
+			return length(pos) - radius;
+		}
+
+		inline dual sdSphereFast(const dual3 &pos, float4 dir, float r)
+		{
+			if (any(dir.w))
+			{
+				float3 ray_dir = dir.xyz;
+				dual b = -dot(pos, ray_dir);
+				dual c = dot(pos, pos) - r * r;
+
+				dual discriminant = b * b - c;
+				if (discriminant.v < 0.f) // no hit
+				{
+					return 1e10f;
+				}
+				else // we got a hit
+				{
+					dual root = sqrt(discriminant);
+					dual t1 = b - root; // smaller one
+					dual t2 = b + root; // bigger one
+					if (t1.v < -dist_eps)
+					{
+						return t2.v > 0.f ? t2 : dual(1e10f);
+					}
+					else
+					{
+						return t1;
+					}
+				}
+			}
+			else
+			{
+				return sdSphere(pos, r);
+			}
+		}
+
+		inline dual sdBox(const dual3 &pos, float3 size)
+		{
+			dual3 q = abs(pos) - size;
+			return length(max(q, 0.f)) + min(max(q.x, max(q.y, q.z)), 0.f);
+		}
+
+		inline dual sdPlane(const dual3 &pos, float3 plane_norm)
+		{
+			return dot(pos, plane_norm);
+		}
+
+		inline dual sdPlaneFast(const dual3 &pos, float4 dir, float3 plane_norm)
+		{
+			dual plane_dist = dot(pos, plane_norm);
+			if (any(dir.w))
+			{
+				float3 ray_dir = dir.xyz;
+				return plane_dist / (saturate(dot(ray_dir, -plane_norm)) + 1e-20f);
+			}
+			else
+			{
+				return plane_dist;
+			}
+		}
+
+		// sdf_ops.hlsl
+		// the cell is piecewise constant, only the offset in it depends on pos
+		inline dual2 opRepLim(const dual2 &pos, float2 count, float2 size)
+		{
+			float2 rounded = size * (round(pos.value() / size + count / 2) - count / 2);
+			float2 limit = count * size * 0.5f;
+			return pos - dual2(clamp(rounded, -limit, limit));
+		}
+
+		inline float opRepAngle(INOUT(dual2) pos, float count)
+		{
+			dual angle = atan2(pos.y, pos.x);
+
+			dual reduced_angle = angle * count / tau + 0.5f;
+			float index = floor(reduced_angle);
+			reduced_angle -= index;
+			angle = (reduced_angle - 0.5f) * tau / count;
+
+			pos = dual2(cos(angle), sin(angle)) * length(pos);
+			return index;
+		}
+
+		inline dual2 opRotate(const dual2 &pos, float angle)
+		{
+			float s = sin(angle);
+			float c = cos(angle);
+			return dual2(pos.x * c - pos.y * s, pos.x * s + pos.y * c);
+		}
+
+		inline dual opShell(const dual &distance, float inner, float outer)
+		{
+			float avg = (outer + inner) * 0.5f;
+			float diff = (outer - inner) * 0.5f;
+			return abs(distance - avg) - diff;
+		}
+
+		inline dual smin(const dual &a, const dual &b, float k)
+		{
+			dual h = saturate(0.5f + 0.5f * (b - a) / k);
+			return lerp(b, a, h) - k * h * (1.f - h);
+		}
+
+		inline dual smax1(const dual &a, const dual &b, float k)
+		{
+			dual h = saturate(0.5f - 0.5f * (b + a) / k);
+			return lerp(b, -a, h) + k * h * (1.f - h);
+		}
+
+		inline dual smax2(const dual &a, const dual &b, float k)
+		{
+			dual h = saturate(0.5f - 0.5f * (b - a) / k);
+			return lerp(b, a, h) + k * h * (1.f - h);
+		}
+
+		// noise.hlsl
+		// the lattice and its gradients are piecewise constant, only the offsets to the corners depend on v
+		inline dual snoise(const dual3 &v)
+		{
+			const float2 C = float2(
+				0.166666666666666667f, // 1/6
+				0.333333333333333333f  // 1/3
+				);
+			const float4 D = float4(0.0f, 0.5f, 1.0f, 2.0f);
+
+			// First corner
+			float3 pos = v.value();
+			float3 i = floor(pos + dot(pos, C.yyy));
+			float3 x0_value = pos - i + dot(i, C.xxx);
+			dual3 x0 = v - i + float3(dot(i, C.xxx));
+
+			// Other corners
+			float3 g = step(x0_value.yzx, x0_value.xyz);
+			float3 l = 1 - g;
+			float3 i1 = min(g.xyz, l.zxy);
+			float3 i2 = max(g.xyz, l.zxy);
+
+			dual3 x1 = x0 - i1 + float3(C.xxx);
+			dual3 x2 = x0 - i2 + float3(C.yyy); // 2.0*C.x = 1/3 = C.y
+			dual3 x3 = x0 - float3(D.yyy);      // -1.0+3.0*C.x = -0.5 = -D.y
+
+			// Permutations
+			i = mod289(i);
+			float4 p = permute(
+				permute(
+					permute(
+						i.z + float4(0.0f, i1.z, i2.z, 1.0f)
+					) + i.y + float4(0.0f, i1.y, i2.y, 1.0f)
+				) + i.x + float4(0.0f, i1.x, i2.x, 1.0f)
+			);
+
+			// Gradients: 7x7 points over a square, mapped onto an octahedron.
+			float n_ = 0.142857142857f; // 1/7
+			float3 ns = n_ * D.wyz - D.xzx;
+
+			float4 j = p - 49.0f * floor(p * ns.z * ns.z); // mod(p,7*7)
+
+			float4 x_ = floor(j * ns.z);
+			float4 y_ = floor(j - 7.0f * x_); // mod(j,N)
+
+			float4 x = x_ * ns.x + ns.yyyy;
+			float4 y = y_ * ns.x + ns.yyyy;
+			float4 h = 1.0f - abs(x) - abs(y);
+
+			float4 b0 = float4(x.xy, y.xy);
+			float4 b1 = float4(x.zw, y.zw);
+
+			float4 s0 = floor(b0) * 2.0f + 1.0f;
+			float4 s1 = floor(b1) * 2.0f + 1.0f;
+			float4 sh = -step(h, 0.0f);
+
+			float4 a0 = b0.xzyw + s0.xzyw * sh.xxyy;
+			float4 a1 = b1.xzyw + s1.xzyw * sh.zzww;
+
+			float3 p0 = float3(a0.xy, h.x);
+			float3 p1 = float3(a0.zw, h.y);
+			float3 p2 = float3(a1.xy, h.z);
+			float3 p3 = float3(a1.zw, h.w);
+
+			//Normalise gradients
+			p0 *= rsqrt(dot(p0, p0));
+			p1 *= rsqrt(dot(p1, p1));
+			p2 *= rsqrt(dot(p2, p2));
+			p3 *= rsqrt(dot(p3, p3));
+
+			// Mix final noise value
+			dual m0 = max(0.6f - dot(x0, x0), 0.0f);
+			dual m1 = max(0.6f - dot(x1, x1), 0.0f);
+			dual m2 = max(0.6f - dot(x2, x2), 0.0f);
+			dual m3 = max(0.6f - dot(x3, x3), 0.0f);
+			m0 = m0 * m0;
+			m1 = m1 * m1;
+			m2 = m2 * m2;
+			m3 = m3 * m3;
+			return 42.0f * (m0 * m0 * dot(x0, p0) + m1 * m1 * dot(x1, p1) + m2 * m2 * dot(x2, p2) + m3 * m3 * dot(x3, p3));
+		}
+
+		// sdf_common.hlsl, the geometry step of it
+		inline void map_groundplane(GeometryInput geometry, const dual3 &pos, dual &output_scene_distance)
+		{
+			dual floor1 = sdPlaneFast(pos, geometry.dir, float3(0.f, 1.f, 0.f));
+			OBJECT(floor1);
+		}
+	}
+}
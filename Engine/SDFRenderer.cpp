@@ -6,6 +6,8 @@
 #include "ShaderUtil.h"
 #include "FullscreenQuad.h"
 
+#include <cstring>
+
 bool SDFRenderer::init(Graphics &graphics)
 {
 	this->graphics = &graphics;
@@ -24,31 +26,50 @@ bool SDFRenderer::init(Graphics &graphics)
 	return true;
 }
 
-bool SDFRenderer::initShader(ShaderIncluder &includer)
+void SDFRenderer::addShaders(ShaderBuild &build)
 {
-	// remove old objects. since d3d keeps a reference internally
-	// the object is not freed yet. setting it to zero ensures
-	// we dont overwrite it later and loose the pointer.
-	// once we set the new objects in the pipeline, the old ones will get released anyway
-	p_shader = nullptr;
-
+	next_pipeline = std::make_unique<Pipeline>();
+	auto &var_manager = next_pipeline->var_manager;
 	var_manager.setSlot(1);
-	var_manager.getVariables().clear();
-	includer.setShaderVariableManager(&var_manager);
-	Comptr<ID3DBlob> p_compiled = compileShader(includer, "pshader_sdf.hlsl", "ps_5_0", "ps_main");
-	if (!p_compiled)
-		return false;
+	var_manager.setBaked(baked);
+	var_manager.setInitialValues(initial_values);
 
+	auto &includer = build.getIncluder();
+	includer.setShaderVariableManager(&var_manager);
+	// only compile in the materials the scene uses
+	includer.setFeaturePrefix("MATERIAL_");
+	includer.setDefines(debug_plane ? std::set<std::string>{ "FEATURE_DEBUG_PLANE" } : std::set<std::string>{});
+	p_job = build.add("pshader_sdf.hlsl", "ps_5_0", "ps_main");
+	includer.setFeaturePrefix({});
+	includer.setDefines({});
 	includer.setShaderVariableManager(nullptr);
+}
+
+bool SDFRenderer::finishBuild(ShaderBuild &build)
+{
+	auto next = std::move(next_pipeline);
+	Comptr<ID3DBlob> p_compiled = build.finish(p_job);
+	if (!next || !p_compiled)
+	{
+		return false;
+	}
 
 	auto device = graphics->GetDevice();
-	if (var_manager.hasVariables() && !var_manager.createConstantBuffer(device))
+	auto &var_manager = next->var_manager;
+	if (var_manager.hasVariables() && !var_manager.isBaked() && !var_manager.createConstantBuffer(device))
+	{
+		build.getIncluder().reportMessage("Could not create the variable buffer", true);
 		return false;
+	}
 
-	HRESULT hr = device->CreatePixelShader(p_compiled->GetBufferPointer(), p_compiled->GetBufferSize(), 0, &p_shader);
+	HRESULT hr = device->CreatePixelShader(p_compiled->GetBufferPointer(), p_compiled->GetBufferSize(), 0, &next->p_shader);
 	if (FAILED(hr))
+	{
+		build.getIncluder().reportMessage("Could not create the pixel shader", true);
 		return false;
+	}
 
+	pipeline = std::move(next);
 	return true;
 }
 
@@ -59,7 +80,38 @@ void SDFRenderer::setParameters(float stime)
 
 VariableMap &SDFRenderer::getVariableMap()
 {
-	return var_manager.getVariables();
+	return pipeline->var_manager.getVariables();
+}
+
+VariableBuffer *SDFRenderer::getVariableBuffer()
+{
+	auto &var_manager = pipeline->var_manager;
+	return var_manager.getBuffer() ? &var_manager.getValues() : nullptr;
+}
+
+void SDFRenderer::setBaked(bool baked)
+{
+	this->baked = baked;
+}
+
+bool SDFRenderer::isBaked() const
+{
+	return baked;
+}
+
+void SDFRenderer::setInitialValues(VariableValues values)
+{
+	initial_values.swap(values);
+}
+
+void SDFRenderer::setDebugPlane(bool debug_plane)
+{
+	this->debug_plane = debug_plane;
+}
+
+bool SDFRenderer::hasDebugPlane() const
+{
+	return debug_plane;
 }
 
 bool SDFRenderer::render(FullscreenQuad &quad, GPUProfiler &profiler, Camera &camera)
@@ -67,12 +119,13 @@ bool SDFRenderer::render(FullscreenQuad &quad, GPUProfiler &profiler, Camera &ca
 	auto ctx = graphics->GetContext();
 
 	// only render something if we have a valid shader
-	if (!(quad.isValid() && p_shader))
+	if (!(quad.isValid() && pipeline->p_shader))
 	{
 		return false;
 	}
 
-	if (var_manager.hasVariables())
+	auto &var_manager = pipeline->var_manager;
+	if (var_manager.hasVariables() && !var_manager.isBaked())
 	{
 		var_manager.updateBuffer(ctx);
 	}
@@ -84,18 +137,20 @@ bool SDFRenderer::render(FullscreenQuad &quad, GPUProfiler &profiler, Camera &ca
 
 	D3D11_MAPPED_SUBRESOURCE sub;
 	ctx->Map(camera_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &sub);
-	camera_cbuffer *cam_buf = static_cast<camera_cbuffer *>(sub.pData);
-	cam_buf->eye = camera.GetEye();
-	cam_buf->front_vec = camera.GetDirection();
-	cam_buf->right_vec = (camera.GetFrustrumEdge(0) - camera.GetFrustrumEdge(3)) * 0.5f;
-	cam_buf->top_vec = (camera.GetFrustrumEdge(0) - camera.GetFrustrumEdge(1)) * 0.5f;
-
-	cam_buf->stime = stime;
+	// filled in here, the mapped memory is only written to, in one go
+	camera_cbuffer cam_buf = {};
+	Camera::RayBasis ray_basis = camera.GetRayBasis();
+	cam_buf.eye = ray_basis.eye;
+	cam_buf.front_vec = ray_basis.front;
+	cam_buf.right_vec = ray_basis.right;
+	cam_buf.top_vec = ray_basis.top;
+	cam_buf.stime = stime;
+	std::memcpy(sub.pData, &cam_buf, sizeof(cam_buf));
 
 	ctx->Unmap(camera_buffer, 0);
 	ctx->PSSetConstantBuffers(0, 2, constant_buffers);
 
-	ctx->PSSetShader(p_shader, nullptr, 0);
+	ctx->PSSetShader(pipeline->p_shader, nullptr, 0);
 
 	profiler.profile("setup");
 
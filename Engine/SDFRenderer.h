@@ -4,13 +4,18 @@
 #include "Math3D.h"
 #include "ShaderUtil.h"
 #include "ShaderVariable.h"
+#include "VariablePreset.h"
 
 #include <d3d11.h>
+#include <memory>
+#include <string>
+#include <type_traits>
 
 class Graphics;
 class Camera;
 class GPUProfiler;
 class ShaderIncluder;
+class ShaderBuild;
 class FullscreenQuad;
 class ShaderVariableManager;
 
@@ -18,27 +23,56 @@ class SDFRenderer
 {
 public:
 	bool init(Graphics &graphics);
-	bool initShader(ShaderIncluder &includer);
+	// adds the scene shader to the build, with the settings as they are now
+	// the old shader keeps rendering until finishBuild
+	void addShaders(ShaderBuild &build);
+	// swaps in the new shader and variables if the build worked, else the old ones stay
+	bool finishBuild(ShaderBuild &build);
 
 	void setParameters(float stime);
 	VariableMap &getVariableMap();
+	// where the sliders write to, nullptr if the values are baked
+	VariableBuffer *getVariableBuffer();
+
+	// takes effect with the next build
+	void setBaked(bool baked);
+	bool isBaked() const;
+	void setInitialValues(VariableValues values);
+	// the plane showing the distance field, off gives a leaner shader
+	void setDebugPlane(bool debug_plane);
+	bool hasDebugPlane() const;
 
 	// true if it did render something, false otherwise
 	bool render(FullscreenQuad &quad, GPUProfiler &profiler, Camera &camera);
 private:
+	// everything a build makes, swapped in as a whole
+	struct Pipeline
+	{
+		Comptr<ID3D11PixelShader> p_shader;
+		ShaderVariableManager var_manager;
+	};
+
 	struct camera_cbuffer
 	{
 		alignas(16) Math3D::Vector3 eye;
 		alignas(16) Math3D::Vector3 front_vec, right_vec, top_vec;
 		alignas(16) float stime;
 	};
+	static_assert(std::is_trivially_copyable_v<camera_cbuffer>);
 
 	Graphics *graphics = nullptr;
 
 	Comptr<ID3D11Buffer> camera_buffer;
-	Comptr<ID3D11PixelShader> p_shader;
 
-	ShaderVariableManager var_manager;
+	std::unique_ptr<Pipeline> pipeline = std::make_unique<Pipeline>();
+	// the one being built
+	std::unique_ptr<Pipeline> next_pipeline;
+	unsigned p_job = 0;
+
+	// the settings for the next build
+	VariableValues initial_values;
+	bool baked = false;
+	bool debug_plane = false;
 
 	float stime = 0.f;
 };
@@ -2,7 +2,6 @@
 #include "WinUtil.h"
 
 #include <filesystem>
-#include <chrono>
 
 const char *SceneManager::classname = "Scenemanager";
 
@@ -29,7 +28,7 @@ bool SceneManager::Open()
 	}
 
 	unsigned width = 430;
-	unsigned height = 350;
+	unsigned height = 375;
 	DWORD windowstyle = WS_CAPTION | WS_SYSMENU | WS_MINIMIZEBOX;
 
 	RECT r;
@@ -48,6 +47,7 @@ bool SceneManager::Open()
 	hSceneRefresh = CreateWindow("BUTTON", "Refresh", child_style, 320, 10, 100, 25, hWnd, 0, hInstance, 0);
 	hSceneLoad = CreateWindow("BUTTON", "Load Scene", child_style, 320, 45, 100, 25, hWnd, 0, hInstance, 0);
 	hReloadOnSave = CreateWindow("BUTTON", "Reload on save", child_style | BS_AUTOCHECKBOX, 10, 320, 200, 20, hWnd, 0, hInstance, 0);
+	hStatus = CreateWindow("STATIC", status.c_str(), child_style | SS_LEFTNOWORDWRAP | SS_ENDELLIPSIS, 10, 347, 410, 20, hWnd, 0, hInstance, 0);
 
 	updateSceneList();
 
@@ -104,35 +104,32 @@ LRESULT CALLBACK SceneManager::WndProc(HWND hWnd, UINT Msg, WPARAM wParam, LPARA
 				reload_on_save = SendMessage(hReloadOnSave, BM_GETCHECK, 0, 0) == BST_CHECKED;
 				if (reload_on_save)
 				{
-					SetTimer(hWnd, 0, 500, 0);
+					updateWatchedFiles();
+					file_watcher.start([hWnd](const std::vector<std::filesystem::path> &changed)
+					{
+						for (auto &file : changed)
+						{
+							OutputDebugString(("changed: " + file.string() + "\n").c_str());
+						}
+						PostMessage(hWnd, WM_FILES_CHANGED, 0, 0);
+					});
 				}
 				else
 				{
-					KillTimer(hWnd, 0);
-					last_time = std::chrono::file_clock::now();
+					file_watcher.stop();
 				}
 			}
 		}
 		break;
-	case WM_TIMER:
-		if (reload_on_save)
+	case WM_FILES_CHANGED:
+		if (reload_on_save && client)
 		{
-			LRESULT index = SendMessage(hSceneSelect, LB_GETCURSEL, 0, 0);
-			if (index != LB_ERR)
-			{
-				auto filename = getStringFromListbox(hSceneSelect, static_cast<int>(index));
-				auto full_filename = getFullFilename(filename);
-
-				auto write_time = std::filesystem::last_write_time(shader_folder / full_filename);
-				if (write_time > last_time)
-				{
-					last_time = write_time;
-					loadScene(full_filename);
-				}
-			}
+			// the new version may include other files, the client tells us after the build
+			client->reloadScene();
 		}
 		break;
 	case WM_DESTROY:
+		file_watcher.stop();
 		this->hWnd = 0;
 		break;
 	}
@@ -166,6 +163,14 @@ void SceneManager::loadScene(const std::filesystem::path &filename)
 	//MessageBox(0, filename.string().c_str(), "now loading:", MB_ICONINFORMATION);
 }
 
+void SceneManager::updateWatchedFiles()
+{
+	if (reload_on_save && client)
+	{
+		file_watcher.setFiles(client->getSceneFiles());
+	}
+}
+
 std::filesystem::path SceneManager::getFullFilename(const std::filesystem::path &filename)
 {
 	return scene_folder / std::filesystem::path(filename).concat(".hlsl");
@@ -175,3 +180,12 @@ void SceneManager::setClient(SceneManagerClient *client)
 {
 	this->client = client;
 }
+
+void SceneManager::setStatus(const std::string &status)
+{
+	this->status = status;
+	if (hWnd)
+	{
+		SetWindowText(hStatus, status.c_str());
+	}
+}
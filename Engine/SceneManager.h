@@ -1,7 +1,10 @@
 #pragma once
 
+#include "FileWatcher.h"
+
 #include <Windows.h>
 #include <string>
+#include <vector>
 #include <filesystem>
 
 class SceneManagerClient
@@ -9,6 +12,10 @@ class SceneManagerClient
 public:
 	virtual ~SceneManagerClient() = default;
 	virtual void loadScene(const std::filesystem::path &filename) = 0;
+	// builds the current scene again
+	virtual void reloadScene() = 0;
+	// every file the current shaders were built from, including all includes
+	virtual std::vector<std::filesystem::path> getSceneFiles() = 0;
 };
 
 class SceneManager
@@ -21,6 +28,11 @@ public:
 	void setSceneFolder(const std::string &folder);
 
 	void setClient(SceneManagerClient *client);
+
+	// shows how the last build went, below the scene list
+	void setStatus(const std::string &status);
+	// asks the client for the files again, call it when a build finished
+	void updateWatchedFiles();
 private:
 	LRESULT CALLBACK WndProc(HWND hWnd, UINT Msg, WPARAM wParam, LPARAM lParam);
 	static LRESULT CALLBACK sWndProc(HWND hWnd, UINT Msg, WPARAM wParam, LPARAM lParam);
@@ -34,13 +46,17 @@ private:
 
 	HWND hSceneSelect, hSceneRefresh, hSceneLoad;
 	HWND hReloadOnSave;
+	HWND hStatus;
 
+	std::string status;
 	bool reload_on_save = false;
-	std::filesystem::file_time_type last_time;
+	FileWatcher file_watcher;
 
 	std::filesystem::path shader_folder, scene_folder;
 
 	SceneManagerClient *client = nullptr;
 
 	static const char *classname;
+	// posted by the file watcher thread
+	static const UINT WM_FILES_CHANGED = WM_APP + 1;
 };
@@ -0,0 +1,202 @@
+#include "ShaderBatch.h"
+#include "IncludeCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+unsigned ShaderBatch::add(ShaderCompilerBackend &backend, const std::string &code, const ShaderCompileArgs &args, uint64_t source_key)
+{
+	Job job;
+	job.args = args;
+
+	// the same sources give the same text for the same file and defines
+	uint64_t key = 0;
+	if (source_key)
+	{
+		key = IncludeCache::combine(source_key, IncludeCache::hash(args.filename));
+		for (auto &define : args.defines)
+		{
+			key = IncludeCache::combine(key, IncludeCache::hash(define));
+		}
+	}
+
+	if (auto iter = shared.find(key); key && iter != shared.end())
+	{
+		job.preprocessed = iter->second;
+		job.timing.shared = true;
+	}
+	else
+	{
+		static const Profiler::ScopeId preprocess_scope = Profiler::intern("preprocess");
+		Profiler::Scope profile(profiler, preprocess_scope);
+		auto start_time = std::chrono::steady_clock::now();
+		auto preprocessed = std::make_shared<Preprocessed>();
+		preprocessed->succeeded = backend.preprocess(code, args, preprocessed->code, preprocessed->messages);
+		job.timing.preprocess = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+		job.preprocessed = preprocessed;
+		if (key)
+		{
+			shared[key] = preprocessed;
+		}
+	}
+
+	// nothing to compile if it failed already
+	job.result.messages = job.preprocessed->messages;
+	if (!job.preprocessed->succeeded)
+	{
+		job.preprocessed = nullptr;
+	}
+	else
+	{
+		job.timing.preprocessed_bytes = job.preprocessed->code.size();
+	}
+
+	jobs.push_back(std::move(job));
+	return static_cast<unsigned>(jobs.size() - 1);
+}
+
+unsigned ShaderBatch::addDone(const ShaderCompileArgs &args, ShaderCompileResult result, bool succeeded)
+{
+	Job job;
+	job.args = args;
+	job.result = std::move(result);
+	job.timing.cached = succeeded;
+	job.succeeded = succeeded;
+	jobs.push_back(std::move(job));
+	return static_cast<unsigned>(jobs.size() - 1);
+}
+
+void ShaderBatch::run(ShaderCompilerBackend &backend, ShaderCache *cache, unsigned thread_count)
+{
+	auto run_start = std::chrono::steady_clock::now();
+	static const Profiler::ScopeId run_scope = Profiler::intern("compile batch");
+	static const Profiler::ScopeId compile_scope = Profiler::intern("compile");
+	Profiler::Scope run_profile(profiler, run_scope);
+
+	std::vector<unsigned> pending;
+	for (unsigned i = 0; i < jobs.size(); ++i)
+	{
+		if (jobs[i].preprocessed)
+		{
+			pending.push_back(i);
+		}
+	}
+	// the longest compile should start first, the size is a good guess for it
+	std::stable_sort(pending.begin(), pending.end(), [&](unsigned a, unsigned b)
+	{
+		return jobs[a].preprocessed->code.size() > jobs[b].preprocessed->code.size();
+	});
+
+	thread_count = thread_count ? thread_count : std::max(std::thread::hardware_concurrency(), 1u);
+	thread_count = std::max(std::min(thread_count, static_cast<unsigned>(pending.size())), 1u);
+
+	std::atomic<size_t> next = 0;
+	auto worker = [&](unsigned thread_index)
+	{
+		if (profiler && thread_index)
+		{
+			profiler->setThreadName("compile " + std::to_string(thread_index));
+		}
+		for (size_t i; (i = next++) < pending.size();)
+		{
+			Job &job = jobs[pending[i]];
+			Profiler::Scope profile(profiler, compile_scope);
+			auto start_time = std::chrono::steady_clock::now();
+
+			ShaderCompileResult result;
+			job.succeeded = compilePreprocessed(backend, cache, job.preprocessed->code, job.args, result);
+			job.result.compiled = std::move(result.compiled);
+			job.result.messages += result.messages;
+			job.result.from_cache = result.from_cache;
+
+			job.timing.compile = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+			job.timing.thread = thread_index;
+			job.timing.cached = result.from_cache;
+			// the text is not needed anymore, and the job is not run again
+			job.preprocessed = nullptr;
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned i = 1; i < thread_count; ++i)
+	{
+		threads.emplace_back(worker, i);
+	}
+	worker(0);
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+
+	run_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start).count();
+}
+
+void ShaderBatch::setProfiler(Profiler *profiler)
+{
+	this->profiler = profiler;
+}
+
+size_t ShaderBatch::size() const
+{
+	return jobs.size();
+}
+
+bool ShaderBatch::succeeded(unsigned job) const
+{
+	return jobs[job].succeeded;
+}
+
+const ShaderCompileArgs &ShaderBatch::getArgs(unsigned job) const
+{
+	return jobs[job].args;
+}
+
+const ShaderCompileResult &ShaderBatch::getResult(unsigned job) const
+{
+	return jobs[job].result;
+}
+
+const ShaderBatch::Timing &ShaderBatch::getTiming(unsigned job) const
+{
+	return jobs[job].timing;
+}
+
+double ShaderBatch::getRunTime() const
+{
+	return run_time;
+}
+
+std::string ShaderBatch::formatTimings() const
+{
+	std::ostringstream out;
+	out.setf(std::ios::fixed);
+	out.precision(1);
+	for (auto &job : jobs)
+	{
+		out << job.args.filename << " " << job.args.entry << ": ";
+		if (job.timing.shared)
+		{
+			out << "shared preprocess";
+		}
+		else
+		{
+			out << "preprocess " << job.timing.preprocess * 1000.0 << " ms";
+		}
+		out << ", compile " << job.timing.compile * 1000.0 << " ms on thread " << job.timing.thread;
+		if (job.timing.cached)
+		{
+			out << " (cached)";
+		}
+		if (!job.succeeded)
+		{
+			out << " (failed)";
+		}
+		out << "\n";
+	}
+	out << "compiles took " << run_time * 1000.0 << " ms in total\n";
+	return out.str();
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Profiler.h"
+#include "ShaderCompiler.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// compiles a set of shaders on a thread pool
+// preprocessing goes through the includes, which are not thread safe, so add does it right away
+// on the calling thread. jobs with the same sources and defines share it, e.g. two entry points of one file
+class ShaderBatch
+{
+public:
+	struct Timing
+	{
+		double preprocess = 0.0; // in seconds, 0 if shared
+		double compile = 0.0; // including the cache lookup
+		size_t preprocessed_bytes = 0; // 0 if it failed or was done already
+		unsigned thread = 0; // which worker compiled it
+		bool shared = false; // preprocessed by an earlier job
+		bool cached = false; // did not need the compiler
+	};
+
+	// source_key stands for the sources and settings the code is preprocessed with, 0 = never share
+	unsigned add(ShaderCompilerBackend &backend, const std::string &code, const ShaderCompileArgs &args, uint64_t source_key);
+	// a job which is done before the compile, e.g. found in memory or failed to load
+	unsigned addDone(const ShaderCompileArgs &args, ShaderCompileResult result, bool succeeded);
+
+	// compiles the jobs on thread_count threads (0 = one per core), the biggest first
+	// the compile of the backend has to be thread safe
+	void run(ShaderCompilerBackend &backend, ShaderCache *cache, unsigned thread_count = 0);
+	// scopes for the preprocessing in add, and the compiles in run. nullptr to stop
+	void setProfiler(Profiler *profiler);
+
+	size_t size() const;
+	bool succeeded(unsigned job) const;
+	const ShaderCompileArgs &getArgs(unsigned job) const;
+	const ShaderCompileResult &getResult(unsigned job) const;
+	const Timing &getTiming(unsigned job) const;
+	// the wall time of the last run, in seconds
+	double getRunTime() const;
+	// one line per job, for the debug output
+	std::string formatTimings() const;
+private:
+	struct Preprocessed
+	{
+		std::string code;
+		std::string messages;
+		bool succeeded = false;
+	};
+
+	struct Job
+	{
+		ShaderCompileArgs args;
+		std::shared_ptr<const Preprocessed> preprocessed; // nullptr if done already
+		ShaderCompileResult result;
+		Timing timing;
+		bool succeeded = false;
+	};
+
+	std::vector<Job> jobs;
+	std::map<uint64_t, std::shared_ptr<const Preprocessed>> shared;
+	double run_time = 0.0;
+	Profiler *profiler = nullptr;
+};
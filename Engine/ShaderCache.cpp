@@ -0,0 +1,380 @@
+#include "ShaderCache.h"
+#include "IncludeCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	constexpr uint32_t index_magic = 0x43464453; // "SDFC"
+	constexpr uint32_t index_version = 1;
+	constexpr uint32_t slot_count = 1024;
+}
+
+struct ShaderCache::Header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t slot_count;
+	uint32_t padding;
+	uint64_t clock; // counts up with every use, for the lru order
+	uint64_t total_bytes;
+};
+
+struct ShaderCache::Slot
+{
+	uint64_t key;
+	uint64_t last_use;
+	uint64_t hash; // of the blob file, to catch damaged files
+	uint64_t size; // 0 = free
+};
+
+// a file mapped read/write into memory
+class ShaderCache::MappedFile
+{
+public:
+	~MappedFile();
+
+	// the file gets the given size. resized tells if it had another size before
+	bool open(const std::filesystem::path &path, size_t size, bool &resized);
+	void close();
+	void *data() const;
+private:
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#else
+	int fd = -1;
+#endif
+	void *view = nullptr;
+	size_t size = 0;
+};
+
+ShaderCache::MappedFile::~MappedFile()
+{
+	close();
+}
+
+void *ShaderCache::MappedFile::data() const
+{
+	return view;
+}
+
+#ifdef _WIN32
+bool ShaderCache::MappedFile::open(const std::filesystem::path &path, size_t size, bool &resized)
+{
+	file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER old_size = {};
+	GetFileSizeEx(file, &old_size);
+	resized = static_cast<size_t>(old_size.QuadPart) != size;
+
+	// the mapping grows the file, but does not shrink it
+	if (resized)
+	{
+		LARGE_INTEGER new_size = {};
+		new_size.QuadPart = static_cast<LONGLONG>(size);
+		if (!SetFilePointerEx(file, new_size, nullptr, FILE_BEGIN) || !SetEndOfFile(file))
+		{
+			close();
+			return false;
+		}
+	}
+
+	mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(size), nullptr);
+	if (!mapping)
+	{
+		close();
+		return false;
+	}
+	view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (!view)
+	{
+		close();
+		return false;
+	}
+	this->size = size;
+	return true;
+}
+
+void ShaderCache::MappedFile::close()
+{
+	if (view)
+	{
+		FlushViewOfFile(view, size);
+		UnmapViewOfFile(view);
+		view = nullptr;
+	}
+	if (mapping)
+	{
+		CloseHandle(mapping);
+		mapping = nullptr;
+	}
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file);
+		file = INVALID_HANDLE_VALUE;
+	}
+}
+#else
+bool ShaderCache::MappedFile::open(const std::filesystem::path &path, size_t size, bool &resized)
+{
+	fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0)
+	{
+		close();
+		return false;
+	}
+	resized = static_cast<size_t>(info.st_size) != size;
+	if (resized && ftruncate(fd, static_cast<off_t>(size)) != 0)
+	{
+		close();
+		return false;
+	}
+
+	view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (view == MAP_FAILED)
+	{
+		view = nullptr;
+		close();
+		return false;
+	}
+	this->size = size;
+	return true;
+}
+
+void ShaderCache::MappedFile::close()
+{
+	if (view)
+	{
+		munmap(view, size);
+		view = nullptr;
+	}
+	if (fd >= 0)
+	{
+		::close(fd);
+		fd = -1;
+	}
+}
+#endif
+
+ShaderCache::ShaderCache()
+{
+}
+
+ShaderCache::~ShaderCache()
+{
+	close();
+}
+
+bool ShaderCache::open(const std::filesystem::path &folder, uint64_t max_bytes)
+{
+	close();
+
+	std::error_code ec;
+	std::filesystem::create_directories(folder, ec);
+
+	bool resized = false;
+	auto file = std::make_unique<MappedFile>();
+	if (!file->open(folder / "index.bin", sizeof(Header) + slot_count * sizeof(Slot), resized))
+	{
+		return false;
+	}
+
+	// a new or foreign index. the blobs it had are unknown now
+	auto header = static_cast<Header *>(file->data());
+	if (resized || header->magic != index_magic || header->version != index_version || header->slot_count != slot_count)
+	{
+		std::memset(file->data(), 0, sizeof(Header) + slot_count * sizeof(Slot));
+		header->magic = index_magic;
+		header->version = index_version;
+		header->slot_count = slot_count;
+
+		for (auto &item : std::filesystem::directory_iterator(folder, ec))
+		{
+			if (item.path().extension() == ".blob")
+			{
+				std::filesystem::remove(item.path(), ec);
+			}
+		}
+	}
+
+	index = std::move(file);
+	this->folder = folder;
+	this->max_bytes = max_bytes;
+	return true;
+}
+
+void ShaderCache::close()
+{
+	index = nullptr;
+}
+
+bool ShaderCache::isOpen() const
+{
+	return index != nullptr;
+}
+
+uint64_t ShaderCache::makeKey(std::string_view preprocessed, std::string_view profile, std::string_view entry, unsigned flags)
+{
+	uint64_t key = IncludeCache::hash(preprocessed);
+	key = IncludeCache::combine(key, IncludeCache::hash(profile));
+	key = IncludeCache::combine(key, IncludeCache::hash(entry));
+	return IncludeCache::combine(key, flags);
+}
+
+bool ShaderCache::find(uint64_t key, std::string &data)
+{
+	std::lock_guard lock(mutex);
+	Slot *slot = index ? findSlot(key) : nullptr;
+	if (!slot)
+	{
+		++stats.misses;
+		return false;
+	}
+
+	std::ifstream file(getBlobFilename(key), std::ios::binary);
+	data.assign(static_cast<size_t>(slot->size), '\0');
+	file.read(data.data(), data.size());
+	if (!file || IncludeCache::hash(data) != slot->hash)
+	{
+		erase(*slot);
+		++stats.misses;
+		return false;
+	}
+
+	slot->last_use = ++static_cast<Header *>(index->data())->clock;
+	++stats.hits;
+	return true;
+}
+
+bool ShaderCache::store(uint64_t key, std::string_view data)
+{
+	std::lock_guard lock(mutex);
+	if (!index || data.empty() || data.size() > max_bytes)
+	{
+		return false;
+	}
+
+	if (Slot *old = findSlot(key))
+	{
+		erase(*old);
+	}
+	Slot *slot = allocate(data.size());
+	if (!slot)
+	{
+		return false;
+	}
+
+	{
+		std::ofstream file(getBlobFilename(key), std::ios::binary | std::ios::trunc);
+		file.write(data.data(), data.size());
+		if (!file)
+		{
+			return false;
+		}
+	}
+
+	auto header = static_cast<Header *>(index->data());
+	slot->key = key;
+	slot->hash = IncludeCache::hash(data);
+	slot->size = data.size();
+	slot->last_use = ++header->clock;
+	header->total_bytes += data.size();
+	return true;
+}
+
+const ShaderCache::Stats &ShaderCache::getStats() const
+{
+	return stats;
+}
+
+void ShaderCache::resetStats()
+{
+	stats = {};
+}
+
+ShaderCache::Slot *ShaderCache::findSlot(uint64_t key)
+{
+	// a linear search over a few kb, nothing compared to a compile
+	auto slots = reinterpret_cast<Slot *>(static_cast<Header *>(index->data()) + 1);
+	for (uint32_t i = 0; i < slot_count; ++i)
+	{
+		if (slots[i].size && slots[i].key == key)
+		{
+			return &slots[i];
+		}
+	}
+	return nullptr;
+}
+
+ShaderCache::Slot *ShaderCache::allocate(uint64_t size)
+{
+	auto header = static_cast<Header *>(index->data());
+	auto slots = reinterpret_cast<Slot *>(header + 1);
+	for (;;)
+	{
+		Slot *free_slot = nullptr, *oldest = nullptr;
+		for (uint32_t i = 0; i < slot_count; ++i)
+		{
+			if (!slots[i].size)
+			{
+				free_slot = free_slot ? free_slot : &slots[i];
+			}
+			else if (!oldest || slots[i].last_use < oldest->last_use)
+			{
+				oldest = &slots[i];
+			}
+		}
+
+		if (free_slot && header->total_bytes + size <= max_bytes)
+		{
+			return free_slot;
+		}
+		if (!oldest)
+		{
+			return nullptr;
+		}
+		erase(*oldest);
+		++stats.evictions;
+	}
+}
+
+void ShaderCache::erase(Slot &slot)
+{
+	std::error_code ec;
+	std::filesystem::remove(getBlobFilename(slot.key), ec);
+
+	auto header = static_cast<Header *>(index->data());
+	header->total_bytes -= std::min(header->total_bytes, slot.size);
+	slot = {};
+}
+
+std::filesystem::path ShaderCache::getBlobFilename(uint64_t key) const
+{
+	std::ostringstream name;
+	name << std::hex << std::setw(16) << std::setfill('0') << key << ".blob";
+	return folder / name.str();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+// keeps compiled shaders on disk between runs
+// the folder has one file per blob, plus a memory mapped index with the key, size,
+// checksum and last use of each. when it is full, the least recently used blob goes
+// find and store can be called from several threads
+class ShaderCache
+{
+public:
+	struct Stats
+	{
+		unsigned hits = 0;
+		unsigned misses = 0;
+		unsigned evictions = 0;
+	};
+
+	ShaderCache();
+	~ShaderCache();
+
+	// creates the folder and index if needed. without an open cache nothing is stored
+	bool open(const std::filesystem::path &folder, uint64_t max_bytes = 64ull << 20);
+	void close();
+	bool isOpen() const;
+
+	// the preprocessed source has the includes and defines in it already
+	static uint64_t makeKey(std::string_view preprocessed, std::string_view profile, std::string_view entry, unsigned flags);
+
+	// false if the key is not there, or the file is damaged
+	bool find(uint64_t key, std::string &data);
+	bool store(uint64_t key, std::string_view data);
+
+	const Stats &getStats() const;
+	void resetStats();
+private:
+	class MappedFile;
+	struct Header;
+	struct Slot;
+
+	Slot *findSlot(uint64_t key);
+	// makes room for size more bytes and returns a free slot
+	Slot *allocate(uint64_t size);
+	void erase(Slot &slot);
+	std::filesystem::path getBlobFilename(uint64_t key) const;
+
+	std::unique_ptr<MappedFile> index;
+	std::filesystem::path folder;
+	uint64_t max_bytes = 0;
+	Stats stats;
+	std::mutex mutex;
+};
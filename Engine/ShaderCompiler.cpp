@@ -0,0 +1,75 @@
+#include "ShaderCompiler.h"
+#include "ShaderCache.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	// the cache entry is the size of the messages, the messages, then the blob
+	std::string packEntry(const ShaderCompileResult &result)
+	{
+		uint32_t message_size = static_cast<uint32_t>(result.messages.size());
+		std::string data(reinterpret_cast<const char *>(&message_size), sizeof(message_size));
+		data += result.messages;
+		data += result.compiled;
+		return data;
+	}
+
+	bool unpackEntry(const std::string &data, ShaderCompileResult &result)
+	{
+		uint32_t message_size;
+		if (data.size() < sizeof(message_size))
+		{
+			return false;
+		}
+		std::memcpy(&message_size, data.data(), sizeof(message_size));
+		if (data.size() - sizeof(message_size) < message_size)
+		{
+			return false;
+		}
+		result.messages = data.substr(sizeof(message_size), message_size);
+		result.compiled = data.substr(sizeof(message_size) + message_size);
+		return true;
+	}
+}
+
+bool compileShaderCached(ShaderCompilerBackend &backend, ShaderCache *cache, const std::string &code, const ShaderCompileArgs &args, ShaderCompileResult &result)
+{
+	std::string preprocessed, messages;
+	if (!backend.preprocess(code, args, preprocessed, messages))
+	{
+		result = {};
+		result.messages = std::move(messages);
+		return false;
+	}
+
+	bool compiled = compilePreprocessed(backend, cache, preprocessed, args, result);
+	result.messages = messages + result.messages;
+	return compiled;
+}
+
+bool compilePreprocessed(ShaderCompilerBackend &backend, ShaderCache *cache, const std::string &preprocessed, const ShaderCompileArgs &args, ShaderCompileResult &result)
+{
+	result = {};
+
+	uint64_t key = ShaderCache::makeKey(preprocessed, args.profile, args.entry, args.flags);
+	std::string data;
+	if (cache && cache->find(key, data) && unpackEntry(data, result))
+	{
+		result.from_cache = true;
+		return true;
+	}
+
+	bool compiled = backend.compile(preprocessed, args, result.compiled, result.messages);
+	if (!compiled)
+	{
+		return false;
+	}
+
+	if (cache)
+	{
+		cache->store(key, packEntry(result));
+	}
+	return true;
+}
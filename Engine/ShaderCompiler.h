@@ -0,0 +1,42 @@
+#pragma once
+
+#include <set>
+#include <string>
+
+class ShaderCache;
+
+// what the compiler needs besides the code
+struct ShaderCompileArgs
+{
+	std::string filename; // for the messages, and the folder of the includes
+	std::string profile;
+	std::string entry;
+	std::set<std::string> defines; // each one is defined as 1
+	unsigned flags = 0;
+};
+
+// the compiler behind compileShader. d3d on windows, a stub in the tests
+class ShaderCompilerBackend
+{
+public:
+	virtual ~ShaderCompilerBackend() = default;
+
+	// resolves the includes and macros. the cache is keyed by the result
+	virtual bool preprocess(const std::string &code, const ShaderCompileArgs &args, std::string &preprocessed, std::string &messages) = 0;
+	// compiled is the bytecode, messages the errors or warnings
+	virtual bool compile(const std::string &preprocessed, const ShaderCompileArgs &args, std::string &compiled, std::string &messages) = 0;
+};
+
+struct ShaderCompileResult
+{
+	std::string compiled;
+	std::string messages; // errors if it failed, else warnings
+	bool from_cache = false;
+};
+
+// preprocesses the code, then takes the blob from the cache, or compiles and stores it
+// the warnings are stored with the blob, so a cached shader still shows them
+// cache can be nullptr, then it always compiles
+bool compileShaderCached(ShaderCompilerBackend &backend, ShaderCache *cache, const std::string &code, const ShaderCompileArgs &args, ShaderCompileResult &result);
+// the second half of compileShaderCached, for code that is preprocessed already
+bool compilePreprocessed(ShaderCompilerBackend &backend, ShaderCache *cache, const std::string &preprocessed, const ShaderCompileArgs &args, ShaderCompileResult &result);
@@ -0,0 +1,1421 @@
+#include "ShaderPreprocessor.h"
+#include "IncludeCache.h"
+
+#include <algorithm>
+#include <charconv>
+
+namespace
+{
+	// D3DCompile gives up at a similar depth, this catches include cycles without guards
+	const unsigned max_include_depth = 32;
+	// parsed files and expansions which were not used for this many runs are dropped
+	const uint64_t max_unused_runs = 16;
+	// more empty lines than this are replaced by a #line
+	const unsigned max_empty_lines = 8;
+
+	bool isIdentifierStart(char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+	}
+
+	bool isIdentifierChar(char c)
+	{
+		return isIdentifierStart(c) || (c >= '0' && c <= '9');
+	}
+
+	bool isDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+	}
+
+	std::string_view trim(std::string_view input)
+	{
+		while (!input.empty() && isSpace(input.front()))
+			input.remove_prefix(1);
+		while (!input.empty() && isSpace(input.back()))
+			input.remove_suffix(1);
+		return input;
+	}
+
+	std::string_view takeIdentifier(std::string_view &input)
+	{
+		input = trim(input);
+		size_t length = 0;
+		if (!input.empty() && isIdentifierStart(input[0]))
+		{
+			while (length < input.size() && isIdentifierChar(input[length]))
+				++length;
+		}
+		auto identifier = input.substr(0, length);
+		input.remove_prefix(length);
+		return identifier;
+	}
+
+	// the end of the string or char literal starting at pos, it stops at the end of the line
+	size_t skipLiteral(std::string_view text, size_t pos)
+	{
+		char quote = text[pos++];
+		while (pos < text.size() && text[pos] != quote && text[pos] != '\n')
+		{
+			pos += text[pos] == '\\' && pos + 1 < text.size() ? 2 : 1;
+		}
+		return std::min(pos + 1, text.size());
+	}
+
+	// numbers like 1.5e-3f or 0x1F, the c rules are looser than that but it does not matter here
+	size_t skipNumber(std::string_view text, size_t pos)
+	{
+		while (pos < text.size())
+		{
+			char c = text[pos];
+			if ((c == '+' || c == '-') && (text[pos - 1] == 'e' || text[pos - 1] == 'E'))
+				++pos;
+			else if (isIdentifierChar(c) || c == '.')
+				++pos;
+			else
+				break;
+		}
+		return pos;
+	}
+
+	// a string literal for #line and __FILE__
+	std::string quote(std::string_view text)
+	{
+		std::string quoted = "\"";
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+				quoted += '\\';
+			quoted += c;
+		}
+		return quoted + "\"";
+	}
+
+	// if two tokens written next to each other would be read as one
+	bool wouldMerge(char left, char right)
+	{
+		std::string_view operators = "+-*/%<>=!&|^.#:";
+		return (isIdentifierChar(left) && isIdentifierChar(right)) || (left == '.' && isDigit(right)) ||
+			(operators.find(left) != std::string_view::npos && operators.find(right) != std::string_view::npos);
+	}
+
+	// the integer expression of an #if, after the macros are expanded
+	class Expression
+	{
+	public:
+		explicit Expression(std::vector<std::string_view> tokens) : tokens(std::move(tokens))
+		{
+		}
+
+		bool evaluate(long long &value)
+		{
+			if (!parseConditional(value))
+			{
+				return false;
+			}
+			if (pos != tokens.size())
+			{
+				return fail("unexpected " + std::string(tokens[pos]));
+			}
+			return true;
+		}
+
+		const std::string &getError() const
+		{
+			return error;
+		}
+	private:
+		bool fail(std::string message)
+		{
+			if (error.empty())
+			{
+				error = std::move(message);
+			}
+			return false;
+		}
+
+		bool accept(std::string_view token)
+		{
+			if (pos < tokens.size() && tokens[pos] == token)
+			{
+				++pos;
+				return true;
+			}
+			return false;
+		}
+
+		bool parseConditional(long long &value)
+		{
+			if (!parseBinary(0, value))
+			{
+				return false;
+			}
+			if (!accept("?"))
+			{
+				return true;
+			}
+			long long first, second;
+			if (!parseConditional(first))
+			{
+				return false;
+			}
+			if (!accept(":"))
+			{
+				return fail("expected : in the condition");
+			}
+			if (!parseConditional(second))
+			{
+				return false;
+			}
+			value = value ? first : second;
+			return true;
+		}
+
+		static int getPrecedence(std::string_view op)
+		{
+			static const std::pair<std::string_view, int> precedences[] =
+			{
+				{ "||", 1 }, { "&&", 2 }, { "|", 3 }, { "^", 4 }, { "&", 5 },
+				{ "==", 6 }, { "!=", 6 }, { "<", 7 }, { ">", 7 }, { "<=", 7 }, { ">=", 7 },
+				{ "<<", 8 }, { ">>", 8 }, { "+", 9 }, { "-", 9 }, { "*", 10 }, { "/", 10 }, { "%", 10 },
+			};
+			for (auto &[name, precedence] : precedences)
+			{
+				if (name == op)
+					return precedence;
+			}
+			return 0;
+		}
+
+		bool parseBinary(int min_precedence, long long &value)
+		{
+			if (!parseUnary(value))
+			{
+				return false;
+			}
+			while (pos < tokens.size())
+			{
+				auto op = tokens[pos];
+				int precedence = getPrecedence(op);
+				if (precedence == 0 || precedence < min_precedence)
+				{
+					break;
+				}
+				++pos;
+				long long right;
+				if (!parseBinary(precedence + 1, right))
+				{
+					return false;
+				}
+				if ((op == "/" || op == "%") && right == 0)
+				{
+					return fail("division by zero");
+				}
+				if (op == "||") value = value || right;
+				else if (op == "&&") value = value && right;
+				else if (op == "|") value |= right;
+				else if (op == "^") value ^= right;
+				else if (op == "&") value &= right;
+				else if (op == "==") value = value == right;
+				else if (op == "!=") value = value != right;
+				else if (op == "<") value = value < right;
+				else if (op == ">") value = value > right;
+				else if (op == "<=") value = value <= right;
+				else if (op == ">=") value = value >= right;
+				else if (op == "<<") value <<= right;
+				else if (op == ">>") value >>= right;
+				else if (op == "+") value += right;
+				else if (op == "-") value -= right;
+				else if (op == "*") value *= right;
+				else if (op == "/") value /= right;
+				else value %= right;
+			}
+			return true;
+		}
+
+		bool parseUnary(long long &value)
+		{
+			if (pos == tokens.size())
+			{
+				return fail("expected a value");
+			}
+			auto token = tokens[pos++];
+			if (token == "!" || token == "~" || token == "-" || token == "+")
+			{
+				if (!parseUnary(value))
+				{
+					return false;
+				}
+				value = token == "!" ? !value : token == "~" ? ~value : token == "-" ? -value : value;
+				return true;
+			}
+			if (token == "(")
+			{
+				if (!parseConditional(value))
+				{
+					return false;
+				}
+				return accept(")") || fail("missing )");
+			}
+			if (isDigit(token[0]))
+			{
+				return parseNumber(token, value);
+			}
+			if (token[0] == '\'' && token.size() >= 3)
+			{
+				value = token[1] == '\\' ? token[2] == 'n' ? '\n' : token[2] == 't' ? '\t' : token[2] == '0' ? '\0' : token[2] : token[1];
+				return true;
+			}
+			if (isIdentifierStart(token[0]))
+			{
+				// what is left over is not a macro
+				value = token == "true";
+				return true;
+			}
+			return fail("unexpected " + std::string(token));
+		}
+
+		bool parseNumber(std::string_view token, long long &value)
+		{
+			int base = 10;
+			if (token.size() > 2 && token[0] == '0' && (token[1] == 'x' || token[1] == 'X'))
+			{
+				base = 16;
+				token.remove_prefix(2);
+			}
+			else if (token.size() > 1 && token[0] == '0')
+			{
+				base = 8;
+			}
+			auto [end, ec] = std::from_chars(token.data(), token.data() + token.size(), value, base);
+			std::string_view suffix(end, token.data() + token.size() - end);
+			if (ec != std::errc() || suffix.find_first_not_of("uUlL") != std::string_view::npos)
+			{
+				return fail("invalid integer " + std::string(token));
+			}
+			return true;
+		}
+
+		std::vector<std::string_view> tokens;
+		size_t pos = 0;
+		std::string error;
+	};
+}
+
+struct ShaderPreprocessor::Token
+{
+	enum class Kind
+	{
+		Identifier,
+		Number,
+		String, // also char literals
+		Punctuator
+	};
+
+	Kind kind = Kind::Punctuator;
+	std::string_view text;
+	bool space = false; // whitespace in front of it
+	bool edge = false; // where a substitution starts or ends, it may need a space to stay apart
+	int param = -1; // in a macro body, the parameter it stands for
+	std::vector<const Macro *> hidden; // the macros this token came from, they do not expand again. sorted
+
+	bool is(std::string_view punctuator) const
+	{
+		return kind == Kind::Punctuator && text == punctuator;
+	}
+};
+
+struct ShaderPreprocessor::Macro
+{
+	std::string name;
+	bool function = false;
+	bool variadic = false; // the last parameter is __VA_ARGS__
+	std::vector<std::string> params;
+	std::string body;
+	Tokens tokens; // of the body, they point into it
+	uint64_t hash = 0;
+};
+
+struct ShaderPreprocessor::Line
+{
+	unsigned number = 1; // where it starts in the file
+	unsigned span = 1; // more than one with a \ at the end or a comment over several lines
+	bool directive = false;
+	std::string name; // of the directive
+	std::string text; // the code without comments, or what follows the directive name
+	std::shared_ptr<const Macro> macro; // of a #define, parsed once
+	std::string error; // of a broken #define, reported when it is active
+};
+
+struct ShaderPreprocessor::File
+{
+	uint64_t hash = 0;
+	std::vector<Line> lines;
+	uint64_t last_run = 0;
+};
+
+struct ShaderPreprocessor::Expansion
+{
+	std::string output;
+	// the files it included, with their content hash
+	std::vector<std::pair<std::string, uint64_t>> files;
+	// what it defined, in order. nullptr for an #undef
+	std::vector<std::pair<std::string, std::shared_ptr<const Macro>>> macros;
+	uint64_t last_run = 0;
+};
+
+namespace
+{
+	template<class Token>
+	void tokenize(std::string_view text, std::vector<Token> &tokens, bool space = false)
+	{
+		size_t pos = 0;
+		while (pos < text.size())
+		{
+			if (isSpace(text[pos]) || text[pos] == '\n')
+			{
+				space = true;
+				++pos;
+				continue;
+			}
+
+			Token token;
+			token.space = space;
+			space = false;
+			size_t start = pos;
+			char c = text[pos];
+			char next = pos + 1 < text.size() ? text[pos + 1] : '\0';
+			if (isIdentifierStart(c))
+			{
+				token.kind = Token::Kind::Identifier;
+				while (pos < text.size() && isIdentifierChar(text[pos]))
+					++pos;
+			}
+			else if (isDigit(c) || (c == '.' && isDigit(next)))
+			{
+				token.kind = Token::Kind::Number;
+				pos = skipNumber(text, pos + 1);
+			}
+			else if (c == '"' || c == '\'')
+			{
+				token.kind = Token::Kind::String;
+				pos = skipLiteral(text, pos);
+			}
+			else
+			{
+				// only the ones the preprocessor looks at, the others are written as they came
+				std::string_view rest = text.substr(pos);
+				pos += 1;
+				for (std::string_view op : { "...", "##", "&&", "||", "==", "!=", "<=", ">=", "<<", ">>" })
+				{
+					if (rest.starts_with(op))
+					{
+						pos = start + op.size();
+						break;
+					}
+				}
+			}
+			token.text = text.substr(start, pos - start);
+			tokens.push_back(std::move(token));
+		}
+	}
+
+	template<class Token>
+	std::string stringize(const std::vector<Token> &tokens)
+	{
+		std::string text = "\"";
+		for (auto &token : tokens)
+		{
+			if (token.space && text.size() > 1)
+			{
+				text += ' ';
+			}
+			for (char c : token.text)
+			{
+				if (token.kind == Token::Kind::String && (c == '"' || c == '\\'))
+				{
+					text += '\\';
+				}
+				text += c;
+			}
+		}
+		return text + "\"";
+	}
+
+	template<class Token>
+	void join(std::string_view indent, const std::vector<Token> &tokens, std::string &text)
+	{
+		text.assign(indent);
+		for (auto &token : tokens)
+		{
+			if (text.size() > indent.size() && (token.space || (token.edge && wouldMerge(text.back(), token.text.front()))))
+			{
+				text += ' ';
+			}
+			text += token.text;
+		}
+	}
+
+	template<class T>
+	void insertSorted(std::vector<T> &target, T item)
+	{
+		auto iter = std::lower_bound(target.begin(), target.end(), item);
+		if (iter == target.end() || *iter != item)
+		{
+			target.insert(iter, item);
+		}
+	}
+}
+
+ShaderPreprocessor::ShaderPreprocessor(Loader loader) : loader(std::move(loader))
+{
+}
+
+bool ShaderPreprocessor::preprocess(const std::string &filename, const std::string &code, const std::set<std::string> &defines, std::string &output)
+{
+	++run;
+	run_files.clear();
+	recording.clear();
+	files.clear();
+	error.clear();
+	macros.clear();
+	macro_hash = 0;
+	for (auto &name : defines)
+	{
+		auto macro = std::make_shared<Macro>();
+		macro->name = name;
+		macro->body = "1";
+		tokenize(macro->body, macro->tokens);
+		macro->hash = IncludeCache::combine(IncludeCache::hash(name), IncludeCache::hash(" 1"));
+		define(macro);
+	}
+
+	run_files[filename] = parseFile(code);
+	output.clear();
+	location_file = filename;
+	location_line = 0;
+	bool succeeded = includeFile(filename, 0, output);
+	scratch.clear();
+
+	std::erase_if(parsed, [&](auto &item) { return item.second->last_run + max_unused_runs < run; });
+	std::erase_if(expansions, [&](auto &item) { return item.second->last_run + max_unused_runs < run; });
+	return succeeded;
+}
+
+bool ShaderPreprocessor::preprocessFile(const std::string &filename, const std::set<std::string> &defines, std::string &output)
+{
+	std::string code;
+	if (!loader(filename, code))
+	{
+		files.clear();
+		error = "could not open \"" + filename + "\"";
+		return false;
+	}
+	return preprocess(filename, code, defines, output);
+}
+
+const std::string &ShaderPreprocessor::getError() const
+{
+	return error;
+}
+
+const std::vector<std::string> &ShaderPreprocessor::getFiles() const
+{
+	return files;
+}
+
+bool ShaderPreprocessor::isDefined(std::string_view name) const
+{
+	return macros.find(name) != macros.end();
+}
+
+const ShaderPreprocessor::Stats &ShaderPreprocessor::getStats() const
+{
+	return stats;
+}
+
+void ShaderPreprocessor::resetStats()
+{
+	stats = {};
+}
+
+void ShaderPreprocessor::clear()
+{
+	parsed.clear();
+	expansions.clear();
+}
+
+std::shared_ptr<ShaderPreprocessor::File> ShaderPreprocessor::getFile(const std::string &filename)
+{
+	if (auto iter = run_files.find(filename); iter != run_files.end())
+	{
+		return iter->second;
+	}
+	std::string code;
+	std::shared_ptr<File> file;
+	if (loader(filename, code))
+	{
+		file = parseFile(code);
+	}
+	run_files[filename] = file;
+	return file;
+}
+
+std::shared_ptr<ShaderPreprocessor::File> ShaderPreprocessor::parseFile(std::string_view code)
+{
+	uint64_t hash = IncludeCache::hash(code);
+	if (auto iter = parsed.find(hash); iter != parsed.end())
+	{
+		iter->second->last_run = run;
+		return iter->second;
+	}
+	++stats.parsed;
+
+	auto file = std::make_shared<File>();
+	file->hash = hash;
+	file->last_run = run;
+
+	// first the comments and line continuations go, then each line is text or a directive
+	std::string text;
+	unsigned number = 1, span = 1;
+	auto finishLine = [&]()
+	{
+		Line &line = file->lines.emplace_back();
+		line.number = number;
+		line.span = span;
+		number += span;
+		span = 1;
+
+		std::string_view rest = trim(text);
+		if (rest.empty() || rest[0] != '#')
+		{
+			text.erase(text.find_last_not_of(" \t\r\v\f") + 1);
+			line.text = std::move(text);
+			text.clear();
+			return;
+		}
+		rest.remove_prefix(1);
+		line.directive = true;
+		line.name = takeIdentifier(rest);
+		line.text = trim(rest);
+		text.clear();
+		rest = line.text;
+		if (line.name != "define")
+		{
+			return;
+		}
+
+		// NAME body, or NAME(params) body with the bracket right after the name
+		auto macro = std::make_shared<Macro>();
+		macro->name = takeIdentifier(rest);
+		if (macro->name.empty())
+		{
+			line.error = "#define without a macro name";
+			return;
+		}
+		std::string signature;
+		if (!rest.empty() && rest[0] == '(')
+		{
+			macro->function = true;
+			rest.remove_prefix(1);
+			while (true)
+			{
+				rest = trim(rest);
+				if (rest.starts_with(")") && macro->params.empty())
+				{
+					rest.remove_prefix(1);
+					break;
+				}
+				if (rest.starts_with("..."))
+				{
+					macro->variadic = true;
+					macro->params.push_back("__VA_ARGS__");
+					rest = trim(rest.substr(3));
+				}
+				else
+				{
+					auto param = takeIdentifier(rest);
+					if (param.empty())
+					{
+						line.error = "expected a parameter name in #define " + macro->name;
+						return;
+					}
+					macro->params.emplace_back(param);
+					rest = trim(rest);
+				}
+				if (rest.starts_with(")"))
+				{
+					rest.remove_prefix(1);
+					break;
+				}
+				if (!rest.starts_with(",") || macro->variadic)
+				{
+					line.error = "expected , or ) in #define " + macro->name;
+					return;
+				}
+				rest.remove_prefix(1);
+			}
+			for (auto &param : macro->params)
+			{
+				signature += param + ",";
+			}
+		}
+		macro->body = trim(rest);
+
+		tokenize(macro->body, macro->tokens);
+		if (!macro->tokens.empty() && macro->tokens.front().space)
+		{
+			macro->tokens.front().space = false;
+		}
+		for (size_t i = 0; i < macro->tokens.size(); ++i)
+		{
+			auto &token = macro->tokens[i];
+			if (token.kind == Token::Kind::Identifier && macro->function)
+			{
+				auto param = std::find(macro->params.begin(), macro->params.end(), token.text);
+				if (param != macro->params.end())
+				{
+					token.param = static_cast<int>(param - macro->params.begin());
+				}
+			}
+			if (token.is("##") && (i == 0 || i + 1 == macro->tokens.size()))
+			{
+				line.error = "## at the edge of #define " + macro->name;
+				return;
+			}
+			signature += token.space ? " " : "";
+			signature += token.text;
+		}
+		if (macro->function)
+		{
+			for (size_t i = 0; i < macro->tokens.size(); ++i)
+			{
+				if (macro->tokens[i].is("#") && (i + 1 == macro->tokens.size() || macro->tokens[i + 1].param < 0))
+				{
+					line.error = "# is not followed by a parameter in #define " + macro->name;
+					return;
+				}
+			}
+		}
+		macro->hash = IncludeCache::combine(IncludeCache::hash(macro->name), IncludeCache::hash((macro->function ? "(" : " ") + signature));
+		line.macro = std::move(macro);
+	};
+
+	size_t pos = 0;
+	while (pos < code.size())
+	{
+		size_t special = code.find_first_of("\n\\/\"'", pos);
+		if (special == std::string_view::npos)
+		{
+			text.append(code.substr(pos));
+			break;
+		}
+		text.append(code.substr(pos, special - pos));
+		pos = special;
+
+		char c = code[pos];
+		char next = pos + 1 < code.size() ? code[pos + 1] : '\0';
+		if (c == '\n')
+		{
+			finishLine();
+			++pos;
+		}
+		else if (c == '\\' && (next == '\n' || (next == '\r' && pos + 2 < code.size() && code[pos + 2] == '\n')))
+		{
+			++span;
+			pos += next == '\n' ? 2 : 3;
+		}
+		else if (c == '/' && next == '/')
+		{
+			pos = std::min(code.find('\n', pos), code.size());
+		}
+		else if (c == '/' && next == '*')
+		{
+			size_t end = code.find("*/", pos + 2);
+			end = end != std::string_view::npos ? end + 2 : code.size();
+			span += static_cast<unsigned>(std::count(code.begin() + pos, code.begin() + end, '\n'));
+			text += ' ';
+			pos = end;
+		}
+		else if (c == '"' || c == '\'')
+		{
+			size_t end = skipLiteral(code, pos);
+			text.append(code.substr(pos, end - pos));
+			pos = end;
+		}
+		else
+		{
+			text += c;
+			++pos;
+		}
+	}
+	if (!trim(text).empty())
+	{
+		finishLine();
+	}
+
+	parsed[hash] = file;
+	return file;
+}
+
+bool ShaderPreprocessor::isValid(const Expansion &expansion)
+{
+	for (auto &[filename, hash] : expansion.files)
+	{
+		auto file = getFile(filename);
+		if (!file || file->hash != hash)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ShaderPreprocessor::includeFile(const std::string &filename, unsigned depth, std::string &output)
+{
+	if (depth > max_include_depth)
+	{
+		return fail("includes nested too deep at \"" + filename + "\"");
+	}
+	auto file = getFile(filename);
+	if (!file)
+	{
+		return fail("could not open \"" + filename + "\"");
+	}
+	auto addFile = [&](const std::string &name, uint64_t hash)
+	{
+		for (auto *expansion : recording)
+		{
+			expansion->files.emplace_back(name, hash);
+		}
+		if (std::find(files.begin(), files.end(), name) == files.end())
+		{
+			files.push_back(name);
+		}
+	};
+	addFile(filename, file->hash);
+
+	// the same file in the same macro state gives the same text
+	uint64_t key = IncludeCache::combine(IncludeCache::combine(file->hash, IncludeCache::hash(filename)), macro_hash);
+	if (auto iter = expansions.find(key); iter != expansions.end() && isValid(*iter->second))
+	{
+		auto expansion = iter->second;
+		expansion->last_run = run;
+		++stats.reused;
+		output += expansion->output;
+		for (auto &[name, hash] : expansion->files)
+		{
+			addFile(name, hash);
+		}
+		for (auto &[name, macro] : expansion->macros)
+		{
+			if (macro)
+			{
+				define(macro);
+			}
+			else
+			{
+				undefine(name);
+			}
+		}
+		return true;
+	}
+
+	++stats.expanded;
+	auto expansion = std::make_shared<Expansion>();
+	expansion->last_run = run;
+	recording.push_back(expansion.get());
+	size_t start = output.size();
+	bool succeeded = processFile(filename, *file, depth, output);
+	recording.pop_back();
+	if (!succeeded)
+	{
+		return false;
+	}
+	expansion->output = output.substr(start);
+	expansions[key] = std::move(expansion);
+	return true;
+}
+
+bool ShaderPreprocessor::processFile(const std::string &filename, const File &file, unsigned depth, std::string &output)
+{
+	struct Conditional
+	{
+		bool parent_active; // if the code around the block is active
+		bool taken; // if a branch was already active
+		bool has_else;
+		unsigned line;
+	};
+	std::vector<Conditional> conditionals;
+	bool active = true;
+
+	// #line changes both
+	std::string display_name = filename;
+	int line_offset = 0;
+
+	// empty lines are only written in front of the next code, so a file of directives writes nothing
+	unsigned pending = 0;
+	bool need_marker = true;
+	auto write = [&](const Line &line, std::string_view text)
+	{
+		if (need_marker || pending > max_empty_lines)
+		{
+			output += "#line " + std::to_string(static_cast<int>(line.number) + line_offset) + " " + quote(display_name) + "\n";
+			need_marker = false;
+		}
+		else
+		{
+			output.append(pending, '\n');
+		}
+		pending = 0;
+		output += text;
+		output += '\n';
+	};
+
+	Tokens tokens, expanded;
+	std::string text;
+	for (size_t index = 0; index < file.lines.size(); ++index)
+	{
+		const Line &line = file.lines[index];
+		location_file = display_name;
+		location_line = static_cast<unsigned>(static_cast<int>(line.number) + line_offset);
+
+		if (!line.directive)
+		{
+			if (!active || line.text.find_first_not_of(" \t\r\v\f") == std::string::npos)
+			{
+				pending += line.span;
+				continue;
+			}
+
+			// most lines have no macros, they are written as they are
+			bool has_macros = false;
+			std::string_view code = line.text;
+			for (size_t pos = 0; pos < code.size() && !has_macros;)
+			{
+				char c = code[pos];
+				if (isIdentifierStart(c))
+				{
+					size_t end = pos;
+					while (end < code.size() && isIdentifierChar(code[end]))
+						++end;
+					auto identifier = code.substr(pos, end - pos);
+					has_macros = macros.find(identifier) != macros.end() || identifier == "__LINE__" || identifier == "__FILE__";
+					pos = end;
+				}
+				else if (isDigit(c))
+				{
+					pos = skipNumber(code, pos + 1);
+				}
+				else if (c == '"' || c == '\'')
+				{
+					pos = skipLiteral(code, pos);
+				}
+				else
+				{
+					++pos;
+				}
+			}
+			if (!has_macros)
+			{
+				write(line, line.text);
+				pending += line.span - 1;
+				continue;
+			}
+
+			// the arguments of a call can go on in the next lines
+			unsigned span = line.span;
+			tokens.clear();
+			tokenize(code, tokens);
+			while (true)
+			{
+				// the last line can only end a call, a name there is not called
+				bool open_end = index + 1 < file.lines.size() && !file.lines[index + 1].directive;
+				bool incomplete;
+				expanded.clear();
+				if (!expand(tokens, expanded, incomplete, open_end))
+				{
+					return false;
+				}
+				if (!incomplete)
+				{
+					break;
+				}
+				if (!open_end)
+				{
+					return fail("unterminated call of a macro");
+				}
+				auto &next = file.lines[++index];
+				tokenize(next.text, tokens, true);
+				span += next.span;
+			}
+			join(code.substr(0, code.find_first_not_of(" \t\r\v\f")), expanded, text);
+			write(line, text);
+			pending += span - 1;
+			scratch.clear();
+			continue;
+		}
+
+		auto &name = line.name;
+		if (name == "if" || name == "ifdef" || name == "ifndef")
+		{
+			bool value = false;
+			if (active)
+			{
+				if (name == "if")
+				{
+					if (!evaluate(line.text, value))
+					{
+						return false;
+					}
+				}
+				else
+				{
+					std::string_view rest = line.text;
+					auto macro = takeIdentifier(rest);
+					if (macro.empty())
+					{
+						return fail("#" + name + " without a macro name");
+					}
+					value = isDefined(macro) == (name == "ifdef");
+				}
+			}
+			conditionals.push_back({ active, value, false, location_line });
+			active = active && value;
+		}
+		else if (name == "elif")
+		{
+			if (conditionals.empty() || conditionals.back().has_else)
+			{
+				return fail(conditionals.empty() ? "#elif without #if" : "#elif after #else");
+			}
+			auto &conditional = conditionals.back();
+			bool value = false;
+			if (conditional.parent_active && !conditional.taken && !evaluate(line.text, value))
+			{
+				return false;
+			}
+			active = conditional.parent_active && !conditional.taken && value;
+			conditional.taken = conditional.taken || value;
+		}
+		else if (name == "else")
+		{
+			if (conditionals.empty() || conditionals.back().has_else)
+			{
+				return fail(conditionals.empty() ? "#else without #if" : "#else after #else");
+			}
+			auto &conditional = conditionals.back();
+			active = conditional.parent_active && !conditional.taken;
+			conditional.taken = true;
+			conditional.has_else = true;
+		}
+		else if (name == "endif")
+		{
+			if (conditionals.empty())
+			{
+				return fail("#endif without #if");
+			}
+			active = conditionals.back().parent_active;
+			conditionals.pop_back();
+		}
+		else if (!active)
+		{
+			// anything goes in skipped code
+		}
+		else if (name == "include")
+		{
+			std::string_view rest = line.text;
+			size_t end = rest.size() >= 2 ? rest.find(rest[0] == '<' ? '>' : '"', 1) : std::string_view::npos;
+			if ((rest.empty() || (rest[0] != '"' && rest[0] != '<')) || end == std::string_view::npos)
+			{
+				return fail("malformed #include");
+			}
+			if (!includeFile(std::string(rest.substr(1, end - 1)), depth + 1, output))
+			{
+				return false;
+			}
+			location_file = display_name;
+			// back in this file, the next line says where
+			need_marker = true;
+			pending = 0;
+			continue;
+		}
+		else if (name == "define")
+		{
+			if (!line.macro)
+			{
+				return fail(line.error);
+			}
+			define(line.macro);
+		}
+		else if (name == "undef")
+		{
+			std::string_view rest = line.text;
+			auto macro = takeIdentifier(rest);
+			if (macro.empty())
+			{
+				return fail("#undef without a macro name");
+			}
+			undefine(macro);
+		}
+		else if (name == "line")
+		{
+			std::string_view rest = line.text;
+			rest = trim(rest);
+			unsigned number = 0;
+			auto [end, ec] = std::from_chars(rest.data(), rest.data() + rest.size(), number);
+			if (ec != std::errc())
+			{
+				return fail("#line without a line number");
+			}
+			rest = trim(rest.substr(end - rest.data()));
+			if (rest.size() >= 2 && rest.front() == '"' && rest.back() == '"')
+			{
+				display_name = rest.substr(1, rest.size() - 2);
+			}
+			// the line after the directive gets the number
+			line_offset = static_cast<int>(number) - static_cast<int>(line.number + line.span);
+			need_marker = true;
+			pending = 0;
+			continue;
+		}
+		else if (name == "error")
+		{
+			return fail("#error " + line.text);
+		}
+		else if (name == "pragma")
+		{
+			// for the compiler
+			write(line, "#pragma " + line.text);
+			pending += line.span - 1;
+			continue;
+		}
+		else if (!name.empty())
+		{
+			return fail("unknown directive #" + name);
+		}
+		pending += line.span;
+	}
+
+	if (!conditionals.empty())
+	{
+		location_line = conditionals.back().line;
+		return fail("missing #endif");
+	}
+	return true;
+}
+
+void ShaderPreprocessor::define(const std::shared_ptr<const Macro> &macro)
+{
+	auto &slot = macros[macro->name];
+	if (slot)
+	{
+		macro_hash ^= slot->hash;
+	}
+	slot = macro;
+	macro_hash ^= macro->hash;
+	for (auto *expansion : recording)
+	{
+		expansion->macros.emplace_back(macro->name, macro);
+	}
+}
+
+void ShaderPreprocessor::undefine(std::string_view name)
+{
+	// not defined, the same state gives the same result again
+	auto iter = macros.find(name);
+	if (iter == macros.end())
+	{
+		return;
+	}
+	macro_hash ^= iter->second->hash;
+	macros.erase(iter);
+	for (auto *expansion : recording)
+	{
+		expansion->macros.emplace_back(name, nullptr);
+	}
+}
+
+bool ShaderPreprocessor::expand(const Tokens &input, Tokens &output, bool &incomplete, bool open_end)
+{
+	// the next token at the back. a replacement goes back in, so it is scanned again together with
+	// what follows. a token is not expanded by a macro it came from, which ends the recursion
+	incomplete = false;
+	Tokens stack(input.rbegin(), input.rend());
+	while (!stack.empty())
+	{
+		Token token = std::move(stack.back());
+		stack.pop_back();
+		if (token.kind != Token::Kind::Identifier)
+		{
+			output.push_back(std::move(token));
+			continue;
+		}
+		if (token.text == "__LINE__" || token.text == "__FILE__")
+		{
+			bool is_line = token.text == "__LINE__";
+			token.kind = is_line ? Token::Kind::Number : Token::Kind::String;
+			token.text = scratch.emplace_back(is_line ? std::to_string(location_line) : quote(location_file));
+			output.push_back(std::move(token));
+			continue;
+		}
+
+		auto iter = macros.find(token.text);
+		if (iter == macros.end() || std::binary_search(token.hidden.begin(), token.hidden.end(), iter->second.get()))
+		{
+			output.push_back(std::move(token));
+			continue;
+		}
+		const Macro &macro = *iter->second;
+
+		std::vector<Tokens> args;
+		std::vector<const Macro *> hidden;
+		if (macro.function)
+		{
+			// without brackets it is just a name, unless they come in the next line
+			if (stack.empty() && open_end)
+			{
+				incomplete = true;
+				return true;
+			}
+			if (stack.empty() || !stack.back().is("("))
+			{
+				output.push_back(std::move(token));
+				continue;
+			}
+			stack.pop_back();
+			args.emplace_back();
+			int depth = 0;
+			bool closed = false;
+			while (!stack.empty())
+			{
+				Token arg = std::move(stack.back());
+				stack.pop_back();
+				if (arg.is("("))
+				{
+					++depth;
+				}
+				else if (arg.is(")") && depth > 0)
+				{
+					--depth;
+				}
+				else if (arg.is(")"))
+				{
+					// only what both the name and the bracket were hidden from
+					std::set_intersection(token.hidden.begin(), token.hidden.end(), arg.hidden.begin(), arg.hidden.end(), std::back_inserter(hidden));
+					closed = true;
+					break;
+				}
+				else if (arg.is(",") && depth == 0 && !(macro.variadic && args.size() == macro.params.size()))
+				{
+					args.emplace_back();
+					continue;
+				}
+				args.back().push_back(std::move(arg));
+			}
+			if (!closed)
+			{
+				incomplete = true;
+				return true;
+			}
+			if (macro.params.empty() && args.size() == 1 && args[0].empty())
+			{
+				args.clear();
+			}
+			if (macro.variadic && args.size() + 1 == macro.params.size())
+			{
+				args.emplace_back();
+			}
+			if (args.size() != macro.params.size())
+			{
+				return fail("macro " + macro.name + " takes " + std::to_string(macro.params.size()) + " arguments, not " + std::to_string(args.size()));
+			}
+		}
+		else
+		{
+			hidden = token.hidden;
+		}
+		insertSorted(hidden, &macro);
+
+		Tokens replacement;
+		if (!substitute(macro, args, replacement))
+		{
+			return false;
+		}
+		for (auto &item : replacement)
+		{
+			for (auto *name : hidden)
+			{
+				insertSorted(item.hidden, name);
+			}
+		}
+		if (!replacement.empty())
+		{
+			replacement.front().space = token.space;
+			replacement.front().edge = true;
+		}
+		if (!stack.empty())
+		{
+			stack.back().edge = true;
+		}
+		stack.insert(stack.end(), std::make_move_iterator(replacement.rbegin()), std::make_move_iterator(replacement.rend()));
+	}
+	return true;
+}
+
+bool ShaderPreprocessor::substitute(const Macro &macro, const std::vector<Tokens> &args, Tokens &output)
+{
+	// the arguments are expanded on their own, once, and only where they are not pasted or stringized
+	std::vector<Tokens> expanded_args(args.size());
+	std::vector<bool> has_expanded(args.size(), false);
+	auto append = [&](const Tokens &tokens, const Token &param)
+	{
+		size_t start = output.size();
+		output.insert(output.end(), tokens.begin(), tokens.end());
+		if (start < output.size())
+		{
+			output[start].space = param.space;
+			output[start].edge = true;
+		}
+	};
+
+	// an empty argument in front of ## leaves nothing to paste to
+	bool placemarker = false;
+	auto &body = macro.tokens;
+	for (size_t i = 0; i < body.size(); ++i)
+	{
+		const Token &token = body[i];
+		bool pasted = i + 1 < body.size() && body[i + 1].is("##");
+		if (macro.function && token.is("#"))
+		{
+			auto &param = body[++i];
+			Token text;
+			text.kind = Token::Kind::String;
+			text.text = scratch.emplace_back(stringize(args[param.param]));
+			text.space = token.space;
+			output.push_back(std::move(text));
+			placemarker = false;
+		}
+		else if (token.is("##"))
+		{
+			auto &right = body[++i];
+			Tokens single;
+			if (right.param < 0)
+			{
+				single.push_back(right);
+				single.back().param = -1;
+			}
+			const Tokens &tokens = right.param >= 0 ? args[right.param] : single;
+			if (placemarker || output.empty())
+			{
+				append(tokens, right);
+			}
+			else if (!tokens.empty())
+			{
+				Token &left = output.back();
+				auto &glued = scratch.emplace_back(std::string(left.text) + std::string(tokens.front().text));
+				Tokens retokenized;
+				tokenize(glued, retokenized);
+				if (retokenized.size() != 1)
+				{
+					return fail("pasting " + std::string(left.text) + " and " + std::string(tokens.front().text) + " does not give a token");
+				}
+				left.kind = retokenized.front().kind;
+				left.text = glued;
+				output.insert(output.end(), tokens.begin() + 1, tokens.end());
+			}
+			placemarker = tokens.empty() && (placemarker || output.empty());
+		}
+		else if (token.param >= 0)
+		{
+			auto &arg = args[token.param];
+			if (pasted)
+			{
+				append(arg, token);
+				placemarker = arg.empty();
+				continue;
+			}
+			if (!has_expanded[token.param])
+			{
+				bool incomplete;
+				if (!expand(arg, expanded_args[token.param], incomplete))
+				{
+					return false;
+				}
+				has_expanded[token.param] = true;
+			}
+			append(expanded_args[token.param], token);
+		}
+		else
+		{
+			output.push_back(token);
+			output.back().param = -1;
+			placemarker = false;
+		}
+	}
+	return true;
+}
+
+bool ShaderPreprocessor::evaluate(std::string_view expression, bool &value)
+{
+	Tokens tokens, resolved, expanded;
+	tokenize(expression, tokens);
+
+	// defined X and defined(X) before the macros are expanded, else X would be replaced
+	for (size_t i = 0; i < tokens.size(); ++i)
+	{
+		if (tokens[i].kind != Token::Kind::Identifier || tokens[i].text != "defined")
+		{
+			resolved.push_back(tokens[i]);
+			continue;
+		}
+		bool bracket = i + 1 < tokens.size() && tokens[i + 1].is("(");
+		size_t name = i + (bracket ? 2 : 1);
+		if (name >= tokens.size() || tokens[name].kind != Token::Kind::Identifier || (bracket && (name + 1 >= tokens.size() || !tokens[name + 1].is(")"))))
+		{
+			return fail("malformed defined in #if");
+		}
+		Token result;
+		result.kind = Token::Kind::Number;
+		result.text = isDefined(tokens[name].text) ? "1" : "0";
+		resolved.push_back(std::move(result));
+		i = name + (bracket ? 1 : 0);
+	}
+
+	bool incomplete;
+	if (!expand(resolved, expanded, incomplete))
+	{
+		return false;
+	}
+	if (incomplete)
+	{
+		return fail("unterminated call of a macro in #if");
+	}
+	std::vector<std::string_view> texts;
+	for (auto &token : expanded)
+	{
+		texts.push_back(token.text);
+	}
+
+	Expression parser(std::move(texts));
+	long long result;
+	bool succeeded = parser.evaluate(result);
+	scratch.clear();
+	if (!succeeded)
+	{
+		return fail(parser.getError() + " in #if");
+	}
+	value = result != 0;
+	return true;
+}
+
+bool ShaderPreprocessor::fail(std::string_view message)
+{
+	error = location_file + "(" + std::to_string(location_line) + "): " + std::string(message);
+	return false;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// a c preprocessor for hlsl, so the shaders can be read without d3d: by tools, the include graph
+// and the permutation keys. resolves the includes with the loader, expands object and function
+// macros (with #, ## and __VA_ARGS__), evaluates #if / #elif / #ifdef / #ifndef and marks where
+// the lines came from with #line, like D3DPreprocess does
+// a file is parsed once per content, and an include is expanded once per content and macros
+// it sees. both are kept between runs, so a reload only expands again what changed
+class ShaderPreprocessor
+{
+public:
+	// loads the code of an included file, by the name used in the #include
+	using Loader = std::function<bool(const std::string &filename, std::string &code)>;
+
+	struct Stats
+	{
+		unsigned parsed = 0; // files split into lines and directives, the others were known
+		unsigned expanded = 0; // includes run through line by line
+		unsigned reused = 0; // includes taken as they were expanded before
+	};
+
+	explicit ShaderPreprocessor(Loader loader);
+
+	// preprocesses code, which is the file filename. every define is set to 1, like the compiler does
+	bool preprocess(const std::string &filename, const std::string &code, const std::set<std::string> &defines, std::string &output);
+	// the same, but loads filename first
+	bool preprocessFile(const std::string &filename, const std::set<std::string> &defines, std::string &output);
+
+	// file(line): message
+	const std::string &getError() const;
+	// every file the last run included, the root first
+	const std::vector<std::string> &getFiles() const;
+	// if name was defined at the end of the last run
+	bool isDefined(std::string_view name) const;
+
+	const Stats &getStats() const;
+	void resetStats();
+	// forgets the parsed files and expanded includes
+	void clear();
+private:
+	struct Token;
+	struct Macro;
+	struct Line;
+	struct File;
+	struct Expansion;
+	using Tokens = std::vector<Token>;
+
+	// the file of this run, loaded once and parsed once per content
+	std::shared_ptr<File> getFile(const std::string &filename);
+	std::shared_ptr<File> parseFile(std::string_view code);
+	// if the files which went into the expansion are still the same
+	bool isValid(const Expansion &expansion);
+
+	bool includeFile(const std::string &filename, unsigned depth, std::string &output);
+	bool processFile(const std::string &filename, const File &file, unsigned depth, std::string &output);
+	void define(const std::shared_ptr<const Macro> &macro);
+	void undefine(std::string_view name);
+
+	// incomplete is set when a macro call goes on behind the tokens. with an open end, more lines
+	// can follow, so a function macro name at the end can still get its brackets from them
+	bool expand(const Tokens &input, Tokens &output, bool &incomplete, bool open_end = false);
+	bool substitute(const Macro &macro, const std::vector<Tokens> &args, Tokens &output);
+	bool evaluate(std::string_view expression, bool &value);
+	bool fail(std::string_view message);
+
+	Loader loader;
+	std::map<std::string, std::shared_ptr<const Macro>, std::less<>> macros;
+	// mixed from all the macros, so an include knows which state it was expanded in
+	uint64_t macro_hash = 0;
+
+	// kept between runs, by content hash and by content and macro state
+	std::map<uint64_t, std::shared_ptr<File>> parsed;
+	std::map<uint64_t, std::shared_ptr<Expansion>> expansions;
+	uint64_t run = 0;
+
+	// what the loader gave in this run, nullptr if it failed
+	std::map<std::string, std::shared_ptr<File>> run_files;
+	// the includes being expanded, each one records the files and macros it depends on
+	std::vector<Expansion *> recording;
+	// text of the tokens made while expanding a line, like pasted ones
+	std::deque<std::string> scratch;
+
+	std::string location_file;
+	unsigned location_line = 0;
+	std::vector<std::string> files;
+	std::string error;
+	Stats stats;
+};
@@ -0,0 +1,317 @@
+#include "ShaderScanner.h"
+#include "VariableTokenizer.h"
+
+#include <algorithm>
+#include <map>
+
+namespace
+{
+	// D3DCompile gives up at a similar depth, this catches include cycles without guards
+	const unsigned max_include_depth = 32;
+
+	bool isIdentifierChar(char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+	}
+
+	bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+	}
+
+	std::string_view trim(std::string_view input)
+	{
+		while (!input.empty() && (isSpace(input.front()) || input.front() == '\n'))
+			input.remove_prefix(1);
+		while (!input.empty() && (isSpace(input.back()) || input.back() == '\n'))
+			input.remove_suffix(1);
+		return input;
+	}
+
+	// splits off the leading identifier
+	std::string_view takeIdentifier(std::string_view &input)
+	{
+		input = trim(input);
+		size_t length = 0;
+		while (length < input.size() && isIdentifierChar(input[length]))
+			++length;
+		auto identifier = input.substr(0, length);
+		input.remove_prefix(length);
+		return identifier;
+	}
+
+	// the state of one #if / #ifdef / #ifndef block
+	struct Conditional
+	{
+		bool parent_active; // if the code around the block is active
+		bool known; // false for #if, we can not evaluate the expression
+		bool taken; // if a branch of a known block was already active
+	};
+}
+
+ShaderScanner::ShaderScanner(Loader loader) : loader(std::move(loader))
+{
+}
+
+bool ShaderScanner::scan(const std::string &filename, VariableMap &variables, const std::set<std::string> &defines)
+{
+	this->defines = { defines.begin(), defines.end() };
+	files.clear();
+	includes.clear();
+	tokens.clear();
+	error.clear();
+	return scanFile(filename, variables, 0);
+}
+
+void ShaderScanner::setTokenPrefix(std::string prefix)
+{
+	token_prefix = std::move(prefix);
+}
+
+const std::vector<std::string> &ShaderScanner::getFiles() const
+{
+	return files;
+}
+
+const std::vector<std::pair<std::string, std::string>> &ShaderScanner::getIncludes() const
+{
+	return includes;
+}
+
+const std::map<std::string, std::set<std::string>> &ShaderScanner::getTokens() const
+{
+	return tokens;
+}
+
+const std::string &ShaderScanner::getError() const
+{
+	return error;
+}
+
+bool ShaderScanner::scanFile(const std::string &filename, VariableMap &variables, unsigned depth)
+{
+	if (depth > max_include_depth)
+	{
+		error = "includes nested too deep at \"" + filename + "\"";
+		return false;
+	}
+
+	std::string code;
+	if (!loader(filename, code))
+	{
+		error = "could not load \"" + filename + "\"";
+		return false;
+	}
+	if (std::find(files.begin(), files.end(), filename) == files.end())
+	{
+		files.push_back(filename);
+	}
+
+	auto fail = [&](unsigned line, std::string_view message)
+	{
+		error = filename + "(" + std::to_string(line) + "): " + std::string(message);
+		return false;
+	};
+
+	std::vector<Conditional> conditionals;
+	bool active = true;
+
+	std::string_view var_tag = VariableTokenizer::getVarTag();
+	size_t pos = 0;
+	unsigned line = 1;
+	bool line_start = true;
+	while (pos < code.size())
+	{
+		char c = code[pos];
+		char next = pos + 1 < code.size() ? code[pos + 1] : '\0';
+
+		if (c == '\n')
+		{
+			++line;
+			line_start = true;
+			++pos;
+		}
+		else if (isSpace(c) || (c == '\\' && next == '\n'))
+		{
+			++pos;
+		}
+		else if (c == '/' && next == '/')
+		{
+			pos = std::min(code.find('\n', pos), code.size());
+		}
+		else if (c == '/' && next == '*')
+		{
+			size_t end = code.find("*/", pos + 2);
+			end = end != std::string::npos ? end + 2 : code.size();
+			line += static_cast<unsigned>(std::count(code.begin() + pos, code.begin() + end, '\n'));
+			pos = end;
+		}
+		else if (c == '"')
+		{
+			// strings only appear in includes and attributes, but a VAR_ in there is no declaration
+			size_t end = code.find_first_of("\"\n", pos + 1);
+			pos = end != std::string::npos && code[end] == '"' ? end + 1 : end;
+		}
+		else if (c == '#' && line_start)
+		{
+			// the directive runs to the end of the line, including continuations
+			std::string directive_line;
+			size_t end = pos + 1;
+			unsigned directive_start_line = line;
+			for (; end < code.size() && code[end] != '\n'; ++end)
+			{
+				if (code[end] == '\\' && end + 1 < code.size() && code[end + 1] == '\n')
+				{
+					++end;
+					++line;
+					continue;
+				}
+				if (code[end] == '/' && end + 1 < code.size() && code[end + 1] == '/')
+				{
+					end = std::min(code.find('\n', end), code.size());
+					break;
+				}
+				directive_line += code[end];
+			}
+			pos = end;
+
+			std::string_view rest = directive_line;
+			auto directive = takeIdentifier(rest);
+			if (directive == "include")
+			{
+				if (active)
+				{
+					rest = trim(rest);
+					if (rest.size() < 2 || !((rest.front() == '"' && rest.back() == '"') || (rest.front() == '<' && rest.back() == '>')))
+					{
+						return fail(directive_start_line, "malformed #include");
+					}
+					std::string child(rest.substr(1, rest.size() - 2));
+					includes.emplace_back(filename, child);
+					if (!scanFile(child, variables, depth + 1))
+					{
+						return false;
+					}
+				}
+			}
+			else if (directive == "define")
+			{
+				if (active)
+				{
+					defines.emplace(takeIdentifier(rest));
+				}
+			}
+			else if (directive == "undef")
+			{
+				if (active)
+				{
+					if (auto iter = defines.find(takeIdentifier(rest)); iter != defines.end())
+					{
+						defines.erase(iter);
+					}
+				}
+			}
+			else if (directive == "ifdef" || directive == "ifndef")
+			{
+				bool defined = defines.find(takeIdentifier(rest)) != defines.end();
+				bool condition = directive == "ifdef" ? defined : !defined;
+				conditionals.push_back({ active, true, condition });
+				active = active && condition;
+			}
+			else if (directive == "if")
+			{
+				conditionals.push_back({ active, false, false });
+			}
+			else if (directive == "elif" || directive == "else")
+			{
+				if (conditionals.empty())
+				{
+					return fail(directive_start_line, "#" + std::string(directive) + " without #if");
+				}
+				auto &conditional = conditionals.back();
+				if (conditional.known)
+				{
+					// an #elif makes the rest of the block unknown
+					bool condition = !conditional.taken;
+					conditional.taken = true;
+					conditional.known = directive == "else";
+					active = conditional.parent_active && condition;
+				}
+				else
+				{
+					active = conditional.parent_active;
+				}
+			}
+			else if (directive == "endif")
+			{
+				if (conditionals.empty())
+				{
+					return fail(directive_start_line, "#endif without #if");
+				}
+				active = conditionals.back().parent_active;
+				conditionals.pop_back();
+			}
+		}
+		else if (isIdentifierChar(c))
+		{
+			line_start = false;
+			size_t end = pos;
+			while (end < code.size() && isIdentifierChar(code[end]))
+				++end;
+			std::string_view identifier(code.data() + pos, end - pos);
+			pos = end;
+
+			if (!active)
+			{
+				continue;
+			}
+			if (!token_prefix.empty() && identifier.size() > token_prefix.size() && identifier.substr(0, token_prefix.size()) == token_prefix)
+			{
+				tokens[filename].emplace(identifier);
+			}
+			if (identifier.size() <= var_tag.size() || identifier.substr(0, var_tag.size()) != var_tag)
+			{
+				continue;
+			}
+
+			// only a use with a parameter list declares the variable
+			size_t bracket = pos;
+			while (bracket < code.size() && (isSpace(code[bracket]) || code[bracket] == '\n'))
+				++bracket;
+			if (bracket >= code.size() || code[bracket] != '(')
+			{
+				continue;
+			}
+			size_t bracket_end = code.find(')', bracket);
+			if (bracket_end == std::string::npos)
+			{
+				return fail(line, "unterminated " + std::string(identifier));
+			}
+
+			Variable var;
+			size_t error_offset;
+			std::string_view error_message;
+			if (!VariableTokenizer::parseParams(std::string_view(code).substr(bracket + 1, bracket_end - bracket - 1), var, error_offset, error_message))
+			{
+				auto [error_line, error_column] = VariableTokenizer::getPosition(code, bracket + 1 + error_offset);
+				error = filename + "(" + std::to_string(error_line) + "," + std::to_string(error_column) + "): invalid parameters for " + std::string(identifier) + ": " + std::string(error_message);
+				return false;
+			}
+			variables[std::string(identifier.substr(var_tag.size()))] = var;
+
+			line += static_cast<unsigned>(std::count(code.begin() + pos, code.begin() + bracket_end, '\n'));
+			pos = bracket_end + 1;
+		}
+		else
+		{
+			line_start = false;
+			++pos;
+		}
+	}
+
+	if (!conditionals.empty())
+	{
+		return fail(line, "missing #endif");
+	}
+	return true;
+}
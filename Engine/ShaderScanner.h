@@ -0,0 +1,51 @@
+#pragma once
+
+#include "ShaderVariable.h"
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// finds all VAR_name(min = ..., max = ..., step = ..., start = ...) declarations of a shader,
+// by following its includes like the preprocessor would: comments are skipped,
+// #ifdef / #ifndef are evaluated, so include guards work. #if expressions are not evaluated,
+// both branches count as active. that may find a variable too much, but never one too little
+// does not depend on d3d, the files come from the loader
+class ShaderScanner
+{
+public:
+	// loads the code of an included file, by the name used in the #include
+	using Loader = std::function<bool(const std::string &filename, std::string &code)>;
+
+	explicit ShaderScanner(Loader loader);
+
+	// adds the variables found in filename and its includes
+	// defines are the macros given to the compiler, they count for #ifdef
+	bool scan(const std::string &filename, VariableMap &variables, const std::set<std::string> &defines = {});
+
+	// also collect the identifiers starting with prefix, e.g. "MATERIAL_". empty = off
+	void setTokenPrefix(std::string prefix);
+
+	// every file the last scan loaded, in the order they were included
+	const std::vector<std::string> &getFiles() const;
+	// every (parent, child) pair of the last scan, by the names used in the #include
+	const std::vector<std::pair<std::string, std::string>> &getIncludes() const;
+	// the identifiers with the token prefix, by file. only from active code, not from directives
+	const std::map<std::string, std::set<std::string>> &getTokens() const;
+	// what went wrong, with file and line, and the column for invalid parameters
+	const std::string &getError() const;
+
+private:
+	bool scanFile(const std::string &filename, VariableMap &variables, unsigned depth);
+
+	Loader loader;
+	std::string token_prefix;
+	std::set<std::string, std::less<>> defines;
+	std::vector<std::string> files;
+	std::vector<std::pair<std::string, std::string>> includes;
+	std::map<std::string, std::set<std::string>> tokens;
+	std::string error;
+};
@@ -0,0 +1,153 @@
+#include "ShaderTimings.h"
+#include "Util.h"
+
+#include <sstream>
+
+namespace
+{
+	struct PhaseTotal
+	{
+		double time = 0.0;
+		uint64_t bytes = 0;
+		unsigned variables = 0;
+		unsigned count = 0;
+		unsigned cached = 0;
+	};
+
+	std::vector<PhaseTotal> sumPhases(const std::vector<ShaderTimings::Event> &events)
+	{
+		std::vector<PhaseTotal> totals(static_cast<size_t>(ShaderTimings::Phase::Count));
+		for (auto &event : events)
+		{
+			auto &total = totals[static_cast<size_t>(event.phase)];
+			total.time += event.time;
+			total.bytes += event.bytes;
+			total.variables += event.variables;
+			total.count += 1;
+			total.cached += event.cached ? 1 : 0;
+		}
+		return totals;
+	}
+}
+
+void ShaderTimings::setShader(std::string shader)
+{
+	std::lock_guard lock(mutex);
+	this->shader = std::move(shader);
+}
+
+void ShaderTimings::add(Event event)
+{
+	std::lock_guard lock(mutex);
+	if (event.shader.empty())
+	{
+		event.shader = shader;
+	}
+	events.push_back(std::move(event));
+}
+
+std::vector<ShaderTimings::Event> ShaderTimings::getEvents() const
+{
+	std::lock_guard lock(mutex);
+	return events;
+}
+
+double ShaderTimings::getTotal(Phase phase) const
+{
+	std::lock_guard lock(mutex);
+	double total = 0.0;
+	for (auto &event : events)
+	{
+		if (event.phase == phase)
+		{
+			total += event.time;
+		}
+	}
+	return total;
+}
+
+std::string ShaderTimings::formatSummary() const
+{
+	auto totals = sumPhases(getEvents());
+	std::ostringstream out;
+	out.setf(std::ios::fixed);
+	out.precision(2);
+	for (size_t phase = 0; phase < totals.size(); ++phase)
+	{
+		auto &total = totals[phase];
+		if (!total.count)
+		{
+			continue;
+		}
+		out << getPhaseName(static_cast<Phase>(phase)) << ": " << total.time * 1000.0 << " ms, " << total.count << " times";
+		if (total.cached)
+		{
+			out << " (" << total.cached << " cached)";
+		}
+		if (total.bytes)
+		{
+			out << ", " << total.bytes << " bytes";
+		}
+		if (total.variables)
+		{
+			out << ", " << total.variables << " variables";
+		}
+		out << "\n";
+	}
+	return out.str();
+}
+
+std::string ShaderTimings::toJson() const
+{
+	auto events = getEvents();
+	auto totals = sumPhases(events);
+
+	std::ostringstream out;
+	out << "{\n\t\"phases\": {";
+	bool first = true;
+	for (size_t phase = 0; phase < totals.size(); ++phase)
+	{
+		auto &total = totals[phase];
+		out << (first ? "\n" : ",\n") << "\t\t" << quoteJson(getPhaseName(static_cast<Phase>(phase))) << ": { \"ms\": " << total.time * 1000.0 <<
+			", \"count\": " << total.count << ", \"cached\": " << total.cached << ", \"bytes\": " << total.bytes << ", \"variables\": " << total.variables << " }";
+		first = false;
+	}
+	out << "\n\t},\n\t\"events\": [";
+	first = true;
+	for (auto &event : events)
+	{
+		out << (first ? "\n" : ",\n") << "\t\t{ \"phase\": " << quoteJson(getPhaseName(event.phase)) << ", \"shader\": " << quoteJson(event.shader) <<
+			", \"file\": " << quoteJson(event.file) << ", \"ms\": " << event.time * 1000.0 << ", \"bytes\": " << event.bytes <<
+			", \"variables\": " << event.variables << ", \"thread\": " << event.thread << ", \"cached\": " << (event.cached ? "true" : "false") << " }";
+		first = false;
+	}
+	out << "\n\t]\n}\n";
+	return out.str();
+}
+
+void ShaderTimings::clear()
+{
+	std::lock_guard lock(mutex);
+	events.clear();
+}
+
+std::string_view ShaderTimings::getPhaseName(Phase phase)
+{
+	switch (phase)
+	{
+	case Phase::Load:
+		return "load";
+	case Phase::Parse:
+		return "parse";
+	case Phase::Scan:
+		return "scan";
+	case Phase::Preprocess:
+		return "preprocess";
+	case Phase::Compile:
+		return "compile";
+	case Phase::Disassemble:
+		return "disassemble";
+	default:
+		return "unknown";
+	}
+}
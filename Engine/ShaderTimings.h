@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// what a shader build spent its time on. the includer and the build add an event for each
+// step, the report sums them up per phase, or writes all of them as json
+class ShaderTimings
+{
+public:
+	enum class Phase
+	{
+		Load, // reading a file, or finding it in memory
+		Parse, // rewriting the VAR_ tags of a file
+		Scan, // finding the variables, features and includes of a shader
+		Preprocess,
+		Compile, // including the blob cache lookup
+		Disassemble,
+		Count
+	};
+
+	struct Event
+	{
+		Phase phase = Phase::Load;
+		std::string shader; // filename and entry of the shader it was built for
+		std::string file; // the file it was about, e.g. an include
+		double time = 0.0; // in seconds
+		uint64_t bytes = 0; // read, or made by the phase
+		unsigned variables = 0; // found by the phase
+		unsigned thread = 0; // of the compile
+		bool cached = false; // taken from memory or the blob cache
+	};
+
+	// events without a shader get this one
+	void setShader(std::string shader);
+	// can be called from the compile threads
+	void add(Event event);
+
+	// in the order they were added
+	std::vector<Event> getEvents() const;
+	// seconds spent in phase, over all the events
+	double getTotal(Phase phase) const;
+	// one line per phase, for the debug output
+	std::string formatSummary() const;
+	// the totals and every event
+	std::string toJson() const;
+	void clear();
+
+	static std::string_view getPhaseName(Phase phase);
+private:
+	mutable std::mutex mutex;
+	std::string shader;
+	std::vector<Event> events;
+};
@@ -1,13 +1,83 @@
 #include "ShaderUtil.h"
+#include "ShaderScanner.h"
+#include "VariableTokenizer.h"
 #include "Util.h"
 
 #include <fstream>
 #include <d3dcompiler.h>
 #include <string_view>
 #include <algorithm>
+#include <charconv>
+#include <bit>
+#include <chrono>
+#include <cstring>
 
 #pragma comment(lib, "d3dcompiler.lib")
 
+namespace
+{
+	// d3d text blobs end with a zero
+	std::string getBlobText(ID3DBlob *blob)
+	{
+		std::string text(static_cast<const char *>(blob->GetBufferPointer()), blob->GetBufferSize());
+		while (!text.empty() && text.back() == '\0')
+		{
+			text.pop_back();
+		}
+		return text;
+	}
+}
+
+D3DCompilerBackend::D3DCompilerBackend(ShaderIncluder *includer) : includer(includer)
+{
+}
+
+bool D3DCompilerBackend::preprocess(const std::string &code, const ShaderCompileArgs &args, std::string &preprocessed, std::string &messages)
+{
+	if (includer->usesBuiltinPreprocessor())
+	{
+		return includer->preprocess(args.filename, code, args.defines, preprocessed, messages);
+	}
+
+	// name = 1 for every define, null terminated
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (auto &define : args.defines)
+	{
+		macros.push_back({ define.c_str(), "1" });
+	}
+	macros.push_back({ nullptr, nullptr });
+
+	Comptr<ID3DBlob> output, error;
+	HRESULT hr = D3DPreprocess(code.c_str(), code.length(), args.filename.c_str(), macros.data(), includer, &output, &error);
+	if (error)
+	{
+		messages = getBlobText(error);
+	}
+	if (FAILED(hr) || !output)
+	{
+		return false;
+	}
+	preprocessed = getBlobText(output);
+	return true;
+}
+
+bool D3DCompilerBackend::compile(const std::string &preprocessed, const ShaderCompileArgs &args, std::string &compiled, std::string &messages)
+{
+	// includes and defines are resolved already
+	Comptr<ID3DBlob> output, error;
+	HRESULT hr = D3DCompile(preprocessed.c_str(), preprocessed.length(), args.filename.c_str(), nullptr, nullptr, args.entry.c_str(), args.profile.c_str(), args.flags, 0, &output, &error);
+	if (error)
+	{
+		messages = getBlobText(error);
+	}
+	if (FAILED(hr) || !output)
+	{
+		return false;
+	}
+	compiled.assign(static_cast<const char *>(output->GetBufferPointer()), output->GetBufferSize());
+	return true;
+}
+
 void ShaderIncluder::setFolder(std::string_view folder)
 {
 	this->folder = folder;
@@ -20,7 +90,11 @@ void ShaderIncluder::setSubstitutions(std::vector<ShaderIncluder::Substitution>
 
 void ShaderIncluder::setExtraHeaders(std::vector<MemoryHeader> headers)
 {
-	this->headers.swap(headers);
+	this->headers.clear();
+	for (auto &[filename, code] : headers)
+	{
+		this->headers.emplace_back(std::move(filename), std::make_shared<const std::string>(std::move(code)));
+	}
 }
 
 void ShaderIncluder::setShaderVariableManager(ShaderVariableManager *var_manager)
@@ -30,6 +104,7 @@ void ShaderIncluder::setShaderVariableManager(ShaderVariableManager *var_manager
 
 void ShaderIncluder::setPass(ShaderPass pass)
 {
+	this->pass = pass;
 	if (var_manager)
 	{
 		var_manager->setPass(pass);
@@ -41,38 +116,316 @@ bool ShaderIncluder::hasVarManager() const
 	return var_manager;
 }
 
+void ShaderIncluder::setDefines(std::set<std::string> defines)
+{
+	this->defines.swap(defines);
+}
+
+void ShaderIncluder::setFeaturePrefix(std::string prefix)
+{
+	feature_prefix = std::move(prefix);
+}
+
+const std::set<std::string> &ShaderIncluder::getDefines() const
+{
+	return active_defines;
+}
+
 HRESULT STDMETHODCALLTYPE ShaderIncluder::Open(D3D_INCLUDE_TYPE IncludeType, LPCSTR pFileName, LPCVOID pParentData, LPCVOID *ppData, UINT *pBytes)
 {
-	std::string code;
-	if (!loadFromFile(pFileName, code))
+	auto code = loadText(pFileName, var_manager != nullptr);
+	if (!code)
 	{
 		return D3D11_ERROR_FILE_NOT_FOUND; // let D3D deal with the error
 	}
 
-	UINT size = static_cast<UINT>(code.size());
-	char *data = new char[size];
-	memcpy(data, code.c_str(), size);
+	// no copy, we keep the text alive until Close
+	const char *data = code->data();
 	*ppData = data;
-	*pBytes = size;
+	*pBytes = static_cast<UINT>(code->size());
+	open_files.emplace(data, std::move(code));
 
 	return S_OK;
 }
 
 HRESULT STDMETHODCALLTYPE ShaderIncluder::Close(LPCVOID pData)
 {
-	delete[] static_cast<const char *>(pData);
+	if (auto iter = open_files.find(pData); iter != open_files.end())
+	{
+		open_files.erase(iter);
+	}
 	return S_OK;
 }
 
 bool ShaderIncluder::loadFromFile(const std::string &filename, std::string &code)
 {
-	// do we have this header preloaded?
+	auto text = loadText(filename, var_manager != nullptr);
+	if (!text)
+	{
+		return false;
+	}
+	code = *text;
+	return true;
+}
+
+bool ShaderIncluder::scanShader(const std::string &filename, std::string &error)
+{
+	// the header is generated from the result, so it is empty while we scan
+	if (var_manager)
+	{
+		setExtraHeaders({ { "user_variables.hlsl", "" } });
+	}
+
+	auto start_time = std::chrono::steady_clock::now();
+	uint64_t bytes = 0;
+
+	// where each name came from, empty for memory headers
+	std::map<std::string, std::filesystem::path> paths;
+	scan_hash = IncludeCache::hash(filename);
+	ShaderScanner scanner([&](const std::string &name, std::string &code)
+	{
+		auto text = loadText(name, false, &paths[name]);
+		if (!text)
+		{
+			return false;
+		}
+		code = *text;
+		bytes += code.size();
+		scan_hash = IncludeCache::combine(scan_hash, IncludeCache::combine(IncludeCache::hash(name), IncludeCache::hash(code)));
+		return true;
+	});
+	scanner.setTokenPrefix(feature_prefix);
+
+	VariableMap no_variables;
+	auto &variables = var_manager ? var_manager->getVariables() : no_variables;
+	bool scanned = scanner.scan(filename, variables, defines);
+	if (timings)
+	{
+		ShaderTimings::Event event;
+		event.phase = ShaderTimings::Phase::Scan;
+		event.file = filename;
+		event.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+		event.bytes = bytes;
+		event.variables = static_cast<unsigned>(variables.size());
+		timings->add(std::move(event));
+	}
+	if (!scanned)
+	{
+		error = scanner.getError();
+		return false;
+	}
+
+	if (auto &root = paths[filename]; !root.empty())
+	{
+		include_graph.addRoot(root);
+	}
+	for (auto &[parent, child] : scanner.getIncludes())
+	{
+		auto &parent_path = paths[parent], &child_path = paths[child];
+		if (!parent_path.empty() && !child_path.empty())
+		{
+			include_graph.addInclude(parent_path, child_path);
+		}
+	}
+
+	// the root knows every feature, only the files it includes tell which ones are used
+	active_defines = defines;
+	for (auto &[file, tokens] : scanner.getTokens())
+	{
+		if (file == filename)
+		{
+			continue;
+		}
+		for (auto &token : tokens)
+		{
+			active_defines.insert("FEATURE_" + token);
+		}
+	}
+	for (auto &define : active_defines)
+	{
+		scan_hash = IncludeCache::combine(scan_hash, IncludeCache::hash(define));
+	}
+
+	if (var_manager)
+	{
+		var_manager->applyInitialValues();
+		std::string header = var_manager->generateHeader();
+		scan_hash = IncludeCache::combine(scan_hash, IncludeCache::hash(header));
+		setExtraHeaders({ { "user_variables.hlsl", std::move(header) } });
+
+		// baked values are part of the code
+		if (var_manager->isBaked())
+		{
+			for (auto &[name, var] : var_manager->getVariables())
+			{
+				scan_hash = IncludeCache::combine(IncludeCache::combine(scan_hash, IncludeCache::hash(name)), std::bit_cast<uint32_t>(var.value));
+			}
+		}
+	}
+	return true;
+}
+
+uint64_t ShaderIncluder::getPermutationKey(const std::string &profile, const std::string &entry) const
+{
+	return IncludeCache::combine(IncludeCache::combine(scan_hash, IncludeCache::hash(profile)), IncludeCache::hash(entry));
+}
+
+uint64_t ShaderIncluder::getSourceKey() const
+{
+	return scan_hash;
+}
+
+Comptr<ID3DBlob> ShaderIncluder::findPermutation(uint64_t key)
+{
+	auto iter = permutations.find(key);
+	if (iter == permutations.end())
+	{
+		return {};
+	}
+	iter->second.last_use = ++use_counter;
+	return Comptr<ID3DBlob>(iter->second.compiled);
+}
+
+void ShaderIncluder::addPermutation(uint64_t key, Comptr<ID3DBlob> &compiled)
+{
+	if (permutations.size() >= max_permutations && !permutations.count(key))
+	{
+		auto oldest = std::min_element(permutations.begin(), permutations.end(), [](auto &a, auto &b)
+		{
+			return a.second.last_use < b.second.last_use;
+		});
+		permutations.erase(oldest);
+	}
+	auto &permutation = permutations[key];
+	permutation.compiled = Comptr<ID3DBlob>(compiled);
+	permutation.last_use = ++use_counter;
+}
+
+void ShaderIncluder::setBuiltinPreprocessor(bool enable)
+{
+	builtin_preprocessor = enable;
+}
+
+bool ShaderIncluder::usesBuiltinPreprocessor() const
+{
+	return builtin_preprocessor;
+}
+
+bool ShaderIncluder::preprocess(const std::string &filename, const std::string &code, const std::set<std::string> &defines, std::string &preprocessed, std::string &error)
+{
+	if (!preprocessor.preprocess(filename, code, defines, preprocessed))
+	{
+		error = preprocessor.getError();
+		return false;
+	}
+	return true;
+}
+
+const ShaderPreprocessor &ShaderIncluder::getPreprocessor() const
+{
+	return preprocessor;
+}
+
+void ShaderIncluder::clearPermutations()
+{
+	permutations.clear();
+}
+
+void ShaderIncluder::setTimings(ShaderTimings *timings)
+{
+	this->timings = timings;
+}
+
+ShaderTimings *ShaderIncluder::getTimings() const
+{
+	return timings;
+}
+
+void ShaderIncluder::setCompilerBackend(ShaderCompilerBackend *backend)
+{
+	this->backend = backend;
+}
+
+ShaderCompilerBackend &ShaderIncluder::getCompilerBackend()
+{
+	return backend ? *backend : d3d_backend;
+}
+
+void ShaderIncluder::setBlobCache(ShaderCache *cache)
+{
+	blob_cache = cache;
+}
+
+ShaderCache *ShaderIncluder::getBlobCache() const
+{
+	return blob_cache;
+}
+
+void ShaderIncluder::setMessageHandler(MessageHandler handler)
+{
+	message_handler = std::move(handler);
+}
+
+void ShaderIncluder::reportMessage(const std::string &message, bool error)
+{
+	if (message_handler)
+	{
+		message_handler(message, error);
+	}
+	else if (error)
+	{
+		ErrorBox(message);
+	}
+	else
+	{
+		WarningBox(message);
+	}
+}
+
+const IncludeCache::Stats &ShaderIncluder::getCacheStats() const
+{
+	return cache.getStats();
+}
+
+void ShaderIncluder::resetCacheStats()
+{
+	cache.resetStats();
+}
+
+const IncludeGraph &ShaderIncluder::getIncludeGraph() const
+{
+	return include_graph;
+}
+
+void ShaderIncluder::clearIncludeGraph()
+{
+	include_graph.clear();
+}
+
+bool ShaderIncluder::loadSource(const std::string &filename, std::string &code)
+{
+	auto text = loadText(filename, false);
+	if (!text)
+	{
+		return false;
+	}
+	code = *text;
+	return true;
+}
+
+std::shared_ptr<const std::string> ShaderIncluder::loadText(const std::string &filename, bool rewrite, std::filesystem::path *path)
+{
+	if (path)
+	{
+		path->clear();
+	}
+
+	// do we have this header preloaded? they are generated, so there is nothing to rewrite
 	for (const auto &[header_filename, header_code] : headers)
 	{
 		if (header_filename == filename)
 		{
-			code = header_code;
-			return true;
+			return header_code;
 		}
 	}
 
@@ -88,25 +441,77 @@ bool ShaderIncluder::loadFromFile(const std::string &filename, std::string &code
 		}
 	}
 
-	std::ifstream file(folder / *final_filename);
-	if (!file)
+	auto full_path = folder / *final_filename;
+	auto start_time = std::chrono::steady_clock::now();
+	unsigned misses = cache.getStats().misses;
+	auto entry = cache.load(full_path);
+	if (!entry)
 	{
-		return false;
+		return nullptr;
+	}
+	if (timings)
+	{
+		ShaderTimings::Event event;
+		event.phase = ShaderTimings::Phase::Load;
+		event.file = filename;
+		event.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+		event.bytes = entry->source.size();
+		event.cached = cache.getStats().misses == misses;
+		timings->add(std::move(event));
+	}
+	if (path)
+	{
+		*path = std::move(full_path);
 	}
 
-	code = readFromFile(file);
+	// how long the rewrite took, and how many new variables it found
+	auto addParseEvent = [&](std::chrono::steady_clock::time_point parse_start, size_t variable_count)
+	{
+		if (timings)
+		{
+			ShaderTimings::Event event;
+			event.phase = ShaderTimings::Phase::Parse;
+			event.file = filename;
+			event.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - parse_start).count();
+			event.bytes = entry->source.size();
+			event.variables = static_cast<unsigned>(var_manager->getVariables().size() - variable_count);
+			timings->add(std::move(event));
+		}
+	};
 
-	if (var_manager)
+	if (!rewrite)
 	{
-		std::string new_code;
-		var_manager->parseFile(code, new_code);
-		code.swap(new_code);
+		return std::shared_ptr<const std::string>(entry, &entry->source);
+	}
 
-		std::string header = var_manager->generateHeader();
-		setExtraHeaders({ { "user_variables.hlsl", header } });
+	// the combined pass also collects the variables, and baked code depends on the values
+	// so both have to run every time
+	if (pass == ShaderPass::CombinedPass || var_manager->isBaked())
+	{
+		start_time = std::chrono::steady_clock::now();
+		size_t variable_count = var_manager->getVariables().size();
+		auto code = std::make_shared<std::string>();
+		var_manager->parseFile(entry->source, *code);
+		addParseEvent(start_time, variable_count);
+
+		if (pass == ShaderPass::CombinedPass)
+		{
+			std::string header = var_manager->generateHeader();
+			setExtraHeaders({ { "user_variables.hlsl", header } });
+		}
+		return code;
 	}
 
-	return true;
+	// the rewrite only depends on the file, so it is done once per content
+	if (!entry->has_rewritten)
+	{
+		start_time = std::chrono::steady_clock::now();
+		size_t variable_count = var_manager->getVariables().size();
+		var_manager->parseFile(entry->source, entry->rewritten);
+		entry->has_rewritten = true;
+		addParseEvent(start_time, variable_count);
+	}
+	return std::shared_ptr<const std::string>(entry, &entry->rewritten);
 }
 
 void ShaderVariableManager::setSlot(unsigned slot)
@@ -119,80 +524,80 @@ void ShaderVariableManager::setPass(ShaderPass pass)
 	this->pass = pass;
 }
 
-bool ShaderVariableManager::parseFile(const std::string &input, std::string &output)
+void ShaderVariableManager::setBaked(bool baked)
+{
+	this->baked = baked;
+}
+
+bool ShaderVariableManager::isBaked() const
 {
-	auto var_tag = getVarTag();
-	auto [code_blocks, variable_blocks] = splitString(input, var_tag, ")");
+	return baked;
+}
+
+void ShaderVariableManager::setInitialValues(VariableValues values)
+{
+	initial_values.swap(values);
+}
+
+void ShaderVariableManager::applyInitialValues()
+{
+	applyVariableValues(variables, initial_values);
+}
 
+bool ShaderVariableManager::parseFile(const std::string &input, std::string &output)
+{
 	output.clear();
 	output.reserve(input.size());
-	for (auto code_iter = code_blocks.begin(), variable_iter = variable_blocks.begin(); variable_iter != variable_blocks.end(); ++code_iter, ++variable_iter)
-	{
-		// extract the name
-		auto bracket_begin = variable_iter->find("(");
-		auto bracket_end = variable_iter->find(")");
 
-		auto var_name = variable_iter->substr(0, bracket_begin);
-		auto var_name_short = variable_iter->substr(var_tag.size(), bracket_begin - var_tag.size());
-		auto param_string = variable_iter->substr(bracket_begin + 1, bracket_end - bracket_begin - 1);
+	VariableTokenizer tokenizer(input);
+	VariableTokenizer::Tag tag;
+	size_t copied = 0;
+	while (tokenizer.next(tag))
+	{
+		auto iter = variables.find(tag.name);
 
-		if (pass == ShaderPass::CombinedPass || pass == ShaderPass::GeneratePass)
+		// in the generate pass the scanner already found the variables
+		if (pass == ShaderPass::CombinedPass)
 		{
-			output += *code_iter;
-			output += var_name;
+			Variable var;
+			if (!tokenizer.parse(tag, var))
+			{
+				break;
+			}
+			if (auto value = initial_values.find(tag.name); value != initial_values.end())
+			{
+				var.value = value->second;
+			}
+			if (iter == variables.end())
+			{
+				iter = variables.emplace(tag.name, var).first;
+			}
+			else
+			{
+				iter->second = var;
+			}
 		}
-		else
+
+		output.append(input, copied, tag.begin - copied);
+		if (baked && iter != variables.end())
 		{
-			// just create a dummy variable
-			output += *code_iter;
-			output += "0.f";
+			output += formatLiteral(iter->second.value);
 		}
-
-		if (pass == ShaderPass::CombinedPass || pass == ShaderPass::CollectPass)
+		else
 		{
-
-			// build the param map
-			auto [params, _] = splitString(param_string, ",");
-			std::map<std::string, float> param_map;
-			for (const auto &param : params)
-			{
-				auto [parts, separators] = splitString(param, "=");
-				if (parts.size() != 2)
-				{
-					if (separators.size() == 1)
-					{
-						return false;
-					}
-					break;
-				}
-
-				auto name_str = removeSpaces(parts[0]);
-				auto val_str = removeSpaces(parts[1]);
-				param_map[std::string(name_str)] = std::stof(std::string(val_str));
-			}
-
-			// add the variable
-			Variable var;
-			auto iter = param_map.find("min");
-			var.minval = iter != param_map.end() ? iter->second : 0.f;
-			iter = param_map.find("max");
-			var.maxval = iter != param_map.end() ? iter->second : 2.f;
-			iter = param_map.find("start");
-			var.start = iter != param_map.end() ? iter->second : (var.maxval + var.minval) * 0.5f;
-			iter = param_map.find("step");
-			var.step = iter != param_map.end() ? iter->second : (var.maxval - var.minval) * 0.05f;
-			var.value = var.start;
-
-			variables[std::string(var_name_short)] = var;
+			output += getVarTag();
+			output += tag.name;
 		}
+		copied = tag.end;
 	}
-	output += code_blocks.back();
-	return true;
+	output.append(input, copied);
+	return !tokenizer.failed();
 }
 
 std::string ShaderVariableManager::generateHeader() const
 {
-	if (variables.empty() || pass == ShaderPass::CollectPass)
+	// baked variables are literals, no buffer needed
+	if (variables.empty() || baked)
 	{
 		return {};
 	}
@@ -236,14 +641,23 @@ void ShaderVariableManager::setValue(std::string_view name, float val)
 	if (auto iter = variables.find(name); iter != variables.end())
 	{
 		iter->second.value = val;
-	}	
+		if (cbuffer)
+		{
+			values.set(iter->second.slot, val);
+		}
+	}
+}
+
+VariableBuffer &ShaderVariableManager::getValues()
+{
+	return values;
 }
 
 bool ShaderVariableManager::createConstantBuffer(ID3D11Device *dev)
 {
-	size_t byte_size = sizeof(float) * static_cast<unsigned>(variables.size());
+	values.layout(variables);
 	D3D11_BUFFER_DESC cbuffer_desc = { 0 };
-	cbuffer_desc.ByteWidth = (byte_size + 15) & ~15;
+	cbuffer_desc.ByteWidth = values.getByteSize();
 	cbuffer_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 	cbuffer_desc.Usage = D3D11_USAGE_DYNAMIC;
 	cbuffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
@@ -256,13 +670,18 @@ bool ShaderVariableManager::createConstantBuffer(ID3D11Device *dev)
 
 void ShaderVariableManager::updateBuffer(ID3D11DeviceContext *ctx)
 {
+	// a dynamic buffer keeps its content, so nothing to do if no slider moved
+	if (!values.isDirty())
+	{
+		return;
+	}
+
 	D3D11_MAPPED_SUBRESOURCE res;
-	ctx->Map(cbuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &res);
-	float *ptr = static_cast<float *>(res.pData);
-	for (const auto &[name, var] : variables)
+	if (FAILED(ctx->Map(cbuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &res)))
 	{
-		*ptr++ = var.value;
+		return;
 	}
+	values.upload(res.pData);
 	ctx->Unmap(cbuffer, 0);
 }
 
@@ -273,96 +692,207 @@ ID3D11Buffer *ShaderVariableManager::getBuffer()
 
 std::string_view ShaderVariableManager::getVarTag()
 {
-	return "VAR_";
+	return VariableTokenizer::getVarTag();
 }
 
-Comptr<ID3DBlob> compileShader(ShaderIncluder &includer, const std::string &filename, const std::string &profile, const std::string &entry, bool display_warnings, bool disassemble)
+std::string ShaderVariableManager::formatLiteral(float value)
 {
-	Comptr<ID3DBlob> compiled, error;
-	if (includer.hasVarManager()) // go for 2 pass mode
+	// the shortest text which gives the same float back
+	char buffer[32];
+	auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+	std::string literal(buffer, end);
+	if (literal.find_first_of(".e") == std::string::npos)
 	{
-		includer.setPass(ShaderPass::CollectPass);
-		bool file_ok = compileShaderPass(includer, filename, profile, entry, D3DCOMPILE_OPTIMIZATION_LEVEL0, compiled, error);
-		if (!file_ok)
-		{
-			return {}; // if the initial file loading fails, nothing else to do
-		}
+		literal += ".0";
+	}
+	// brackets, so a negative value is safe after any operator
+	return "(" + literal + "f)";
+}
 
-		if (!compiled) // we need code to proceed here, so this is an error and we abort
-		{
-			if (error)
-			{
-				ErrorBox(static_cast<const char *>(error->GetBufferPointer()));
-			}
-			return {};
-		}
+ShaderBuild::ShaderBuild(ShaderIncluder &includer) : includer(includer), backend(includer.getCompilerBackend()), cache(includer.getBlobCache())
+{
+	includer.setTimings(&timings);
+}
 
-		// reset the buffer
-		compiled = nullptr;
-		error = nullptr;
+ShaderBuild::~ShaderBuild()
+{
+	if (includer.getTimings() == &timings)
+	{
+		includer.setTimings(nullptr);
+	}
+}
+
+unsigned ShaderBuild::add(const std::string &filename, const std::string &profile, const std::string &entry)
+{
+	ShaderCompileArgs args;
+	args.filename = filename;
+	args.profile = profile;
+	args.entry = entry;
+	args.flags =
+#ifdef _DEBUG
+		D3DCOMPILE_DEBUG |
+#endif
+		D3DCOMPILE_OPTIMIZATION_LEVEL3;
+	timings.setShader(filename + " " + entry);
 
-		// setup the next pass
-		includer.setPass(ShaderPass::GeneratePass);
+	// find the variables and features first, so the header exists before the compiler includes it
+	static const Profiler::ScopeId scan_scope = Profiler::intern("scan");
+	std::string scan_error;
+	bool scanned;
+	{
+		Profiler::Scope profile(profiler, scan_scope);
+		scanned = includer.scanShader(filename, scan_error);
 	}
-	else // single pass
+	if (!scanned)
 	{
-		includer.setPass(ShaderPass::CombinedPass);
+		includer.setExtraHeaders({});
+		keys.push_back(0);
+		blobs.emplace_back();
+		return batch.addDone(args, { {}, scan_error }, false);
+	}
+	includer.setPass(includer.hasVarManager() ? ShaderPass::GeneratePass : ShaderPass::CombinedPass);
+	args.defines = includer.getDefines();
+
+	// the same sources with the same defines give the same code
+	uint64_t key = includer.getPermutationKey(profile, entry);
+	keys.push_back(key);
+	blobs.push_back(includer.findPermutation(key));
+	if (blobs.back())
+	{
+		includer.setExtraHeaders({});
+		return batch.addDone(args, {}, true);
 	}
 
-	bool file_ok = compileShaderPass(includer, filename, profile, entry, D3DCOMPILE_OPTIMIZATION_LEVEL3, compiled, error);
-	if (!file_ok)
+	std::string code;
+	if (!includer.loadFromFile(filename, code))
 	{
-		return {}; // if the initial file loading fails, nothing else to do
+		includer.setExtraHeaders({});
+		return batch.addDone(args, { {}, Format() << "Could not load file \"" << filename << "\"" }, false);
 	}
 
-	if (error)
+	// entry points of one file share the preprocessing
+	unsigned job = batch.add(backend, code, args, includer.getSourceKey());
+	auto &timing = batch.getTiming(job);
+	ShaderTimings::Event event;
+	event.phase = ShaderTimings::Phase::Preprocess;
+	event.file = filename;
+	event.time = timing.preprocess;
+	event.bytes = timing.preprocessed_bytes;
+	event.cached = timing.shared;
+	timings.add(std::move(event));
+
+	// remove headers again
+	includer.setExtraHeaders({});
+	return job;
+}
+
+void ShaderBuild::setProfiler(Profiler *profiler)
+{
+	this->profiler = profiler;
+	batch.setProfiler(profiler);
+}
+
+void ShaderBuild::run(unsigned thread_count)
+{
+	batch.run(backend, cache, thread_count);
+
+	for (unsigned job = 0; job < batch.size(); ++job)
+	{
+		auto &args = batch.getArgs(job);
+		auto &timing = batch.getTiming(job);
+		if (blobs[job] || timing.preprocessed_bytes == 0)
+		{
+			continue; // nothing was compiled
+		}
+		ShaderTimings::Event event;
+		event.phase = ShaderTimings::Phase::Compile;
+		event.shader = args.filename + " " + args.entry;
+		event.file = args.filename;
+		event.time = timing.compile;
+		event.bytes = batch.getResult(job).compiled.size();
+		event.thread = timing.thread;
+		event.cached = timing.cached;
+		timings.add(std::move(event));
+	}
+}
+
+Comptr<ID3DBlob> ShaderBuild::finish(unsigned job, bool display_warnings, bool disassemble)
+{
+	// found in memory, or finished before
+	if (blobs[job])
+	{
+		return Comptr<ID3DBlob>(blobs[job]);
+	}
+
+	auto &result = batch.getResult(job);
+	Comptr<ID3DBlob> compiled;
+	if (!result.compiled.empty() && SUCCEEDED(D3DCreateBlob(result.compiled.size(), &compiled)))
+	{
+		std::memcpy(compiled->GetBufferPointer(), result.compiled.data(), result.compiled.size());
+	}
+
+	if (!result.messages.empty())
 	{
 		if (!compiled) // no code, thus an error
 		{
-			ErrorBox(static_cast<const char *>(error->GetBufferPointer()));
+			includer.reportMessage(result.messages, true);
 		}
 		else if (display_warnings) // its a warning, since we got the code
 		{
-			WarningBox(static_cast<const char *>(error->GetBufferPointer()));
+			includer.reportMessage(result.messages, false);
 		}
 	}
 
-	// remove headers again
-	includer.setExtraHeaders({});
+	if (compiled)
+	{
+		includer.addPermutation(keys[job], compiled);
+		blobs[job] = Comptr<ID3DBlob>(compiled);
+	}
 
 	if (disassemble && compiled)
 	{
+		auto start_time = std::chrono::steady_clock::now();
 		UINT disasm_flags = 0;
 		Comptr<ID3DBlob> disassembled;
 		D3DDisassemble(compiled->GetBufferPointer(), compiled->GetBufferSize(), disasm_flags, nullptr, &disassembled);
 		if (disassembled)
 		{
-			std::string output_filename = changeFileExtension(filename, "asm");
+			std::string output_filename = changeFileExtension(batch.getArgs(job).filename, "asm");
 			std::ofstream out_file(output_filename, std::ios::out);
 			out_file.write(static_cast<const char *>(disassembled->GetBufferPointer()), disassembled->GetBufferSize() - 1);
 		}
+
+		ShaderTimings::Event event;
+		event.phase = ShaderTimings::Phase::Disassemble;
+		event.shader = batch.getArgs(job).filename + " " + batch.getArgs(job).entry;
+		event.file = batch.getArgs(job).filename;
+		event.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+		event.bytes = disassembled ? disassembled->GetBufferSize() : 0;
+		timings.add(std::move(event));
 	}
 
 	return compiled;
 }
 
-bool compileShaderPass(ShaderIncluder &includer, const std::string &filename, const std::string &profile, const std::string &entry, unsigned extra_flags, Comptr<ID3DBlob> &compiled, Comptr<ID3DBlob> &error)
+ShaderIncluder &ShaderBuild::getIncluder()
 {
-	std::string code;
-	// first load the file
-	if (!includer.loadFromFile(filename, code))
-	{
-		ErrorBox(Format() << "Could not load file \"" << filename << "\"");
-		return false;
-	}
+	return includer;
+}
 
-	// then try to compile it
-	UINT flags =
-#ifdef _DEBUG
-		D3DCOMPILE_DEBUG |
-#endif
-		extra_flags;
+const ShaderBatch &ShaderBuild::getBatch() const
+{
+	return batch;
+}
 
-	D3DCompile(code.c_str(), code.length(), filename.c_str(), nullptr, &includer, entry.c_str(), profile.c_str(), flags, 0, &compiled, &error);
-	return true;
+const ShaderTimings &ShaderBuild::getTimings() const
+{
+	return timings;
+}
+
+Comptr<ID3DBlob> compileShader(ShaderIncluder &includer, const std::string &filename, const std::string &profile, const std::string &entry, bool display_warnings, bool disassemble)
+{
+	ShaderBuild build(includer);
+	unsigned job = build.add(filename, profile, entry);
+	build.run(1);
+	return build.finish(job, display_warnings, disassemble);
 }
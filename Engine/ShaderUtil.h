@@ -1,7 +1,15 @@
 #pragma once
 
 #include "Comptr.h"
+#include "IncludeCache.h"
+#include "IncludeGraph.h"
+#include "ShaderBatch.h"
+#include "ShaderCompiler.h"
+#include "ShaderPreprocessor.h"
+#include "ShaderTimings.h"
 #include "ShaderVariable.h"
+#include "VariableBuffer.h"
+#include "VariablePreset.h"
 
 #include <d3dcommon.h>
 #include <d3d11.h>
@@ -9,22 +17,41 @@
 #include <string_view>
 #include <vector>
 #include <map>
+#include <set>
+#include <memory>
 #include <filesystem>
+#include <functional>
+#include <cstdint>
 
 enum class ShaderPass
 {
-	CombinedPass,
-	CollectPass,
-	GeneratePass
+	CombinedPass, // collects the variables while loading
+	GeneratePass // the variables are known, just rewrites them
 };
 
 class ShaderVariableManager;
+class ShaderIncluder;
+class ShaderCache;
+
+// compiles with d3dcompiler. preprocess resolves the includes through the includer
+class D3DCompilerBackend : public ShaderCompilerBackend
+{
+public:
+	explicit D3DCompilerBackend(ShaderIncluder *includer);
+
+	bool preprocess(const std::string &code, const ShaderCompileArgs &args, std::string &preprocessed, std::string &messages) override;
+	bool compile(const std::string &preprocessed, const ShaderCompileArgs &args, std::string &compiled, std::string &messages) override;
+private:
+	ShaderIncluder *includer;
+};
 
 class ShaderIncluder : public ID3DInclude
 {
 public:
 	using Substitution = std::pair<std::string, std::string>;
 	using MemoryHeader = std::pair<std::string, std::string>;
+	// gets the errors and warnings of compileShader
+	using MessageHandler = std::function<void(const std::string &message, bool error)>;
 
 	void setFolder(std::string_view folder);
 	void setSubstitutions(std::vector<Substitution> substitutions);
@@ -32,18 +59,104 @@ public:
 	void setShaderVariableManager(ShaderVariableManager *var_manager);
 	void setPass(ShaderPass);
 	bool hasVarManager() const;
+	// macros given to the compiler, e.g. for features turned on in the ui
+	void setDefines(std::set<std::string> defines);
+	// identifiers with this prefix in the included files turn on FEATURE_<identifier>
+	// e.g. a scene using MATERIAL_WOOD gets FEATURE_MATERIAL_WOOD. empty = off
+	void setFeaturePrefix(std::string prefix);
+	// the defines of the last scan, the ones set plus the detected features
+	const std::set<std::string> &getDefines() const;
 
 	HRESULT STDMETHODCALLTYPE Open(D3D_INCLUDE_TYPE IncludeType, LPCSTR pFileName, LPCVOID pParentData, LPCVOID *ppData, UINT *pBytes) override;
 	HRESULT STDMETHODCALLTYPE Close(LPCVOID pData) override;
 
 	// in this class so we bundle all the file handling at one place
 	bool loadFromFile(const std::string &filename, std::string &code);
+	// walks filename and its includes without compiling it. finds the variables,
+	// the features and the include graph, and the key of the permutation
+	bool scanShader(const std::string &filename, std::string &error);
+
+	// compiled shaders, by the sources, defines and values they were made of
+	// a key of the last scan, for this profile and entry
+	uint64_t getPermutationKey(const std::string &profile, const std::string &entry) const;
+	// stands for everything the last scan read, the same key gives the same preprocessed code
+	uint64_t getSourceKey() const;
+	Comptr<ID3DBlob> findPermutation(uint64_t key);
+	void addPermutation(uint64_t key, Comptr<ID3DBlob> &compiled);
+	// the next build compiles everything again, e.g. to measure it
+	void clearPermutations();
+
+	// gets an event for every file loaded or parsed and every scan, nullptr = off
+	void setTimings(ShaderTimings *timings);
+	ShaderTimings *getTimings() const;
+
+	// resolves the includes and macros with ShaderPreprocessor instead of D3DPreprocess
+	// the files are loaded the same way, and kept expanded between builds
+	void setBuiltinPreprocessor(bool enable);
+	bool usesBuiltinPreprocessor() const;
+	// code is the file filename, error is set on failure
+	bool preprocess(const std::string &filename, const std::string &code, const std::set<std::string> &defines, std::string &preprocessed, std::string &error);
+	const ShaderPreprocessor &getPreprocessor() const;
+
+	// the compiler to use, nullptr = d3d
+	void setCompilerBackend(ShaderCompilerBackend *backend);
+	ShaderCompilerBackend &getCompilerBackend();
+	// keeps the compiled shaders on disk, nullptr = off
+	void setBlobCache(ShaderCache *cache);
+	ShaderCache *getBlobCache() const;
+
+	// without a handler the messages pop up in a message box
+	void setMessageHandler(MessageHandler handler);
+	void reportMessage(const std::string &message, bool error);
+
+	// how often the files came from memory, since the last reset
+	const IncludeCache::Stats &getCacheStats() const;
+	void resetCacheStats();
+
+	// the files of every shader compiled since the last clear
+	const IncludeGraph &getIncludeGraph() const;
+	void clearIncludeGraph();
 private:
+	struct Permutation
+	{
+		Comptr<ID3DBlob> compiled;
+		uint64_t last_use;
+	};
+
+	// the file as it is on disk, or the preloaded header
+	bool loadSource(const std::string &filename, std::string &code);
+	// shared, so Open can hand it to the compiler without a copy. path is where it came from
+	std::shared_ptr<const std::string> loadText(const std::string &filename, bool rewrite, std::filesystem::path *path = nullptr);
+
 	std::filesystem::path folder;
 	std::vector<Substitution> substitutions;
-	std::vector<MemoryHeader> headers;
+	std::vector<std::pair<std::string, std::shared_ptr<const std::string>>> headers;
 
 	ShaderVariableManager *var_manager = nullptr;
+	ShaderPass pass = ShaderPass::CombinedPass;
+
+	D3DCompilerBackend d3d_backend{ this };
+	ShaderCompilerBackend *backend = nullptr;
+	ShaderCache *blob_cache = nullptr;
+	MessageHandler message_handler;
+	ShaderTimings *timings = nullptr;
+
+	std::set<std::string> defines;
+	std::string feature_prefix;
+	std::set<std::string> active_defines;
+
+	IncludeCache cache;
+	IncludeGraph include_graph;
+	ShaderPreprocessor preprocessor{ [this](const std::string &filename, std::string &code) { return loadFromFile(filename, code); } };
+	bool builtin_preprocessor = false;
+	// what the compiler currently has open, keyed by the pointer it got
+	std::multimap<const void *, std::shared_ptr<const std::string>> open_files;
+
+	// every edit of a file makes a new key, so only the recently used ones are kept
+	static constexpr size_t max_permutations = 32;
+	uint64_t scan_hash = 0;
+	uint64_t use_counter = 0;
+	std::map<uint64_t, Permutation> permutations;
 };
 
 class ShaderVariableManager
@@ -52,6 +165,13 @@ public:
 	// sets the slot of the corresponding constant buffer
 	void setSlot(unsigned slot);
 	void setPass(ShaderPass);
+	// replaces the variables by their current values as literals, so the compiler can fold them
+	// there is no constant buffer then, changing a value needs a new compile
+	void setBaked(bool baked);
+	bool isBaked() const;
+	// the values the variables get after they were found, instead of their start values
+	void setInitialValues(VariableValues values);
+	void applyInitialValues();
 	// parses the input shader, replaces all variable encounters
 	// and also creates the variable entries
 	bool parseFile(const std::string &input, std::string &output);
@@ -60,19 +180,60 @@ public:
 	bool hasVariables() const;
 	VariableMap &getVariables();
 	void setValue(std::string_view name, float val);
+	// the values as they go to the gpu, by the slot of each variable
+	VariableBuffer &getValues();
 
+	// lays out the values and creates the buffer for them
 	bool createConstantBuffer(ID3D11Device *dev);
+	// only uploads when a value changed since the last time
 	void updateBuffer(ID3D11DeviceContext *ctx);
 	ID3D11Buffer *getBuffer();
 private:
 	static std::string_view getVarTag();
+	static std::string formatLiteral(float value);
 
 	VariableMap variables;
+	VariableValues initial_values;
 	unsigned slot;
 	ShaderPass pass = ShaderPass::CombinedPass;
+	bool baked = false;
 
+	VariableBuffer values;
 	Comptr<ID3D11Buffer> cbuffer;
 };
 
+// the shaders of a reload, compiled together on several threads
+// add and finish use the includer, run only the backend and the blob cache. so the includer
+// is free again while run works on another thread
+class ShaderBuild
+{
+public:
+	explicit ShaderBuild(ShaderIncluder &includer);
+	~ShaderBuild();
+
+	// scans and preprocesses the shader with the current settings of the includer
+	// errors show up in finish, like the ones of the compile
+	unsigned add(const std::string &filename, const std::string &profile, const std::string &entry);
+	void run(unsigned thread_count = 0);
+	// scopes for the scans, the preprocessing and the compiles. nullptr to stop
+	void setProfiler(Profiler *profiler);
+	// the compiled shader, nullptr if it failed. reports the messages, once per job
+	Comptr<ID3DBlob> finish(unsigned job, bool display_warnings = true, bool disassemble = false);
+
+	ShaderIncluder &getIncluder();
+	// the timing of each job
+	const ShaderBatch &getBatch() const;
+	// every phase of every shader, from loading the files to the disassembly
+	const ShaderTimings &getTimings() const;
+private:
+	ShaderIncluder &includer;
+	ShaderCompilerBackend &backend;
+	ShaderCache *cache;
+	ShaderBatch batch;
+	std::vector<uint64_t> keys; // of the permutation, per job
+	std::vector<Comptr<ID3DBlob>> blobs; // the ones found in memory, and the finished ones
+	ShaderTimings timings;
+	Profiler *profiler = nullptr;
+};
+
 Comptr<ID3DBlob> compileShader(ShaderIncluder &includer, const std::string &filename, const std::string &profile, const std::string &entry, bool display_warnings = true, bool disassemble = false);
-bool compileShaderPass(ShaderIncluder &includer, const std::string &filename, const std::string &profile, const std::string &entry, unsigned extra_flags, Comptr<ID3DBlob> &compiled, Comptr<ID3DBlob> &error);
@@ -7,6 +7,7 @@ struct Variable
 {
 	float minval, maxval, start, step;
 	float value; // the current value
+	unsigned slot = 0; // where the value is in the VariableBuffer
 };
 
 using VariableMap = std::map<std::string, Variable, std::less<>>;
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include "TileScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace
+{
+	// interleaves the bits of x and y
+	unsigned mortonCode(unsigned x, unsigned y)
+	{
+		auto spread = [](unsigned v)
+		{
+			v &= 0xffff;
+			v = (v | (v << 8)) & 0x00ff00ff;
+			v = (v | (v << 4)) & 0x0f0f0f0f;
+			v = (v | (v << 2)) & 0x33333333;
+			v = (v | (v << 1)) & 0x55555555;
+			return v;
+		};
+		return spread(x) | (spread(y) << 1);
+	}
+
+	// the tiles of one worker. the owner takes from the front, thieves from the back
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<unsigned> tiles;
+
+		std::optional<unsigned> pop()
+		{
+			std::lock_guard lock(mutex);
+			if (tiles.empty())
+			{
+				return std::nullopt;
+			}
+			unsigned tile = tiles.front();
+			tiles.pop_front();
+			return tile;
+		}
+
+		std::optional<unsigned> steal()
+		{
+			std::lock_guard lock(mutex);
+			if (tiles.empty())
+			{
+				return std::nullopt;
+			}
+			unsigned tile = tiles.back();
+			tiles.pop_back();
+			return tile;
+		}
+	};
+}
+
+std::vector<TileScheduler::Tile> TileScheduler::makeTiles(unsigned width, unsigned height, unsigned tile_size, Order order)
+{
+	tile_size = std::max(tile_size, 1u);
+	unsigned tiles_x = (width + tile_size - 1) / tile_size;
+	unsigned tiles_y = (height + tile_size - 1) / tile_size;
+
+	struct SortTile
+	{
+		Tile tile;
+		double key;
+	};
+	std::vector<SortTile> sort_tiles;
+	sort_tiles.reserve(static_cast<size_t>(tiles_x) * tiles_y);
+	for (unsigned ty = 0; ty < tiles_y; ++ty)
+	{
+		for (unsigned tx = 0; tx < tiles_x; ++tx)
+		{
+			Tile tile;
+			tile.x = tx * tile_size;
+			tile.y = ty * tile_size;
+			tile.width = std::min(tile_size, width - tile.x);
+			tile.height = std::min(tile_size, height - tile.y);
+
+			double key = 0.0;
+			if (order == Order::Morton)
+			{
+				key = mortonCode(tx, ty);
+			}
+			else if (order == Order::CenterOut)
+			{
+				double dx = tile.x + tile.width * 0.5 - width * 0.5;
+				double dy = tile.y + tile.height * 0.5 - height * 0.5;
+				key = dx * dx + dy * dy;
+			}
+			sort_tiles.push_back({ tile, key });
+		}
+	}
+
+	// stable, so equal keys stay in scanline order
+	std::stable_sort(sort_tiles.begin(), sort_tiles.end(), [](const SortTile &a, const SortTile &b)
+	{
+		return a.key < b.key;
+	});
+
+	std::vector<Tile> tiles;
+	tiles.reserve(sort_tiles.size());
+	for (auto &sort_tile : sort_tiles)
+	{
+		tiles.push_back(sort_tile.tile);
+	}
+	return tiles;
+}
+
+void TileScheduler::run(const std::vector<Tile> &tiles, unsigned thread_count, const std::function<void(const Tile &, unsigned)> &func)
+{
+	this->thread_count = thread_count ? thread_count : std::max(std::thread::hardware_concurrency(), 1u);
+	timings.assign(tiles.size(), {});
+
+	// deal the tiles out round robin, so every worker starts with the front of the order
+	std::vector<WorkQueue> queues(this->thread_count);
+	for (unsigned i = 0; i < tiles.size(); ++i)
+	{
+		queues[i % this->thread_count].tiles.push_back(i);
+	}
+
+	auto worker = [&](unsigned thread_index)
+	{
+		for (;;)
+		{
+			bool stolen = false;
+			std::optional<unsigned> index = queues[thread_index].pop();
+			for (unsigned k = 1; !index && k < this->thread_count; ++k)
+			{
+				index = queues[(thread_index + k) % this->thread_count].steal();
+				stolen = true;
+			}
+			// no work was left anywhere. nothing gets added while running, so we are done
+			if (!index)
+			{
+				break;
+			}
+
+			auto start_time = std::chrono::steady_clock::now();
+			func(tiles[*index], thread_index);
+
+			TileTiming &timing = timings[*index];
+			timing.tile = tiles[*index];
+			timing.thread = thread_index;
+			timing.stolen = stolen;
+			timing.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned i = 1; i < this->thread_count; ++i)
+	{
+		threads.emplace_back(worker, i);
+	}
+	worker(0);
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+}
+
+unsigned TileScheduler::getThreadCount() const
+{
+	return thread_count;
+}
+
+const std::vector<TileScheduler::TileTiming> &TileScheduler::getTimings() const
+{
+	return timings;
+}
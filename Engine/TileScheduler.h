@@ -0,0 +1,46 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+// splits a frame into screen tiles and renders them on a work-stealing thread pool
+// the cost per pixel varies a lot (sky vs. refractions), so a static split would leave threads idle
+class TileScheduler
+{
+public:
+	enum class Order
+	{
+		Scanline, // row by row
+		Morton, // z-order curve, keeps neighboring tiles close in time
+		CenterOut // closest to the screen center first
+	};
+
+	struct Tile
+	{
+		unsigned x, y;
+		unsigned width, height;
+	};
+
+	struct TileTiming
+	{
+		Tile tile;
+		unsigned thread; // which worker rendered the tile
+		bool stolen; // if the tile was taken from another worker's queue
+		double time; // in seconds
+	};
+
+	// splits width x height into tiles of tile_size (smaller at the edges), sorted by order
+	static std::vector<Tile> makeTiles(unsigned width, unsigned height, unsigned tile_size, Order order);
+
+	// runs func(tile, thread index) for every tile on thread_count threads (0 = one per core)
+	// the tiles are dealt out to the workers in order, idle workers steal from the back of the others
+	void run(const std::vector<Tile> &tiles, unsigned thread_count, const std::function<void(const Tile &, unsigned)> &func);
+
+	// how many threads the last run used
+	unsigned getThreadCount() const;
+	// one entry per tile of the last run, in the order of the tiles
+	const std::vector<TileTiming> &getTimings() const;
+private:
+	unsigned thread_count = 0;
+	std::vector<TileTiming> timings;
+};
@@ -1,5 +1,8 @@
 #include "Util.h"
+#ifdef _WIN32
 #include <Windows.h>
+#endif
+#include <cstdio>
 
 std::string_view removeSpaces(std::string_view input)
 {
@@ -58,14 +61,23 @@ std::string readFromFile(std::ifstream &file)
 	return ret;
 }
 
+// the tools without a window print them instead
 void ErrorBox(const std::string &msg)
 {
+#ifdef _WIN32
 	MessageBoxA(0, msg.c_str(), "Error", MB_ICONERROR);
+#else
+	fprintf(stderr, "Error: %s\n", msg.c_str());
+#endif
 }
 
 void WarningBox(const std::string &msg)
 {
+#ifdef _WIN32
 	MessageBoxA(0, msg.c_str(), "Warning", MB_ICONWARNING);
+#else
+	fprintf(stderr, "Warning: %s\n", msg.c_str());
+#endif
 }
 
 std::string mergeViews(std::string_view str1, std::string_view str2)
@@ -96,4 +108,32 @@ std::string changeFileExtension(std::string_view filename, std::string_view new_
 
 	// in all other cases we can safely replace the part after the dot
 	return mergeViews(filename.substr(0, index_dot + 1), new_extension);
-}
\ No newline at end of file
+}
+
+std::string quoteJson(std::string_view text)
+{
+	std::string quoted = "\"";
+	for (char c : text)
+	{
+		switch (c)
+		{
+		case '"': quoted += "\\\""; break;
+		case '\\': quoted += "\\\\"; break;
+		case '\n': quoted += "\\n"; break;
+		case '\r': quoted += "\\r"; break;
+		case '\t': quoted += "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char buffer[8];
+				snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+				quoted += buffer;
+			}
+			else
+			{
+				quoted += c;
+			}
+		}
+	}
+	return quoted + "\"";
+}
@@ -65,4 +65,6 @@ std::pair<std::vector<std::string_view>, std::vector<std::string_view>> splitStr
 std::string readFromFile(std::ifstream &file);
 void ErrorBox(const std::string &msg);
 void WarningBox(const std::string &msg);
-std::string changeFileExtension(std::string_view filename, std::string_view new_extension);
\ No newline at end of file
+std::string changeFileExtension(std::string_view filename, std::string_view new_extension);
+// text as a json string, with the quotes
+std::string quoteJson(std::string_view text);
\ No newline at end of file
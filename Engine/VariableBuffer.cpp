@@ -0,0 +1,61 @@
+#include "VariableBuffer.h"
+
+#include <cstring>
+
+void VariableBuffer::layout(VariableMap &variables)
+{
+	slot_count = static_cast<unsigned>(variables.size());
+	registers.assign((slot_count + 3) / 4, Register{});
+
+	unsigned slot = 0;
+	for (auto &[name, var] : variables)
+	{
+		var.slot = slot++;
+		registers[var.slot / 4].values[var.slot % 4] = var.value;
+	}
+	dirty = true;
+}
+
+unsigned VariableBuffer::size() const
+{
+	return slot_count;
+}
+
+unsigned VariableBuffer::getByteSize() const
+{
+	return static_cast<unsigned>(registers.size() * sizeof(Register));
+}
+
+const float *VariableBuffer::data() const
+{
+	return reinterpret_cast<const float *>(registers.data());
+}
+
+float VariableBuffer::get(unsigned slot) const
+{
+	return registers[slot / 4].values[slot % 4];
+}
+
+void VariableBuffer::set(unsigned slot, float value)
+{
+	float &current = registers[slot / 4].values[slot % 4];
+	if (current != value)
+	{
+		current = value;
+		dirty = true;
+	}
+}
+
+bool VariableBuffer::isDirty() const
+{
+	return dirty;
+}
+
+void VariableBuffer::upload(void *dest)
+{
+	if (!registers.empty())
+	{
+		std::memcpy(dest, registers.data(), getByteSize());
+	}
+	dirty = false;
+}
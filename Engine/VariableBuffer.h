@@ -0,0 +1,39 @@
+#pragma once
+
+#include "ShaderVariable.h"
+
+#include <vector>
+
+// the values of the user variables, laid out like their constant buffer
+// each variable has a slot, its index in a flat float array. hlsl packs the floats of the
+// cbuffer four to a register, so the array is padded to whole 16 byte registers
+// the dirty bit tells if it has to be uploaded again
+class VariableBuffer
+{
+public:
+	// gives every variable its slot, in the order of the map like the cbuffer declaration
+	// takes the current values, and is dirty afterwards
+	void layout(VariableMap &variables);
+
+	unsigned size() const;
+	// a multiple of 16
+	unsigned getByteSize() const;
+	const float *data() const;
+
+	float get(unsigned slot) const;
+	// only makes it dirty if the value changed
+	void set(unsigned slot, float value);
+
+	bool isDirty() const;
+	// copies getByteSize bytes to dest and clears the dirty bit
+	void upload(void *dest);
+private:
+	struct alignas(16) Register
+	{
+		float values[4];
+	};
+
+	std::vector<Register> registers;
+	unsigned slot_count = 0;
+	bool dirty = false;
+};
@@ -52,9 +52,9 @@ void VariableManager::resetVariables()
 	var_maps.clear();
 }
 
-void VariableManager::setVariables(std::string_view name, VariableMap *var_map)
+void VariableManager::setVariables(std::string_view name, VariableMap *var_map, VariableBuffer *values)
 {
-	var_maps[std::string(name)] = var_map;
+	var_maps[std::string(name)] = { var_map, values };
 }
 
 void VariableManager::createControls()
@@ -69,9 +69,9 @@ void VariableManager::createControls()
 	controls.clear();
 
 	size_t count = 0;
-	for (auto &[name, map] : var_maps)
+	for (auto &[name, set] : var_maps)
 	{
-		count += map->size();
+		count += set.variables->size();
 	}
 
 	unsigned height_per_element = 40;
@@ -89,9 +89,9 @@ void VariableManager::createControls()
 
 	unsigned y = 0;
 	// create new controls
-	for (auto &[scene_name, var_map] : var_maps)
+	for (auto &[scene_name, set] : var_maps)
 	{
-		for (auto &[var_name, var] : *var_map)
+		for (auto &[var_name, var] : *set.variables)
 		{
 			std::string name = std::string(scene_name) + "." + var_name;
 
@@ -103,6 +103,7 @@ void VariableManager::createControls()
 			slider.hSlider = CW(TRACKBAR_CLASS, "", TBS_HORZ, 220, y + 10, 200, 25);
 			slider.hValue = CW("EDIT", "", WS_BORDER, 430, y + 10, 100, 25);
 			slider.var = &var;
+			slider.values = set.values;
 
 			int steps = slider.valueToSlider(var.maxval);
 			SendMessage(slider.hSlider, TBM_SETRANGE, FALSE, MAKELONG(0, steps));
@@ -155,6 +156,10 @@ LRESULT CALLBACK VariableManager::WndProc(HWND hWnd, UINT Msg, WPARAM wParam, LP
 						}
 
 						control.var->value = control.sliderToValue(pos);
+						if (control.values)
+						{
+							control.values->set(control.var->slot, control.var->value);
+						}
 						control.setEditBoxToValue();
 						break;
 					}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ShaderVariable.h"
+#include "VariableBuffer.h"
 
 #include <Windows.h>
 #include <string>
@@ -14,13 +15,15 @@ public:
 	bool Open();
 
 	void resetVariables();
-	void setVariables(std::string_view name, VariableMap *var_map);
+	// the sliders write into values through the slot of each variable, nullptr = no buffer
+	void setVariables(std::string_view name, VariableMap *var_map, VariableBuffer *values = nullptr);
 	void createControls();
 private:
 	struct Slider
 	{
 		HWND hLabel, hSlider, hValue;
 		Variable *var;
+		VariableBuffer *values;
 
 		int valueToSlider(float value) const;
 		float sliderToValue(int slider) const;
@@ -38,8 +41,14 @@ private:
 	HINSTANCE hInstance;
 	HWND hWnd = 0;
 
+	struct VariableSet
+	{
+		VariableMap *variables;
+		VariableBuffer *values;
+	};
+
 	std::vector<Slider> controls;
-	std::map<std::string, VariableMap *> var_maps;
+	std::map<std::string, VariableSet> var_maps;
 
 	unsigned window_width, window_height;
 	DWORD window_style;
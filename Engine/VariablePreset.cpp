@@ -0,0 +1,90 @@
+#include "VariablePreset.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+VariableValues getVariableValues(const VariableMap &variables)
+{
+	VariableValues values;
+	for (auto &[name, var] : variables)
+	{
+		values[name] = var.value;
+	}
+	return values;
+}
+
+void applyVariableValues(VariableMap &variables, const VariableValues &values)
+{
+	for (auto &[name, value] : values)
+	{
+		if (auto iter = variables.find(name); iter != variables.end())
+		{
+			iter->second.value = value;
+		}
+	}
+}
+
+std::filesystem::path getPresetFilename(const std::filesystem::path &scene_filename)
+{
+	return std::filesystem::path(scene_filename).replace_extension(".preset");
+}
+
+bool loadPreset(const std::filesystem::path &filename, VariableValues &values)
+{
+	std::ifstream file(filename);
+	if (!file)
+	{
+		return false;
+	}
+
+	values.clear();
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.find_first_not_of(" \t\r") == std::string::npos)
+		{
+			continue; // empty lines
+		}
+		auto equal = line.find('=');
+		if (equal == std::string::npos)
+		{
+			return false;
+		}
+
+		auto name_begin = line.find_first_not_of(" \t");
+		auto name_end = line.find_last_not_of(" \t", equal - 1);
+		if (name_begin >= equal || name_end == std::string::npos)
+		{
+			return false;
+		}
+
+		const char *value_str = line.c_str() + equal + 1;
+		char *end;
+		float value = std::strtof(value_str, &end);
+		if (end == value_str)
+		{
+			return false;
+		}
+		values[line.substr(name_begin, name_end - name_begin + 1)] = value;
+	}
+	return true;
+}
+
+bool savePreset(const std::filesystem::path &filename, const VariableValues &values)
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		return false;
+	}
+
+	// enough digits to get the same float back
+	file << std::setprecision(std::numeric_limits<float>::max_digits10);
+	for (auto &[name, value] : values)
+	{
+		file << name << " = " << value << "\n";
+	}
+	return static_cast<bool>(file);
+}
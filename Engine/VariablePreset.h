@@ -0,0 +1,20 @@
+#pragma once
+
+#include "ShaderVariable.h"
+
+#include <filesystem>
+#include <map>
+#include <string>
+
+// the values of the user variables of a scene, by name without the VAR_ tag
+using VariableValues = std::map<std::string, float, std::less<>>;
+
+VariableValues getVariableValues(const VariableMap &variables);
+// sets the values of the variables which are in values, the others keep theirs
+void applyVariableValues(VariableMap &variables, const VariableValues &values);
+
+// a preset is stored next to its scene, sdf_scene_x.hlsl -> sdf_scene_x.preset
+// one "name = value" per line
+std::filesystem::path getPresetFilename(const std::filesystem::path &scene_filename);
+bool loadPreset(const std::filesystem::path &filename, VariableValues &values);
+bool savePreset(const std::filesystem::path &filename, const VariableValues &values);
@@ -0,0 +1,212 @@
+#include "VariableTokenizer.h"
+
+#include <charconv>
+
+namespace
+{
+	bool isIdentifierChar(char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+	}
+
+	bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+	}
+}
+
+VariableTokenizer::VariableTokenizer(std::string_view code) : code(code)
+{
+}
+
+bool VariableTokenizer::next(Tag &tag)
+{
+	auto var_tag = getVarTag();
+	while (!failed() && (pos = code.find(var_tag, pos)) != std::string_view::npos)
+	{
+		size_t begin = pos;
+		pos += var_tag.size();
+		// the end of a longer identifier, like MY_VAR_x
+		if (begin > 0 && isIdentifierChar(code[begin - 1]))
+		{
+			continue;
+		}
+
+		size_t name_end = pos;
+		while (name_end < code.size() && isIdentifierChar(code[name_end]))
+			++name_end;
+		size_t bracket = name_end;
+		while (bracket < code.size() && isSpace(code[bracket]))
+			++bracket;
+		if (name_end == pos || bracket == code.size() || code[bracket] != '(')
+		{
+			pos = name_end;
+			continue;
+		}
+
+		size_t bracket_end = code.find(')', bracket);
+		if (bracket_end == std::string_view::npos)
+		{
+			return fail(begin, "missing )");
+		}
+
+		tag.name = code.substr(pos, name_end - pos);
+		tag.params = code.substr(bracket + 1, bracket_end - bracket - 1);
+		tag.begin = begin;
+		tag.end = bracket_end + 1;
+		pos = tag.end;
+		return true;
+	}
+	pos = code.size();
+	return false;
+}
+
+bool VariableTokenizer::parse(const Tag &tag, Variable &var)
+{
+	size_t offset;
+	std::string_view message;
+	if (!parseParams(tag.params, var, offset, message))
+	{
+		return fail(static_cast<size_t>(tag.params.data() - code.data()) + offset, message);
+	}
+	return true;
+}
+
+bool VariableTokenizer::failed() const
+{
+	return !error_message.empty();
+}
+
+size_t VariableTokenizer::getErrorOffset() const
+{
+	return error_offset;
+}
+
+std::string_view VariableTokenizer::getErrorMessage() const
+{
+	return error_message;
+}
+
+std::string VariableTokenizer::getError() const
+{
+	auto [line, column] = getPosition(code, error_offset);
+	return std::to_string(line) + "," + std::to_string(column) + ": " + std::string(error_message);
+}
+
+bool VariableTokenizer::parseParams(std::string_view params, Variable &var, size_t &error_offset, std::string_view &error_message)
+{
+	size_t pos = 0;
+	auto skipSpace = [&]()
+	{
+		while (pos < params.size() && isSpace(params[pos]))
+			++pos;
+	};
+	auto fail = [&](std::string_view message)
+	{
+		error_offset = pos;
+		error_message = message;
+		return false;
+	};
+
+	float minval = 0.f, maxval = 2.f, start = 0.f, step = 0.f;
+	bool has_start = false, has_step = false;
+	for (skipSpace(); pos < params.size(); skipSpace())
+	{
+		size_t name_begin = pos;
+		while (pos < params.size() && isIdentifierChar(params[pos]))
+			++pos;
+		if (pos == name_begin)
+		{
+			return fail("expected a parameter name");
+		}
+		auto name = params.substr(name_begin, pos - name_begin);
+
+		skipSpace();
+		if (pos == params.size() || params[pos] != '=')
+		{
+			return fail("expected =");
+		}
+		++pos;
+		skipSpace();
+
+		// from_chars does not take a plus sign
+		size_t number_begin = pos;
+		if (pos + 1 < params.size() && params[pos] == '+' && params[pos + 1] != '-')
+		{
+			++pos;
+		}
+		float value;
+		auto [end, ec] = std::from_chars(params.data() + pos, params.data() + params.size(), value);
+		if (ec != std::errc())
+		{
+			pos = number_begin;
+			return fail(ec == std::errc::result_out_of_range ? "number out of range" : "expected a number");
+		}
+		pos = static_cast<size_t>(end - params.data());
+
+		if (name == "min")
+		{
+			minval = value;
+		}
+		else if (name == "max")
+		{
+			maxval = value;
+		}
+		else if (name == "start")
+		{
+			start = value;
+			has_start = true;
+		}
+		else if (name == "step")
+		{
+			step = value;
+			has_step = true;
+		}
+
+		// a comma at the end is fine
+		skipSpace();
+		if (pos < params.size() && params[pos] != ',')
+		{
+			return fail("expected , between the parameters");
+		}
+		++pos;
+	}
+
+	var.minval = minval;
+	var.maxval = maxval;
+	var.start = has_start ? start : (maxval + minval) * 0.5f;
+	var.step = has_step ? step : (maxval - minval) * 0.05f;
+	var.value = var.start;
+	return true;
+}
+
+std::pair<unsigned, unsigned> VariableTokenizer::getPosition(std::string_view code, size_t offset)
+{
+	unsigned line = 1, column = 1;
+	for (size_t i = 0; i < offset && i < code.size(); ++i)
+	{
+		if (code[i] == '\n')
+		{
+			++line;
+			column = 1;
+		}
+		else
+		{
+			++column;
+		}
+	}
+	return { line, column };
+}
+
+std::string_view VariableTokenizer::getVarTag()
+{
+	return "VAR_";
+}
+
+bool VariableTokenizer::fail(size_t offset, std::string_view message)
+{
+	error_offset = offset;
+	error_message = message;
+	pos = code.size();
+	return false;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "ShaderVariable.h"
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+// reads the VAR_name(min = 0, max = 1, start = 0.5, step = 0.1) tags of shader code
+// one pass over the text, the numbers are read with from_chars. nothing is allocated,
+// only the error text is made when it is asked for
+class VariableTokenizer
+{
+public:
+	struct Tag
+	{
+		std::string_view name; // without the VAR_ tag
+		std::string_view params; // between the brackets
+		size_t begin = 0, end = 0; // of the whole tag in the code, end is behind the bracket
+	};
+
+	explicit VariableTokenizer(std::string_view code);
+
+	// the next tag, false at the end of the code or on an error
+	// a VAR_name without brackets is a use of the variable, not a tag
+	bool next(Tag &tag);
+	// the parameters of a tag. unknown names are ignored, the missing ones get their default
+	bool parse(const Tag &tag, Variable &var);
+
+	bool failed() const;
+	// where it went wrong, in the code
+	size_t getErrorOffset() const;
+	std::string_view getErrorMessage() const;
+	// "line,column: message"
+	std::string getError() const;
+
+	// parses a parameter list on its own. on an error, error_offset is relative to params
+	static bool parseParams(std::string_view params, Variable &var, size_t &error_offset, std::string_view &error_message);
+	// the line and column of offset, both counted from 1
+	static std::pair<unsigned, unsigned> getPosition(std::string_view code, size_t offset);
+	static std::string_view getVarTag();
+private:
+	bool fail(size_t offset, std::string_view message);
+
+	std::string_view code;
+	size_t pos = 0;
+	size_t error_offset = 0;
+	std::string_view error_message;
+};
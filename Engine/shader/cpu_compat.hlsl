@@ -0,0 +1,11 @@
+#ifndef CPU_COMPAT_HLSL
+#define CPU_COMPAT_HLSL
+
+// the few spots where the shader libraries need different syntax
+// to also compile as C++ (see HLSL.h, which defines these first)
+
+#ifndef INOUT
+#define INOUT(type) inout type
+#endif
+
+#endif
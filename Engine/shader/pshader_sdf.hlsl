@@ -2,6 +2,7 @@
 #include "sdf_structs.hlsl"
 #include "noise.hlsl"
 #include "math_constants.hlsl"
+#include "sdf_constants.hlsl"
 
 struct ps_input
 {
@@ -28,11 +29,6 @@ cbuffer camera : register(b0)
 // pull in the user constants
 #include "user_variables.hlsl"
 
-static const float dist_eps = 0.0001f;    // how close to the object before terminating
-static const float grad_eps = 0.0001f;    // how far to move when computing the gradient
-static const float reflect_eps = 0.001f;  // how far to move the ray along after a reflection
-static const float refract_eps = 0.001f;  // how far to move the ray along after a refraction
-static const float shadow_eps = 0.0003f;   // how far to step along the light ray when looking for occluders
 static const float max_dist_check = 1e30; // maximum practical number
 
 static const float3 lighting_dir = normalize(float3(-0.5f, -1.f, 1.75f));
@@ -50,39 +46,12 @@ struct Ray
 	uint depth;
 };
 
-#define SCENE_HIT 0          // we did hit something
-#define SCENE_RANGE_LIMIT 1  // we terminated because we run out of range
-#define SCENE_ITER_LIMIT 2   // we terminated because we run out of iterations
-
-// must be bigger than bounce count
-#define INVALID_DEPTH 1000000
-
-#define BOUNCE_COUNT 16
-#define RAY_COUNT 8
-#define ITER_COUNT 100
-#define LIGHT_COUNT 8
-#define RANGE 100.f
-
-// numbers are somewhat arbitrary
-#define MATERIAL_NONE 0            // no material. just use the diffuse color with lighting. default case
-#define MATERIAL_PLAIN 1           // just use the diffuse color without lighting
-#define MATERIAL_ITER 2            // shows the iteration count as a heat map
-#define MATERIAL_NORMAL1 3         // show the normal vector color coded
-#define MATERIAL_NORMAL2 4         // show the normal vector abs color coded
-#define MATERIAL_DISTANCE_PLANE 5  // the distance plane
-#define MATERIAL_WOOD 20           // wood. uses the material_position
-#define MATERIAL_MARBLE_DARK 21    // dark marble. uses the material_position
-#define MATERIAL_MARBLE_LIGHT 22   // light marble. uses the material position
-#define MATERIAL_FIRE 23           // a flame effect. uses the material position
-
-// makros for convenience
-#define OBJECT(distance) output_scene_distance = min(output_scene_distance, distance)
-#define OBJECT_TRANSPARENT(distance, distance_transparent) output_scene_distance = ((march.has_transparent && distance_transparent < dist_eps) ? output_scene_distance : min(output_scene_distance, distance))
-#define MATERIAL(distance) (abs(distance) < dist_eps)
-
 // the actual scene now
 #include "sdf_scene.hlsl"
 
+// the debug plane shows the distance field on a cut through the scene
+// it costs a second map() per material lookup, so it only exists when the ui turns it on
+#ifdef FEATURE_DEBUG_PLANE
 float3 get_debug_plane_point()
 {
 	float debug_plane_point_x = VAR_debug_x(min = -10, max = +10, step = 0.02);
@@ -160,6 +129,25 @@ void map_material(GeometryInput geometry, MaterialInput material_input, inout Ma
 		map(geometry, march, material_input, material_output, false, output_scene_distance);
 	}
 }
+#else
+float map_geometry(GeometryInput geometry, MarchingInput march)
+{
+	float output_scene_distance = 3e38;
+
+	MaterialInput material_input = (MaterialInput)0;
+	MaterialOutput material_output = (MaterialOutput)0;
+
+	map(geometry, march, material_input, material_output, true, output_scene_distance);
+	return output_scene_distance;
+}
+
+void map_material(GeometryInput geometry, MaterialInput material_input, inout MaterialOutput material_output)
+{
+	float output_scene_distance = 3e38;
+	MarchingInput march = (MarchingInput)0;
+	map(geometry, march, material_input, material_output, false, output_scene_distance);
+}
+#endif
 
 float3 grad(GeometryInput geometry, MarchingInput march, float baseline, float sample_distance)
 {
@@ -426,58 +414,75 @@ void ps_main(ps_input input, out ps_output output)
 				float3 color = float3(0.f, 0.f, 0.f);
 
 				bool use_light = true;
-				// handle material
-				if (material_output.material_id == MATERIAL_ITER)
+				// handle material. only the ones the scene uses are compiled in, see FEATURE_MATERIAL_* in sdf_constants.hlsl
+				switch (material_output.material_id)
 				{
+#ifdef FEATURE_MATERIAL_ITER
+				case MATERIAL_ITER:
 					color += iter_count_to_color(iter_count, ITER_COUNT - 1);
 					use_light = false;
 					hdr_output = 0.f;
-				}
-				else if (material_output.material_id == MATERIAL_PLAIN)
-				{
+					break;
+#endif
+#ifdef FEATURE_MATERIAL_PLAIN
+				case MATERIAL_PLAIN:
 					color += diffuse_color;
 					use_light = false;
-				}
-				else if (material_output.material_id == MATERIAL_NORMAL1)
-				{
-					float3 normal_color = max(0.01f, new_normal);
-					normal_color = normal_color / max(max(normal_color.r, normal_color.g), normal_color.b);
-					color += normal_color;
-					use_light = false;
-					hdr_output = 0.f;
-				}
-				else if (material_output.material_id == MATERIAL_NORMAL2)
-				{
-					float3 normal_color = abs(new_normal);
-					color += normal_color;
+					break;
+#endif
+#ifdef FEATURE_MATERIAL_NORMAL1
+				case MATERIAL_NORMAL1:
+					{
+						float3 normal_color = max(0.01f, new_normal);
+						normal_color = normal_color / max(max(normal_color.r, normal_color.g), normal_color.b);
+						color += normal_color;
+						use_light = false;
+						hdr_output = 0.f;
+					}
+					break;
+#endif
+#ifdef FEATURE_MATERIAL_NORMAL2
+				case MATERIAL_NORMAL2:
+					color += abs(new_normal);
 					use_light = false;
 					hdr_output = 0.f;
-				}
-				else if (material_output.material_id == MATERIAL_DISTANCE_PLANE)
-				{
+					break;
+#endif
+#ifdef FEATURE_DEBUG_PLANE
+				case MATERIAL_DISTANCE_PLANE:
 					color += debug_plane_color(material_output.material_properties.x);
 					use_light = false;
 					hdr_output = 0.f;
-				}
-				else if (material_output.material_id == MATERIAL_WOOD)
-				{
+					break;
+#endif
+#ifdef FEATURE_MATERIAL_WOOD
+				case MATERIAL_WOOD:
 					diffuse_color += wood(material_output.material_position.xyz);
-				}
-				else if (material_output.material_id == MATERIAL_MARBLE_DARK)
-				{
+					break;
+#endif
+#ifdef FEATURE_MATERIAL_MARBLE_DARK
+				case MATERIAL_MARBLE_DARK:
 					diffuse_color += marble(material_output.material_position.xyz, float3(0.556f, 0.478f, 0.541f));
-				}
-				else if (material_output.material_id == MATERIAL_MARBLE_LIGHT)
-				{
+					break;
+#endif
+#ifdef FEATURE_MATERIAL_MARBLE_LIGHT
+				case MATERIAL_MARBLE_LIGHT:
 					diffuse_color += marble(material_output.material_position.xyz, float3(0.7f, 0.7f, 0.7f));
-				}
-				else if (material_output.material_id == MATERIAL_FIRE)
-				{
-					float fadeout = saturate(dot(-geometry_input.dir.xyz, new_normal));
-					float4 fire_color = fire(material_output.material_position.xyz, 1.f - fadeout);
-					color += fire_color.rgb;
-					material_output.diffuse_color.a = saturate(fire_color.a);
-					material_output.diffuse_color.rgb = float3(1.f, 1.f, 1.f);
+					break;
+#endif
+#ifdef FEATURE_MATERIAL_FIRE
+				case MATERIAL_FIRE:
+					{
+						float fadeout = saturate(dot(-geometry_input.dir.xyz, new_normal));
+						float4 fire_color = fire(material_output.material_position.xyz, 1.f - fadeout);
+						color += fire_color.rgb;
+						material_output.diffuse_color.a = saturate(fire_color.a);
+						material_output.diffuse_color.rgb = float3(1.f, 1.f, 1.f);
+					}
+					break;
+#endif
+				default:
+					break;
 				}
 
 				// handle transparent material
@@ -1,6 +1,8 @@
 #ifndef SDF_COMMON_HLSL
 #define SDF_COMMON_HLSL
 
+#include "cpu_compat.hlsl"
+
 float3 HUEtoRGB(float H)
 {
 	float R = abs(H * 6 - 3) - 1;
@@ -59,7 +61,7 @@ float3 total_tile_color(float3 pos, float3 dir, float3 offset_right, float3 offs
 	return color.rgb;
 }
 
-void map_groundplane(GeometryInput geometry, inout MaterialOutput material_output, bool geometry_step, inout float output_scene_distance)
+void map_groundplane(GeometryInput geometry, INOUT(MaterialOutput) material_output, bool geometry_step, INOUT(float) output_scene_distance)
 {
 	float floor1 = sdPlaneFast(geometry.pos, geometry.dir, float3(0.f, 1.f, 0.f));
 
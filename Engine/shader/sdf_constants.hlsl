@@ -0,0 +1,44 @@
+#ifndef SDF_CONSTANTS_HLSL
+#define SDF_CONSTANTS_HLSL
+
+// shared between pshader_sdf.hlsl and the CPU renderer
+
+static const float dist_eps = 0.0001f;    // how close to the object before terminating
+static const float grad_eps = 0.0001f;    // how far to move when computing the gradient
+static const float reflect_eps = 0.001f;  // how far to move the ray along after a reflection
+static const float refract_eps = 0.001f;  // how far to move the ray along after a refraction
+static const float shadow_eps = 0.0003f;   // how far to step along the light ray when looking for occluders
+
+#define SCENE_HIT 0          // we did hit something
+#define SCENE_RANGE_LIMIT 1  // we terminated because we run out of range
+#define SCENE_ITER_LIMIT 2   // we terminated because we run out of iterations
+
+// must be bigger than bounce count
+#define INVALID_DEPTH 1000000
+
+#define BOUNCE_COUNT 16
+#define RAY_COUNT 8
+#define ITER_COUNT 100
+#define LIGHT_COUNT 8
+#define RANGE 100.f
+
+// numbers are somewhat arbitrary
+// the shading of a material is only compiled in when the scene names it, e.g. using MATERIAL_WOOD
+// defines FEATURE_MATERIAL_WOOD. so always use the names, never the numbers
+#define MATERIAL_NONE 0            // no material. just use the diffuse color with lighting. default case
+#define MATERIAL_PLAIN 1           // just use the diffuse color without lighting
+#define MATERIAL_ITER 2            // shows the iteration count as a heat map
+#define MATERIAL_NORMAL1 3         // show the normal vector color coded
+#define MATERIAL_NORMAL2 4         // show the normal vector abs color coded
+#define MATERIAL_DISTANCE_PLANE 5  // the distance plane
+#define MATERIAL_WOOD 20           // wood. uses the material_position
+#define MATERIAL_MARBLE_DARK 21    // dark marble. uses the material_position
+#define MATERIAL_MARBLE_LIGHT 22   // light marble. uses the material position
+#define MATERIAL_FIRE 23           // a flame effect. uses the material position
+
+// makros for convenience
+#define OBJECT(distance) output_scene_distance = min(output_scene_distance, distance)
+#define OBJECT_TRANSPARENT(distance, distance_transparent) output_scene_distance = ((march.has_transparent && distance_transparent < dist_eps) ? output_scene_distance : min(output_scene_distance, distance))
+#define MATERIAL(distance) (abs(distance) < dist_eps)
+
+#endif
\ No newline at end of file
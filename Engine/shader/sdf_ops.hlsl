@@ -1,4 +1,8 @@
+#ifndef SDF_OPS_HLSL
+#define SDF_OPS_HLSL
+
 #include "math_constants.hlsl"
+#include "cpu_compat.hlsl"
 
 // replicates a box of space along all axes
 // count: the extra count how many boxes will be added
@@ -42,7 +46,7 @@ float opRepInf(float pos, float size)
 	return x - size * floor(x / size) - size * 0.5f;
 }
 
-float opRepAngle(inout float2 pos, float count)
+float opRepAngle(INOUT(float2) pos, float count)
 {
 	float angle = atan2(pos.y, pos.x);
 
@@ -132,4 +136,6 @@ float smax2(float a, float b, float k)
 {
 	float h = saturate(0.5 - 0.5 * (b - a) / k);
 	return lerp(b, a, h) + k * h * (1.f - h);
-}
\ No newline at end of file
+}
+
+#endif
\ No newline at end of file
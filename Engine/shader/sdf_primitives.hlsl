@@ -1,3 +1,6 @@
+#ifndef SDF_PRIMITIVES_HLSL
+#define SDF_PRIMITIVES_HLSL
+
 #include "math_constants.hlsl"
 
 // this library provides basic primitives for SDFs
@@ -129,4 +132,6 @@ float sdLimit3(float3 pos, float3 dir, float3 lim_val)
 	float3 barrier_pos = barrier_to_use * lim_val - pos;
 	float3 t = barrier_pos / dir;
 	return min(min(t.x, t.y), t.z);
-}
\ No newline at end of file
+}
+
+#endif
\ No newline at end of file
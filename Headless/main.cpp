@@ -0,0 +1,388 @@
+#include "../Engine/Camera.h"
+#include "../Engine/CPURenderer.h"
+#include "../Engine/CPUScene.h"
+#include "../Engine/FrameStats.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdlib>
+
+// renders a scene on the cpu without a window or graphics device
+// usage: Headless [options]
+//  --scene <name>          the scene file stem, default sdf_scene_fast_sphere
+//  --size <width> <height> default 640 360
+//  --threads <count>       default one per core
+//  --tile-size <pixels>    default 32
+//  --tile-order <order>    scanline, morton or center. default scanline
+//  --tile-timings          prints how long each tile took
+//  --cone <size>           block size of the cone pass: 0 (off), 4 or 8. default 8
+//  --simd <mode>           how to march the primary rays: off, auto, scalar, avx2, avx512. default auto
+//  --temporal              warm start the primary rays from the previous frame
+//  --gradient <mode>       how the normals are computed: dual (one evaluation on dual numbers) or diff (finite differences). default dual
+//  --soft-shadows <k>      a penumbra, the bigger k the sharper. default 0 (hard shadows)
+//  --cutoff <weight>       secondary rays of less contribution are not traced. default 0
+//  --roulette <weight>     below it, secondary rays end by russian roulette. default 0 (off)
+//  --time <seconds>        the scene time
+//  --frames <count>        renders an animation, default 1. the statistics are printed per frame
+//  --time-step <seconds>   how far the scene time advances per frame, default 1/60
+//  --eye-step <x> <y> <z>  how far the eye moves per frame, default 0 0 0
+//  --eye <x> <y> <z>       default 0 2 -3
+//  --lookat <x> <y> <z>    default 0 1 0
+//  --output <file>         where to write the hdr image (.pfm), default output.pfm
+//  --trace <file>          writes the profiler scopes of all frames as a chrome trace (.json)
+//  --clock <clock>         what the trace is timed with: chrono or rdtsc. default chrono
+//  --stats <file>          writes the statistics of the frame and tile times (.csv or .json)
+int main(int argc, char *argv[])
+{
+	std::string scene_name = "sdf_scene_fast_sphere";
+	std::string output = "output.pfm";
+	std::string trace;
+	std::string stats_output;
+	bool use_tsc = false;
+	unsigned width = 640, height = 360;
+	unsigned thread_count = 0;
+	unsigned tile_size = 32;
+	TileScheduler::Order tile_order = TileScheduler::Order::Scanline;
+	bool print_tile_timings = false;
+	unsigned cone_block_size = 8;
+	bool packet_marching = true;
+	PacketMarcher::Backend packet_backend = PacketMarcher::Backend::Auto;
+	bool temporal_cache = false;
+	bool dual_gradient = true;
+	float shadow_sharpness = 0.f;
+	float contribution_cutoff = 0.f;
+	float roulette_threshold = 0.f;
+	float stime = 0.f;
+	unsigned frame_count = 1;
+	float time_step = 1.f / 60.f;
+	Math3D::Vector3 eye_step(0.f, 0.f, 0.f);
+	Math3D::Vector3 eye(0.f, 2.f, -3.f);
+	Math3D::Vector3 lookat(0.f, 1.f, 0.f);
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string_view arg = argv[i];
+		auto has_args = [&](int count)
+		{
+			if (i + count >= argc)
+			{
+				std::cerr << "missing value for " << arg << "\n";
+				std::exit(-1);
+			}
+			return true;
+		};
+
+		if (arg == "--scene" && has_args(1))
+		{
+			scene_name = argv[++i];
+		}
+		else if (arg == "--size" && has_args(2))
+		{
+			width = std::stoul(argv[++i]);
+			height = std::stoul(argv[++i]);
+		}
+		else if (arg == "--threads" && has_args(1))
+		{
+			thread_count = std::stoul(argv[++i]);
+		}
+		else if (arg == "--tile-size" && has_args(1))
+		{
+			tile_size = std::stoul(argv[++i]);
+		}
+		else if (arg == "--tile-order" && has_args(1))
+		{
+			std::string_view order = argv[++i];
+			if (order == "scanline")
+				tile_order = TileScheduler::Order::Scanline;
+			else if (order == "morton")
+				tile_order = TileScheduler::Order::Morton;
+			else if (order == "center")
+				tile_order = TileScheduler::Order::CenterOut;
+			else
+			{
+				std::cerr << "unknown tile order " << order << "\n";
+				return -1;
+			}
+		}
+		else if (arg == "--tile-timings")
+		{
+			print_tile_timings = true;
+		}
+		else if (arg == "--cone" && has_args(1))
+		{
+			cone_block_size = std::stoul(argv[++i]);
+		}
+		else if (arg == "--simd" && has_args(1))
+		{
+			std::string_view mode = argv[++i];
+			packet_marching = mode != "off";
+			if (mode == "scalar")
+				packet_backend = PacketMarcher::Backend::Scalar;
+			else if (mode == "avx2")
+				packet_backend = PacketMarcher::Backend::AVX2;
+			else if (mode == "avx512")
+				packet_backend = PacketMarcher::Backend::AVX512;
+			else if (mode != "auto" && mode != "off")
+			{
+				std::cerr << "unknown simd mode " << mode << "\n";
+				return -1;
+			}
+		}
+		else if (arg == "--temporal")
+		{
+			temporal_cache = true;
+		}
+		else if (arg == "--gradient" && has_args(1))
+		{
+			std::string_view mode = argv[++i];
+			dual_gradient = mode == "dual";
+			if (mode != "dual" && mode != "diff")
+			{
+				std::cerr << "unknown gradient mode " << mode << "\n";
+				return -1;
+			}
+		}
+		else if (arg == "--soft-shadows" && has_args(1))
+		{
+			shadow_sharpness = std::stof(argv[++i]);
+		}
+		else if (arg == "--cutoff" && has_args(1))
+		{
+			contribution_cutoff = std::stof(argv[++i]);
+		}
+		else if (arg == "--roulette" && has_args(1))
+		{
+			roulette_threshold = std::stof(argv[++i]);
+		}
+		else if (arg == "--time" && has_args(1))
+		{
+			stime = std::stof(argv[++i]);
+		}
+		else if (arg == "--frames" && has_args(1))
+		{
+			frame_count = std::max(static_cast<unsigned>(std::stoul(argv[++i])), 1u);
+		}
+		else if (arg == "--time-step" && has_args(1))
+		{
+			time_step = std::stof(argv[++i]);
+		}
+		else if (arg == "--eye-step" && has_args(3))
+		{
+			for (unsigned k = 0; k < 3; ++k)
+				eye_step[k] = std::stof(argv[++i]);
+		}
+		else if (arg == "--eye" && has_args(3))
+		{
+			for (unsigned k = 0; k < 3; ++k)
+				eye[k] = std::stof(argv[++i]);
+		}
+		else if (arg == "--lookat" && has_args(3))
+		{
+			for (unsigned k = 0; k < 3; ++k)
+				lookat[k] = std::stof(argv[++i]);
+		}
+		else if (arg == "--output" && has_args(1))
+		{
+			output = argv[++i];
+		}
+		else if (arg == "--trace" && has_args(1))
+		{
+			trace = argv[++i];
+		}
+		else if (arg == "--stats" && has_args(1))
+		{
+			stats_output = argv[++i];
+		}
+		else if (arg == "--clock" && has_args(1))
+		{
+			std::string_view clock = argv[++i];
+			use_tsc = clock == "rdtsc";
+			if (clock != "chrono" && clock != "rdtsc")
+			{
+				std::cerr << "unknown clock " << clock << "\n";
+				return -1;
+			}
+		}
+		else
+		{
+			std::cerr << "unknown argument " << arg << "\n";
+			return -1;
+		}
+	}
+
+	auto scene = createCPUScene(scene_name);
+	if (!scene)
+	{
+		std::cerr << "no cpu version of the scene " << scene_name << "\n";
+		return -1;
+	}
+
+	// same setup as the application
+	Camera camera;
+	camera.SetCameraMode(Camera::CameraMode::FPS);
+	camera.SetAspect(static_cast<float>(width) / height);
+	camera.SetFOVY(Math3D::ToRadian(60.f));
+	camera.SetNearPlane(1.f);
+	camera.SetFarPlane(300.f);
+	camera.SetRoll(0.f);
+
+	CPURenderer renderer;
+	renderer.setScene(scene.get());
+	renderer.setThreadCount(thread_count);
+	renderer.setTiling(tile_size, tile_order);
+	renderer.setConeBlockSize(cone_block_size);
+	renderer.setPacketMarching(packet_marching, packet_backend);
+	renderer.setTemporalCache(temporal_cache);
+	renderer.setDualGradient(dual_gradient);
+	renderer.setSoftShadows(shadow_sharpness);
+	renderer.setContributionCutoff(contribution_cutoff);
+	renderer.setRussianRoulette(roulette_threshold);
+
+	std::unique_ptr<Profiler> profiler;
+	Profiler::Capture capture;
+	if (!trace.empty())
+	{
+		std::unique_ptr<ProfilerClock> clock;
+		if (use_tsc)
+		{
+			clock = std::make_unique<TscClock>();
+		}
+		profiler = std::make_unique<Profiler>(std::move(clock));
+		profiler->setThreadName("main");
+		renderer.setProfiler(profiler.get());
+	}
+
+	// big enough for all the tiles of a short animation
+	FrameStats frame_stats(1 << 14);
+	for (unsigned frame = 0; frame < frame_count; ++frame)
+	{
+		scene->setParameters(stime + frame * time_step);
+		camera.SetEye(eye + eye_step * static_cast<float>(frame));
+		camera.SetLookat(lookat);
+		if (!renderer.render(camera, width, height))
+		{
+			std::cerr << "rendering failed\n";
+			return -1;
+		}
+
+		frame_stats.add("frame", renderer.getStats().render_time);
+		for (auto &timing : renderer.getTileTimings())
+		{
+			frame_stats.add("tile", timing.time);
+		}
+
+		// captured every frame, so the ring buffers only need to hold one
+		if (profiler)
+		{
+			auto frame_capture = profiler->capture();
+			capture.frequency = frame_capture.frequency;
+			capture.clock = frame_capture.clock;
+			for (auto &frame_track : frame_capture.tracks)
+			{
+				auto track = std::ranges::find_if(capture.tracks, [&](auto &entry)
+				{
+					return entry.id == frame_track.id;
+				});
+				if (track == capture.tracks.end())
+				{
+					capture.tracks.push_back(std::move(frame_track));
+					continue;
+				}
+				track->events.insert(track->events.end(), frame_track.events.begin(), frame_track.events.end());
+				track->dropped += frame_track.dropped;
+			}
+		}
+
+		if (frame_count > 1)
+		{
+			auto &stats = renderer.getStats();
+			std::cout << "frame " << frame << ": " << stats.render_time * 1000.0 << " ms, iterations: " << stats.iterations;
+			if (temporal_cache)
+			{
+				uint64_t lookups = stats.temporal_hits + stats.temporal_misses;
+				std::cout << ", temporal hit rate: " << (lookups ? 100.0 * stats.temporal_hits / lookups : 0.0) << "%, iterations saved: " << stats.temporal_iterations_saved;
+			}
+			std::cout << "\n";
+		}
+	}
+
+	// the details of the last frame
+	auto &stats = renderer.getStats();
+	std::cout << "rendered " << width << "x" << height << " in " << stats.render_time * 1000.0 << " ms\n";
+	if (packet_marching)
+	{
+		std::cout << "primary rays marched in packets, backend: " << PacketMarcher::getName(PacketMarcher::resolveBackend(packet_backend)) << "\n";
+	}
+	std::cout << "rays: " << stats.rays << ", iterations: " << stats.iterations << ", map calls: " << stats.map_calls << ", cone iterations: " << stats.cone_iterations <<
+		", rays dropped: " << stats.rays_dropped << ", rays culled: " << stats.rays_culled << "\n";
+
+	// the load balance: how busy each thread was, and the spread of the tile times
+	auto &tile_timings = renderer.getTileTimings();
+	if (!tile_timings.empty())
+	{
+		std::vector<double> busy_time;
+		unsigned stolen_count = 0;
+		double min_time = tile_timings[0].time, max_time = 0.0, total_time = 0.0;
+		for (auto &timing : tile_timings)
+		{
+			if (timing.thread >= busy_time.size())
+			{
+				busy_time.resize(timing.thread + 1);
+			}
+			busy_time[timing.thread] += timing.time;
+			stolen_count += timing.stolen;
+			min_time = std::min(min_time, timing.time);
+			max_time = std::max(max_time, timing.time);
+			total_time += timing.time;
+
+			if (print_tile_timings)
+			{
+				std::cout << "tile " << timing.tile.x << " " << timing.tile.y << " " << timing.tile.width << "x" << timing.tile.height << ": " << timing.time * 1000.0 << " ms, thread " << timing.thread << (timing.stolen ? " (stolen)" : "") << "\n";
+			}
+		}
+		std::cout << "tiles: " << tile_timings.size() << ", stolen: " << stolen_count << ", tile time min/mean/max: " << min_time * 1000.0 << "/" << total_time / tile_timings.size() * 1000.0 << "/" << max_time * 1000.0 << " ms\n";
+		std::cout << "busy time per thread (ms):";
+		for (double time : busy_time)
+		{
+			std::cout << " " << time * 1000.0;
+		}
+		std::cout << "\n";
+	}
+
+	if (!renderer.saveImage(output))
+	{
+		std::cerr << "could not write " << output << "\n";
+		return -1;
+	}
+
+	if (frame_count > 1)
+	{
+		std::cout << frame_stats.report();
+	}
+	if (!stats_output.empty())
+	{
+		bool json = std::filesystem::path(stats_output).extension() == ".json";
+		if (std::ofstream file(stats_output); !file || !(file << (json ? frame_stats.toJson() : frame_stats.toCsv())))
+		{
+			std::cerr << "could not write " << stats_output << "\n";
+			return -1;
+		}
+	}
+
+	if (profiler)
+	{
+		if (std::ofstream file(trace); !file || !(file << Profiler::toChromeTrace(capture)))
+		{
+			std::cerr << "could not write " << trace << "\n";
+			return -1;
+		}
+		std::cout << "trace timed with " << capture.clock << ", " << capture.frequency << " ticks per second\n";
+	}
+	return 0;
+}
@@ -1,10 +1,45 @@
 #include "pch.h"
 #include "CppUnitTest.h"
 #include "../Engine/Util.h"
+#include "../Engine/SDFLibrary.h"
+#include "../Engine/SDFLibraryDual.h"
+#include "../Engine/PacketMarcher.h"
+#include "../Engine/TileScheduler.h"
+#include "../Engine/ShaderScanner.h"
+#include "../Engine/ShaderPreprocessor.h"
+#include "../Engine/VariableTokenizer.h"
+#include "../Engine/IncludeCache.h"
+#include "../Engine/IncludeGraph.h"
+#include "../Engine/FileWatcher.h"
+#include "../Engine/VariablePreset.h"
+#include "../Engine/VariableBuffer.h"
+#include "../Engine/ShaderCompiler.h"
+#include "../Engine/ShaderCache.h"
+#include "../Engine/ShaderBatch.h"
+#include "../Engine/ShaderTimings.h"
+#include "../Engine/Profiler.h"
+#include "../Engine/FrameStats.h"
+#include "../Engine/Math3D.h"
+#include "../Engine/Camera.h"
+#include "../Engine/CPUScene.h"
+#include "../Engine/CPURenderer.h"
+#include "../Engine/RayQueue.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <algorithm>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <type_traits>
 #include <vector>
 #include <cmath>
+#include <cfloat>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -32,36 +67,19 @@ namespace Microsoft::VisualStudio::CppUnitTestFramework
 	}
 }
 
-// minimal class to test the hlsl stuff as well
-class float3
-{
-public:
-	float3(float x, float y, float z) : x(x), y(y), z(z)
-	{
-	}
-	float x, y, z;
-};
-
-float length(const float3 &vec)
-{
-	return sqrtf(vec.x * vec.x + vec.y * vec.y + vec.z * vec.z);
-}
-
-float dot(const float3 &vec1, const float3 &vec2)
-{
-	return vec1.x * vec2.x + vec1.y * vec2.y + vec1.z * vec2.z;
-}
-
 bool close(float f1, float f2)
 {
 	return abs(f1 - f2) < 0.001f;
 }
 
-// assumes dir is already normalized
-float sdSphereFast(float3 pos, float3 dir, float r)
+// what sdSphereFast returns when the ray misses
+static const float sphere_miss = 1e10f;
+
+// the fast sphere as it is meant to work, assumes dir is already normalized
+float sdSphereFastReference(hlsl::float3 pos, hlsl::float3 dir, float r)
 {
-	float b = -dot(pos, dir);
-	float c = dot(pos, pos) - r * r;
+	float b = -hlsl::dot(pos, dir);
+	float c = hlsl::dot(pos, pos) - r * r;
 
 	float discriminant = b * b - c;
 	if (discriminant < 0.f) // no hit
@@ -77,8 +95,83 @@ float sdSphereFast(float3 pos, float3 dir, float r)
 	}
 }
 
+// the camera of Headless, at its default eye and lookat
+void setupCPUCamera(Camera &camera, unsigned width, unsigned height)
+{
+	camera.SetCameraMode(Camera::CameraMode::FPS);
+	camera.SetAspect(static_cast<float>(width) / height);
+	camera.SetFOVY(Math3D::ToRadian(60.f));
+	camera.SetNearPlane(1.f);
+	camera.SetFarPlane(300.f);
+	camera.SetRoll(0.f);
+	camera.SetEye(Math3D::Vector3(0.f, 2.f, -3.f));
+	camera.SetLookat(Math3D::Vector3(0.f, 1.f, 0.f));
+}
+
+// the color of all pixels added up
+hlsl::float3 frameSum(const std::vector<hlsl::float4> &framebuffer)
+{
+	hlsl::float3 sum = hlsl::float3(0.f, 0.f, 0.f);
+	for (auto &pixel : framebuffer)
+	{
+		sum += pixel.xyz;
+	}
+	return sum;
+}
+
+// the same frame to the bit
+bool sameFrame(const std::vector<hlsl::float4> &a, const std::vector<hlsl::float4> &b)
+{
+	return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const hlsl::float4 &p1, const hlsl::float4 &p2)
+	{
+		return p1.x == p2.x && p1.y == p2.y && p1.z == p2.z && p1.w == p2.w;
+	});
+}
+
+// the sums of gems at 48x27 with frameSum, from the renderer which queued the shadow rays like the shader
+// and traced all secondary rays
+static const hlsl::float3 gems_reference_sum = hlsl::float3(278.593f, 396.906f, 478.818f);
+
 namespace UnitTest
 {
+	using hlsl::float2;
+	using hlsl::float3;
+	using hlsl::float4;
+	using hlsl::float3x3;
+	using hlsl::sdSphereFast;
+
+	// "compiles" by copying, so the cache can be tested without a gpu compiler
+	class StubCompilerBackend : public ShaderCompilerBackend
+	{
+	public:
+		// the batch compiles on several threads
+		std::atomic<unsigned> preprocess_count = 0;
+		std::atomic<unsigned> compile_count = 0;
+
+		bool preprocess(const std::string &code, const ShaderCompileArgs &args, std::string &preprocessed, std::string &messages) override
+		{
+			++preprocess_count;
+			preprocessed.clear();
+			for (auto &define : args.defines)
+				preprocessed += "#define " + define + " 1\n";
+			preprocessed += code;
+			return true;
+		}
+
+		bool compile(const std::string &preprocessed, const ShaderCompileArgs &args, std::string &compiled, std::string &messages) override
+		{
+			++compile_count;
+			if (preprocessed.find("error") != std::string::npos)
+			{
+				messages = args.filename + "(1): error";
+				return false;
+			}
+			messages = preprocessed.find("warning") != std::string::npos ? "warning" : "";
+			compiled = args.profile + ":" + preprocessed;
+			return true;
+		}
+	};
+
 	TEST_CLASS(UnitTest)
 	{
 	public:
@@ -183,7 +276,7 @@ namespace UnitTest
 		// normal case, one hit
 		TEST_METHOD(TestFastSphere1)
 		{
-			float distance = sdSphereFast({ -4.f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, 1.f);
+			float distance = sdSphereFastReference({ -4.f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, 1.f);
 			float expected = 3.f;
 			Assert::IsTrue(close(distance, expected));
 		}
@@ -191,7 +284,7 @@ namespace UnitTest
 		// miss it but get the closest point
 		TEST_METHOD(TestFastSphere2)
 		{
-			float distance = sdSphereFast({ -4.f, 2.f, 0.f }, { 1.f, 0.f, 0.f }, 1.f);
+			float distance = sdSphereFastReference({ -4.f, 2.f, 0.f }, { 1.f, 0.f, 0.f }, 1.f);
 			float expected = 4.f;
 			Assert::IsTrue(close(distance, expected));
 		}
@@ -199,7 +292,7 @@ namespace UnitTest
 		// no hit and no closest point, edge case
 		TEST_METHOD(TestFastSphere3)
 		{
-			float distance = sdSphereFast({ 0.f, 2.f, 0.f }, { 1.f, 0.f, 0.f }, 1.f);
+			float distance = sdSphereFastReference({ 0.f, 2.f, 0.f }, { 1.f, 0.f, 0.f }, 1.f);
 			float expected = FLT_MAX;
 			Assert::IsTrue(close(distance, expected));
 		}
@@ -207,7 +300,7 @@ namespace UnitTest
 		// no hit and no closest point, normal case
 		TEST_METHOD(TestFastSphere4)
 		{
-			float distance = sdSphereFast({ 0.f, 2.f, 0.f }, { 1.f, 0.1f, 0.f }, 1.f);
+			float distance = sdSphereFastReference({ 0.f, 2.f, 0.f }, { 1.f, 0.1f, 0.f }, 1.f);
 			float expected = FLT_MAX;
 			Assert::IsTrue(close(distance, expected));
 		}
@@ -215,7 +308,7 @@ namespace UnitTest
 		// inside on one side
 		TEST_METHOD(TestFastSphere5)
 		{
-			float distance = sdSphereFast({ 0.5f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, 1.f);
+			float distance = sdSphereFastReference({ 0.5f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, 1.f);
 			float expected = 0.5f;
 			Assert::IsTrue(close(distance, expected));
 		}
@@ -223,9 +316,1379 @@ namespace UnitTest
 		// inside on the far side
 		TEST_METHOD(TestFastSphere6)
 		{
-			float distance = sdSphereFast({ -0.5f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, 1.f);
+			float distance = sdSphereFastReference({ -0.5f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, 1.f);
 			float expected = 1.5f;
 			Assert::IsTrue(close(distance, expected));
 		}
+
+		// the same cases with the shader library, which does not return the closest point yet
+		// (see the TODO in sdSphereFast)
+		TEST_METHOD(TestFastSphereLibrary1)
+		{
+			float distance = sdSphereFast(float3(-4.f, 0.f, 0.f), float4(1.f, 0.f, 0.f, 1.f), 1.f);
+			float expected = 3.f;
+			Assert::IsTrue(close(distance, expected));
+		}
+
+		TEST_METHOD(TestFastSphereLibrary2)
+		{
+			float distance = sdSphereFast(float3(-4.f, 2.f, 0.f), float4(1.f, 0.f, 0.f, 1.f), 1.f);
+			float expected = sphere_miss;
+			Assert::IsTrue(close(distance, expected));
+		}
+
+		TEST_METHOD(TestFastSphereLibrary3)
+		{
+			float distance = sdSphereFast(float3(0.f, 2.f, 0.f), float4(1.f, 0.f, 0.f, 1.f), 1.f);
+			float expected = sphere_miss;
+			Assert::IsTrue(close(distance, expected));
+		}
+
+		TEST_METHOD(TestFastSphereLibrary4)
+		{
+			float distance = sdSphereFast(float3(0.f, 2.f, 0.f), float4(1.f, 0.1f, 0.f, 1.f), 1.f);
+			float expected = sphere_miss;
+			Assert::IsTrue(close(distance, expected));
+		}
+
+		TEST_METHOD(TestFastSphereLibrary5)
+		{
+			float distance = sdSphereFast(float3(0.5f, 0.f, 0.f), float4(1.f, 0.f, 0.f, 1.f), 1.f);
+			float expected = 0.5f;
+			Assert::IsTrue(close(distance, expected));
+		}
+
+		TEST_METHOD(TestFastSphereLibrary6)
+		{
+			float distance = sdSphereFast(float3(-0.5f, 0.f, 0.f), float4(1.f, 0.f, 0.f, 1.f), 1.f);
+			float expected = 1.5f;
+			Assert::IsTrue(close(distance, expected));
+		}
+
+		// test the hlsl runtime
+		// reading swizzles
+		TEST_METHOD(TestSwizzle1)
+		{
+			float4 vec(1.f, 2.f, 3.f, 4.f);
+			float3 zxy = vec.zxy;
+			float2 ww = vec.ww;
+
+			Assert::AreEqual(3.f, zxy.x);
+			Assert::AreEqual(1.f, zxy.y);
+			Assert::AreEqual(2.f, zxy.z);
+			Assert::AreEqual(4.f, ww.x);
+			Assert::AreEqual(4.f, ww.y);
+		}
+
+		// writing swizzles must only touch the selected components
+		TEST_METHOD(TestSwizzle2)
+		{
+			float3 vec(1.f, 2.f, 3.f);
+			float3 other(4.f, 5.f, 6.f);
+			vec.xz = other.zy;
+			vec.xy += float2(1.f, 1.f);
+
+			Assert::AreEqual(7.f, vec.x);
+			Assert::AreEqual(3.f, vec.y);
+			Assert::AreEqual(5.f, vec.z);
+		}
+
+		// a swizzle as inout parameter is written back, the vectors stay plain data
+		TEST_METHOD(TestSwizzle3)
+		{
+			static_assert(std::is_trivially_copyable_v<float2> && std::is_trivially_copyable_v<float3> && std::is_trivially_copyable_v<float4>);
+
+			float3 vec(0.f, 5.f, 1.f);
+			float index = hlsl::opRepAngle(vec.xz, 4.f);
+			float3 other(7.f, 8.f, 9.f);
+			other.xz = vec.xz;
+
+			Assert::AreEqual(1.f, index);
+			Assert::IsTrue(close(vec.x, 1.f) && close(vec.z, 0.f));
+			Assert::AreEqual(5.f, vec.y);
+			Assert::IsTrue(close(other.x, 1.f) && close(other.z, 0.f));
+			Assert::AreEqual(8.f, other.y);
+		}
+
+		// matrix times column vector and row vector times matrix
+		TEST_METHOD(TestMul)
+		{
+			float3x3 mat(
+				1.f, 2.f, 3.f,
+				4.f, 5.f, 6.f,
+				7.f, 8.f, 9.f);
+			float3 vec(1.f, 0.f, -1.f);
+
+			float3 col = hlsl::mul(mat, vec);
+			float3 row = hlsl::mul(vec, mat);
+
+			Assert::IsTrue(close(col.x, -2.f) && close(col.y, -2.f) && close(col.z, -2.f));
+			Assert::IsTrue(close(row.x, -6.f) && close(row.y, -6.f) && close(row.z, -6.f));
+		}
+
+		// parallel rays against a unit sphere, every backend has to agree with the analytic result
+		TEST_METHOD(TestPacketMarcher)
+		{
+			auto sphere = [](void *user, const unsigned *lanes, const float *pos_x, const float *pos_y, const float *pos_z, const float *camera_distance, float *distance, unsigned count)
+			{
+				for (unsigned i = 0; i < count; ++i)
+				{
+					distance[i] = std::sqrt(pos_x[i] * pos_x[i] + pos_y[i] * pos_y[i] + pos_z[i] * pos_z[i]) - 1.f;
+				}
+			};
+
+			PacketMarcher::Params params = { 100.f, 1.f, 0.0001f, 100, sphere, nullptr };
+			for (auto backend : { PacketMarcher::Backend::Scalar, PacketMarcher::Backend::AVX2, PacketMarcher::Backend::AVX512 })
+			{
+				PacketMarcher::Packet packet;
+				packet.count = PacketMarcher::getWidth(backend);
+				for (unsigned i = 0; i < packet.count; ++i)
+				{
+					packet.pos_x[i] = -1.5f + 3.f * i / packet.count;
+					packet.pos_y[i] = 0.f;
+					packet.pos_z[i] = -3.f;
+					packet.dir_x[i] = 0.f;
+					packet.dir_y[i] = 0.f;
+					packet.dir_z[i] = 1.f;
+					packet.camera_distance[i] = 0.f;
+				}
+				float start_x[PacketMarcher::max_width];
+				std::copy(packet.pos_x, packet.pos_x + packet.count, start_x);
+
+				PacketMarcher::march(backend, packet, params);
+
+				for (unsigned i = 0; i < packet.count; ++i)
+				{
+					bool expected_hit = std::abs(start_x[i]) < 0.99f;
+					Assert::AreEqual(expected_hit, packet.hit[i]);
+					if (expected_hit)
+					{
+						float expected_z = -std::sqrt(1.f - start_x[i] * start_x[i]);
+						Assert::IsTrue(close(packet.pos_z[i], expected_z));
+						Assert::IsTrue(close(packet.camera_distance[i], 3.f + expected_z));
+					}
+				}
+			}
+		}
+
+		// every order has to cover each pixel exactly once
+		TEST_METHOD(TestTileOrder)
+		{
+			const unsigned width = 100, height = 70;
+			for (auto order : { TileScheduler::Order::Scanline, TileScheduler::Order::Morton, TileScheduler::Order::CenterOut })
+			{
+				auto tiles = TileScheduler::makeTiles(width, height, 16, order);
+				Assert::AreEqual(size_t(7 * 5), tiles.size());
+
+				std::vector<int> coverage(width * height);
+				for (auto &tile : tiles)
+				{
+					for (unsigned y = tile.y; y < tile.y + tile.height; ++y)
+						for (unsigned x = tile.x; x < tile.x + tile.width; ++x)
+							++coverage[y * width + x];
+				}
+				Assert::IsTrue(std::all_of(coverage.begin(), coverage.end(), [](int count) { return count == 1; }));
+
+				if (order == TileScheduler::Order::CenterOut)
+				{
+					Assert::AreEqual(48u, tiles[0].x);
+					Assert::AreEqual(32u, tiles[0].y);
+				}
+			}
+		}
+
+		// includes, guards, comments and #ifdef, all without a compiler
+		TEST_METHOD(TestShaderScanner)
+		{
+			std::map<std::string, std::string> files =
+			{
+				{ "main.hlsl",
+					"#include \"lib.hlsl\"\n"
+					"#include \"lib.hlsl\"\n"
+					"// float unused = VAR_commented(min = 1, max = 2);\n"
+					"#ifdef DEBUG_VIEW\n"
+					"float debug = VAR_debug();\n"
+					"#endif\n"
+					"float size = VAR_size(min = -1, max = 3, start = 0.5);\n" },
+				{ "lib.hlsl",
+					"#ifndef LIB_HLSL\n"
+					"#define LIB_HLSL\n"
+					"/* VAR_block(min = 0) */\n"
+					"float speed = VAR_speed(min = 2, max = 4, step = 0.5);\n"
+					"#endif\n" },
+			};
+			unsigned load_count = 0;
+			ShaderScanner scanner([&](const std::string &filename, std::string &code)
+			{
+				++load_count;
+				auto iter = files.find(filename);
+				if (iter == files.end())
+					return false;
+				code = iter->second;
+				return true;
+			});
+
+			VariableMap variables;
+			Assert::IsTrue(scanner.scan("main.hlsl", variables));
+			Assert::AreEqual(size_t(2), variables.size());
+			Assert::AreEqual(size_t(2), scanner.getFiles().size());
+			Assert::AreEqual(3u, load_count);
+
+			auto &size = variables.at("size");
+			Assert::IsTrue(close(size.minval, -1.f) && close(size.maxval, 3.f) && close(size.start, 0.5f) && close(size.step, 0.2f));
+			auto &speed = variables.at("speed");
+			Assert::IsTrue(close(speed.minval, 2.f) && close(speed.maxval, 4.f) && close(speed.start, 3.f) && close(speed.step, 0.5f));
+
+			files["main.hlsl"] = "\n#include \"missing.hlsl\"\n";
+			Assert::IsFalse(scanner.scan("main.hlsl", variables));
+			files["main.hlsl"] = "\n\nfloat x = VAR_x(min = abc);\n";
+			Assert::IsFalse(scanner.scan("main.hlsl", variables));
+			Assert::AreEqual(std::string("main.hlsl(3,23): invalid parameters for VAR_x: expected a number"), scanner.getError());
+		}
+
+		// tags with and without parameters, uses without brackets, and where a broken tag goes wrong
+		TEST_METHOD(TestVariableTokenizer)
+		{
+			std::string_view code =
+				"float a = VAR_size(min = -1, max = +3, start = 0.5,);\n"
+				"float b = VAR_size * MY_VAR_x(1) + VAR_empty ( );\n";
+			VariableTokenizer tokenizer(code);
+			VariableTokenizer::Tag tag;
+			Variable var;
+			Assert::IsTrue(tokenizer.next(tag) && tokenizer.parse(tag, var));
+			Assert::AreEqual(std::string("size"), std::string(tag.name));
+			Assert::AreEqual(std::string("VAR_size(min = -1, max = +3, start = 0.5,)"), std::string(code.substr(tag.begin, tag.end - tag.begin)));
+			Assert::IsTrue(close(var.minval, -1.f) && close(var.maxval, 3.f) && close(var.start, 0.5f) && close(var.step, 0.2f));
+			Assert::IsTrue(tokenizer.next(tag) && tokenizer.parse(tag, var));
+			Assert::AreEqual(std::string("empty"), std::string(tag.name));
+			Assert::IsTrue(close(var.minval, 0.f) && close(var.maxval, 2.f) && close(var.value, 1.f));
+			Assert::IsFalse(tokenizer.next(tag));
+			Assert::IsFalse(tokenizer.failed());
+
+			// the column of the first wrong character
+			std::pair<std::string_view, std::string> errors[] =
+			{
+				{ "\n  VAR_x(min 1)", "2,13: expected =" },
+				{ "VAR_x(min = 1 max = 2)", "1,15: expected , between the parameters" },
+				{ "VAR_x(min = 1e99)", "1,13: number out of range" },
+				{ "VAR_x(= 1)", "1,7: expected a parameter name" },
+				{ "x\nVAR_x(min = 1", "2,1: missing )" },
+			};
+			for (auto &[broken, error] : errors)
+			{
+				VariableTokenizer broken_tokenizer(broken);
+				while (broken_tokenizer.next(tag) && broken_tokenizer.parse(tag, var))
+				{
+				}
+				Assert::IsTrue(broken_tokenizer.failed());
+				Assert::AreEqual(error, broken_tokenizer.getError());
+			}
+		}
+
+		// the permutation of a shader depends on the defines and on the material names the includes use
+		TEST_METHOD(TestShaderFeatures)
+		{
+			std::map<std::string, std::string> files =
+			{
+				{ "main.hlsl",
+					"#include \"scene.hlsl\"\n"
+					"#ifdef FEATURE_DEBUG_PLANE\n"
+					"float plane = VAR_plane();\n"
+					"#endif\n"
+					"uint all = MATERIAL_WOOD + MATERIAL_FIRE;\n" },
+				{ "scene.hlsl",
+					"#include \"constants.hlsl\"\n"
+					"// MATERIAL_FIRE\n"
+					"uint id = MATERIAL_WOOD;\n" },
+				{ "constants.hlsl",
+					"#define MATERIAL_WOOD 20\n"
+					"#define MATERIAL_FIRE 23\n" },
+			};
+			ShaderScanner scanner([&](const std::string &filename, std::string &code)
+			{
+				auto iter = files.find(filename);
+				if (iter == files.end())
+					return false;
+				code = iter->second;
+				return true;
+			});
+			scanner.setTokenPrefix("MATERIAL_");
+
+			VariableMap variables;
+			Assert::IsTrue(scanner.scan("main.hlsl", variables));
+			Assert::AreEqual(size_t(0), variables.size());
+			Assert::AreEqual(size_t(2), scanner.getIncludes().size());
+			Assert::IsTrue(scanner.getIncludes()[1] == std::make_pair(std::string("scene.hlsl"), std::string("constants.hlsl")));
+
+			// comments and #define do not count
+			auto &tokens = scanner.getTokens();
+			Assert::AreEqual(size_t(2), tokens.size());
+			Assert::IsTrue(tokens.at("scene.hlsl") == std::set<std::string>{ "MATERIAL_WOOD" });
+			Assert::AreEqual(size_t(2), tokens.at("main.hlsl").size());
+
+			Assert::IsTrue(scanner.scan("main.hlsl", variables, { "FEATURE_DEBUG_PLANE" }));
+			Assert::AreEqual(size_t(1), variables.count("plane"));
+		}
+
+		// blobs survive a restart, keep their warnings and the least recently used goes first
+		TEST_METHOD(TestShaderCache)
+		{
+			auto folder = std::filesystem::temp_directory_path() / "shader_cache_test";
+			std::filesystem::remove_all(folder);
+
+			StubCompilerBackend backend;
+			ShaderCompileArgs args;
+			args.filename = "test.hlsl";
+			args.profile = "ps_5_0";
+			args.entry = "ps_main";
+			ShaderCompileResult result;
+			{
+				ShaderCache cache;
+				Assert::IsTrue(cache.open(folder));
+				Assert::IsTrue(compileShaderCached(backend, &cache, "float a; // warning", args, result));
+				Assert::IsFalse(result.from_cache);
+				Assert::IsTrue(compileShaderCached(backend, &cache, "float a; // warning", args, result));
+				Assert::IsTrue(result.from_cache);
+				Assert::AreEqual(std::string("warning"), result.messages);
+				Assert::AreEqual(1u, backend.compile_count.load());
+
+				// errors are not cached
+				Assert::IsFalse(compileShaderCached(backend, &cache, "error", args, result));
+				Assert::IsFalse(compileShaderCached(backend, &cache, "error", args, result));
+				Assert::AreEqual(3u, backend.compile_count.load());
+			}
+
+			// a new run finds the blob, a define or another profile is another blob
+			ShaderCache cache;
+			Assert::IsTrue(cache.open(folder));
+			Assert::IsTrue(compileShaderCached(backend, &cache, "float a; // warning", args, result));
+			Assert::IsTrue(result.from_cache);
+			Assert::AreEqual(std::string("ps_5_0:float a; // warning"), result.compiled);
+			args.defines = { "FEATURE_X" };
+			Assert::IsTrue(compileShaderCached(backend, &cache, "float a; // warning", args, result));
+			Assert::IsFalse(result.from_cache);
+			args.defines.clear();
+			args.profile = "cs_5_0";
+			Assert::IsTrue(compileShaderCached(backend, &cache, "float a; // warning", args, result));
+			Assert::IsFalse(result.from_cache);
+
+			// room for two blobs of 100 bytes
+			Assert::IsTrue(cache.open(folder, 250));
+			Assert::IsTrue(cache.store(1, std::string(100, 'a')));
+			Assert::IsTrue(cache.store(2, std::string(100, 'b')));
+			std::string data;
+			Assert::IsTrue(cache.find(1, data));
+			Assert::IsTrue(cache.store(3, std::string(100, 'c')));
+			Assert::IsFalse(cache.find(2, data));
+			Assert::IsTrue(cache.find(1, data) && cache.find(3, data));
+			Assert::AreEqual(std::string(100, 'c'), data);
+
+			// a damaged blob is a miss
+			std::ofstream(folder / "0000000000000003.blob", std::ios::binary | std::ios::trunc) << "x";
+			Assert::IsFalse(cache.find(3, data));
+
+			cache.close();
+			std::filesystem::remove_all(folder);
+		}
+
+		// entry points of one file are preprocessed once, every job is compiled on some thread
+		TEST_METHOD(TestShaderBatch)
+		{
+			StubCompilerBackend backend;
+			ShaderBatch batch;
+			ShaderCompileArgs args;
+			args.filename = "bloom.hlsl";
+			args.profile = "cs_5_0";
+			args.entry = "cs_main1";
+			unsigned first = batch.add(backend, "float a;", args, 1);
+			args.entry = "cs_main2";
+			unsigned second = batch.add(backend, "float a;", args, 1);
+			// other defines give other code
+			args.defines = { "FEATURE_X" };
+			unsigned third = batch.add(backend, "float a;", args, 1);
+			args.defines.clear();
+			args.filename = "broken.hlsl";
+			unsigned broken = batch.add(backend, "error", args, 0);
+			args.filename = "memory.hlsl";
+			unsigned done = batch.addDone(args, {}, true);
+			Assert::AreEqual(3u, backend.preprocess_count.load());
+			Assert::IsFalse(batch.getTiming(first).shared);
+			Assert::IsTrue(batch.getTiming(second).shared);
+			Assert::IsFalse(batch.getTiming(third).shared);
+
+			batch.run(backend, nullptr, 4);
+			Assert::AreEqual(4u, backend.compile_count.load());
+			Assert::AreEqual(size_t(5), batch.size());
+			Assert::IsTrue(batch.succeeded(first) && batch.succeeded(second) && batch.succeeded(third) && batch.succeeded(done));
+			Assert::IsFalse(batch.succeeded(broken));
+			Assert::AreEqual(std::string("broken.hlsl(1): error"), batch.getResult(broken).messages);
+			Assert::AreEqual(std::string("cs_5_0:float a;"), batch.getResult(second).compiled);
+			Assert::AreEqual(std::string("cs_5_0:#define FEATURE_X 1\nfloat a;"), batch.getResult(third).compiled);
+			for (unsigned job = 0; job < batch.size(); ++job)
+			{
+				Assert::IsTrue(batch.getTiming(job).thread < 4);
+			}
+			Assert::IsTrue(batch.getRunTime() >= 0.0);
+		}
+
+		// a file is only read again when it changed on disk, and only counts as new when the content changed
+		TEST_METHOD(TestIncludeCache)
+		{
+			auto path = std::filesystem::temp_directory_path() / "include_cache_test.hlsl";
+			auto write = [&](const char *code, int age)
+			{
+				std::ofstream(path) << code;
+				std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now() - std::chrono::seconds(age));
+			};
+
+			IncludeCache cache;
+			write("float a = 1.f;", 10);
+			auto first = cache.load(path);
+			auto second = cache.load(path);
+			Assert::IsTrue(first && first == second);
+			Assert::AreEqual(1u, cache.getStats().misses);
+			Assert::AreEqual(1u, cache.getStats().hits);
+
+			// touched, same content
+			write("float a = 1.f;", 5);
+			Assert::IsTrue(cache.load(path) == first);
+			Assert::AreEqual(2u, cache.getStats().hits);
+
+			write("float b = 2.f;", 0);
+			auto changed = cache.load(path);
+			Assert::AreEqual(2u, cache.getStats().misses);
+			Assert::AreEqual(std::string("float b = 2.f;"), changed->source);
+			Assert::AreEqual(std::string("float a = 1.f;"), first->source);
+
+			std::filesystem::remove(path);
+			Assert::IsFalse(static_cast<bool>(cache.load(path)));
+		}
+
+		// a change to a shared include has to reach every shader that uses it
+		TEST_METHOD(TestIncludeGraph)
+		{
+			IncludeGraph graph;
+			graph.addRoot("shader/pshader_sdf.hlsl");
+			graph.addRoot("shader/vshader.hlsl");
+			graph.addInclude("shader/pshader_sdf.hlsl", "shader/scenes/scene.hlsl");
+			graph.addInclude("shader/scenes/scene.hlsl", "shader/noise.hlsl");
+			graph.addInclude("shader/noise.hlsl", "shader/scenes/scene.hlsl"); // a cycle, guarded in the files
+
+			Assert::AreEqual(size_t(4), graph.getFiles().size());
+			auto roots = graph.getDependentRoots("shader/scenes/../noise.hlsl");
+			Assert::AreEqual(size_t(1), roots.size());
+			Assert::IsTrue(roots[0] == std::filesystem::path("shader/pshader_sdf.hlsl"));
+			Assert::AreEqual(size_t(1), graph.getDependentRoots("shader/vshader.hlsl").size());
+			Assert::AreEqual(size_t(0), graph.getDependentRoots("shader/other.hlsl").size());
+		}
+
+		// several quick writes are reported once, other files in the folder not at all
+		TEST_METHOD(TestFileWatcher)
+		{
+			auto folder = std::filesystem::temp_directory_path() / "file_watcher_test";
+			std::filesystem::create_directories(folder);
+			auto watched = folder / "watched.hlsl";
+			auto other = folder / "other.hlsl";
+			std::ofstream(watched) << "a";
+
+			std::mutex mutex;
+			std::condition_variable cv;
+			std::vector<std::vector<std::filesystem::path>> reports;
+
+			FileWatcher watcher;
+			watcher.setFiles({ watched });
+			Assert::IsTrue(watcher.start([&](const std::vector<std::filesystem::path> &changed)
+			{
+				std::lock_guard lock(mutex);
+				reports.push_back(changed);
+				cv.notify_one();
+			}, std::chrono::milliseconds(100)));
+
+			std::ofstream(other) << "b";
+			std::ofstream(watched) << "b";
+			std::ofstream(watched) << "c";
+
+			{
+				std::unique_lock lock(mutex);
+				Assert::IsTrue(cv.wait_for(lock, std::chrono::seconds(5), [&] { return !reports.empty(); }));
+			}
+			// give a second report a chance to show up
+			std::this_thread::sleep_for(std::chrono::milliseconds(300));
+			watcher.stop();
+
+			Assert::AreEqual(size_t(1), reports.size());
+			Assert::AreEqual(size_t(1), reports[0].size());
+			Assert::IsTrue(std::filesystem::equivalent(reports[0][0], watched));
+			std::filesystem::remove_all(folder);
+		}
+
+		// the frozen values have to come back exactly, and only for variables that still exist
+		TEST_METHOD(TestVariablePreset)
+		{
+			Assert::IsTrue(getPresetFilename("scenes/sdf_scene_cube.hlsl") == std::filesystem::path("scenes/sdf_scene_cube.preset"));
+
+			auto filename = std::filesystem::temp_directory_path() / "variable_preset_test.preset";
+			VariableValues values = { { "size", 0.1f }, { "levels", 7.f }, { "removed", -1e-7f } };
+			Assert::IsTrue(savePreset(filename, values));
+
+			VariableValues loaded;
+			Assert::IsTrue(loadPreset(filename, loaded));
+			Assert::IsTrue(loaded == values);
+
+			VariableMap variables;
+			variables["size"] = { 0.f, 1.f, 0.5f, 0.05f, 0.5f };
+			variables["levels"] = { 1.f, 10.f, 3.f, 1.f, 3.f };
+			applyVariableValues(variables, loaded);
+			Assert::AreEqual(size_t(2), variables.size());
+			Assert::AreEqual(0.1f, variables["size"].value);
+			Assert::AreEqual(7.f, variables["levels"].value);
+
+			std::ofstream(filename) << "size 0.5\n";
+			Assert::IsFalse(loadPreset(filename, loaded));
+			std::filesystem::remove(filename);
+		}
+		// slots follow the cbuffer order, and only a real change needs an upload
+		TEST_METHOD(TestVariableBuffer)
+		{
+			VariableMap variables;
+			for (int i = 0; i < 5; ++i)
+			{
+				variables["v" + std::to_string(i)] = { 0.f, 10.f, 1.f, 1.f, static_cast<float>(i) };
+			}
+			VariableBuffer values;
+			values.layout(variables);
+			Assert::AreEqual(5u, values.size());
+			Assert::AreEqual(32u, values.getByteSize());
+			Assert::AreEqual(size_t(0), reinterpret_cast<uintptr_t>(values.data()) % 16);
+			Assert::AreEqual(3u, variables["v3"].slot);
+			Assert::AreEqual(3.f, values.get(variables["v3"].slot));
+			Assert::IsTrue(values.isDirty());
+
+			float uploaded[8] = {};
+			values.upload(uploaded);
+			Assert::IsFalse(values.isDirty());
+			Assert::AreEqual(4.f, uploaded[4]);
+			Assert::AreEqual(0.f, uploaded[5]);
+
+			values.set(variables["v4"].slot, 4.f);
+			Assert::IsFalse(values.isDirty());
+			values.set(variables["v4"].slot, 7.f);
+			Assert::IsTrue(values.isDirty());
+			values.upload(uploaded);
+			Assert::AreEqual(7.f, uploaded[4]);
+		}
+
+		// includes, guards, #if expressions and both kinds of macros, and what is expanded again after a change
+		TEST_METHOD(TestShaderPreprocessor)
+		{
+			std::map<std::string, std::string> files =
+			{
+				{ "main.hlsl",
+					"#include \"lib.hlsl\"\n"
+					"#include \"lib.hlsl\"\n"
+					"#define SQUARE(x) ((x) * (x))\n"
+					"#if defined(FEATURE_X) && LIB_VERSION >= 2\n"
+					"float a = SQUARE(LIB_SCALE);\n"
+					"#elif LIB_VERSION == 1\n"
+					"float a = 0;\n"
+					"#else\n"
+					"float a = -1;\n"
+					"#endif\n"
+					"float b = OBJECT(1,\n"
+					"\t2);\n"
+					"float c = NAME(x, y);\n" },
+				{ "lib.hlsl",
+					"#ifndef LIB_HLSL\n"
+					"#define LIB_HLSL\n"
+					"#define LIB_VERSION 2\n"
+					"#define LIB_SCALE 0.5f\n"
+					"#define OBJECT(a, b) min(a, b)\n"
+					"#define NAME(a, b) a ## _ ## b\n"
+					"float lib = 1; /* a comment */\n"
+					"#endif\n" },
+			};
+			ShaderPreprocessor preprocessor([&](const std::string &filename, std::string &code)
+			{
+				auto iter = files.find(filename);
+				if (iter == files.end())
+					return false;
+				code = iter->second;
+				return true;
+			});
+
+			std::string expected =
+				"#line 7 \"lib.hlsl\"\n"
+				"float lib = 1;\n"
+				"#line 5 \"main.hlsl\"\n"
+				"float a = ((0.5f) * (0.5f));\n"
+				"\n\n\n\n\n"
+				"float b = min(1, 2);\n"
+				"\n"
+				"float c = x_y;\n";
+			std::string output;
+			Assert::IsTrue(preprocessor.preprocessFile("main.hlsl", { "FEATURE_X" }, output));
+			Assert::AreEqual(expected, output);
+			Assert::IsTrue(preprocessor.getFiles() == std::vector<std::string>{ "main.hlsl", "lib.hlsl" });
+			Assert::IsTrue(preprocessor.isDefined("SQUARE") && preprocessor.isDefined("LIB_HLSL"));
+			Assert::AreEqual(2u, preprocessor.getStats().parsed);
+			Assert::AreEqual(3u, preprocessor.getStats().expanded);
+
+			// nothing changed, the whole file comes from the cache
+			preprocessor.resetStats();
+			Assert::IsTrue(preprocessor.preprocessFile("main.hlsl", { "FEATURE_X" }, output));
+			Assert::AreEqual(expected, output);
+			Assert::AreEqual(0u, preprocessor.getStats().parsed);
+			Assert::AreEqual(0u, preprocessor.getStats().expanded);
+			Assert::AreEqual(1u, preprocessor.getStats().reused);
+
+			// only main changed, the includes are taken as they were
+			preprocessor.resetStats();
+			files["main.hlsl"] += "float d = LIB_VERSION;\n";
+			Assert::IsTrue(preprocessor.preprocessFile("main.hlsl", { "FEATURE_X" }, output));
+			Assert::AreEqual(expected + "float d = 2;\n", output);
+			Assert::AreEqual(1u, preprocessor.getStats().expanded);
+			Assert::AreEqual(2u, preprocessor.getStats().reused);
+
+			// a changed include is noticed through the file that includes it
+			files["lib.hlsl"].replace(files["lib.hlsl"].find("VERSION 2"), 9, "VERSION 1");
+			Assert::IsTrue(preprocessor.preprocessFile("main.hlsl", { "FEATURE_X" }, output));
+			Assert::IsTrue(output.find("float a = 0;") != std::string::npos);
+
+			// a macro does not expand itself again, # makes a string
+			Assert::IsTrue(preprocessor.preprocess("other.hlsl", "#define A B\n#define B A\n#define STR(x) #x\nA STR(a \"b\")\n", {}, output));
+			Assert::AreEqual(std::string("#line 4 \"other.hlsl\"\nA \"a \\\"b\\\"\"\n"), output);
+
+			// as in cpp the brackets of a call can start in the next line, without them the name stays
+			Assert::IsTrue(preprocessor.preprocess("other.hlsl", "#define F(x) x+1\nF\n\n(2) F\n-F\n", {}, output));
+			Assert::AreEqual(std::string("#line 2 \"other.hlsl\"\n2+1 F -F\n"), output);
+
+			std::pair<std::string, std::string> errors[] =
+			{
+				{ "#if 1 / 0\n#endif\n", "other.hlsl(1): division by zero in #if" },
+				{ "\n#ifdef X\n", "other.hlsl(2): missing #endif" },
+				{ "#include \"missing.hlsl\"\n", "other.hlsl(1): could not open \"missing.hlsl\"" },
+				{ "#define F(a) a\nF(1, 2)\n", "other.hlsl(2): macro F takes 1 arguments, not 2" },
+				{ "#error stop\n", "other.hlsl(1): #error stop" },
+			};
+			for (auto &[code, error] : errors)
+			{
+				Assert::IsFalse(preprocessor.preprocess("other.hlsl", code, {}, output));
+				Assert::AreEqual(error, preprocessor.getError());
+			}
+		}
+
+		// events come from several threads, are summed per phase and written as json
+		TEST_METHOD(TestShaderTimings)
+		{
+			ShaderTimings timings;
+			timings.setShader("pshader_sdf.hlsl ps_main");
+			timings.add({ ShaderTimings::Phase::Load, {}, "sdf_ops.hlsl", 0.001, 2000, 0, 0, false });
+			timings.add({ ShaderTimings::Phase::Load, {}, "sdf_ops.hlsl", 0.0005, 2000, 0, 0, true });
+			timings.add({ ShaderTimings::Phase::Scan, {}, "pshader_sdf.hlsl", 0.002, 4000, 3, 0, false });
+
+			std::vector<std::thread> threads;
+			for (unsigned i = 0; i < 4; ++i)
+			{
+				threads.emplace_back([&, i]()
+				{
+					timings.add({ ShaderTimings::Phase::Compile, "bloom.hlsl cs_main" + std::to_string(i), "bloom.hlsl", 0.01, 100, 0, i, false });
+				});
+			}
+			for (auto &thread : threads)
+			{
+				thread.join();
+			}
+
+			auto events = timings.getEvents();
+			Assert::AreEqual(size_t(7), events.size());
+			Assert::AreEqual(std::string("pshader_sdf.hlsl ps_main"), events[0].shader);
+			Assert::IsTrue(close(static_cast<float>(timings.getTotal(ShaderTimings::Phase::Load)), 0.0015f));
+			Assert::IsTrue(close(static_cast<float>(timings.getTotal(ShaderTimings::Phase::Compile)), 0.04f));
+			Assert::AreEqual(0.0, timings.getTotal(ShaderTimings::Phase::Disassemble));
+
+			auto summary = timings.formatSummary();
+			Assert::IsTrue(summary.find("load: 1.50 ms, 2 times (1 cached), 4000 bytes\n") != std::string::npos);
+			Assert::IsTrue(summary.find("scan: 2.00 ms, 1 times, 4000 bytes, 3 variables\n") != std::string::npos);
+			Assert::IsTrue(summary.find("disassemble") == std::string::npos);
+
+			auto json = timings.toJson();
+			Assert::IsTrue(json.find("\"compile\": { \"ms\": 40, \"count\": 4,") != std::string::npos);
+			Assert::IsTrue(json.find("{ \"phase\": \"scan\", \"shader\": \"pshader_sdf.hlsl ps_main\", \"file\": \"pshader_sdf.hlsl\", \"ms\": 2, \"bytes\": 4000, \"variables\": 3, \"thread\": 0, \"cached\": false }") != std::string::npos);
+			Assert::AreEqual(std::string("\"a\\\"b\\\\c\\n\""), quoteJson("a\"b\\c\n"));
+
+			timings.clear();
+			Assert::AreEqual(size_t(0), timings.getEvents().size());
+		}
+
+		TEST_METHOD(TestProfiler)
+		{
+			auto outer = Profiler::intern("outer");
+			auto inner = Profiler::intern("inner");
+			Assert::AreEqual(outer, Profiler::intern("outer"));
+			Assert::IsTrue(outer != inner);
+			Assert::AreEqual(std::string_view("inner"), Profiler::getName(inner));
+
+			Profiler profiler(std::make_unique<TscClock>(), 16);
+			profiler.setThreadName("main");
+			{
+				Profiler::Scope outer_scope(&profiler, outer);
+				for (unsigned i = 0; i < 3; ++i)
+				{
+					Profiler::Scope inner_scope(&profiler, inner);
+				}
+			}
+			// nothing open, ignored
+			profiler.end();
+
+			std::thread worker([&]()
+			{
+				profiler.setThreadName("worker");
+				for (unsigned i = 0; i < 20; ++i)
+				{
+					Profiler::Scope inner_scope(&profiler, inner);
+				}
+			});
+			worker.join();
+			profiler.addEvent("gpu", outer, 0, 100, 50);
+
+			auto capture = profiler.capture();
+			Assert::AreEqual(size_t(3), capture.tracks.size());
+			auto &main_track = capture.tracks[0];
+			Assert::AreEqual(std::string("main"), main_track.name);
+			Assert::AreEqual(size_t(4), main_track.events.size());
+			// the inner ones end first
+			Assert::AreEqual(inner, main_track.events[0].scope);
+			Assert::AreEqual(1u, main_track.events[0].depth);
+			Assert::AreEqual(outer, main_track.events[3].scope);
+			Assert::AreEqual(0u, main_track.events[3].depth);
+			Assert::IsTrue(main_track.events[3].begin <= main_track.events[0].begin && main_track.events[0].end <= main_track.events[3].end);
+
+			// 20 events do not fit into 16
+			auto &worker_track = capture.tracks[1];
+			Assert::AreEqual(std::string("worker"), worker_track.name);
+			Assert::AreEqual(uint64_t(20), worker_track.events.size() + worker_track.dropped);
+			Assert::IsTrue(worker_track.dropped >= 4);
+
+			auto &gpu_track = capture.tracks[2];
+			Assert::AreEqual(std::string("gpu"), gpu_track.name);
+			Assert::AreEqual(size_t(1), gpu_track.events.size());
+			Assert::AreEqual(uint64_t(100), gpu_track.events[0].end);
+
+			auto trace = Profiler::toChromeTrace(capture);
+			Assert::IsTrue(trace.find("{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 2, \"args\": { \"name\": \"worker\" } }") != std::string::npos);
+			Assert::IsTrue(trace.find("{ \"name\": \"inner\", \"ph\": \"X\", \"ts\": ") != std::string::npos);
+			Assert::IsTrue(trace.find("\"dur\": 0.000, \"pid\": 1, \"tid\": 3 }") != std::string::npos);
+
+			// the finished worker is gone, the rest only has what is new
+			{
+				Profiler::Scope outer_scope(&profiler, outer);
+			}
+			capture = profiler.capture();
+			Assert::AreEqual(size_t(2), capture.tracks.size());
+			Assert::AreEqual(size_t(1), capture.tracks[0].events.size());
+			Assert::AreEqual(size_t(0), capture.tracks[1].events.size());
+		}
+
+		TEST_METHOD(TestProfilerThreadReuse)
+		{
+			auto scope = Profiler::intern("work");
+			Profiler profiler(nullptr, 16);
+			Profiler other(nullptr, 16);
+
+			// like the shader batches, new threads for every build and no capture in between
+			for (unsigned i = 0; i < 100; ++i)
+			{
+				std::thread worker([&]()
+				{
+					Profiler::Scope outer_scope(&profiler, scope);
+					// switching profilers keeps the track of the first one known as finished
+					Profiler::Scope other_scope(&other, scope);
+					Profiler::Scope inner_scope(&profiler, scope);
+				});
+				worker.join();
+			}
+
+			auto capture = profiler.capture();
+			Assert::IsTrue(capture.tracks.size() <= Profiler::max_finished_tracks + 1);
+			uint64_t events = capture.dropped;
+			for (auto &track : capture.tracks)
+			{
+				events += track.events.size() + track.dropped;
+			}
+			Assert::AreEqual(uint64_t(200), events);
+			Assert::IsTrue(other.capture().tracks.size() <= Profiler::max_finished_tracks + 1);
+
+			// all of them were captured, so the next threads take those tracks over
+			for (unsigned i = 0; i < 100; ++i)
+			{
+				std::thread worker([&]()
+				{
+					Profiler::Scope outer_scope(&profiler, scope);
+				});
+				worker.join();
+				Assert::IsTrue(profiler.capture().tracks.size() <= 1);
+			}
+		}
+
+		TEST_METHOD(TestFrameStats)
+		{
+			FrameStats stats(100);
+			Assert::IsFalse(stats.isReportDue());
+			Assert::AreEqual(uint64_t(0), stats.getSummary("frame").count);
+
+			// 250 samples, only the last 100 count: 150 to 249 ms
+			for (unsigned i = 0; i < 250; ++i)
+			{
+				stats.add("frame", i / 1000.0);
+			}
+			stats.add("Bloom 1", 0.002);
+
+			auto summary = stats.getSummary("frame");
+			Assert::AreEqual(uint64_t(250), summary.count);
+			Assert::AreEqual(size_t(100), summary.window);
+			Assert::IsTrue(close(static_cast<float>(summary.min), 0.150f));
+			Assert::IsTrue(close(static_cast<float>(summary.max), 0.249f));
+			Assert::IsTrue(close(static_cast<float>(summary.mean), 0.1995f));
+			Assert::IsTrue(close(static_cast<float>(summary.p50), 0.199f));
+			Assert::IsTrue(close(static_cast<float>(summary.p95), 0.244f));
+			Assert::IsTrue(close(static_cast<float>(summary.p99), 0.248f));
+			// of 0 to 99 ms: (100^2 - 1) / 12
+			Assert::IsTrue(close(static_cast<float>(summary.variance * 1e6), 833.25f));
+
+			auto summaries = stats.getSummaries();
+			Assert::AreEqual(size_t(2), summaries.size());
+			Assert::AreEqual(std::string("Bloom 1"), summaries[0].name);
+			Assert::AreEqual(0.0, summaries[0].variance);
+
+			auto csv = stats.toCsv();
+			Assert::IsTrue(csv.starts_with("scope,count,window,min_ms,mean_ms,p50_ms,p95_ms,p99_ms,max_ms,stddev_ms\n\"Bloom 1\",1,1,2,2,2,2,2,2,0\n"));
+			auto json = stats.toJson();
+			Assert::IsTrue(json.find("{ \"name\": \"Bloom 1\", \"count\": 1, \"window\": 1, \"min_ms\": 2,") != std::string::npos);
+			// the samples oldest first
+			Assert::IsTrue(json.find("\"samples_ms\": [150, 151, 152,") != std::string::npos);
+			Assert::IsTrue(stats.report().find("frame: mean 199.500 ms, min 150.000, p50 199.000, p95 244.000, p99 248.000, max 249.000, stddev 28.866 (100 samples)\n") != std::string::npos);
+
+			stats.setReportInterval(1e-9);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			Assert::IsTrue(stats.isReportDue());
+			stats.clear();
+			Assert::AreEqual(size_t(0), stats.getSummaries().size());
+		}
+
+		TEST_METHOD(TestMath3D)
+		{
+			using namespace Math3D;
+			static_assert(std::is_trivially_copyable_v<Vector2> && std::is_trivially_copyable_v<Vector3> && std::is_trivially_copyable_v<Vector4>);
+			static_assert(std::is_trivially_copyable_v<Quaternion> && std::is_trivially_copyable_v<Plane> && std::is_trivially_copyable_v<Matrix4x4>);
+			static_assert(alignof(Vector4) == 16 && alignof(Matrix4x4) == 16);
+			constexpr Vector3 constant(1.f, 2.f, 3.f);
+			static_assert(constant.y == 2.f);
+			constexpr Matrix4x4 identity = Matrix4x4::IdentityMatrix();
+			static_assert(identity.f22 == 1.f && identity.f23 == 0.f);
+
+			Matrix4x4 view = Matrix4x4::CameraMatrix(Vector3(1.f, 2.f, -3.f), Vector3(0.f, 1.f, 0.f));
+			Matrix4x4 projection = Matrix4x4::ProjectionMatrix(ToRadian(60.f), 16.f / 9.f, 1.f, 300.f);
+			Matrix4x4 full = view * projection;
+
+			// the same as the plain loop, to the bit
+			for (unsigned i = 0; i < 4; ++i)
+			{
+				for (unsigned j = 0; j < 4; ++j)
+				{
+					float expected = 0.f;
+					for (unsigned k = 0; k < 4; ++k)
+					{
+						expected += view[i][k] * projection[k][j];
+					}
+					Assert::AreEqual(expected, full[i][j]);
+					Assert::AreEqual(full[i][j], full.Transposed()[j][i]);
+				}
+			}
+
+			Matrix4x4 product = full * full.Inverted();
+			Matrix4x4 rotation = Matrix4x4::RotationAxisMatrix(Vector3(1.f, 2.f, 3.f), 0.7f);
+			Matrix4x4 rotation_inverse = rotation.Inverted();
+			for (unsigned i = 0; i < 4; ++i)
+			{
+				for (unsigned j = 0; j < 4; ++j)
+				{
+					Assert::IsTrue(close(product[i][j], identity[i][j]));
+					// a rotation is inverted by its transpose
+					Assert::IsTrue(close(rotation_inverse[i][j], rotation[j][i]));
+				}
+			}
+			Matrix4x4 singular = Matrix4x4::ScaleMatrix(1.f, 0.f, 1.f);
+			Assert::IsFalse(singular.Invert());
+			Assert::AreEqual(0.f, singular.f22);
+			Assert::AreEqual(0.f, singular.Inverted().f11);
+
+			// row vectors, with w = 1
+			Vector3 points[3] = { Vector3(0.f, 0.f, 0.f), Vector3(1.f, 2.f, 3.f), Vector3(-5.f, 0.5f, 10.f) };
+			Vector4 transformed[3];
+			full.TransformPoints(points, transformed, 3);
+			for (unsigned i = 0; i < 3; ++i)
+			{
+				Vector4 expected = Vector4(points[i].x, points[i].y, points[i].z, 1.f) * full;
+				Assert::IsTrue(expected == transformed[i]);
+				for (unsigned j = 0; j < 4; ++j)
+				{
+					Assert::IsTrue(close(transformed[i][j], points[i].x * full[0][j] + points[i].y * full[1][j] + points[i].z * full[2][j] + full[3][j]));
+				}
+			}
+		}
+
+		TEST_METHOD(TestDual)
+		{
+			using namespace hlsl;
+			// the value of the float version, and its central differences as the gradient
+			auto check = [](auto function, auto dual_function, float3 pos)
+			{
+				dual result = dual_function(dual3::position(pos));
+				Assert::IsTrue(close(function(pos), result.v));
+				const float h = 1e-3f;
+				for (unsigned axis = 0; axis < 3; ++axis)
+				{
+					float3 offset = float3(0.f);
+					offset[axis] = h;
+					float difference = (function(pos + offset) - function(pos - offset)) / (2.f * h);
+					Assert::IsTrue(close(difference, result.d[axis]));
+				}
+			};
+
+			// the same code runs on float3 and dual3
+			auto box = [](auto pos)
+			{
+				return sdBox(pos, float3(1.f, 0.5f, 0.5f));
+			};
+			check(box, box, float3(1.3f, 0.2f, -0.1f));
+			check(box, box, float3(1.3f, 0.8f, 0.9f));
+			check(box, box, float3(0.2f, 0.1f, -0.3f));
+
+			auto blend = [](auto pos)
+			{
+				return smin(sdSphere(pos - float3(0.5f, 0.f, 0.f), 0.5f), sdBox(pos + float3(0.5f, 0.f, 0.f), float3(0.4f, 0.4f, 0.4f)), 0.3f);
+			};
+			check(blend, blend, float3(0.f, 0.6f, 0.1f));
+			check(blend, blend, float3(1.2f, -0.3f, 0.4f));
+
+			auto sphere_fast = [](auto pos)
+			{
+				return sdSphereFast(pos, float4(0.f, 0.f, 1.f, 1.f), 0.5f);
+			};
+			check(sphere_fast, sphere_fast, float3(0.1f, 0.2f, -2.f));
+
+			auto rotated = [](float3 pos)
+			{
+				float2 xz = opRotate(float2(pos.x, pos.z), 0.7f);
+				return sdBox(float3(xz.x, pos.y, xz.y), float3(1.f, 0.5f, 0.5f));
+			};
+			auto rotated_dual = [](const dual3 &pos)
+			{
+				dual2 xz = opRotate(dual2(pos.x, pos.z), 0.7f);
+				return sdBox(dual3(xz.x, pos.y, xz.y), float3(1.f, 0.5f, 0.5f));
+			};
+			check(rotated, rotated_dual, float3(1.1f, 0.3f, 0.9f));
+
+			auto noise = [](auto pos)
+			{
+				return snoise(pos);
+			};
+			check(noise, noise, float3(0.3f, 1.7f, -2.2f));
+			check(noise, noise, float3(12.5f, -3.1f, 0.7f));
+
+			auto blends = [](auto pos)
+			{
+				auto sphere = sdSphere(pos - float3(0.5f, 0.f, 0.f), 0.5f);
+				auto plane = sdPlane(pos, float3(0.f, 1.f, 0.f));
+				return smax1(sphere, plane, 0.2f) + smax2(sphere, plane, 0.3f) + opShell(sphere, 0.1f, 0.2f);
+			};
+			check(blends, blends, float3(0.6f, 0.1f, 0.2f));
+			check(blends, blends, float3(-0.3f, 0.4f, -0.5f));
+
+			auto repeated = [](float3 pos)
+			{
+				float2 xz = opRepLim(float2(pos.x, pos.z), float2(2.f, 2.f), float2(3.f, 3.f));
+				return sdBox(float3(xz.x, pos.y, xz.y), float3(0.4f, 0.4f, 0.4f));
+			};
+			auto repeated_dual = [](const dual3 &pos)
+			{
+				dual2 xz = opRepLim(dual2(pos.x, pos.z), float2(2.f, 2.f), float2(3.f, 3.f));
+				return sdBox(dual3(xz.x, pos.y, xz.y), float3(0.4f, 0.4f, 0.4f));
+			};
+			check(repeated, repeated_dual, float3(1.1f, 0.3f, 2.1f));
+			check(repeated, repeated_dual, float3(-5.3f, 0.2f, 0.4f));
+
+			// the geometry step of the ground plane, along a ray
+			GeometryInput geometry = {};
+			geometry.dir = float4(0.3f, -0.8f, 0.5f, 1.f);
+			auto ground = [&](float3 pos)
+			{
+				MaterialOutput material_output = {};
+				float distance = 3e38f;
+				geometry.pos = pos;
+				map_groundplane(geometry, material_output, true, distance);
+				return distance;
+			};
+			auto ground_dual = [&](const dual3 &pos)
+			{
+				dual distance = 3e38f;
+				map_groundplane(geometry, pos, distance);
+				return distance;
+			};
+			check(ground, ground_dual, float3(0.2f, 1.5f, -0.4f));
+		}
+
+		// map_gradient of every scene against the geometry step of its map
+		TEST_METHOD(TestCPUSceneGradients)
+		{
+			using namespace hlsl;
+			for (auto name : getCPUSceneNames())
+			{
+				auto scene = createCPUScene(name);
+				scene->setParameters(1.3f);
+
+				GeometryInput geometry = {};
+				geometry.dir = float4(0.f, 0.f, 1.f, 0.f);
+				MarchingInput march = {};
+				auto map = [&](float3 pos)
+				{
+					MaterialInput material_input = {};
+					MaterialOutput material_output = {};
+					float distance = 3e38f;
+					geometry.pos = pos;
+					scene->map(geometry, march, material_input, material_output, true, distance);
+					return distance;
+				};
+
+				for (float3 pos : { float3(0.3f, 0.9f, -0.2f), float3(-0.6f, 1.4f, 0.5f), float3(0.7f, 0.35f, 0.6f) })
+				{
+					dual result = 3e38f;
+					geometry.pos = pos;
+					Assert::IsTrue(scene->map_gradient(geometry, dual3::position(pos), march, result));
+					Assert::IsTrue(close(map(pos), result.v));
+					const float h = 1e-3f;
+					for (unsigned axis = 0; axis < 3; ++axis)
+					{
+						float3 offset = float3(0.f);
+						offset[axis] = h;
+						float difference = (map(pos + offset) - map(pos - offset)) / (2.f * h);
+						Assert::IsTrue(close(difference, result.d[axis]));
+					}
+				}
+			}
+		}
+
+		TEST_METHOD(TestCameraRays)
+		{
+			using namespace Math3D;
+			Camera camera;
+			camera.SetCameraMode(Camera::CameraMode::FPS);
+			camera.SetEye(Vector3(0.f, 2.f, -3.f));
+			camera.SetLookat(Vector3(1.f, 1.f, 0.f));
+			camera.SetRoll(0.3f);
+			camera.SetFOVY(ToRadian(60.f));
+			camera.SetAspect(16.f / 9.f);
+
+			// the same vectors the frustum edges give
+			Camera::RayBasis basis = camera.GetRayBasis();
+			Vector3 right = (camera.GetFrustrumEdge(0) - camera.GetFrustrumEdge(3)) * 0.5f;
+			Vector3 top = (camera.GetFrustrumEdge(0) - camera.GetFrustrumEdge(1)) * 0.5f;
+			for (unsigned i = 0; i < 3; ++i)
+			{
+				Assert::IsTrue(close(basis.right[i], right[i]));
+				Assert::IsTrue(close(basis.top[i], top[i]));
+			}
+
+			// odd sizes, so some pixels go past the 4 wide path
+			const unsigned width = 64, height = 32;
+			TileScheduler::Tile tile = { 5, 2, 7, 3 };
+			Camera::RayVectors origins, dirs;
+			Camera::RayFootprints footprints;
+			basis.GenerateRays(tile, width, height, origins, dirs, footprints);
+			Assert::AreEqual(size_t(21), dirs.x.size());
+			Assert::AreEqual(size_t(21), footprints.bottom.z.size());
+
+			for (unsigned y = 0; y < tile.height; ++y)
+			{
+				for (unsigned x = 0; x < tile.width; ++x)
+				{
+					// the way the pixel shader gets there, to the bit
+					float screen_x = (static_cast<float>(tile.x + x) + 0.5f) / width * 2.f - 1.f;
+					float screen_y = 1.f - (static_cast<float>(tile.y + y) + 0.5f) / height * 2.f;
+					Vector3 dir = basis.front + basis.right * screen_x + basis.top * screen_y;
+					float invlen = 1.f / sqrtf(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z);
+
+					size_t index = y * tile.width + x;
+					Assert::AreEqual(basis.eye.y, origins.y[index]);
+					Assert::AreEqual(dir.x * invlen, dirs.x[index]);
+					Assert::AreEqual(dir.y * invlen, dirs.y[index]);
+					Assert::AreEqual(dir.z * invlen, dirs.z[index]);
+					Assert::AreEqual(basis.right.x * (2.f / width) * invlen, footprints.right.x[index]);
+					Assert::AreEqual(basis.top.y * (-2.f / height) * invlen, footprints.bottom.y[index]);
+					Assert::IsTrue(close(dirs.x[index] * dirs.x[index] + dirs.y[index] * dirs.y[index] + dirs.z[index] * dirs.z[index], 1.f));
+				}
+			}
+		}
+
+		TEST_METHOD(TestCPURendererHardShadows)
+		{
+			auto scene = createCPUScene("sdf_scene_gems");
+			Assert::IsTrue(scene != nullptr);
+
+			const unsigned width = 48, height = 27;
+			Camera camera;
+			setupCPUCamera(camera, width, height);
+			auto render = [&](CPURenderer &renderer)
+			{
+				renderer.setScene(scene.get());
+				renderer.setThreadCount(1);
+				Assert::IsTrue(renderer.render(camera, width, height));
+				return frameSum(renderer.getFramebuffer());
+			};
+
+			// the same image as with the shadow rays queued like in the shader
+			CPURenderer hard;
+			float3 hard_sum = render(hard);
+			for (unsigned k = 0; k < 3; ++k)
+			{
+				Assert::IsTrue(abs(hard_sum[k] - gems_reference_sum[k]) < 0.05f);
+			}
+
+			// the penumbra darkens it, and going back to 0 gives the same image to the bit
+			CPURenderer toggled;
+			toggled.setSoftShadows(8.f);
+			float3 soft_sum = render(toggled);
+			Assert::IsTrue(soft_sum.x < hard_sum.x - 1.f);
+			toggled.setSoftShadows(0.f);
+			render(toggled);
+			Assert::IsTrue(sameFrame(hard.getFramebuffer(), toggled.getFramebuffer()));
+		}
+
+		TEST_METHOD(TestCPURendererRayCulling)
+		{
+			auto scene = createCPUScene("sdf_scene_gems");
+			Assert::IsTrue(scene != nullptr);
+
+			Camera camera;
+			auto render = [&](CPURenderer &renderer, unsigned width, unsigned height)
+			{
+				setupCPUCamera(camera, width, height);
+				renderer.setScene(scene.get());
+				renderer.setThreadCount(1);
+				Assert::IsTrue(renderer.render(camera, width, height));
+				return frameSum(renderer.getFramebuffer());
+			};
+
+			// both at 0 trace all rays, as before there were any
+			CPURenderer traced;
+			traced.setContributionCutoff(0.f);
+			traced.setRussianRoulette(0.f);
+			float3 traced_sum = render(traced, 48, 27);
+			for (unsigned k = 0; k < 3; ++k)
+			{
+				Assert::IsTrue(abs(traced_sum[k] - gems_reference_sum[k]) < 0.05f);
+			}
+			Assert::AreEqual(uint64_t(0), traced.getStats().rays_culled);
+			Assert::AreEqual(uint64_t(0), traced.getStats().rays_dropped);
+
+			// bigger, so enough rays get culled
+			const unsigned width = 160, height = 90;
+			CPURenderer reference;
+			float3 reference_sum = render(reference, width, height);
+			Assert::AreEqual(uint64_t(0), reference.getStats().rays_culled);
+
+			// the cutoff ends the weak rays, and their light with them
+			CPURenderer cutoff;
+			cutoff.setContributionCutoff(0.3f);
+			float3 cutoff_sum = render(cutoff, width, height);
+			Assert::IsTrue(cutoff.getStats().rays_culled > 0);
+			Assert::IsTrue(cutoff.getStats().rays < reference.getStats().rays);
+			Assert::IsTrue(cutoff_sum.x + cutoff_sum.y + cutoff_sum.z < reference_sum.x + reference_sum.y + reference_sum.z - 5.f);
+
+			// the roulette ends some too, but the survivors make up for them on average
+			CPURenderer roulette;
+			roulette.setRussianRoulette(0.6f);
+			float3 roulette_sum = render(roulette, width, height);
+			Assert::IsTrue(roulette.getStats().rays_culled > 0);
+			for (unsigned k = 0; k < 3; ++k)
+			{
+				Assert::IsTrue(abs(roulette_sum[k] - reference_sum[k]) < 1.f);
+			}
+
+			// and back at 0, the same image as before
+			cutoff.setContributionCutoff(0.f);
+			render(cutoff, width, height);
+			Assert::IsTrue(sameFrame(reference.getFramebuffer(), cutoff.getFramebuffer()));
+			Assert::AreEqual(uint64_t(0), cutoff.getStats().rays_culled);
+			roulette.setRussianRoulette(0.f);
+			render(roulette, width, height);
+			Assert::IsTrue(sameFrame(reference.getFramebuffer(), roulette.getFramebuffer()));
+		}
+
+		TEST_METHOD(TestCPURendererConePass)
+		{
+			auto scene = createCPUScene("sdf_scene_gems");
+			Assert::IsTrue(scene != nullptr);
+
+			// not a multiple of the blocks, so there are partial ones at the edges
+			const unsigned width = 100, height = 54;
+			Camera camera;
+			setupCPUCamera(camera, width, height);
+
+			CPURenderer cold;
+			cold.setScene(scene.get());
+			cold.setThreadCount(1);
+			cold.setConeBlockSize(0);
+			Assert::IsTrue(cold.render(camera, width, height));
+			Assert::AreEqual(uint64_t(0), cold.getStats().cone_iterations);
+			auto &cold_distances = cold.getPrimaryDistances();
+
+			for (unsigned block_size : { 8u, 4u })
+			{
+				CPURenderer cone;
+				cone.setScene(scene.get());
+				cone.setThreadCount(1);
+				cone.setConeBlockSize(block_size);
+				Assert::IsTrue(cone.render(camera, width, height));
+				Assert::IsTrue(cone.getStats().cone_iterations > 0);
+				Assert::IsTrue(cone.getStats().iterations < cold.getStats().iterations);
+
+				// no ray may start past the surface a march from the eye finds
+				auto &distances = cone.getPrimaryDistances();
+				Assert::AreEqual(cold_distances.size(), distances.size());
+				unsigned skipped = 0;
+				for (size_t i = 0; i < distances.size(); ++i)
+				{
+					Assert::AreEqual(0.f, cold_distances[i].start);
+					if (cold_distances[i].hit >= 0.f)
+					{
+						Assert::IsTrue(distances[i].start <= cold_distances[i].hit);
+					}
+					skipped += distances[i].start > 0.f;
+				}
+				Assert::IsTrue(skipped > 0);
+
+				// the hits move by less than dist_eps, which barely shows
+				auto &expected = cold.getFramebuffer();
+				auto &actual = cone.getFramebuffer();
+				for (size_t i = 0; i < expected.size(); ++i)
+				{
+					for (unsigned k = 0; k < 4; ++k)
+					{
+						Assert::IsTrue(abs(expected[i][k] - actual[i][k]) < 1e-3f);
+					}
+				}
+			}
+		}
+
+		TEST_METHOD(TestCPURendererTemporal)
+		{
+			auto scene = createCPUScene("sdf_scene_gyroid");
+			Assert::IsTrue(scene != nullptr);
+
+			const unsigned width = 160, height = 90;
+			Camera camera;
+			setupCPUCamera(camera, width, height);
+
+			CPURenderer cold;
+			cold.setScene(scene.get());
+			cold.setThreadCount(1);
+			Assert::IsTrue(cold.render(camera, width, height));
+
+			// the same view twice, the second frame starts from the hits of the first
+			CPURenderer warm;
+			warm.setScene(scene.get());
+			warm.setThreadCount(1);
+			warm.setTemporalCache(true);
+			Assert::IsTrue(warm.render(camera, width, height));
+			Assert::AreEqual(uint64_t(0), warm.getStats().temporal_hits);
+			Assert::IsTrue(warm.render(camera, width, height));
+			Assert::IsTrue(warm.getStats().temporal_hits > 0);
+			Assert::AreEqual(uint64_t(width) * height, warm.getStats().temporal_hits + warm.getStats().temporal_misses);
+			Assert::IsTrue(warm.getStats().temporal_iterations_saved > 0);
+
+			// only grazing hits on the thin shell may end elsewhere, 0.04% of the pixels
+			auto &expected = cold.getFramebuffer();
+			auto &actual = warm.getFramebuffer();
+			Assert::AreEqual(expected.size(), actual.size());
+			unsigned different = 0;
+			for (size_t i = 0; i < expected.size(); ++i)
+			{
+				if (abs(expected[i].x - actual[i].x) > 0.01f || abs(expected[i].y - actual[i].y) > 0.01f || abs(expected[i].z - actual[i].z) > 0.01f)
+				{
+					++different;
+				}
+			}
+			Assert::IsTrue(different <= width * height * 4 / 10000);
+		}
+
+		TEST_METHOD(TestCPURendererTemporalResize)
+		{
+			auto scene = createCPUScene("sdf_scene_gems");
+			Assert::IsTrue(scene != nullptr);
+
+			CPURenderer renderer;
+			renderer.setScene(scene.get());
+			renderer.setThreadCount(1);
+			renderer.setTemporalCache(true);
+
+			Camera camera;
+			setupCPUCamera(camera, 64, 36);
+			Assert::IsTrue(renderer.render(camera, 64, 36));
+			Assert::IsTrue(renderer.render(camera, 64, 36));
+			Assert::IsTrue(renderer.getStats().temporal_hits > 0);
+
+			// the history is from another size, so all pixels start cold
+			setupCPUCamera(camera, 48, 27);
+			Assert::IsTrue(renderer.render(camera, 48, 27));
+			Assert::AreEqual(uint64_t(0), renderer.getStats().temporal_hits);
+			Assert::AreEqual(uint64_t(48 * 27), renderer.getStats().temporal_misses);
+			Assert::AreEqual(uint64_t(0), renderer.getStats().temporal_iterations_saved);
+			for (unsigned k = 0; k < 3; ++k)
+			{
+				Assert::IsTrue(abs(frameSum(renderer.getFramebuffer())[k] - gems_reference_sum[k]) < 0.05f);
+			}
+
+			// and the next frame at that size uses the history again
+			Assert::IsTrue(renderer.render(camera, 48, 27));
+			Assert::IsTrue(renderer.getStats().temporal_hits > 0);
+		}
+
+		TEST_METHOD(TestRayQueue)
+		{
+			struct Ray
+			{
+				float weight;
+				unsigned id;
+			};
+
+			RayQueue<Ray, 8> queue;
+			Assert::IsTrue(queue.empty());
+			for (unsigned id = 0; id < 8; ++id)
+			{
+				Assert::IsTrue(queue.push({ 0.1f + ((id * 5) % 8) * 0.1f, id }));
+			}
+			Assert::AreEqual(8u, queue.size());
+
+			// all slots taken, the new ray takes the place of the weakest
+			Assert::IsFalse(queue.push({ 0.55f, 8 }));
+			// and one weaker than all of them is the one dropped
+			Assert::IsFalse(queue.push({ 0.05f, 9 }));
+			Assert::AreEqual(8u, queue.size());
+
+			// strongest first, without id 0 (weight 0.1) and 9
+			std::vector<unsigned> order;
+			float last = 1e10f;
+			while (!queue.empty())
+			{
+				Ray ray = queue.pop();
+				Assert::IsTrue(ray.weight <= last);
+				last = ray.weight;
+				order.push_back(ray.id);
+			}
+			std::vector<unsigned> expected = { 3, 6, 1, 8, 4, 7, 2, 5 };
+			Assert::IsTrue(order == expected);
+		}
+
 	};
 }